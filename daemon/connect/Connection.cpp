@@ -896,6 +896,29 @@ void Connection::ReadBuffer(char** buffer, int *bufLen)
 	m_bufAvail = 0;
 };
 
+/*
+ * Puts data back into the read buffer, the data is returned again by the next read operation.
+ */
+void Connection::UnreadBuffer(const char* buffer, int bufLen)
+{
+	if (bufLen <= 0)
+	{
+		return;
+	}
+
+	int offset = m_bufAvail > 0 ? (int)(m_bufPtr - m_readBuf) : 0;
+	if (bufLen + m_bufAvail + 1 > m_readBuf.Size())
+	{
+		m_readBuf.Reserve(bufLen + m_bufAvail + 1);
+	}
+
+	memmove(m_readBuf + bufLen, m_readBuf + offset, m_bufAvail);
+	memcpy(m_readBuf, buffer, bufLen);
+	m_bufPtr = m_readBuf;
+	m_bufAvail += bufLen;
+	m_readBuf[m_bufAvail] = '\0';
+}
+
 void Connection::Cancel()
 {
 	debug("Cancelling connection");
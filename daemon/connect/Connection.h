@@ -65,6 +65,7 @@ public:
 	int TryRecv(char* buffer, int size);
 	char* ReadLine(char* buffer, int size, int* bytesRead);
 	void ReadBuffer(char** buffer, int *bufLen);
+	void UnreadBuffer(const char* buffer, int bufLen);
 	int WriteLine(const char* buffer);
 	std::unique_ptr<Connection> Accept();
 	void Cancel();
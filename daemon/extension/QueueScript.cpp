@@ -192,6 +192,7 @@ void QueueScriptController::AddMessage(Message::EKind kind, const char* text)
 				if (nzbInfo)
 				{
 					nzbInfo->GetParameters()->SetParameter(param, value + 1);
+					nzbInfo->SetChanged(true);
 				}
 			}
 			else
@@ -207,6 +208,7 @@ void QueueScriptController::AddMessage(Message::EKind kind, const char* text)
 			if (nzbInfo)
 			{
 				nzbInfo->SetFinalDir(msgText + 6 + 10);
+				nzbInfo->SetChanged(true);
 			}
 		}
 		else if (!strncmp(msgText + 6, "MARK=BAD", 8))
@@ -218,6 +220,7 @@ void QueueScriptController::AddMessage(Message::EKind kind, const char* text)
 			{
 				nzbInfo->PrintMessage(Message::mkWarning, "Marking %s as bad", *m_nzbName);
 				nzbInfo->SetMarkStatus(NzbInfo::ksBad);
+				nzbInfo->SetChanged(true);
 			}
 		}
 		else
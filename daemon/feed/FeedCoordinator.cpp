@@ -34,7 +34,11 @@
 
 std::unique_ptr<RegEx>& FeedCoordinator::FilterHelper::GetRegEx(int id)
 {
-	m_regExes.resize(id);
+	// compiled regexes are shared by all items of the feed
+	if ((int)m_regExes.size() < id)
+	{
+		m_regExes.resize(id);
+	}
 	return m_regExes[id - 1];
 }
 
@@ -390,10 +394,11 @@ void FeedCoordinator::FilterFeed(FeedInfo* feedInfo, FeedItemList* feedItems)
 		feedItemInfo.SetDupeMode(dmScore);
 		feedItemInfo.SetFeedFilterHelper(&filterHelper);
 		feedItemInfo.BuildDupeKey(nullptr, nullptr, nullptr, nullptr);
-		if (feedFilter)
-		{
-			feedFilter->Match(feedItemInfo);
-		}
+	}
+
+	if (feedFilter)
+	{
+		feedFilter->Match(*feedItems);
 	}
 }
 
@@ -24,15 +24,216 @@
 #include "Util.h"
 #include "FeedFilter.h"
 
+static const char* WORD_SEPARATORS = " !\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~";
+
+void FeedFilter::WordCache::Reset()
+{
+	for (Entry& entry : m_entries)
+	{
+		entry.valid = false;
+	}
+}
+
+FeedFilter::WordList* FeedFilter::WordCache::GetWords(EField field, const char* strValue)
+{
+	Entry& entry = m_entries[field];
+	if (!entry.valid)
+	{
+		SplitWords(strValue, entry.buffer, entry.words);
+		entry.valid = true;
+	}
+	return &entry.words;
+}
+
+uint32 FeedFilter::PatternMatcher::HashWord(const char* word)
+{
+	BString<1024> loWord = word;
+	for (char* p = loWord; *p; p++) *p = tolower(*p); // convert string to lowercase
+	return Util::HashBJ96(loWord, loWord.Length(), 0);
+}
+
+int FeedFilter::PatternMatcher::AddPattern(FieldPatterns& fieldPatterns, const char* text)
+{
+	int pattern = (int)m_patterns.size();
+	m_patterns.emplace_back(text);
+	m_found.push_back(false);
+	fieldPatterns.patterns.push_back(pattern);
+	return pattern;
+}
+
+int FeedFilter::PatternMatcher::AddWord(EField field, const char* word)
+{
+	FieldPatterns& fieldPatterns = m_fields[field];
+	int pattern = AddPattern(fieldPatterns, word);
+	fieldPatterns.words.emplace(HashWord(word), pattern);
+	return pattern;
+}
+
+int FeedFilter::PatternMatcher::AddSubstring(EField field, const char* substring)
+{
+	FieldPatterns& fieldPatterns = m_fields[field];
+	int pattern = AddPattern(fieldPatterns, substring);
+
+	// add the substring into the trie
+	int node = 0;
+	for (const char* p = substring; *p; p++)
+	{
+		char ch = tolower(*p);
+		int next = 0;
+		for (std::pair<char, int>& edge : fieldPatterns.nodes[node].next)
+		{
+			if (edge.first == ch)
+			{
+				next = edge.second;
+				break;
+			}
+		}
+
+		if (!next)
+		{
+			next = (int)fieldPatterns.nodes.size();
+			fieldPatterns.nodes.emplace_back();
+			fieldPatterns.nodes[node].next.emplace_back(ch, next);
+		}
+
+		node = next;
+	}
+
+	fieldPatterns.nodes[node].patterns.push_back(pattern);
+	return pattern;
+}
+
+/*
+ * Calculates failure links of the automaton: for each node the node of the longest
+ * proper suffix, which is also in the trie. Each node also gets the patterns of
+ * its failure node since these patterns end at the same position.
+ */
+void FeedFilter::PatternMatcher::Compile()
+{
+	for (FieldPatterns& fieldPatterns : m_fields)
+	{
+		std::vector<Node>& nodes = fieldPatterns.nodes;
+		std::deque<int> queue;
+
+		for (std::pair<char, int>& edge : nodes[0].next)
+		{
+			queue.push_back(edge.second);
+		}
+
+		while (!queue.empty())
+		{
+			int node = queue.front();
+			queue.pop_front();
+
+			for (std::pair<char, int>& edge : nodes[node].next)
+			{
+				int child = edge.second;
+				int fail = FindNext(fieldPatterns, nodes[node].fail, edge.first);
+				nodes[child].fail = fail;
+				nodes[child].patterns.insert(nodes[child].patterns.end(),
+					nodes[fail].patterns.begin(), nodes[fail].patterns.end());
+				queue.push_back(child);
+			}
+		}
+	}
+}
+
+int FeedFilter::PatternMatcher::FindNext(FieldPatterns& fieldPatterns, int node, char ch)
+{
+	while (true)
+	{
+		for (std::pair<char, int>& edge : fieldPatterns.nodes[node].next)
+		{
+			if (edge.first == ch)
+			{
+				return edge.second;
+			}
+		}
+
+		if (node == 0)
+		{
+			return 0;
+		}
+
+		node = fieldPatterns.nodes[node].fail;
+	}
+}
+
+void FeedFilter::PatternMatcher::Reset()
+{
+	for (FieldPatterns& fieldPatterns : m_fields)
+	{
+		fieldPatterns.searched = false;
+	}
+}
+
+bool FeedFilter::PatternMatcher::Match(EField field, int pattern, const char* strValue)
+{
+	FieldPatterns& fieldPatterns = m_fields[field];
+	if (!fieldPatterns.searched)
+	{
+		Search(fieldPatterns, strValue,
+			fieldPatterns.words.empty() ? nullptr : m_wordCache->GetWords(field, strValue));
+		fieldPatterns.searched = true;
+	}
+	return m_found[pattern];
+}
+
+void FeedFilter::PatternMatcher::Search(FieldPatterns& fieldPatterns, const char* strValue, WordList* words)
+{
+	for (int pattern : fieldPatterns.patterns)
+	{
+		m_found[pattern] = false;
+	}
+
+	if (words)
+	{
+		for (const char* word : *words)
+		{
+			std::pair<std::unordered_multimap<uint32, int>::iterator, std::unordered_multimap<uint32, int>::iterator> range =
+				fieldPatterns.words.equal_range(HashWord(word));
+			for (std::unordered_multimap<uint32, int>::iterator it = range.first; it != range.second; it++)
+			{
+				if (!strcasecmp(word, m_patterns[it->second]))
+				{
+					m_found[it->second] = true;
+				}
+			}
+		}
+	}
+
+	if (fieldPatterns.nodes.size() > 1)
+	{
+		int node = 0;
+		for (const char* p = strValue; *p; p++)
+		{
+			node = FindNext(fieldPatterns, node, tolower(*p));
+			for (int pattern : fieldPatterns.nodes[node].patterns)
+			{
+				m_found[pattern] = true;
+			}
+		}
+	}
+}
+
+void FeedFilter::SplitWords(const char* strValue, CString& buffer, WordList& words)
+{
+	buffer = strValue;
+	words.clear();
+
+	Tokenizer tok(buffer, WORD_SEPARATORS, true);
+	while (const char* word = tok.Next())
+	{
+		words.push_back(word);
+	}
+}
+
 bool FeedFilter::Term::Match(FeedItemInfo& feedItemInfo)
 {
 	const char* strValue = nullptr;
 	int64 intValue = 0;
 
-	if (!GetFieldData(m_field, &feedItemInfo, &strValue, &intValue))
-	{
-		return false;
-	}
+	GetFieldData(&feedItemInfo, &strValue, &intValue);
 
 	bool match = MatchValue(strValue, intValue);
 
@@ -49,6 +250,9 @@ bool FeedFilter::Term::MatchValue(const char* strValue, int64 intValue)
 	double fFloatValue = (double)intValue;
 	BString<100> intBuf;
 
+	// words of attributes and of numeric fields are not shared between terms
+	bool cachedWords = strValue && m_fieldId != ffAttr;
+
 	if (m_command < fcEqual && !strValue)
 	{
 		intBuf.Format("%" PRId64, intValue);
@@ -64,7 +268,7 @@ bool FeedFilter::Term::MatchValue(const char* strValue, int64 intValue)
 	switch (m_command)
 	{
 		case fcText:
-			return MatchText(strValue);
+			return MatchText(strValue, cachedWords);
 
 		case fcRegex:
 			return MatchRegex(strValue);
@@ -89,76 +293,151 @@ bool FeedFilter::Term::MatchValue(const char* strValue, int64 intValue)
 	}
 }
 
-bool FeedFilter::Term::MatchText(const char* strValue)
+void FeedFilter::Term::CompileText()
 {
-	const char* WORD_SEPARATORS = " !\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~";
-
 	// first check if we should make word-search or substring-search
 	int paramLen = strlen(m_param);
-	bool substr = paramLen >= 2 && m_param[0] == '*' && m_param[paramLen-1] == '*';
-	if (!substr)
+	m_substr = paramLen >= 2 && m_param[0] == '*' && m_param[paramLen-1] == '*';
+	if (!m_substr)
 	{
 		for (const char* p = m_param; *p; p++)
 		{
 			char ch = *p;
 			if (strchr(WORD_SEPARATORS, ch) && ch != '*' && ch != '?' && ch != '#')
 			{
-				substr = true;
+				m_substr = true;
 				break;
 			}
 		}
 	}
 
-	bool match = false;
+	// literal patterns of text fields can be searched together with patterns of other terms,
+	// except when the rule needs the matched text for its options
+	bool literal = m_patternMatcher && !m_refValues && m_fieldId <= ffDupeStatus;
 
-	if (!substr)
+	if (!m_substr)
 	{
-		// Word-search
-
-		// split szStrValue into tokens
-		Tokenizer tok(strValue, WORD_SEPARATORS);
-		while (const char* word = tok.Next())
+		m_wildMask = std::make_unique<WildMask>(m_param, m_refValues != nullptr);
+		if (literal && !strpbrk(m_param, "*?#"))
 		{
-			WildMask mask(m_param, m_refValues != nullptr);
-			match = mask.Match(word);
-			if (match)
-			{
-				FillWildMaskRefValues(word, &mask, 0);
-				break;
-			}
+			m_pattern = m_patternMatcher->AddWord(m_fieldId, m_param);
+		}
+		else if (literal)
+		{
+			AddPrefilter(m_param);
 		}
+		return;
 	}
-	else
+
+	m_refOffset = 1;
+	const char* format = "*%s*";
+	if (paramLen >= 2 && m_param[0] == '*' && m_param[paramLen-1] == '*')
 	{
-		// Substring-search
+		format = "%s";
+		m_refOffset = 0;
+	}
+	else if (paramLen >= 1 && m_param[0] == '*')
+	{
+		format = "%s*";
+		m_refOffset = 0;
+	}
+	else if (paramLen >= 1 && m_param[paramLen-1] == '*')
+	{
+		format = "*%s";
+	}
+
+	CString mask = CString::FormatStr(format, *m_param);
+
+	// the mask has form "*substring*"
+	CString substring(mask + 1, mask.Length() - 2);
+	if (literal && !substring.Empty() && !strpbrk(substring, "*?#"))
+	{
+		m_pattern = m_patternMatcher->AddSubstring(m_fieldId, substring);
+	}
+	else if (literal)
+	{
+		AddPrefilter(substring);
+	}
+
+	m_wildMask = std::make_unique<WildMask>(mask, m_refValues != nullptr);
+}
 
-		int refOffset = 1;
-		const char* format = "*%s*";
-		if (paramLen >= 2 && m_param[0] == '*' && m_param[paramLen-1] == '*')
+/*
+ * A text can only match the mask if it contains each literal part of the mask.
+ * The longest part is searched together with the patterns of other terms,
+ * which rejects most texts before the mask is checked.
+ */
+void FeedFilter::Term::AddPrefilter(const char* mask)
+{
+	const char* longest = nullptr;
+	int longestLen = 0;
+	for (const char* p = mask; *p; )
+	{
+		int len = (int)strcspn(p, "*?#");
+		if (len > longestLen)
 		{
-			format = "%s";
-			refOffset = 0;
+			longest = p;
+			longestLen = len;
 		}
-		else if (paramLen >= 1 && m_param[0] == '*')
+		p += len;
+		if (*p)
 		{
-			format = "%s*";
-			refOffset = 0;
+			p++;
 		}
-		else if (paramLen >= 1 && m_param[paramLen-1] == '*')
+	}
+
+	if (longest)
+	{
+		m_prefilter = m_patternMatcher->AddSubstring(m_fieldId, CString(longest, longestLen));
+	}
+}
+
+bool FeedFilter::Term::MatchText(const char* strValue, bool cachedWords)
+{
+	if (m_pattern > -1 && cachedWords)
+	{
+		return m_patternMatcher->Match(m_fieldId, m_pattern, strValue);
+	}
+
+	if (m_prefilter > -1 && cachedWords && !m_patternMatcher->Match(m_fieldId, m_prefilter, strValue))
+	{
+		return false;
+	}
+
+	if (m_substr)
+	{
+		// Substring-search
+		bool match = m_wildMask->Match(strValue);
+		if (match)
 		{
-			format = "*%s";
+			FillWildMaskRefValues(strValue, m_wildMask.get(), m_refOffset);
 		}
+		return match;
+	}
 
-		WildMask mask(CString::FormatStr(format, *m_param), m_refValues != nullptr);
-		match = mask.Match(strValue);
+	// Word-search
+	CString buffer;
+	WordList words;
+	WordList* wordList = &words;
+	if (cachedWords && m_wordCache)
+	{
+		wordList = m_wordCache->GetWords(m_fieldId, strValue);
+	}
+	else
+	{
+		SplitWords(strValue, buffer, words);
+	}
 
-		if (match)
+	for (const char* word : *wordList)
+	{
+		if (m_wildMask->Match(word))
 		{
-			FillWildMaskRefValues(strValue, &mask, refOffset);
+			FillWildMaskRefValues(word, m_wildMask.get(), 0);
+			return true;
 		}
 	}
 
-	return match;
+	return false;
 }
 
 bool FeedFilter::Term::MatchRegex(const char* strValue)
@@ -267,9 +546,7 @@ bool FeedFilter::Term::Compile(char* token)
 
 	debug("%s, Field: %s, Command: %i, Param: %s", (m_positive ? "Positive" : "Negative"), field, m_command, token);
 
-	const char* strValue;
-	int64 intValue;
-	if (!GetFieldData(field, nullptr, &strValue, &intValue))
+	if (!ParseField(field))
 	{
 		return false;
 	}
@@ -282,114 +559,149 @@ bool FeedFilter::Term::Compile(char* token)
 	m_field = field;
 	m_param = token;
 
+	if (m_command == fcText)
+	{
+		CompileText();
+	}
+
 	return true;
 }
 
-/*
- * If pFeedItemInfo is nullptr, only field name is validated
- */
-bool FeedFilter::Term::GetFieldData(const char* field, FeedItemInfo* feedItemInfo,
-	const char** StrValue, int64* IntValue)
+bool FeedFilter::Term::ParseField(const char* field)
 {
-	*StrValue = nullptr;
-	*IntValue = 0;
-
-	if (!field || !strcasecmp(field, "title"))
-	{
-		*StrValue = feedItemInfo ? feedItemInfo->GetTitle() : nullptr;
-		return true;
-	}
-	else if (!strcasecmp(field, "filename"))
-	{
-		*StrValue = feedItemInfo ? feedItemInfo->GetFilename() : nullptr;
-		return true;
-	}
-	else if (!strcasecmp(field, "category"))
-	{
-		*StrValue = feedItemInfo ? feedItemInfo->GetCategory() : nullptr;
+	struct FieldName
+	{
+		const char* name;
+		EField field;
+	};
+
+	static const FieldName FIELD_NAMES[] = {
+		{ "title", ffTitle },
+		{ "filename", ffFilename },
+		{ "category", ffCategory },
+		{ "link", ffLink },
+		{ "url", ffLink },
+		{ "size", ffSize },
+		{ "age", ffAge },
+		{ "imdbid", ffImdbId },
+		{ "rageid", ffRageId },
+		{ "tvdbid", ffTvdbId },
+		{ "tvmazeid", ffTvmazeId },
+		{ "description", ffDescription },
+		{ "season", ffSeason },
+		{ "episode", ffEpisode },
+		{ "priority", ffPriority },
+		{ "dupekey", ffDupeKey },
+		{ "dupescore", ffDupeScore },
+		{ "dupestatus", ffDupeStatus }
+	};
+
+	if (!field)
+	{
+		m_fieldId = ffTitle;
 		return true;
 	}
-	else if (!strcasecmp(field, "link") || !strcasecmp(field, "url"))
-	{
-		*StrValue = feedItemInfo ? feedItemInfo->GetUrl() : nullptr;
-		return true;
-	}
-	else if (!strcasecmp(field, "size"))
-	{
-		*IntValue = feedItemInfo ? feedItemInfo->GetSize() : 0;
-		return true;
-	}
-	else if (!strcasecmp(field, "age"))
-	{
-		*IntValue = feedItemInfo ? Util::CurrentTime() - feedItemInfo->GetTime() : 0;
-		return true;
-	}
-	else if (!strcasecmp(field, "imdbid"))
-	{
-		*IntValue = feedItemInfo ? feedItemInfo->GetImdbId() : 0;
-		return true;
-	}
-	else if (!strcasecmp(field, "rageid"))
-	{
-		*IntValue = feedItemInfo ? feedItemInfo->GetRageId() : 0;
-		return true;
-	}
-	else if (!strcasecmp(field, "tvdbid"))
-	{
-		*IntValue = feedItemInfo ? feedItemInfo->GetTvdbId() : 0;
-		return true;
-	}
-	else if (!strcasecmp(field, "tvmazeid"))
-	{
-		*IntValue = feedItemInfo ? feedItemInfo->GetTvmazeId() : 0;
-		return true;
-	}
-	else if (!strcasecmp(field, "description"))
-	{
-		*StrValue = feedItemInfo ? feedItemInfo->GetDescription() : nullptr;
-		return true;
-	}
-	else if (!strcasecmp(field, "season"))
-	{
-		*IntValue = feedItemInfo ? feedItemInfo->GetSeasonNum() : 0;
-		return true;
-	}
-	else if (!strcasecmp(field, "episode"))
-	{
-		*IntValue = feedItemInfo ? feedItemInfo->GetEpisodeNum() : 0;
-		return true;
-	}
-	else if (!strcasecmp(field, "priority"))
-	{
-		*IntValue = feedItemInfo ? feedItemInfo->GetPriority() : 0;
-		return true;
-	}
-	else if (!strcasecmp(field, "dupekey"))
-	{
-		*StrValue = feedItemInfo ? feedItemInfo->GetDupeKey() : nullptr;
-		return true;
-	}
-	else if (!strcasecmp(field, "dupescore"))
+
+	if (!strncasecmp(field, "attr-", 5))
 	{
-		*IntValue = feedItemInfo ? feedItemInfo->GetDupeScore() : 0;
+		m_fieldId = ffAttr;
 		return true;
 	}
-	else if (!strcasecmp(field, "dupestatus"))
+
+	for (const FieldName& fieldName : FIELD_NAMES)
 	{
-		*StrValue = feedItemInfo ? feedItemInfo->GetDupeStatus() : nullptr;
-		return true;
+		if (!strcasecmp(field, fieldName.name))
+		{
+			m_fieldId = fieldName.field;
+			return true;
+		}
 	}
-	else if (!strncasecmp(field, "attr-", 5))
+
+	return false;
+}
+
+void FeedFilter::Term::GetFieldData(FeedItemInfo* feedItemInfo, const char** StrValue, int64* IntValue)
+{
+	*StrValue = nullptr;
+	*IntValue = 0;
+
+	switch (m_fieldId)
 	{
-		if (feedItemInfo)
+		case ffTitle:
+			*StrValue = feedItemInfo->GetTitle();
+			break;
+
+		case ffFilename:
+			*StrValue = feedItemInfo->GetFilename();
+			break;
+
+		case ffCategory:
+			*StrValue = feedItemInfo->GetCategory();
+			break;
+
+		case ffLink:
+			*StrValue = feedItemInfo->GetUrl();
+			break;
+
+		case ffSize:
+			*IntValue = feedItemInfo->GetSize();
+			break;
+
+		case ffAge:
+			*IntValue = Util::CurrentTime() - feedItemInfo->GetTime();
+			break;
+
+		case ffImdbId:
+			*IntValue = feedItemInfo->GetImdbId();
+			break;
+
+		case ffRageId:
+			*IntValue = feedItemInfo->GetRageId();
+			break;
+
+		case ffTvdbId:
+			*IntValue = feedItemInfo->GetTvdbId();
+			break;
+
+		case ffTvmazeId:
+			*IntValue = feedItemInfo->GetTvmazeId();
+			break;
+
+		case ffDescription:
+			*StrValue = feedItemInfo->GetDescription();
+			break;
+
+		case ffSeason:
+			*IntValue = feedItemInfo->GetSeasonNum();
+			break;
+
+		case ffEpisode:
+			*IntValue = feedItemInfo->GetEpisodeNum();
+			break;
+
+		case ffPriority:
+			*IntValue = feedItemInfo->GetPriority();
+			break;
+
+		case ffDupeKey:
+			*StrValue = feedItemInfo->GetDupeKey();
+			break;
+
+		case ffDupeScore:
+			*IntValue = feedItemInfo->GetDupeScore();
+			break;
+
+		case ffDupeStatus:
+			*StrValue = feedItemInfo->GetDupeStatus();
+			break;
+
+		case ffAttr:
 		{
-			FeedItemInfo::Attr* attr = feedItemInfo->GetAttributes()->Find(field + 5);
+			FeedItemInfo::Attr* attr = feedItemInfo->GetAttributes()->Find(m_field + 5);
 			*StrValue = attr ? attr->GetValue() : nullptr;
+			break;
 		}
-		return true;
 	}
-
-	return false;
 }
 
 bool FeedFilter::Term::ParseParam(const char* field, const char* param)
@@ -781,11 +1093,17 @@ bool FeedFilter::Rule::CompileTerm(char* termstr)
 {
 	m_terms.emplace_back();
 	m_terms.back().SetRefValues(m_hasPatCategory || m_hasPatDupeKey || m_hasPatAddDupeKey ? &m_refValues : nullptr);
+	m_terms.back().SetWordCache(m_wordCache);
+	m_terms.back().SetPatternMatcher(m_patternMatcher);
 	bool ok = m_terms.back().Compile(termstr);
 	if (!ok)
 	{
 		m_terms.pop_back();
 	}
+	else if (m_terms.back().GetCommand() >= fcOpeningBrace)
+	{
+		m_andOnly = false;
+	}
 	return ok;
 }
 
@@ -816,6 +1134,19 @@ bool FeedFilter::Rule::Match(FeedItemInfo& feedItemInfo)
 
 bool FeedFilter::Rule::MatchExpression(FeedItemInfo& feedItemInfo)
 {
+	if (m_andOnly)
+	{
+		// no braces and no "OR" operators: all terms must match, stop on first mismatch
+		for (Term& term : m_terms)
+		{
+			if (!term.Match(feedItemInfo))
+			{
+				return false;
+			}
+		}
+		return !m_terms.empty();
+	}
+
 	CString expr;
 	expr.Reserve(m_terms.size());
 
@@ -949,16 +1280,30 @@ void FeedFilter::Compile(const char* filter)
 	}
 
 	CompileRule(rule);
+
+	m_patternMatcher.Compile();
 }
 
 void FeedFilter::CompileRule(char* rulestr)
 {
 	m_rules.emplace_back();
+	m_rules.back().SetWordCache(&m_wordCache);
+	m_rules.back().SetPatternMatcher(&m_patternMatcher);
 	m_rules.back().Compile(rulestr);
 }
 
+void FeedFilter::Match(FeedItemList& feedItems)
+{
+	for (FeedItemInfo& feedItemInfo : feedItems)
+	{
+		Match(feedItemInfo);
+	}
+}
+
 void FeedFilter::Match(FeedItemInfo& feedItemInfo)
 {
+	ResetItem();
+
 	int index = 0;
 	for (Rule& rule : m_rules)
 	{
@@ -975,6 +1320,8 @@ void FeedFilter::Match(FeedItemInfo& feedItemInfo)
 						feedItemInfo.SetMatchStatus(FeedItemInfo::msAccepted);
 						feedItemInfo.SetMatchRule(index);
 						ApplyOptions(rule, feedItemInfo);
+						// options may have changed the dupekey
+						ResetItem();
 						if (rule.GetCommand() == frAccept)
 						{
 							return;
@@ -1010,6 +1357,12 @@ void FeedFilter::Match(FeedItemInfo& feedItemInfo)
 	feedItemInfo.SetMatchRule(0);
 }
 
+void FeedFilter::ResetItem()
+{
+	m_wordCache.Reset();
+	m_patternMatcher.Reset();
+}
+
 void FeedFilter::ApplyOptions(Rule& rule, FeedItemInfo& feedItemInfo)
 {
 	if (rule.HasPause())
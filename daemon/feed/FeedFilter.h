@@ -31,9 +31,93 @@ class FeedFilter
 public:
 	FeedFilter(const char* filter);
 	void Match(FeedItemInfo& feedItemInfo);
+	void Match(FeedItemList& feedItems);
 
 private:
 	typedef std::vector<CString> RefValues;
+	typedef std::vector<const char*> WordList;
+
+	enum EField
+	{
+		ffTitle,
+		ffFilename,
+		ffCategory,
+		ffLink,
+		ffDescription,
+		ffDupeKey,
+		ffDupeStatus,
+		ffSize,
+		ffAge,
+		ffImdbId,
+		ffRageId,
+		ffTvdbId,
+		ffTvmazeId,
+		ffSeason,
+		ffEpisode,
+		ffPriority,
+		ffDupeScore,
+		ffAttr
+	};
+
+	// words of text fields of the item being matched, shared by all terms
+	class WordCache
+	{
+	public:
+		void Reset();
+		WordList* GetWords(EField field, const char* strValue);
+
+	private:
+		struct Entry
+		{
+			bool valid = false;
+			CString buffer;
+			WordList words;
+		};
+
+		Entry m_entries[ffAttr];
+	};
+
+	// Literal words and substrings of text terms of all rules. Each field of an item
+	// is searched once for all patterns: words are looked up in a hash table,
+	// substrings are found by an Aho-Corasick automaton. For terms with wildcards
+	// the longest literal part of the mask is searched, the mask is only checked
+	// if that part is found.
+	class PatternMatcher
+	{
+	public:
+		PatternMatcher(WordCache* wordCache) : m_wordCache(wordCache) {}
+		int AddWord(EField field, const char* word);
+		int AddSubstring(EField field, const char* substring);
+		void Compile();
+		void Reset();
+		bool Match(EField field, int pattern, const char* strValue);
+
+	private:
+		struct Node
+		{
+			std::vector<std::pair<char, int>> next;
+			int fail = 0;
+			std::vector<int> patterns;
+		};
+
+		struct FieldPatterns
+		{
+			std::vector<int> patterns;
+			std::unordered_multimap<uint32, int> words;
+			std::vector<Node> nodes{1};
+			bool searched = false;
+		};
+
+		WordCache* m_wordCache;
+		std::vector<CString> m_patterns;
+		std::vector<bool> m_found;
+		FieldPatterns m_fields[ffAttr];
+
+		int AddPattern(FieldPatterns& fieldPatterns, const char* text);
+		int FindNext(FieldPatterns& fieldPatterns, int node, char ch);
+		void Search(FieldPatterns& fieldPatterns, const char* strValue, WordList* words);
+		static uint32 HashWord(const char* word);
+	};
 
 	enum ETermCommand
 	{
@@ -55,6 +139,8 @@ private:
 		Term() {}
 		Term(Term&&) = delete; // catch performance issues
 		void SetRefValues(RefValues* refValues) { m_refValues = refValues; }
+		void SetWordCache(WordCache* wordCache) { m_wordCache = wordCache; }
+		void SetPatternMatcher(PatternMatcher* patternMatcher) { m_patternMatcher = patternMatcher; }
 		bool Compile(char* token);
 		bool Match(FeedItemInfo& feedItemInfo);
 		ETermCommand GetCommand() { return m_command; }
@@ -62,22 +148,32 @@ private:
 	private:
 		bool m_positive;
 		CString m_field;
+		EField m_fieldId = ffTitle;
 		ETermCommand m_command;
 		CString m_param;
 		int64 m_intParam = 0;
 		double m_floatParam = 0.0;
 		bool m_float = false;
+		bool m_substr = false;
+		int m_refOffset = 0;
+		std::unique_ptr<WildMask> m_wildMask;
 		std::unique_ptr<RegEx> m_regEx;
 		RefValues* m_refValues = nullptr;
+		WordCache* m_wordCache = nullptr;
+		PatternMatcher* m_patternMatcher = nullptr;
+		int m_pattern = -1;
+		int m_prefilter = -1;
 
-		bool GetFieldData(const char* field, FeedItemInfo* feedItemInfo,
-			const char** StrValue, int64* IntValue);
+		bool ParseField(const char* field);
+		void GetFieldData(FeedItemInfo* feedItemInfo, const char** StrValue, int64* IntValue);
 		bool ParseParam(const char* field, const char* param);
 		bool ParseSizeParam(const char* param);
 		bool ParseAgeParam(const char* param);
 		bool ParseNumericParam(const char* param);
+		void CompileText();
+		void AddPrefilter(const char* mask);
 		bool MatchValue(const char* strValue, int64 intValue);
-		bool MatchText(const char* strValue);
+		bool MatchText(const char* strValue, bool cachedWords);
 		bool MatchRegex(const char* strValue);
 		void FillWildMaskRefValues(const char* strValue, WildMask* mask, int refOffset);
 		void FillRegExRefValues(const char* strValue, RegEx* regEx);
@@ -99,6 +195,8 @@ private:
 	public:
 		Rule() {}
 		Rule(Rule&&) = delete; // catch performance issues
+		void SetWordCache(WordCache* wordCache) { m_wordCache = wordCache; }
+		void SetPatternMatcher(PatternMatcher* patternMatcher) { m_patternMatcher = patternMatcher; }
 		void Compile(char* rule);
 		bool IsValid() { return m_isValid; }
 		ERuleCommand GetCommand() { return m_command; }
@@ -169,6 +267,9 @@ private:
 		CString m_patAddDupeKey;
 		TermList m_terms;
 		RefValues m_refValues;
+		WordCache* m_wordCache = nullptr;
+		PatternMatcher* m_patternMatcher = nullptr;
+		bool m_andOnly = true;
 
 		char* CompileCommand(char* rule);
 		char* CompileOptions(char* rule);
@@ -179,10 +280,14 @@ private:
 	typedef std::deque<Rule> RuleList;
 
 	RuleList m_rules;
+	WordCache m_wordCache;
+	PatternMatcher m_patternMatcher{&m_wordCache};
 
 	void Compile(const char* filter);
 	void CompileRule(char* rule);
 	void ApplyOptions(Rule& rule, FeedItemInfo& feedItemInfo);
+	void ResetItem();
+	static void SplitWords(const char* strValue, CString& buffer, WordList& words);
 };
 
 #endif
@@ -190,13 +190,45 @@ void FeedHistory::Remove(const char* url)
 
 FeedHistoryInfo* FeedHistory::Find(const char* url)
 {
-	for (FeedHistoryInfo& feedHistoryInfo : this)
+	if (m_index.empty())
 	{
-		if (!strcmp(feedHistoryInfo.GetUrl(), url))
+		for (FeedHistoryInfo& feedHistoryInfo : this)
 		{
-			return &feedHistoryInfo;
+			Index(&feedHistoryInfo);
+		}
+	}
+
+	std::pair<UrlIndex::iterator, UrlIndex::iterator> range =
+		m_index.equal_range(Util::HashBJ96(url, strlen(url), 0));
+	for (UrlIndex::iterator it = range.first; it != range.second; it++)
+	{
+		if (!strcmp(it->second->GetUrl(), url))
+		{
+			return it->second;
 		}
 	}
 
 	return nullptr;
 }
+
+void FeedHistory::emplace_back(const char* url, FeedHistoryInfo::EStatus status, time_t lastSeen)
+{
+	FeedHistoryBase::emplace_back(url, status, lastSeen);
+	if (!m_index.empty())
+	{
+		Index(&back());
+	}
+}
+
+FeedHistory::iterator FeedHistory::erase(iterator first, iterator last)
+{
+	// remaining items are moved, the index is built again on next search
+	m_index.clear();
+	return FeedHistoryBase::erase(first, last);
+}
+
+void FeedHistory::Index(FeedHistoryInfo* feedHistoryInfo)
+{
+	const char* url = feedHistoryInfo->GetUrl();
+	m_index.emplace(Util::HashBJ96(url, strlen(url), 0), feedHistoryInfo);
+}
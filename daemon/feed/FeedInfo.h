@@ -253,11 +253,26 @@ private:
 
 typedef std::deque<FeedHistoryInfo> FeedHistoryBase;
 
+/*
+ Feed history with an index of urls. The index is built on first search and is
+ maintained by "emplace_back"; "erase" and "clear" discard the index.
+ */
 class FeedHistory : public FeedHistoryBase
 {
 public:
 	void Remove(const char* url);
 	FeedHistoryInfo* Find(const char* url);
+	void emplace_back(const char* url, FeedHistoryInfo::EStatus status, time_t lastSeen);
+	iterator erase(iterator first, iterator last);
+	iterator erase(iterator pos) { return erase(pos, pos + 1); }
+	void clear() { m_index.clear(); FeedHistoryBase::clear(); }
+
+private:
+	typedef std::unordered_multimap<uint32, FeedHistoryInfo*> UrlIndex;
+
+	UrlIndex m_index;
+
+	void Index(FeedHistoryInfo* feedHistoryInfo);
 };
 
 #endif
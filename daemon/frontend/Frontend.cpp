@@ -95,7 +95,7 @@ void Frontend::FreeData()
 	if (IsRemoteMode())
 	{
 		m_remoteMessages.clear();
-		DownloadQueue::Guard()->GetQueue()->clear();
+		DownloadQueue::Guard()->GetQueue()->Clear();
 	}
 }
 
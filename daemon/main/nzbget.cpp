@@ -54,6 +54,9 @@
 #include "StackTrace.h"
 #include "CommandScript.h"
 #include "YEncode.h"
+#ifndef DISABLE_PARCHECK
+#include "par2cmdline.h"
+#endif
 #ifdef WIN32
 #include "WinService.h"
 #include "WinConsole.h"
@@ -116,6 +119,10 @@ int main(int argc, char *argv[], char *argp[])
 
 	Util::Init();
 	YEncode::init();
+#ifndef DISABLE_PARCHECK
+	Par2::Galois16SimdInit();
+	Par2::MD5SimdInit();
+#endif
 
 	g_ArgumentCount = argc;
 	g_Arguments = (char*(*)[])argv;
@@ -181,7 +188,7 @@ public:
 	virtual void AddNewsServer(int id, bool active, const char* name, const char* host,
 		int port, int ipVersion, const char* user, const char* pass, bool joinGroup,
 		bool tls, const char* cipher, int maxConnections, int retention,
-		int level, int group, bool optional);
+		int level, int group, bool optional, int pipelining);
 	virtual void AddFeed(int id, const char* name, const char* url, int interval,
 		const char* filter, bool backlog, bool pauseNzb, const char* category,
 		int priority, const char* feedScript);
@@ -652,6 +659,10 @@ void NZBGet::DoMainLoop()
 #ifdef WIN32
 	m_winConsole->Start();
 #endif
+	if (m_options->GetServerMode())
+	{
+		m_diskState->StartWriter();
+	}
 	m_queueCoordinator->Start();
 	m_urlCoordinator->Start();
 	m_prePostProcessor->Start();
@@ -743,6 +754,9 @@ void NZBGet::Run(bool reload)
 	StopRemoteServer();
 	StopFrontend();
 
+	// write all pending changes of diskstate
+	m_diskState->StopWriter();
+
 	Final();
 }
 
@@ -1008,10 +1022,11 @@ void NZBGet::Daemonize()
 
 void NZBGet::AddNewsServer(int id, bool active, const char* name, const char* host,
 	int port, int ipVersion, const char* user, const char* pass, bool joinGroup, bool tls,
-	const char* cipher, int maxConnections, int retention, int level, int group, bool optional)
+	const char* cipher, int maxConnections, int retention, int level, int group, bool optional,
+	int pipelining)
 {
 	m_serverPool->AddServer(std::make_unique<NewsServer>(id, active, name, host, port, ipVersion, user, pass, joinGroup,
-		tls, cipher, maxConnections, retention, level, group, optional));
+		tls, cipher, maxConnections, retention, level, group, optional, pipelining));
 }
 
 void NZBGet::AddFeed(int id, const char* name, const char* url, int interval, const char* filter,
@@ -170,6 +170,7 @@ using namespace MSXML;
 #include <sys/wait.h>
 #include <sys/un.h>
 #include <sys/file.h>
+#include <sys/mman.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <stdint.h>
@@ -195,6 +196,11 @@ using namespace MSXML;
 #include <execinfo.h>
 #endif
 
+#ifdef HAVE_IO_URING
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
 #endif /* POSIX INCLUDES */
 
 // COMMON INCLUDES
@@ -218,6 +224,7 @@ using namespace MSXML;
 #include <set>
 #include <map>
 #include <unordered_map>
+#include <unordered_set>
 #include <iterator>
 #include <algorithm>
 #include <fstream>
@@ -226,7 +233,9 @@ using namespace MSXML;
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <atomic>
 #include <chrono>
+#include <random>
 
 // NOTE: do not include <iostream> in "nzbget.h". <iostream> contains objects requiring
 // intialization, causing every unit in nzbget to have initialization routine. This in particular
@@ -139,6 +139,11 @@ void ArticleDownloader::Run()
 
 		// test connection
 		bool connected = m_connection && m_connection->Connect();
+		if (!connected && m_connection && m_connection->GetPipelineBroken())
+		{
+			debug("Article %s @ %s aborted: pipeline broken", *m_infoName, *m_connectionName);
+			status = adRetry;
+		}
 		if (connected && !IsStopped())
 		{
 			NewsServer* newsServer = m_connection->GetNewsServer();
@@ -152,6 +157,14 @@ void ArticleDownloader::Run()
 			}
 		}
 
+		if (status == adRetry && !IsStopped())
+		{
+			// the request was pipelined on a connection which broke before our turn,
+			// that's not a failure of the server; trying again on another connection
+			FreeConnection(false);
+			continue;
+		}
+
 		if (m_connection)
 		{
 			AddServerData();
@@ -320,13 +333,38 @@ ArticleDownloader::EStatus ArticleDownloader::Download()
 		}
 	}
 
+	// with pipelining the request may have to wait until responses
+	// to requests made earlier over the same connection are consumed
+	bool pipelined = m_connection->GetPipelining() > 1;
+	if (pipelined)
+	{
+		SetStatus(adWaiting);
+	}
+
 	// retrieve article
 	response = m_connection->Request(BString<1024>("%s %s\r\n",
 		g_Options->GetRawArticle() ? "ARTICLE" : "BODY", m_articleInfo->GetMessageId()));
 
+	SetLastUpdateTimeNow();
+	SetStatus(adRunning);
+
+	if (!response && pipelined && m_connection->GetPipelineBroken())
+	{
+		debug("Article %s @ %s aborted: pipeline broken", *m_infoName, *m_connectionName);
+		return adRetry;
+	}
+
+	if (pipelined)
+	{
+		Guard guard(m_connectionMutex);
+		m_pipelineReading = true;
+	}
+
 	status = CheckResponse(response, "could not fetch article");
 	if (status != adFinished)
 	{
+		// error responses have no body, the next response can be read
+		FinishRequest(status != adConnectError);
 		return status;
 	}
 
@@ -339,14 +377,8 @@ ArticleDownloader::EStatus ArticleDownloader::Download()
 
 	while (!IsStopped() && !m_decoder.GetEof())
 	{
-		// throttle the bandwidth
-		while (!IsStopped() && (g_WorkState->GetSpeedLimit() > 0.0f) &&
-			(g_StatMeter->CalcCurrentDownloadSpeed() > g_WorkState->GetSpeedLimit() ||
-			g_StatMeter->CalcMomentaryDownloadSpeed() > g_WorkState->GetSpeedLimit()))
-		{
-			SetLastUpdateTimeNow();
-			Util::Sleep(10);
-		}
+		// send requests of other downloaders sharing the connection
+		m_connection->FlushRequests();
 
 		char* buffer;
 		int len;
@@ -369,6 +401,16 @@ ArticleDownloader::EStatus ArticleDownloader::Download()
 		}
 
 		g_StatMeter->AddSpeedReading(len);
+
+		// throttle the bandwidth, stop waiting if the speed limit was changed
+		int waitTime = g_StatMeter->ReserveDownloadBytes(len);
+		if (waitTime > 0)
+		{
+			// a throttled downloader must not be treated as hanging
+			m_lastUpdateTime = Util::CurrentTime() + waitTime / 1000 + 1;
+			g_StatMeter->WaitDownloadBytes(waitTime, this);
+		}
+
 		time_t oldTime = m_lastUpdateTime;
 		SetLastUpdateTimeNow();
 		if (oldTime != m_lastUpdateTime)
@@ -376,8 +418,18 @@ ArticleDownloader::EStatus ArticleDownloader::Download()
 			AddServerData();
 		}
 
-		// decode article data
-		len = m_decoder.DecodeBuffer(buffer, len);
+		// decode article data, directly into article cache if possible
+		char* outbuf = m_writingStarted && m_decoder.GetFormat() == Decoder::efYenc ?
+			m_articleWriter.GetCacheBuffer(len) : nullptr;
+		if (outbuf)
+		{
+			len = m_decoder.DecodeBuffer(buffer, len, outbuf);
+			buffer = outbuf;
+		}
+		else
+		{
+			len = m_decoder.DecodeBuffer(buffer, len);
+		}
 
 		// write to output file
 		if (len > 0 && !Write(buffer, len))
@@ -392,6 +444,17 @@ ArticleDownloader::EStatus ArticleDownloader::Download()
 		status = adFailed;
 	}
 
+	bool inSync = status == adRunning && m_decoder.GetEof();
+	if (inSync && pipelined)
+	{
+		// the data received after the article belongs to the next response
+		char* remainder;
+		int remLen;
+		m_decoder.GetRemainder(&remainder, &remLen);
+		m_connection->UnreadBuffer(remainder, remLen);
+	}
+	FinishRequest(inSync);
+
 	if (status == adRunning)
 	{
 		FreeConnection(true);
@@ -559,8 +622,16 @@ void ArticleDownloader::Stop()
 {
 	debug("Trying to stop ArticleDownloader");
 	Thread::Stop();
+	g_StatMeter->WakeUpDownloadWaiters();
 	Guard guard(m_connectionMutex);
-	if (m_connection)
+	if (m_connection && m_connection->GetPipelining() > 1 && !m_pipelineReading)
+	{
+		// another downloader may be reading its response from the shared connection,
+		// only the requests waiting for their turn (including ours) are aborted;
+		// they are retried on other connections
+		m_connection->BreakPipeline();
+	}
+	else if (m_connection)
 	{
 		m_connection->SetSuppressErrors(true);
 		m_connection->Cancel();
@@ -568,6 +639,13 @@ void ArticleDownloader::Stop()
 	debug("ArticleDownloader stopped successfully");
 }
 
+void ArticleDownloader::FinishRequest(bool inSync)
+{
+	Guard guard(m_connectionMutex);
+	m_pipelineReading = false;
+	m_connection->FinishRequest(inSync);
+}
+
 void ArticleDownloader::FreeConnection(bool keepConnected)
 {
 	if (m_connection)
@@ -86,6 +86,7 @@ private:
 	NntpConnection* m_connection = nullptr;
 	EStatus m_status = adUndefined;
 	Mutex m_connectionMutex;
+	bool m_pipelineReading = false;
 	CString m_infoName;
 	CString m_connectionName;
 	CString m_articleFilename;
@@ -100,6 +101,7 @@ private:
 	EStatus Download();
 	EStatus DecodeCheck();
 	void FreeConnection(bool keepConnected);
+	void FinishRequest(bool inSync);
 	EStatus CheckResponse(const char* response, const char* comment);
 	void SetStatus(EStatus status) { m_status = status; }
 	bool Write(char* buffer, int len);
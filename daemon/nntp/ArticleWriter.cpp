@@ -26,6 +26,50 @@
 #include "Util.h"
 #include "FileSystem.h"
 
+#ifndef DISABLE_PARCHECK
+#include "par2cmdline.h"
+#include "md5.h"
+#endif
+
+// number of cached segments written to disk at once when flushing the cache
+static const int FLUSH_BATCH_SIZE = 64;
+
+/*
+ * Writers for articles written directly into output files by downloader threads.
+ * Downloader threads live for one article only; the writers are kept for reuse
+ * to not set up an io_uring for each article.
+ */
+class DirectWriterPool
+{
+public:
+	std::unique_ptr<BatchFileWriter> Acquire();
+	void Release(std::unique_ptr<BatchFileWriter> writer);
+
+private:
+	Mutex m_mutex;
+	std::vector<std::unique_ptr<BatchFileWriter>> m_writers;
+};
+
+static DirectWriterPool g_DirectWriters;
+
+std::unique_ptr<BatchFileWriter> DirectWriterPool::Acquire()
+{
+	Guard guard(m_mutex);
+	if (m_writers.empty())
+	{
+		return std::make_unique<BatchFileWriter>();
+	}
+	std::unique_ptr<BatchFileWriter> writer = std::move(m_writers.back());
+	m_writers.pop_back();
+	return writer;
+}
+
+void DirectWriterPool::Release(std::unique_ptr<BatchFileWriter> writer)
+{
+	Guard guard(m_mutex);
+	m_writers.push_back(std::move(writer));
+}
+
 CachedSegmentData::~CachedSegmentData()
 {
 	g_ArticleCache->Free(this);
@@ -36,8 +80,10 @@ CachedSegmentData& CachedSegmentData::operator=(CachedSegmentData&& other)
 	g_ArticleCache->Free(this);
 	m_data = other.m_data;
 	m_size = other.m_size;
+	m_capacity = other.m_capacity;
 	other.m_data = nullptr;
 	other.m_size = 0;
+	other.m_capacity = 0;
 	return *this;
 }
 
@@ -61,6 +107,7 @@ bool ArticleWriter::Start(Decoder::EFormat format, const char* filename, int64 f
 	int64 articleOffset, int articleSize)
 {
 	m_outFile.Close();
+	CloseDirectFile();
 	m_format = format;
 	m_articleOffset = articleOffset;
 	m_articleSize = articleSize ? articleSize : m_articleInfo->GetSize();
@@ -123,23 +170,33 @@ bool ArticleWriter::Start(Decoder::EFormat format, const char* filename, int64 f
 		}
 	}
 
-	if (!m_articleData.GetData())
+	bool directWrite = (g_Options->GetDirectWrite() || m_fileInfo->GetForceDirectWrite()) && m_format == Decoder::efYenc;
+
+	if (!m_articleData.GetData() && directWrite)
 	{
-		bool directWrite = (g_Options->GetDirectWrite() || m_fileInfo->GetForceDirectWrite()) && m_format == Decoder::efYenc;
-		const char* outFilename = directWrite ? m_outputFilename : m_tempFilename;
-		if (!m_outFile.Open(outFilename, directWrite ? DiskFile::omReadWrite : DiskFile::omWrite))
+		// the article is collected in memory and written into output file at once
+		m_directFile = g_DirectWriters.Acquire();
+		if (!m_directFile->Open(m_outputFilename))
 		{
 			m_fileInfo->GetNzbInfo()->PrintMessage(Message::mkError,
-				"Could not %s file %s: %s", directWrite ? "open" : "create", outFilename,
+				"Could not open file %s: %s", *m_outputFilename,
 				*FileSystem::GetLastErrorMessage());
+			CloseDirectFile();
 			return false;
 		}
-		SetWriteBuffer(m_outFile, m_articleInfo->GetSize());
-
-		if (directWrite)
+		m_directBuffer.Reserve(m_articleSize);
+		m_directWritten = 0;
+	}
+	else if (!m_articleData.GetData())
+	{
+		if (!m_outFile.Open(m_tempFilename, DiskFile::omWrite))
 		{
-			m_outFile.Seek(m_articleOffset);
+			m_fileInfo->GetNzbInfo()->PrintMessage(Message::mkError,
+				"Could not create file %s: %s", *m_tempFilename,
+				*FileSystem::GetLastErrorMessage());
+			return false;
 		}
+		SetWriteBuffer(m_outFile, m_articleInfo->GetSize());
 	}
 
 	return true;
@@ -163,7 +220,11 @@ bool ArticleWriter::Write(char* buffer, int len)
 
 	if (!g_Options->GetRawArticle() && m_articleData.GetData())
 	{
-		memcpy(m_articleData.GetData() + m_articlePtr - len, buffer, len);
+		char* dest = m_articleData.GetData() + m_articlePtr - len;
+		if (dest != buffer)
+		{
+			memcpy(dest, buffer, len);
+		}
 		return true;
 	}
 
@@ -172,13 +233,77 @@ bool ArticleWriter::Write(char* buffer, int len)
 		return true;
 	}
 
+	if (m_directFile)
+	{
+		char* dest = m_directBuffer + m_articlePtr - len;
+		if (dest != buffer)
+		{
+			memcpy(dest, buffer, len);
+		}
+		return m_articlePtr < m_articleSize || WriteDirect();
+	}
+
 	return m_outFile.Write(buffer, len) > 0;
 }
 
+bool ArticleWriter::WriteDirect()
+{
+	int size = std::min(m_articlePtr, m_articleSize);
+	if (m_directWritten < size)
+	{
+		m_directFile->Write(m_directBuffer + m_directWritten, size - m_directWritten,
+			m_articleOffset + m_directWritten);
+		m_directWritten = size;
+	}
+	return m_directFile->Flush();
+}
+
+void ArticleWriter::CloseDirectFile()
+{
+	if (m_directFile)
+	{
+		m_directFile->Close();
+		g_DirectWriters.Release(std::move(m_directFile));
+	}
+	m_directBuffer.Clear();
+}
+
+/*
+ * Returns the position in the cache segment (or in the buffer of a direct write)
+ * where the next "len" bytes of article data will be stored, allowing to decode
+ * the data directly there. The data must then be passed to "Write" as usual,
+ * which doesn't copy it again.
+ * Returns nullptr if the article isn't written via memory or if there is no room.
+ */
+char* ArticleWriter::GetCacheBuffer(int len)
+{
+	if (g_Options->GetRawArticle() || m_articlePtr + len > m_articleSize)
+	{
+		return nullptr;
+	}
+	if (m_articleData.GetData())
+	{
+		return m_articleData.GetData() + m_articlePtr;
+	}
+	if (m_directFile)
+	{
+		return m_directBuffer + m_articlePtr;
+	}
+	return nullptr;
+}
+
 void ArticleWriter::Finish(bool success)
 {
 	m_outFile.Close();
 
+	if (m_directFile && success && !g_Options->GetSkipWrite() && !WriteDirect())
+	{
+		m_fileInfo->GetNzbInfo()->PrintMessage(Message::mkError,
+			"Could not write file %s: %s", *m_outputFilename,
+			*FileSystem::GetLastErrorMessage());
+	}
+	CloseDirectFile();
+
 	if (!success)
 	{
 		FileSystem::DeleteFile(m_tempFilename);
@@ -209,7 +334,7 @@ void ArticleWriter::Finish(bool success)
 			}
 			Guard contentGuard = g_ArticleCache->GuardContent();
 			m_articleInfo->AttachSegment(std::make_unique<CachedSegmentData>(std::move(m_articleData)), m_articleOffset, m_articlePtr);
-			m_fileInfo->SetCachedArticles(m_fileInfo->GetCachedArticles() + 1);
+			g_ArticleCache->SetCachedArticles(m_fileInfo, m_fileInfo->GetCachedArticles() + 1);
 		}
 		else
 		{
@@ -265,6 +390,27 @@ bool ArticleWriter::CreateOutputFile(int64 size)
 	return true;
 }
 
+/*
+ * Flushes content of the output file into disk before renaming. The articles were
+ * written by downloader threads and by the cache via different file handles.
+ */
+void ArticleWriter::SyncOutputFile()
+{
+	std::unique_ptr<BatchFileWriter> syncFile = g_DirectWriters.Acquire();
+	CString errmsg;
+	if (!syncFile->Open(m_outputFilename))
+	{
+		errmsg = FileSystem::GetLastErrorMessage();
+	}
+	if (!syncFile->Active() || !syncFile->Sync(errmsg))
+	{
+		m_fileInfo->GetNzbInfo()->PrintMessage(Message::mkWarning,
+			"Could not flush file %s into disk: %s", *m_outputFilename, *errmsg);
+	}
+	syncFile->Close();
+	g_DirectWriters.Release(std::move(syncFile));
+}
+
 void ArticleWriter::BuildOutputFilename()
 {
 	BString<1024> filename("%s%c%i.%03i", g_Options->GetTempDir(), PATH_SEPARATOR,
@@ -390,6 +536,17 @@ void ArticleWriter::CompleteFileParts()
 	}
 
 	uint32 crc = 0;
+	CString hashFull;
+
+#ifndef DISABLE_PARCHECK
+	// When the whole file passes through memory in order (joined from article parts or
+	// written from cache) its MD5 is computed along the way, allowing the par-checker
+	// to verify the file without reading it back from disk.
+	bool hashing = g_Options->GetParQuick() && !g_Options->GetRawArticle() && !g_Options->GetSkipWrite() &&
+		m_fileInfo->GetSuccessArticles() == m_fileInfo->GetTotalArticles();
+	int64 hashSize = 0;
+	Par2::MD5Context md5Context;
+#endif
 
 	{
 		std::unique_ptr<ArticleCache::FlushGuard> flushGuard;
@@ -424,6 +581,11 @@ void ArticleWriter::CompleteFileParts()
 				}
 			}
 
+#ifndef DISABLE_PARCHECK
+			// segments written directly to disk aren't in memory anymore
+			hashing = hashing && (pa->GetSegmentContent() || !directWrite);
+#endif
+
 			if (pa->GetSegmentContent())
 			{
 				if (!g_Options->GetSkipWrite())
@@ -431,6 +593,14 @@ void ArticleWriter::CompleteFileParts()
 					outfile.Seek(pa->GetSegmentOffset());
 					outfile.Write(pa->GetSegmentContent(), pa->GetSegmentSize());
 				}
+#ifndef DISABLE_PARCHECK
+				hashing = hashing && (!directWrite || pa->GetSegmentOffset() == hashSize);
+				if (hashing)
+				{
+					md5Context.Update(pa->GetSegmentContent(), pa->GetSegmentSize());
+					hashSize += pa->GetSegmentSize();
+				}
+#endif
 				pa->DiscardSegment();
 			}
 			else if (!g_Options->GetRawArticle() && !directWrite && !g_Options->GetSkipWrite())
@@ -443,6 +613,12 @@ void ArticleWriter::CompleteFileParts()
 					{
 						cnt = (int)infile.Read(buffer, buffer.Size());
 						outfile.Write(buffer, cnt);
+#ifndef DISABLE_PARCHECK
+						if (hashing)
+						{
+							md5Context.Update(buffer, cnt);
+						}
+#endif
 					}
 					infile.Close();
 				}
@@ -475,10 +651,36 @@ void ArticleWriter::CompleteFileParts()
 		}
 
 		buffer.Clear();
+
+		if (cached)
+		{
+			// all cached segments were written into the file
+			Guard contentGuard = g_ArticleCache->GuardContent();
+			g_ArticleCache->SetCachedArticles(m_fileInfo, 0);
+		}
+	}
+
+#ifndef DISABLE_PARCHECK
+	if (hashing && m_fileInfo->GetSuccessArticles() == m_fileInfo->GetTotalArticles())
+	{
+		Par2::MD5Hash hash;
+		md5Context.Final(hash);
+		hashFull = hash.print().c_str();
 	}
+#endif
 
 	if (outfile.Active())
 	{
+		if (!directWrite && !g_Options->GetSkipWrite())
+		{
+			// flush file content before renaming
+			CString errmsg;
+			if (outfile.Flush() && !outfile.Sync(errmsg))
+			{
+				m_fileInfo->GetNzbInfo()->PrintMessage(Message::mkWarning,
+					"Could not flush file %s into disk: %s", *tmpdestfile, *errmsg);
+			}
+		}
 		outfile.Close();
 		if (!directWrite && !FileSystem::MoveFile(tmpdestfile, ofn))
 		{
@@ -490,6 +692,11 @@ void ArticleWriter::CompleteFileParts()
 
 	if (directWrite)
 	{
+		if (!g_Options->GetRawArticle() && !g_Options->GetSkipWrite())
+		{
+			SyncOutputFile();
+		}
+
 		if (!FileSystem::SameFilename(m_outputFilename, ofn) &&
 			!FileSystem::MoveFile(m_outputFilename, ofn))
 		{
@@ -545,6 +752,7 @@ void ArticleWriter::CompleteFileParts()
 		GuardedDownloadQueue guard = DownloadQueue::Guard();
 
 		m_fileInfo->SetCrc(crc);
+		m_fileInfo->SetHashFull(hashFull);
 		m_fileInfo->SetOutputFilename(ofn);
 
 		if (strcmp(m_fileInfo->GetFilename(), filename))
@@ -568,16 +776,34 @@ void ArticleWriter::CompleteFileParts()
 	}
 }
 
-void ArticleWriter::FlushCache()
+void ArticleWriter::FlushCache(BatchFileWriter& batchFile)
 {
 	detail("Flushing cache for %s", *m_infoName);
 
 	bool directWrite = g_Options->GetDirectWrite() && m_fileInfo->GetOutputInitialized();
 	DiskFile outfile;
-	bool needBufFile = false;
+	std::vector<ArticleInfo*> batchArticles;
+	bool writeError = false;
 	int flushedArticles = 0;
 	int64 flushedSize = 0;
 
+	// segments queued for writing must stay in memory until the batch is written
+	auto flushBatch = [&]
+	{
+		if (!batchFile.Flush() && !writeError)
+		{
+			m_fileInfo->GetNzbInfo()->PrintMessage(Message::mkError,
+				"Could not write file %s: %s", m_fileInfo->GetOutputFilename(),
+				*FileSystem::GetLastErrorMessage());
+			writeError = true;
+		}
+		for (ArticleInfo* pa : batchArticles)
+		{
+			pa->DiscardSegment();
+		}
+		batchArticles.clear();
+	};
+
 	{
 		ArticleCache::FlushGuard flushGuard = g_ArticleCache->GuardFlush();
 
@@ -611,49 +837,53 @@ void ArticleWriter::FlushCache()
 				break;
 			}
 
-			if (directWrite && !outfile.Active())
+			if (directWrite)
 			{
-				if (!outfile.Open(m_fileInfo->GetOutputFilename(), DiskFile::omReadWrite))
+				if (!batchFile.Active())
 				{
-					m_fileInfo->GetNzbInfo()->PrintMessage(Message::mkError,
-						"Could not open file %s: %s", m_fileInfo->GetOutputFilename(),
-						*FileSystem::GetLastErrorMessage());
-					// prevent multiple error messages
-					pa->DiscardSegment();
-					flushedArticles++;
-					break;
+					batchFile.SetWriteBuffer(g_Options->GetWriteBuffer() * 1024);
+					if (!batchFile.Open(m_fileInfo->GetOutputFilename()))
+					{
+						m_fileInfo->GetNzbInfo()->PrintMessage(Message::mkError,
+							"Could not open file %s: %s", m_fileInfo->GetOutputFilename(),
+							*FileSystem::GetLastErrorMessage());
+						// prevent multiple error messages
+						pa->DiscardSegment();
+						flushedArticles++;
+						break;
+					}
 				}
-				needBufFile = true;
-			}
 
-			BString<1024> destFile;
+				if (!g_Options->GetSkipWrite())
+				{
+					batchFile.Write(pa->GetSegmentContent(), pa->GetSegmentSize(), pa->GetSegmentOffset());
+				}
 
-			if (!directWrite)
-			{
-				destFile.Format("%s.tmp", pa->GetResultFilename());
-				if (!outfile.Open(destFile, DiskFile::omWrite))
+				flushedSize += pa->GetSegmentSize();
+				flushedArticles++;
+
+				batchArticles.push_back(pa);
+				if ((int)batchArticles.size() >= FLUSH_BATCH_SIZE)
 				{
-					m_fileInfo->GetNzbInfo()->PrintMessage(Message::mkError,
-						"Could not create file %s: %s", *destFile,
-						*FileSystem::GetLastErrorMessage());
-					// prevent multiple error messages
-					pa->DiscardSegment();
-					flushedArticles++;
-					break;
+					flushBatch();
 				}
-				needBufFile = true;
+				continue;
 			}
 
-			if (outfile.Active() && needBufFile)
+			BString<1024> destFile;
+			destFile.Format("%s.tmp", pa->GetResultFilename());
+			if (!outfile.Open(destFile, DiskFile::omWrite))
 			{
-				SetWriteBuffer(outfile, 0);
-				needBufFile = false;
+				m_fileInfo->GetNzbInfo()->PrintMessage(Message::mkError,
+					"Could not create file %s: %s", *destFile,
+					*FileSystem::GetLastErrorMessage());
+				// prevent multiple error messages
+				pa->DiscardSegment();
+				flushedArticles++;
+				break;
 			}
 
-			if (directWrite)
-			{
-				outfile.Seek(pa->GetSegmentOffset());
-			}
+			SetWriteBuffer(outfile, 0);
 
 			if (!g_Options->GetSkipWrite())
 			{
@@ -665,24 +895,22 @@ void ArticleWriter::FlushCache()
 
 			pa->DiscardSegment();
 
-			if (!directWrite)
-			{
-				outfile.Close();
+			outfile.Close();
 
-				if (!FileSystem::MoveFile(destFile, pa->GetResultFilename()))
-				{
-					m_fileInfo->GetNzbInfo()->PrintMessage(Message::mkError,
-						"Could not rename file %s to %s: %s", *destFile, pa->GetResultFilename(),
-						*FileSystem::GetLastErrorMessage());
-				}
+			if (!FileSystem::MoveFile(destFile, pa->GetResultFilename()))
+			{
+				m_fileInfo->GetNzbInfo()->PrintMessage(Message::mkError,
+					"Could not rename file %s to %s: %s", *destFile, pa->GetResultFilename(),
+					*FileSystem::GetLastErrorMessage());
 			}
 		}
 
-		outfile.Close();
+		flushBatch();
+		batchFile.Close();
 
 		{
 			Guard contentGuard = g_ArticleCache->GuardContent();
-			m_fileInfo->SetCachedArticles(m_fileInfo->GetCachedArticles() - flushedArticles);
+			g_ArticleCache->SetCachedArticles(m_fileInfo, m_fileInfo->GetCachedArticles() - flushedArticles);
 			m_fileInfo->SetFlushLocked(false);
 		}
 	}
@@ -760,66 +988,340 @@ bool ArticleWriter::MoveCompletedFiles(NzbInfo* nzbInfo, const char* oldDestDir)
 }
 
 
+std::atomic<uint64> ArticleCache::m_generation{0};
+uint64 ArticleCache::m_releasedGeneration = 0;
+
 CachedSegmentData ArticleCache::Alloc(int size)
 {
-	Guard guard(m_allocMutex);
+	int capacity = (size + SLOT_GRANULARITY - 1) / SLOT_GRANULARITY * SLOT_GRANULARITY;
+
+	// the reservation must be counted before a slot is taken, see "ReleaseSlots"
+	m_reserved += capacity;
+
+	char* p = AllocSlot(capacity);
+	if (!p)
+	{
+		m_reserved -= capacity;
+		return CachedSegmentData();
+	}
 
-	void* p = nullptr;
+	if (m_allocated.fetch_add(size) == 0)
+	{
+		Guard guard(m_allocMutex);
+		UpdateCacheFlag();
+		// Resume Run(), the notification arrives later, after releasing m_allocMutex
+		m_allocCond.NotifyAll();
+	}
 
-	if (m_allocated + size <= (size_t)g_Options->GetArticleCache() * 1024 * 1024)
+	return CachedSegmentData(p, size, capacity);
+}
+
+bool ArticleCache::Realloc(CachedSegmentData* segment, int newSize)
+{
+	if (newSize > segment->m_capacity)
 	{
-		p = malloc(size);
-		if (p)
+		CachedSegmentData newSegment = Alloc(newSize);
+		if (!newSegment.m_data)
 		{
-			if (!m_allocated && g_Options->GetServerMode() && g_Options->GetContinuePartial())
-			{
-				g_DiskState->WriteCacheFlag();
-			}
-			if (!m_allocated)
+			return false;
+		}
+		memcpy(newSegment.m_data, segment->m_data, segment->m_size);
+		*segment = std::move(newSegment);
+		return true;
+	}
+
+	m_allocated += newSize - segment->m_size;
+	segment->m_size = newSize;
+
+	return true;
+}
+
+void ArticleCache::Free(CachedSegmentData* segment)
+{
+	if (segment->m_data)
+	{
+		// the slot must be in a free list before the reservation is released
+		FreeSlot(segment->m_data, segment->m_capacity);
+		m_reserved -= segment->m_capacity;
+		if (m_allocated.fetch_sub(segment->m_size) == (size_t)segment->m_size)
+		{
+			Guard guard(m_allocMutex);
+			UpdateCacheFlag();
+		}
+	}
+}
+
+void ArticleCache::UpdateCacheFlag()
+{
+	bool cached = m_allocated > 0;
+	if (cached != m_cacheFlag && g_Options->GetServerMode() && g_Options->GetContinuePartial())
+	{
+		if (cached)
+		{
+			g_DiskState->WriteCacheFlag();
+		}
+		else
+		{
+			g_DiskState->DeleteCacheFlag();
+		}
+	}
+	m_cacheFlag = cached;
+}
+
+ArticleCache::LocalSlots::~LocalSlots()
+{
+	if (g_ArticleCache)
+	{
+		g_ArticleCache->ReturnLocalSlots(*this);
+	}
+}
+
+/*
+ * Returns the free list of the current thread. The list is emptied if the
+ * slots were merged back into the region since the list was used last time.
+ */
+ArticleCache::LocalSlots& ArticleCache::GetLocalSlots()
+{
+	static thread_local LocalSlots localSlots;
+
+	if (localSlots.generation != m_generation)
+	{
+		// "ReleaseSlots" may be running, wait for it to decide
+		Guard guard(m_allocMutex);
+		if (localSlots.generation < m_releasedGeneration)
+		{
+			for (SlotList& slots : localSlots.slots)
 			{
-				// Resume Run(), the notification arrives later, after releasing m_allocMutex
-				m_allocCond.NotifyAll();
+				slots.clear();
 			}
-			m_allocated += size;
 		}
+		localSlots.generation = m_generation;
 	}
 
-	return CachedSegmentData((char*)p, p ? size : 0);
+	return localSlots;
 }
 
-bool ArticleCache::Realloc(CachedSegmentData* segment, int newSize)
+// Gives the free list of an exiting thread to the shared free lists
+void ArticleCache::ReturnLocalSlots(LocalSlots& localSlots)
 {
 	Guard guard(m_allocMutex);
+	if (localSlots.generation < m_releasedGeneration)
+	{
+		return;
+	}
+
+	for (int sizeClass = 0; sizeClass < LOCAL_CLASSES; sizeClass++)
+	{
+		SlotList& local = localSlots.slots[sizeClass];
+		if (!local.empty())
+		{
+			SlotList& shared = m_freeSlots[(sizeClass + 1) * SLOT_GRANULARITY];
+			shared.insert(shared.end(), local.begin(), local.end());
+			local.clear();
+		}
+	}
+}
+
+/*
+ * Takes a free slot of the size class "capacity" from the free list of the
+ * current thread, or a batch of slots from the shared free list, or carves a
+ * new slot from the region. If the region is used up a free slot of a larger
+ * size class is taken and "capacity" is updated.
+ */
+char* ArticleCache::AllocSlot(int& capacity)
+{
+	LocalSlots& localSlots = GetLocalSlots();
+	int sizeClass = capacity / SLOT_GRANULARITY - 1;
+	SlotList* local = sizeClass < LOCAL_CLASSES ? &localSlots.slots[sizeClass] : nullptr;
+
+	if (local && !local->empty())
+	{
+		char* p = local->back();
+		local->pop_back();
+		return p;
+	}
+
+	Guard guard(m_allocMutex);
+
+	SlotList& shared = m_freeSlots[capacity];
+	if (!shared.empty())
+	{
+		char* p = shared.back();
+		shared.pop_back();
+		while (local && !shared.empty() && (int)local->size() < LOCAL_SLOTS / 2)
+		{
+			local->push_back(shared.back());
+			shared.pop_back();
+		}
+		return p;
+	}
 
-	void* p = realloc(segment->m_data, newSize);
+	char* p = CarveSlot(capacity);
 	if (p)
 	{
-		m_allocated += newSize - segment->m_size;
-		segment->m_size = newSize;
-		segment->m_data = (char*)p;
+		return p;
+	}
+
+	for (auto pool = m_freeSlots.upper_bound(capacity); pool != m_freeSlots.end(); pool++)
+	{
+		if (!pool->second.empty())
+		{
+			p = pool->second.back();
+			pool->second.pop_back();
+			m_reserved += pool->first - capacity;
+			capacity = pool->first;
+			return p;
+		}
+	}
+
+	return nullptr;
+}
+
+// Must be called under "m_allocMutex"
+char* ArticleCache::CarveSlot(int capacity)
+{
+	if (!m_region)
+	{
+		size_t regionSize = (size_t)g_Options->GetArticleCache() * 1024 * 1024 / SLOT_GRANULARITY * SLOT_GRANULARITY;
+		if (regionSize == 0)
+		{
+			return nullptr;
+		}
+#ifdef WIN32
+		m_region = (char*)VirtualAlloc(nullptr, regionSize, MEM_RESERVE, PAGE_NOACCESS);
+#else
+		void* p = mmap(nullptr, regionSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		m_region = p != MAP_FAILED ? (char*)p : nullptr;
+#endif
+		if (!m_region)
+		{
+			return nullptr;
+		}
+		m_regionSize = regionSize;
+	}
+
+	if (m_carved + capacity > m_regionSize)
+	{
+		return nullptr;
 	}
 
+	char* p = m_region + m_carved;
+#ifdef WIN32
+	if (!VirtualAlloc(p, capacity, MEM_COMMIT, PAGE_READWRITE))
+	{
+		return nullptr;
+	}
+#endif
+	m_carved += capacity;
 	return p;
 }
 
-void ArticleCache::Free(CachedSegmentData* segment)
+void ArticleCache::FreeSlot(char* data, int capacity)
 {
-	if (segment->m_size)
+	LocalSlots& localSlots = GetLocalSlots();
+	int sizeClass = capacity / SLOT_GRANULARITY - 1;
+	SlotList* local = sizeClass < LOCAL_CLASSES ? &localSlots.slots[sizeClass] : nullptr;
+
+	if (local && (int)local->size() < LOCAL_SLOTS)
 	{
-		free(segment->m_data);
+		local->push_back(data);
+		return;
+	}
 
-		Guard guard(m_allocMutex);
-		m_allocated -= segment->m_size;
-		if (!m_allocated && g_Options->GetServerMode() && g_Options->GetContinuePartial())
+	// the local list is full, move half of it to the shared list
+	Guard guard(m_allocMutex);
+	SlotList& shared = m_freeSlots[capacity];
+	shared.push_back(data);
+	while (local && (int)local->size() > LOCAL_SLOTS / 2)
+	{
+		shared.push_back(local->back());
+		local->pop_back();
+	}
+}
+
+/*
+ * Merges all free slots back into the region and returns its pages to the system.
+ * The generation is incremented before the reservations are checked the second
+ * time: an allocation running at the same time has either counted its reservation
+ * already, which keeps the slots in place, or sees the new generation and waits
+ * for the outcome in "GetLocalSlots". The per-thread free lists are dropped only
+ * if the slots were merged.
+ * Must be called under "m_allocMutex".
+ */
+void ArticleCache::ReleaseSlots()
+{
+	if (m_reserved > 0 || !m_carved)
+	{
+		return;
+	}
+
+	m_generation++;
+
+	if (m_reserved > 0)
+	{
+		return;
+	}
+
+#ifdef WIN32
+	VirtualFree(m_region, m_carved, MEM_DECOMMIT);
+#else
+	madvise(m_region, m_carved, MADV_DONTNEED);
+#endif
+
+	m_freeSlots.clear();
+	m_carved = 0;
+	m_releasedGeneration = m_generation;
+}
+
+// Must be called under "m_allocMutex"
+void ArticleCache::UnmapRegion()
+{
+	ReleaseSlots();
+
+	if (m_region && !m_carved)
+	{
+#ifdef WIN32
+		VirtualFree(m_region, 0, MEM_RELEASE);
+#else
+		munmap(m_region, m_regionSize);
+#endif
+		m_region = nullptr;
+		m_regionSize = 0;
+	}
+}
+
+void ArticleCache::LogDebugInfo()
+{
+	int cachedFiles;
+	{
+		Guard contentGuard = GuardContent();
+		cachedFiles = (int)m_cachedFiles.size();
+	}
+
+	Guard guard(m_allocMutex);
+
+	size_t allocated = m_allocated;
+	size_t reserved = m_reserved;
+
+	info("   ---------- ArticleCache");
+	info("    Allocated: %" PRIi64 ", Reserved: %" PRIi64 ", Carved: %" PRIi64 ", Region: %" PRIi64,
+		(int64)allocated, (int64)reserved, (int64)m_carved, (int64)m_regionSize);
+	info("    Files with cached articles: %i", cachedFiles);
+	info("    Fill: %i%%, Fragmentation: %i%%",
+		m_regionSize > 0 ? (int)(allocated * 100 / m_regionSize) : 0,
+		m_carved > 0 ? (int)((m_carved - std::min(allocated, m_carved)) * 100 / m_carved) : 0);
+	for (auto& pool : m_freeSlots)
+	{
+		if (!pool.second.empty())
 		{
-			g_DiskState->DeleteCacheFlag();
+			info("    Shared free slots of %i KB: %i", pool.first / 1024, (int)pool.second.size());
 		}
 	}
 }
 
 void ArticleCache::Run()
 {
-	// automatically flush the cache if it is filled to 90% (only in DirectWrite mode)
+	// automatically flush the cache if its slots fill 90% of it (only in DirectWrite mode)
 	size_t fillThreshold = (size_t)g_Options->GetArticleCache() * 1024 * 1024 / 100 * 90;
 
 	int resetCounter = 0;
@@ -827,15 +1329,17 @@ void ArticleCache::Run()
 	while (!IsStopped() || m_allocated > 0)
 	{
 		if ((justFlushed || resetCounter >= 1000 || IsStopped() ||
-			 (g_Options->GetDirectWrite() && m_allocated >= fillThreshold)) &&
+			 (g_Options->GetDirectWrite() && m_reserved >= fillThreshold)) &&
 			m_allocated > 0)
 		{
-			justFlushed = CheckFlush(m_allocated >= fillThreshold);
+			justFlushed = CheckFlush(m_reserved >= fillThreshold);
 			resetCounter = 0;
 		}
 		else if (!m_allocated)
 		{
 			Guard guard(m_allocMutex);
+			// the cache is empty, give the memory back to the system
+			ReleaseSlots();
 			m_allocCond.Wait(m_allocMutex, [&]{ return IsStopped() || m_allocated > 0; });
 			resetCounter = 0;
 		}
@@ -845,6 +1349,9 @@ void ArticleCache::Run()
 			resetCounter += 5;
 		}
 	}
+
+	Guard guard(m_allocMutex);
+	UnmapRegion();
 }
 
 void ArticleCache::Stop()
@@ -863,24 +1370,34 @@ bool ArticleCache::CheckFlush(bool flushEverything)
 	BString<1024> infoName;
 
 	{
+		// the queue is locked only while the file is chosen and its name is formatted;
+		// during flushing the file is protected by "LockFile", which must be called
+		// before the file is destroyed
 		GuardedDownloadQueue downloadQueue = DownloadQueue::Guard();
-		for (NzbInfo* nzbInfo : downloadQueue->GetQueue())
+		Guard contentGuard = GuardContent();
+
+		// prefer files which are not being downloaded anymore
+		for (FileInfo* fileInfo : m_cachedFiles)
 		{
-			if (m_fileInfo)
+			if (!fileInfo->GetFlushLocked() && fileInfo->GetActiveDownloads() == 0)
 			{
+				m_fileInfo = fileInfo;
 				break;
 			}
+		}
 
-			for (FileInfo* fileInfo : nzbInfo->GetFileList())
+		for (auto it = m_cachedFiles.begin(); !m_fileInfo && flushEverything && it != m_cachedFiles.end(); it++)
+		{
+			if (!(*it)->GetFlushLocked())
 			{
-				if (fileInfo->GetCachedArticles() > 0 && (fileInfo->GetActiveDownloads() == 0 || flushEverything))
-				{
-					m_fileInfo = fileInfo;
-					infoName.Format("%s%c%s", m_fileInfo->GetNzbInfo()->GetName(), PATH_SEPARATOR, m_fileInfo->GetFilename());
-					break;
-				}
+				m_fileInfo = *it;
 			}
 		}
+
+		if (m_fileInfo)
+		{
+			infoName.Format("%s%c%s", m_fileInfo->GetNzbInfo()->GetName(), PATH_SEPARATOR, m_fileInfo->GetFilename());
+		}
 	}
 
 	if (m_fileInfo)
@@ -888,7 +1405,9 @@ bool ArticleCache::CheckFlush(bool flushEverything)
 		ArticleWriter articleWriter;
 		articleWriter.SetFileInfo(m_fileInfo);
 		articleWriter.SetInfoName(infoName);
-		articleWriter.FlushCache();
+		articleWriter.FlushCache(m_batchFile);
+
+		Guard contentGuard = GuardContent();
 		m_fileInfo = nullptr;
 		return true;
 	}
@@ -898,6 +1417,36 @@ bool ArticleCache::CheckFlush(bool flushEverything)
 	return false;
 }
 
+/*
+ * Called before the file is deleted from the queue. Returns false if the file
+ * is being flushed at the moment, otherwise prevents it from being chosen for
+ * flushing later.
+ */
+bool ArticleCache::LockFile(FileInfo* fileInfo)
+{
+	Guard contentGuard = GuardContent();
+	if (fileInfo == m_fileInfo)
+	{
+		return false;
+	}
+	fileInfo->SetFlushLocked(true);
+	return true;
+}
+
+void ArticleCache::SetCachedArticles(FileInfo* fileInfo, int cachedArticles)
+{
+	if (fileInfo->GetCachedArticles() == 0 && cachedArticles > 0)
+	{
+		m_cachedFiles.push_back(fileInfo);
+	}
+	else if (fileInfo->GetCachedArticles() > 0 && cachedArticles <= 0)
+	{
+		m_cachedFiles.erase(std::find(m_cachedFiles.begin(), m_cachedFiles.end(), fileInfo));
+	}
+
+	fileInfo->SetCachedArticles(cachedArticles);
+}
+
 ArticleCache::FlushGuard::FlushGuard(Mutex& mutex) : m_guard(&mutex)
 {
 	g_ArticleCache->m_flushing = true;
@@ -30,10 +30,12 @@ class CachedSegmentData : public SegmentData
 {
 public:
 	CachedSegmentData() {}
-	CachedSegmentData(char* data, int size) : m_data(data), m_size(size) {}
+	CachedSegmentData(char* data, int size, int capacity) :
+		m_data(data), m_size(size), m_capacity(capacity) {}
 	CachedSegmentData(const CachedSegmentData&) = delete;
 	CachedSegmentData(CachedSegmentData&& other) :
-		m_data(other.m_data), m_size(other.m_size) { other.m_data = nullptr; other.m_size = 0; }
+		m_data(other.m_data), m_size(other.m_size), m_capacity(other.m_capacity)
+		{ other.m_data = nullptr; other.m_size = 0; other.m_capacity = 0; }
 	CachedSegmentData& operator=(CachedSegmentData&& other);
 	virtual ~CachedSegmentData();
 	virtual char* GetData() { return m_data; }
@@ -41,6 +43,7 @@ public:
 private:
 	char* m_data = nullptr;
 	int m_size = 0;
+	int m_capacity = 0;
 
 	friend class ArticleCache;
 };
@@ -54,16 +57,20 @@ public:
 	void Prepare();
 	bool Start(Decoder::EFormat format, const char* filename, int64 fileSize, int64 articleOffset, int articleSize);
 	bool Write(char* buffer, int len);
+	char* GetCacheBuffer(int len);
 	void Finish(bool success);
 	bool GetDuplicate() { return m_duplicate; }
 	void CompleteFileParts();
 	static bool MoveCompletedFiles(NzbInfo* nzbInfo, const char* oldDestDir);
-	void FlushCache();
+	void FlushCache(BatchFileWriter& batchFile);
 
 private:
 	FileInfo* m_fileInfo;
 	ArticleInfo* m_articleInfo;
 	DiskFile m_outFile;
+	std::unique_ptr<BatchFileWriter> m_directFile;
+	CharBuffer m_directBuffer;
+	int m_directWritten = 0;
 	CString m_tempFilename;
 	CString m_outputFilename;
 	const char* m_resultFilename = nullptr;
@@ -78,9 +85,12 @@ private:
 	bool CreateOutputFile(int64 size);
 	void BuildOutputFilename();
 	void SetWriteBuffer(DiskFile& outFile, int recSize);
+	bool WriteDirect();
+	void CloseDirectFile();
+	void SyncOutputFile();
 };
 
-class ArticleCache : public Thread
+class ArticleCache : public Thread, public Debuggable
 {
 public:
 	class FlushGuard
@@ -103,18 +113,70 @@ public:
 	Guard GuardContent() { return Guard(m_contentMutex); }
 	bool GetFlushing() { return m_flushing; }
 	size_t GetAllocated() { return m_allocated; }
-	bool FileBusy(FileInfo* fileInfo) { return fileInfo == m_fileInfo; }
+	bool LockFile(FileInfo* fileInfo);
+	// Must be called under "GuardContent"
+	void SetCachedArticles(FileInfo* fileInfo, int cachedArticles);
+
+protected:
+	virtual void LogDebugInfo();
 
 private:
-	size_t m_allocated = 0;
+	// Cache memory is one region of the size of the cache limit, reserved from the
+	// system on the first allocation. Slots of size classes (multiples of
+	// SLOT_GRANULARITY) are carved from the region. Freed slots are kept in per-thread
+	// free lists and move to the shared free lists in batches or when the thread exits.
+	// Once the cache becomes empty all slots are merged back into the region and its
+	// pages are returned to the system.
+	static const int SLOT_GRANULARITY = 64 * 1024;
+	// size classes kept in per-thread free lists (up to 1 MB)
+	static const int LOCAL_CLASSES = 16;
+	// slots per size class in a per-thread free list
+	static const int LOCAL_SLOTS = 4;
+	typedef std::vector<char*> SlotList;
+	typedef std::map<int, SlotList> SlotPools;
+	typedef std::deque<FileInfo*> CachedFiles;
+
+	struct LocalSlots
+	{
+		uint64 generation = 0;
+		SlotList slots[LOCAL_CLASSES];
+		~LocalSlots();
+	};
+
+	// incremented when the slots are about to be merged back into the region,
+	// makes the per-thread free lists to be checked
+	static std::atomic<uint64> m_generation;
+	// the generation of the last merge, older per-thread free lists are dropped
+	static uint64 m_releasedGeneration;
+
+	std::atomic<size_t> m_allocated{0};
+	std::atomic<size_t> m_reserved{0};
+	char* m_region = nullptr;
+	size_t m_regionSize = 0;
+	size_t m_carved = 0;
+	bool m_cacheFlag = false;
+	SlotPools m_freeSlots;
 	bool m_flushing = false;
 	Mutex m_allocMutex;
 	Mutex m_flushMutex;
 	Mutex m_contentMutex;
 	FileInfo* m_fileInfo = nullptr;
 	ConditionVar m_allocCond;
+	// Files having cached articles, in the order they got their first cached article.
+	// Files cached earlier are usually downloaded completely and are flushed first.
+	CachedFiles m_cachedFiles;
+	// Reused for all flushed files to keep the io_uring of the cache thread
+	BatchFileWriter m_batchFile;
 
 	bool CheckFlush(bool flushEverything);
+	LocalSlots& GetLocalSlots();
+	void ReturnLocalSlots(LocalSlots& localSlots);
+	char* AllocSlot(int& capacity);
+	char* CarveSlot(int capacity);
+	void FreeSlot(char* data, int capacity);
+	void ReleaseSlots();
+	void UnmapRegion();
+	void UpdateCacheFlag();
 };
 
 extern ArticleCache* g_ArticleCache;
@@ -59,8 +59,9 @@ void Decoder::Clear()
  * At the end of yEnc-data switches back to line by line mode to
  * process '=yend'-marker and EOF-marker.
  * UU-encoded articles are processed completely in line by line mode.
+ * Decoded data goes to "outbuf" (may be "buffer" itself, needs "len" bytes).
  */
-int Decoder::DecodeBuffer(char* buffer, int len)
+int Decoder::DecodeBuffer(char* buffer, int len, char* outbuf)
 {
 	if (m_rawMode)
 	{
@@ -72,7 +73,7 @@ int Decoder::DecodeBuffer(char* buffer, int len)
 
 	if (m_body && m_format == efYenc)
 	{
-		outlen = DecodeYenc(buffer, buffer, len);
+		outlen = DecodeYenc(buffer, outbuf, len);
 		if (m_body)
 		{
 			return outlen;
@@ -90,8 +91,12 @@ int Decoder::DecodeBuffer(char* buffer, int len)
 
 		if (line[0] == '.' && line[1] == '\r')
 		{
+			// keep data following the article, it belongs to the next response
+			// when requests are pipelined
 			m_eof = true;
-			m_lineBuf.SetLength(0);
+			int rem = m_lineBuf.Length() - (int)(end + 1 - m_lineBuf);
+			memmove((char*)m_lineBuf, end + 1, rem);
+			m_lineBuf.SetLength(rem);
 			return outlen;
 		}
 
@@ -105,7 +110,7 @@ int Decoder::DecodeBuffer(char* buffer, int len)
 			ProcessYenc(line, llen);
 			if (m_body)
 			{
-				outlen = DecodeYenc(end + 1, buffer, m_lineBuf.Length() - (int)(end + 1 - m_lineBuf));
+				outlen = DecodeYenc(end + 1, outbuf, m_lineBuf.Length() - (int)(end + 1 - m_lineBuf));
 				if (m_body)
 				{
 					m_lineBuf.SetLength(0);
@@ -137,6 +142,15 @@ int Decoder::DecodeBuffer(char* buffer, int len)
 	return outlen;
 }
 
+/*
+ * Returns data received after the end of article.
+ */
+void Decoder::GetRemainder(char** buffer, int* len)
+{
+	*buffer = m_eof ? (char*)m_lineBuf : nullptr;
+	*len = m_eof ? m_lineBuf.Length() : 0;
+}
+
 Decoder::EFormat Decoder::DetectFormat(const char* buffer, int len)
 {
 	if (!strncmp(buffer, "=ybegin ", 8))
@@ -47,7 +47,8 @@ public:
 	Decoder();
 	EStatus Check();
 	void Clear();
-	int DecodeBuffer(char* buffer, int len);
+	int DecodeBuffer(char* buffer, int len) { return DecodeBuffer(buffer, len, buffer); }
+	int DecodeBuffer(char* buffer, int len, char* outbuf);
 	void SetCrcCheck(bool crcCheck) { m_crcCheck = crcCheck; }
 	void SetRawMode(bool rawMode) { m_rawMode = rawMode; }
 	EFormat GetFormat() { return m_format; }
@@ -57,6 +58,7 @@ public:
 	uint32 GetExpectedCrc() { return m_expectedCRC; }
 	uint32 GetCalculatedCrc() { return m_calculatedCRC; }
 	bool GetEof() { return m_eof; }
+	void GetRemainder(char** buffer, int* len);
 	const char* GetArticleFilename() { return m_articleFilename; }
 
 private: 
@@ -35,7 +35,7 @@ public:
 	NewsServer(int id, bool active, const char* name, const char* host, int port, int ipVersion,
 		const char* user, const char* pass, bool joinGroup,
 		bool tls, const char* cipher, int maxConnections, int retention,
-		int level, int group, bool optional);
+		int level, int group, bool optional, int pipelining);
 	int GetId() { return m_id; }
 	int GetStateId() { return m_stateId; }
 	void SetStateId(int stateId) { m_stateId = stateId; }
@@ -59,6 +59,7 @@ public:
 	bool GetOptional() { return m_optional; }
 	time_t GetBlockTime() { return m_blockTime; }
 	void SetBlockTime(time_t blockTime) { m_blockTime = blockTime; }
+	int GetPipelining() { return m_pipelining; }
 
 private:
 	int m_id;
@@ -79,6 +80,7 @@ private:
 	int m_normLevel;
 	int m_group;
 	bool m_optional = false;
+	int m_pipelining;
 	time_t m_blockTime = 0;
 };
 
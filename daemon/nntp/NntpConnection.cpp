@@ -28,7 +28,8 @@
 static const int CONNECTION_LINEBUFFER_SIZE = 1024*10;
 
 NntpConnection::NntpConnection(NewsServer* newsServer) :
-	Connection(newsServer->GetHost(), newsServer->GetPort(), newsServer->GetTls()), m_newsServer(newsServer)
+	Connection(newsServer->GetHost(), newsServer->GetPort(), newsServer->GetTls()), m_newsServer(newsServer),
+	m_pipelining(newsServer->GetPipelining())
 {
 	m_lineBuf.Reserve(CONNECTION_LINEBUFFER_SIZE);
 	SetCipher(newsServer->GetCipher());
@@ -43,6 +44,11 @@ const char* NntpConnection::Request(const char* req)
 		return nullptr;
 	}
 
+	if (m_pipelining > 1)
+	{
+		return PipelinedRequest(req);
+	}
+
 	m_authError = false;
 
 	WriteLine(req);
@@ -71,6 +77,144 @@ const char* NntpConnection::Request(const char* req)
 	return answer;
 }
 
+/*
+ * The request is queued and sent by the downloader which currently reads from the connection
+ * (or by ourselves if nobody does). Then we wait until all responses to requests made before
+ * ours are consumed. The caller must report via "FinishRequest" when the response is read.
+ * Returns nullptr if the request could not be processed because the pipeline was broken
+ * before our turn; "GetPipelineBroken" tells this case apart from a connection error.
+ */
+const char* NntpConnection::PipelinedRequest(const char* req)
+{
+	{
+		Guard guard(m_pipelineMutex);
+		if (m_pipelineBroken)
+		{
+			return nullptr;
+		}
+
+		int ticket = m_pipelineTicket++;
+		m_pipelineQueue.emplace_back(req);
+
+		m_pipelineCond.Wait(m_pipelineMutex, [&]{ return m_pipelineTurn == ticket || m_pipelineBroken; });
+		if (m_pipelineBroken)
+		{
+			return nullptr;
+		}
+	}
+
+	m_authError = false;
+
+	FlushRequests();
+
+	char* answer = ReadLine(m_lineBuf, m_lineBuf.Size(), nullptr);
+
+	if (answer && !strncmp(answer, "480", 3))
+	{
+		// authorizing now would mix up responses to the requests already sent,
+		// the connection must be reopened instead
+		debug("%s requested authorization in the middle of pipeline", GetHost());
+		m_authError = true;
+	}
+
+	return answer;
+}
+
+/*
+ * Sends requests queued by other downloaders sharing the connection.
+ * Must be called only by the downloader whose response is being read.
+ */
+void NntpConnection::FlushRequests()
+{
+	if (m_pipelining <= 1)
+	{
+		return;
+	}
+
+	StringBuilder requests;
+	{
+		Guard guard(m_pipelineMutex);
+		for (CString& req : m_pipelineQueue)
+		{
+			requests.Append(req);
+		}
+		m_pipelineQueue.clear();
+	}
+
+	if (!requests.Empty())
+	{
+		WriteLine(requests);
+	}
+}
+
+/*
+ * Passes the connection to the downloader whose response comes next.
+ * If the response wasn't consumed completely the responses of all pending
+ * requests are lost and the connection can't be used anymore.
+ */
+void NntpConnection::FinishRequest(bool inSync)
+{
+	if (m_pipelining <= 1)
+	{
+		return;
+	}
+
+	Guard guard(m_pipelineMutex);
+	if (!inSync)
+	{
+		m_pipelineBroken = true;
+	}
+	m_pipelineTurn++;
+	m_pipelineCond.NotifyAll();
+}
+
+bool NntpConnection::GetPipelineBroken()
+{
+	Guard guard(m_pipelineMutex);
+	return m_pipelineBroken;
+}
+
+bool NntpConnection::CanJoinPipeline()
+{
+	Guard guard(m_pipelineMutex);
+	return m_pipelineOpen && !m_pipelineBroken && m_pipelineUsers < m_pipelining;
+}
+
+void NntpConnection::JoinPipeline()
+{
+	Guard guard(m_pipelineMutex);
+	m_pipelineUsers++;
+}
+
+/*
+ * Returns the number of remaining users. The last user closes the connection
+ * if it was broken so that the next one starts with a fresh connection.
+ */
+int NntpConnection::LeavePipeline()
+{
+	Guard guard(m_pipelineMutex);
+	m_pipelineUsers--;
+	if (m_pipelineUsers == 0)
+	{
+		if (m_pipelineBroken)
+		{
+			Connection::Disconnect();
+			m_activeGroup = nullptr;
+		}
+		ResetPipeline();
+	}
+	return m_pipelineUsers;
+}
+
+void NntpConnection::ResetPipeline()
+{
+	m_pipelineQueue.clear();
+	m_pipelineTicket = 0;
+	m_pipelineTurn = 0;
+	m_pipelineOpen = false;
+	m_pipelineBroken = false;
+}
+
 bool NntpConnection::Authenticate()
 {
 	if (strlen(m_newsServer->GetUser()) == 0 || strlen(m_newsServer->GetPassword()) == 0)
@@ -186,6 +330,27 @@ bool NntpConnection::Connect()
 {
 	debug("Opening connection to %s", GetHost());
 
+	if (m_pipelining > 1)
+	{
+		Guard guard(m_pipelineMutex);
+		if (m_pipelineUsers > 1 && (m_status != csConnected || m_pipelineBroken))
+		{
+			// the connection was broken while shared with other downloaders and
+			// can't be reopened while they are still using it;
+			// the caller retries the request on another connection
+			m_pipelineBroken = true;
+			m_pipelineCond.NotifyAll();
+			return false;
+		}
+		if (m_pipelineBroken)
+		{
+			Connection::Disconnect();
+			m_activeGroup = nullptr;
+			ResetPipeline();
+		}
+		m_pipelineOpen = m_status == csConnected;
+	}
+
 	if (m_status == csConnected)
 	{
 		return true;
@@ -220,19 +385,74 @@ bool NntpConnection::Connect()
 
 	debug("Connection to %s established", GetHost());
 
+	if (m_pipelining > 1)
+	{
+		Guard guard(m_pipelineMutex);
+		m_pipelineOpen = true;
+	}
+
 	return true;
 }
 
 bool NntpConnection::Disconnect()
 {
+	if (m_pipelining > 1)
+	{
+		Guard guard(m_pipelineMutex);
+		if (m_pipelineUsers > 1)
+		{
+			// other downloaders are waiting for their responses on this connection;
+			// the connection is closed when the last of them leaves the pipeline
+			m_pipelineBroken = true;
+			m_pipelineCond.NotifyAll();
+			return true;
+		}
+
+		if (m_pipelineBroken || m_pipelineTurn != m_pipelineTicket)
+		{
+			// responses to pending requests are still in the stream, no point to say good bye
+			ResetPipeline();
+			m_activeGroup = nullptr;
+			return Connection::Disconnect();
+		}
+	}
+
 	if (m_status == csConnected)
 	{
 		Request("quit\r\n");
 		m_activeGroup = nullptr;
 	}
+
+	if (m_pipelining > 1)
+	{
+		Guard guard(m_pipelineMutex);
+		ResetPipeline();
+	}
+
 	return Connection::Disconnect();
 }
 
+void NntpConnection::Cancel()
+{
+	Connection::Cancel();
+
+	if (m_pipelining > 1)
+	{
+		BreakPipeline();
+	}
+}
+
+/*
+ * Aborts the requests waiting for their turn without touching the socket,
+ * the response being read at the moment can still be completed.
+ */
+void NntpConnection::BreakPipeline()
+{
+	Guard guard(m_pipelineMutex);
+	m_pipelineBroken = true;
+	m_pipelineCond.NotifyAll();
+}
+
 void NntpConnection::ReportErrorAnswer(const char* msgPrefix, const char* answer)
 {
 	BString<1024> errStr(msgPrefix, m_newsServer->GetName(), m_newsServer->GetHost(), answer);
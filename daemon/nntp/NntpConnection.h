@@ -25,6 +25,7 @@
 #include "NString.h"
 #include "NewsServer.h"
 #include "Connection.h"
+#include "Thread.h"
 
 class NntpConnection : public Connection
 {
@@ -36,14 +37,40 @@ public:
 	const char* Request(const char* req);
 	const char* JoinGroup(const char* grp);
 	bool GetAuthError() { return m_authError; }
+	void Cancel();
+
+	// Pipelining: several downloaders may share one connection. Requests are sent in
+	// the order they were made and responses are read in the same order. Only the
+	// downloader whose response is due reads from or writes to the socket.
+	int GetPipelining() { return m_pipelining; }
+	void FlushRequests();
+	void FinishRequest(bool inSync);
+	bool GetPipelineBroken();
+	void BreakPipeline();
+	bool CanJoinPipeline();
+	void JoinPipeline();
+	int LeavePipeline();
 
 private:
+	typedef std::deque<CString> RequestQueue;
+
 	NewsServer* m_newsServer;
 	CString m_activeGroup;
 	CharBuffer m_lineBuf;
 	bool m_authError = false;
+	int m_pipelining;
+	Mutex m_pipelineMutex;
+	ConditionVar m_pipelineCond;
+	RequestQueue m_pipelineQueue;
+	int m_pipelineUsers = 0;
+	int m_pipelineTicket = 0;
+	int m_pipelineTurn = 0;
+	bool m_pipelineOpen = false;
+	bool m_pipelineBroken = false;
 
 	void Clear();
+	const char* PipelinedRequest(const char* req);
+	void ResetPipeline();
 	void ReportErrorAnswer(const char* msgPrefix, const char* answer);
 	bool Authenticate();
 	bool AuthInfoUser(int recur);
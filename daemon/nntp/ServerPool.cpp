@@ -129,7 +129,8 @@ void ServerPool::InitConnections()
 					connections++;
 				}
 
-				m_levels[normLevel] += connections;
+				// with pipelining each connection can serve multiple downloads
+				m_levels[normLevel] += connections * newsServer->GetPipelining();
 			}
 		}
 	}
@@ -174,12 +175,14 @@ NntpConnection* ServerPool::LockedGetConnection(int level, NewsServer* wantServe
 
 	PooledConnection* connection = nullptr;
 	std::vector<PooledConnection*> candidates;
+	std::vector<PooledConnection*> sharedCandidates;
 	candidates.reserve(m_connections.size());
 
 	for (PooledConnection* candidateConnection : &m_connections)
 	{
 		NewsServer* candidateServer = candidateConnection->GetNewsServer();
-		if (!candidateConnection->GetInUse() && candidateServer->GetActive() &&
+		bool shared = candidateConnection->GetInUse();
+		if ((!shared || candidateConnection->CanJoinPipeline()) && candidateServer->GetActive() &&
 			candidateServer->GetNormLevel() == level &&
 			(!wantServer || candidateServer == wantServer ||
 			 (wantServer->GetGroup() > 0 && wantServer->GetGroup() == candidateServer->GetGroup())) &&
@@ -206,11 +209,18 @@ NntpConnection* ServerPool::LockedGetConnection(int level, NewsServer* wantServe
 
 			if (useConnection)
 			{
-				candidates.push_back(candidateConnection);
+				(shared ? sharedCandidates : candidates).push_back(candidateConnection);
 			}
 		}
 	}
 
+	// Idle connections are preferred; pipelines of busy connections are
+	// filled only when all connections are already in use.
+	if (candidates.empty())
+	{
+		candidates.swap(sharedCandidates);
+	}
+
 	if (!candidates.empty())
 	{
 		// Peeking a random free connection. This is better than taking the first
@@ -219,6 +229,7 @@ NntpConnection* ServerPool::LockedGetConnection(int level, NewsServer* wantServe
 		int randomIndex = rand() % candidates.size();
 		connection = candidates[randomIndex];
 		connection->SetInUse(true);
+		connection->JoinPipeline();
 	}
 
 	if (connection)
@@ -238,7 +249,10 @@ void ServerPool::FreeConnection(NntpConnection* connection, bool used)
 
 	Guard guard(m_connectionsMutex);
 
-	((PooledConnection*)connection)->SetInUse(false);
+	if (connection->LeavePipeline() == 0)
+	{
+		((PooledConnection*)connection)->SetInUse(false);
+	}
 	if (used)
 	{
 		((PooledConnection*)connection)->SetFreeTimeNow();
@@ -170,6 +170,9 @@ StatMeter::StatMeter()
 	debug("Creating StatMeter");
 
 	ResetSpeedStat();
+
+	m_workStateObserver.m_owner = this;
+	g_WorkState->Attach(&m_workStateObserver);
 }
 
 void StatMeter::Init()
@@ -282,6 +285,8 @@ void StatMeter::CalcTotalStat(int* upTimeSec, int* dnTimeSec, int64* allBytes, b
 // Average speed in last 30 seconds
 int StatMeter::CalcCurrentDownloadSpeed()
 {
+	CollectSpeedReadings();
+
 	if (m_standBy)
 	{
 		return 0;
@@ -299,12 +304,98 @@ int StatMeter::CalcCurrentDownloadSpeed()
 // Amount of data downloaded in current second
 int StatMeter::CalcMomentaryDownloadSpeed()
 {
+	CollectSpeedReadings();
+
 	time_t curTime = Util::CurrentTime();
 	int speed = curTime == m_curSecTime ? m_curSecBytes : 0;
 	return speed;
 }
 
+/*
+ * Called by downloader threads for every received buffer. The bytes are added
+ * to the thread's shard without locking and are accounted in speed meter slots
+ * in "CollectSpeedReadings".
+ */
 void StatMeter::AddSpeedReading(int bytes)
+{
+	int shard = (int)(std::hash<std::thread::id>()(std::this_thread::get_id()) % SPEEDMETER_SHARDS);
+	m_speedShards[shard].bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+/*
+ * Moves bytes reported by downloader threads into speed meter slots.
+ * Called by QueueCoordinator periodically and before speed calculations.
+ */
+void StatMeter::CollectSpeedReadings()
+{
+	int64 bytes = 0;
+	for (SpeedShard& speedShard : m_speedShards)
+	{
+		bytes += speedShard.bytes.exchange(0, std::memory_order_relaxed);
+	}
+
+	Guard guard(m_statMutex);
+	UpdateSpeedSlots(bytes);
+}
+
+/*
+ * Reserves bandwidth for data just received by a downloader thread.
+ * Returns the time in milliseconds the caller must wait before receiving more data
+ * in order to keep the speed limit. Reservations are served in the order they
+ * are made, which shares the bandwidth fairly among all connections.
+ */
+int StatMeter::ReserveDownloadBytes(int bytes)
+{
+	int speedLimit = g_WorkState->GetSpeedLimit();
+	if (speedLimit <= 0)
+	{
+		return 0;
+	}
+
+	int64 curTicks = Util::CurrentTicks();
+
+	Guard guard(m_limitMutex);
+	if (speedLimit != m_limitSpeed)
+	{
+		// reservations made at the old limit are dropped
+		m_limitSpeed = speedLimit;
+		m_limitNextFree = curTicks;
+	}
+
+	// unused bandwidth can be accumulated only for a short time to limit bursts
+	m_limitNextFree = std::max(m_limitNextFree, curTicks - SPEEDLIMIT_BURST);
+	m_limitNextFree += (int64)bytes * 1000000 / speedLimit;
+	return (int)(std::max(m_limitNextFree - curTicks, (int64)0) / 1000);
+}
+
+/*
+ * Blocks the downloader thread for the time returned by "ReserveDownloadBytes".
+ * The wait ends early if the speed limit is changed or if the thread is stopped.
+ */
+void StatMeter::WaitDownloadBytes(int waitTime, Thread* thread)
+{
+	int64 deadline = Util::CurrentTicks() + (int64)waitTime * 1000;
+	int speedLimit = g_WorkState->GetSpeedLimit();
+
+	Guard guard(m_limitMutex);
+	while (!thread->IsStopped() && g_WorkState->GetSpeedLimit() == speedLimit)
+	{
+		int64 remaining = deadline - Util::CurrentTicks();
+		if (remaining <= 0)
+		{
+			break;
+		}
+		m_limitCond.WaitFor(m_limitMutex, (int)((remaining + 999) / 1000));
+	}
+}
+
+void StatMeter::WakeUpDownloadWaiters()
+{
+	Guard guard(m_limitMutex);
+	m_limitCond.NotifyAll();
+}
+
+void StatMeter::UpdateSpeedSlots(int64 bytes)
 {
 	time_t curTime = Util::CurrentTime();
 	int nowSlot = (int)curTime / SPEEDMETER_SLOTSIZE;
@@ -314,7 +405,7 @@ void StatMeter::AddSpeedReading(int bytes)
 		m_curSecTime =	curTime;
 		m_curSecBytes = 0;
 	}
-	m_curSecBytes += bytes;
+	m_curSecBytes += (int)bytes;
 
 	while (nowSlot > m_speedTime[m_speedBytesIndex])
 	{
@@ -353,7 +444,7 @@ void StatMeter::AddSpeedReading(int bytes)
 	{
 		m_speedStartTime = nowSlot;
 	}
-	m_speedBytes[m_speedBytesIndex] += bytes;
+	m_speedBytes[m_speedBytesIndex] += (int)bytes;
 	m_speedTotalBytes += bytes;
 	m_allBytes += bytes;
 }
@@ -23,6 +23,7 @@
 
 #include "Log.h"
 #include "Thread.h"
+#include "Observer.h"
 #include "Util.h"
 
 class ServerVolume
@@ -81,6 +82,10 @@ public:
 	int CalcCurrentDownloadSpeed();
 	int CalcMomentaryDownloadSpeed();
 	void AddSpeedReading(int bytes);
+	void CollectSpeedReadings();
+	int ReserveDownloadBytes(int bytes);
+	void WaitDownloadBytes(int waitTime, Thread* thread);
+	void WakeUpDownloadWaiters();
 	void AddServerData(int bytes, int serverId);
 	void CalcTotalStat(int* upTimeSec, int* dnTimeSec, int64* allBytes, bool* standBy);
 	void CalcQuotaUsage(int64& monthBytes, int64& dayBytes);
@@ -94,9 +99,25 @@ protected:
 	virtual void LogDebugInfo();
 
 private:
+	class WorkStateObserver : public Observer
+	{
+	public:
+		StatMeter* m_owner;
+		virtual void Update(Subject* caller, void* aspect) { m_owner->WakeUpDownloadWaiters(); }
+	};
+
+	// bytes reported by downloader threads, collected into speed meter slots periodically;
+	// each thread uses its own shard to avoid contention, shards are on separate cache lines
+	struct alignas(64) SpeedShard
+	{
+		std::atomic<int64> bytes{0};
+	};
+
 	// speed meter
 	static const int SPEEDMETER_SLOTS = 30;
 	static const int SPEEDMETER_SLOTSIZE = 1; //Split elapsed time into this number of secs.
+	static const int SPEEDMETER_SHARDS = 16;
+	SpeedShard m_speedShards[SPEEDMETER_SHARDS];
 	int m_speedBytes[SPEEDMETER_SLOTS];
 	int64 m_speedTotalBytes;
 	int m_speedTime[SPEEDMETER_SLOTS];
@@ -106,6 +127,15 @@ private:
 	int m_curSecBytes;
 	time_t m_curSecTime;
 
+	// speed limiter (token bucket): time in microseconds when the bandwidth
+	// reserved so far is used up, at the speed limit "m_limitSpeed"
+	static const int SPEEDLIMIT_BURST = 100000;
+	int64 m_limitNextFree = 0;
+	int m_limitSpeed = 0;
+	Mutex m_limitMutex;
+	ConditionVar m_limitCond;
+	WorkStateObserver m_workStateObserver;
+
 	// time
 	int64 m_allBytes = 0;
 	time_t m_startServer = 0;
@@ -122,6 +152,7 @@ private:
 	Mutex m_volumeMutex;
 
 	void ResetSpeedStat();
+	void UpdateSpeedSlots(int64 bytes);
 	void AdjustTimeOffset();
 	void CheckQuota();
 	int CalcMonthSlots(ServerVolume& volume);
@@ -44,6 +44,11 @@ const char* Par2CmdLineErrStr[] = { "OK",
 
 class RepairThread;
 
+static const int MAX_BATCH_SIZE = 8;
+static const size_t TILE_SIZE = 64 * 1024;
+static const size_t MIN_TILE_SIZE = 4 * 1024;
+static const Par2::u32 TILE_OUTPUTS = 4;
+
 class Repairer : public Par2::Par2Repairer, public ParChecker::AbstractRepairer
 {
 public:
@@ -62,41 +67,98 @@ protected:
 	virtual bool ScanDataFile(Par2::DiskFile *diskfile, Par2::Par2RepairerSourceFile* &sourcefile,
 		Par2::MatchType &matchtype, Par2::MD5Hash &hashfull, Par2::MD5Hash &hash16k, Par2::u32 &count);
 	virtual bool RepairData(Par2::u32 inputindex, size_t blocklength);
+	virtual Par2::u32 ExtraBufferCount();
+	virtual bool VerifyFiles(const vector<Par2::Par2RepairerSourceFile*>& files, bool& finalresult);
 
 private:
-	typedef vector<Thread*> Threads;
+	struct BatchInput
+	{
+		Par2::u32 inputindex;
+		Par2::u8* buffer;
+	};
+
+	typedef vector<BatchInput> Batch;
+	typedef vector<std::unique_ptr<Par2::u8[]>> Buffers;
+	typedef std::unique_ptr<std::atomic<uint64>[]> TaskRanges;
 
 	ParChecker* m_owner;
 	Par2::CommandLine commandLine;
-	Threads m_threads;
 	bool m_parallel;
 	Mutex progresslock;
 
+	// Input blocks are collected into batches. While one batch is being
+	// processed by the repair threads the next one is read from disk.
+	// The input buffer of the repairer is the first of the batch buffers.
+	int m_batchSize;
+	Batch m_batch[2];
+	int m_collecting;
+	Buffers m_buffers;
+	void* m_ownInputBuffer;
+
+	// A batch is split into tiles: a stripe of all input blocks of the batch
+	// times a group of output blocks. Each thread has a range of tiles and
+	// steals tiles from the other ranges when its own one is done.
+	int m_threadCount;
+	TaskRanges m_taskRanges;
+	Batch* m_taskBatch;
+	size_t m_taskLength;
+	size_t m_tileSize;
+	int m_stripeCount;
+	std::atomic<int> m_pendingTasks{0};
+	int m_taskNumber = 0;
+	int m_runningThreads = 0;
+	bool m_stopThreads = false;
+	Mutex m_taskMutex;
+	ConditionVar m_taskCond;
+	ConditionVar m_doneCond;
+
+	// Source files are verified concurrently, each thread takes the next
+	// file from the list until all are done.
+	const vector<Par2::Par2RepairerSourceFile*>* m_verifyFiles;
+	std::atomic<int> m_verifyNext{0};
+	std::atomic<bool> m_verifyResult{true};
+	std::atomic<bool> m_verifyStop{false};
+	int m_verifyThreads = 0;
+
 	virtual void BeginRepair();
 	virtual void EndRepair();
-	void RepairBlock(Par2::u32 inputindex, Par2::u32 outputindex, size_t blocklength);
-	static void SyncSleep();
+	int GetRepairThreads(int* maxThreads);
+	Par2::u8* GetBuffer(int index) { return index == 0 ? (Par2::u8*)m_ownInputBuffer : m_buffers[index - 1].get(); }
+	void StartTasks(Batch* batch, size_t blocklength);
+	void WaitTasks();
+	void ProcessTasks(int threadIndex);
+	bool TakeTask(int threadIndex, int* task);
+	void RepairTile(int task);
+	void VerifyTasks();
 
 	friend class ParChecker;
 	friend class RepairThread;
+	friend class VerifyThread;
 };
 
 class RepairThread : public Thread
 {
 public:
-	RepairThread(Repairer* owner) : m_owner(owner) {}
-	void RepairBlock(Par2::u32 inputindex, Par2::u32 outputindex, size_t blocklength);
-	bool IsWorking() { return m_working; }
+	RepairThread(Repairer* owner, int index) : m_owner(owner), m_index(index) {}
 
 protected:
 	virtual void Run();
 
 private:
 	Repairer* m_owner;
-	Par2::u32 m_inputindex;
-	Par2::u32 m_outputindex;
-	size_t m_blocklength;
-	volatile bool m_working = false;
+	int m_index;
+};
+
+class VerifyThread : public Thread
+{
+public:
+	VerifyThread(Repairer* owner) : m_owner(owner) {}
+
+protected:
+	virtual void Run() { m_owner->VerifyTasks(); }
+
+private:
+	Repairer* m_owner;
 };
 
 class RepairCreatorPacket : public Par2::CreatorPacket
@@ -153,7 +215,10 @@ bool Repairer::ScanDataFile(Par2::DiskFile *diskfile, Par2::Par2RepairerSourceFi
 		string name;
 		Par2::DiskFile::SplitFilename(diskfile->FileName(), path, name);
 
-		sig_filename(name);
+		{
+			std::lock_guard<std::mutex> lock(verificationmutex);
+			sig_filename(name);
+		}
 
 		if (!(m_owner->GetStage() == ParChecker::ptVerifyingRepaired && m_owner->GetParFull()))
 		{
@@ -161,6 +226,7 @@ bool Repairer::ScanDataFile(Par2::DiskFile *diskfile, Par2::Par2RepairerSourceFi
 			ParChecker::EFileStatus fileStatus = m_owner->VerifyDataFile(diskfile, sourcefile, &availableBlocks);
 			if (fileStatus != ParChecker::fsUnknown)
 			{
+				std::lock_guard<std::mutex> lock(verificationmutex);
 				sig_done(name, availableBlocks, sourcefile->BlockCount());
 				sig_progress(1000);
 				matchtype = fileStatus == ParChecker::fsSuccess ? Par2::eFullMatch :
@@ -174,12 +240,33 @@ bool Repairer::ScanDataFile(Par2::DiskFile *diskfile, Par2::Par2RepairerSourceFi
 	return Par2Repairer::ScanDataFile(diskfile, sourcefile, matchtype, hashfull, hash16k, count);
 }
 
-void Repairer::BeginRepair()
+int Repairer::GetRepairThreads(int* maxThreads)
 {
-	int maxThreads = g_Options->GetParThreads() > 0 ? g_Options->GetParThreads() : Util::NumberOfCpuCores();
-	maxThreads = maxThreads > 0 ? maxThreads : 1;
+	*maxThreads = g_Options->GetParThreads() > 0 ? g_Options->GetParThreads() : Util::NumberOfCpuCores();
+	*maxThreads = *maxThreads > 0 ? *maxThreads : 1;
+
+	// the blocks are split into tiles, several threads can work on one block
+	return missingblockcount > 0 ? *maxThreads : 1;
+}
 
-	int threads = maxThreads > (int)missingblockcount ? (int)missingblockcount : maxThreads;
+/*
+ * Called before the buffers are allocated. The batch buffers are taken from
+ * the par-buffer memory limit, which makes the output chunks smaller. Batches
+ * are limited to a quarter of the output blocks to keep the chunks from
+ * shrinking too much, since every chunk is one more pass over the input files.
+ */
+Par2::u32 Repairer::ExtraBufferCount()
+{
+	int maxThreads;
+	bool parallel = GetRepairThreads(&maxThreads) > 1;
+	m_batchSize = std::min(MAX_BATCH_SIZE, std::max(1, (int)missingblockcount / 4));
+	return parallel ? m_batchSize * 2 - 1 : 0;
+}
+
+void Repairer::BeginRepair()
+{
+	int maxThreads;
+	int threads = GetRepairThreads(&maxThreads);
 
 	m_owner->PrintMessage(Message::mkInfo, "Using %i of max %i thread(s) to repair %i block(s) for %s",
 		threads, maxThreads, (int)missingblockcount, *m_owner->m_nzbName);
@@ -188,17 +275,26 @@ void Repairer::BeginRepair()
 
 	if (m_parallel)
 	{
+		m_ownInputBuffer = inputbuffer;
+		for (int i = 1; i < m_batchSize * 2; i++)
+		{
+			m_buffers.emplace_back(new Par2::u8[(size_t)chunksize]);
+		}
+		m_batch[0].clear();
+		m_batch[1].clear();
+		m_collecting = 0;
+
+		m_threadCount = threads;
+		m_taskRanges = std::make_unique<std::atomic<uint64>[]>(threads);
+		m_runningThreads = threads;
+		m_stopThreads = false;
 		for (int i = 0; i < threads; i++)
 		{
-			RepairThread* repairThread = new RepairThread(this);
-			m_threads.push_back(repairThread);
+			m_taskRanges[i] = 0;
+			RepairThread* repairThread = new RepairThread(this, i);
 			repairThread->SetAutoDestroy(true);
 			repairThread->Start();
 		}
-
-#ifdef WIN32
-		timeBeginPeriod(1);
-#endif
 	}
 }
 
@@ -206,14 +302,15 @@ void Repairer::EndRepair()
 {
 	if (m_parallel)
 	{
-		for (Thread* thread : m_threads)
-		{
-			thread->Stop();
-		}
+		WaitTasks();
 
-#ifdef WIN32
-		timeEndPeriod(1);
-#endif
+		Guard guard(m_taskMutex);
+		m_stopThreads = true;
+		m_taskCond.NotifyAll();
+		m_doneCond.Wait(m_taskMutex, [&]{ return m_runningThreads == 0; });
+
+		inputbuffer = m_ownInputBuffer;
+		m_buffers.clear();
 	}
 }
 
@@ -224,59 +321,135 @@ bool Repairer::RepairData(Par2::u32 inputindex, size_t blocklength)
 		return false;
 	}
 
-	for (Par2::u32 outputindex = 0; outputindex < missingblockcount; )
+	Batch& batch = m_batch[m_collecting];
+	batch.push_back({inputindex, (Par2::u8*)inputbuffer});
+
+	bool lastInput = inputindex + 1 == inputblocks.size();
+	if ((int)batch.size() == m_batchSize || lastInput || cancelled)
 	{
-		bool jobAdded = false;
-		for (Thread* thread : m_threads)
+		WaitTasks();
+		StartTasks(&batch, blocklength);
+		m_collecting = 1 - m_collecting;
+		m_batch[m_collecting].clear();
+
+		if (lastInput || cancelled)
 		{
-			RepairThread* repairThread = (RepairThread*)thread;
-			if (!repairThread->IsWorking())
-			{
-				repairThread->RepairBlock(inputindex, outputindex, blocklength);
-				outputindex++;
-				jobAdded = true;
-				break;
-			}
+			// the output blocks are written after the last input block
+			WaitTasks();
 		}
+	}
 
-		if (cancelled)
+	// the next input block is read into a free buffer
+	inputbuffer = GetBuffer(m_collecting * m_batchSize + (int)m_batch[m_collecting].size());
+
+	return true;
+}
+
+void Repairer::StartTasks(Batch* batch, size_t blocklength)
+{
+	// Stripes of the output blocks of one tile should stay in the CPU cache
+	// while all input blocks of the batch are added to them. The stripes are
+	// made smaller if there are not enough tiles for all threads.
+	int groupCount = (missingblockcount + TILE_OUTPUTS - 1) / TILE_OUTPUTS;
+	size_t tileSize = TILE_SIZE;
+	while (tileSize > MIN_TILE_SIZE &&
+		(int)((blocklength + tileSize - 1) / tileSize) * groupCount < m_threadCount * 4)
+	{
+		tileSize /= 2;
+	}
+
+	m_taskBatch = batch;
+	m_taskLength = blocklength;
+	m_tileSize = tileSize;
+	m_stripeCount = (int)((blocklength + tileSize - 1) / tileSize);
+
+	int taskCount = m_stripeCount * groupCount;
+	m_pendingTasks = taskCount;
+
+	for (int i = 0; i < m_threadCount; i++)
+	{
+		uint64 begin = (uint64)taskCount * i / m_threadCount;
+		uint64 end = (uint64)taskCount * (i + 1) / m_threadCount;
+		m_taskRanges[i] = (begin << 32) | end;
+	}
+
+	Guard guard(m_taskMutex);
+	m_taskNumber++;
+	m_taskCond.NotifyAll();
+}
+
+void Repairer::WaitTasks()
+{
+	Guard guard(m_taskMutex);
+	m_doneCond.Wait(m_taskMutex, [&]{ return m_pendingTasks == 0; });
+}
+
+void Repairer::ProcessTasks(int threadIndex)
+{
+	int task;
+	while (TakeTask(threadIndex, &task))
+	{
+		if (!cancelled)
 		{
-			break;
+			RepairTile(task);
 		}
 
-		if (!jobAdded)
+		if (--m_pendingTasks == 0)
 		{
-			SyncSleep();
+			Guard guard(m_taskMutex);
+			m_doneCond.NotifyAll();
 		}
 	}
+}
 
-	// Wait until all m_Threads complete their jobs
-	bool working = true;
-	while (working)
+// Takes a tile from the front of the own range or steals one from the back of another range
+bool Repairer::TakeTask(int threadIndex, int* task)
+{
+	for (int i = 0; i < m_threadCount; i++)
 	{
-		working = false;
-		for (Thread* thread : m_threads)
+		int rangeIndex = (threadIndex + i) % m_threadCount;
+		std::atomic<uint64>& range = m_taskRanges[rangeIndex];
+		uint64 value = range;
+		while (true)
 		{
-			RepairThread* repairThread = (RepairThread*)thread;
-			if (repairThread->IsWorking())
+			uint32 begin = (uint32)(value >> 32);
+			uint32 end = (uint32)value;
+			if (begin >= end)
 			{
-				working = true;
-				SyncSleep();
 				break;
 			}
+
+			uint64 newValue = i == 0 ? ((uint64)(begin + 1) << 32) | end : ((uint64)begin << 32) | (end - 1);
+			if (range.compare_exchange_weak(value, newValue))
+			{
+				*task = i == 0 ? begin : end - 1;
+				return true;
+			}
 		}
 	}
 
-	return true;
+	return false;
 }
 
-void Repairer::RepairBlock(Par2::u32 inputindex, Par2::u32 outputindex, size_t blocklength)
+void Repairer::RepairTile(int task)
 {
-	// Select the appropriate part of the output buffer
-	void *outbuf = &((Par2::u8*)outputbuffer)[chunksize * outputindex];
+	int stripe = task % m_stripeCount;
+	Par2::u32 firstOutput = (Par2::u32)(task / m_stripeCount) * TILE_OUTPUTS;
+	Par2::u32 lastOutput = std::min(firstOutput + TILE_OUTPUTS, missingblockcount);
+	size_t offset = stripe * m_tileSize;
+	size_t length = std::min(m_tileSize, m_taskLength - offset);
 
-	// Process the data
-	rs.Process(blocklength, inputindex, inputbuffer, outputindex, outbuf);
+	for (BatchInput& input : *m_taskBatch)
+	{
+		for (Par2::u32 outputindex = firstOutput; outputindex < lastOutput; outputindex++)
+		{
+			// Select the appropriate part of the output buffer
+			Par2::u8* outbuf = &((Par2::u8*)outputbuffer)[chunksize * outputindex + offset];
+
+			// Process the data
+			rs.Process(length, input.inputindex, input.buffer + offset, outputindex, outbuf);
+		}
+	}
 
 	if (noiselevel > Par2::CommandLine::nlQuiet)
 	{
@@ -287,7 +460,7 @@ void Repairer::RepairBlock(Par2::u32 inputindex, Par2::u32 outputindex, size_t b
 		{
 			Guard guard(progresslock);
 			oldfraction = (Par2::u32)(1000 * progress / totaldata);
-			progress += blocklength;
+			progress += length * m_taskBatch->size() * (lastOutput - firstOutput);
 			newfraction = (Par2::u32)(1000 * progress / totaldata);
 		}
 
@@ -298,44 +471,96 @@ void Repairer::RepairBlock(Par2::u32 inputindex, Par2::u32 outputindex, size_t b
 	}
 }
 
-// Sleep for synchronisation
-void Repairer::SyncSleep()
+bool Repairer::VerifyFiles(const vector<Par2::Par2RepairerSourceFile*>& files, bool& finalresult)
 {
-#ifdef WIN32
-	// Windows doesn't allow sleep intervals less than one millisecond
-	Sleep(1);
-#else
-	usleep(100);
-#endif
+	int threads = g_Options->GetParThreads() > 0 ? g_Options->GetParThreads() : Util::NumberOfCpuCores();
+	threads = std::min(threads, (int)files.size());
+	if (threads < 2)
+	{
+		return false;
+	}
+
+	debug("Using %i thread(s) to verify %i file(s)", threads, (int)files.size());
+
+	m_verifyFiles = &files;
+	m_verifyNext = 0;
+	m_verifyResult = true;
+	m_verifyStop = false;
+	m_verifyThreads = threads;
+
+	// the read-ahead buffers of all threads together stay within the limit of one checksummer
+	hashahead = Par2::FileCheckSummer::MaxHashAhead / threads;
+
+	for (int i = 0; i < threads; i++)
+	{
+		VerifyThread* verifyThread = new VerifyThread(this);
+		verifyThread->SetAutoDestroy(true);
+		verifyThread->Start();
+	}
+
+	Guard guard(m_taskMutex);
+	m_doneCond.Wait(m_taskMutex, [&]{ return m_verifyThreads == 0; });
+
+	hashahead = Par2::FileCheckSummer::MaxHashAhead;
+	finalresult = finalresult && m_verifyResult;
+	return true;
 }
 
-void RepairThread::Run()
+void Repairer::VerifyTasks()
 {
-	while (!IsStopped())
+	while (!cancelled && !m_verifyStop)
 	{
-		if (m_working)
+		int index = m_verifyNext++;
+		if (index >= (int)m_verifyFiles->size())
 		{
-			m_owner->RepairBlock(m_inputindex, m_outputindex, m_blocklength);
-			m_working = false;
+			break;
 		}
-		else
+
+		bool fileResult = true;
+		if (!VerifySourceFile(m_verifyFiles->at(index), fileResult))
+		{
+			m_verifyStop = true;
+			fileResult = false;
+		}
+
+		if (!fileResult)
 		{
-			Repairer::SyncSleep();
+			m_verifyResult = false;
 		}
 	}
+
+	Guard guard(m_taskMutex);
+	m_verifyThreads--;
+	m_doneCond.NotifyAll();
 }
 
-void RepairThread::RepairBlock(Par2::u32 inputindex, Par2::u32 outputindex, size_t blocklength)
+void RepairThread::Run()
 {
-	m_inputindex = inputindex;
-	m_outputindex = outputindex;
-	m_blocklength = blocklength;
-	m_working = true;
+	int taskNumber = 0;
+	while (true)
+	{
+		{
+			Guard guard(m_owner->m_taskMutex);
+			m_owner->m_taskCond.Wait(m_owner->m_taskMutex,
+				[&]{ return m_owner->m_taskNumber != taskNumber || m_owner->m_stopThreads; });
+			if (m_owner->m_stopThreads)
+			{
+				m_owner->m_runningThreads--;
+				m_owner->m_doneCond.NotifyAll();
+				break;
+			}
+			taskNumber = m_owner->m_taskNumber;
+		}
+
+		m_owner->ProcessTasks(m_index);
+	}
 }
 
 
 int ParChecker::StreamBuf::overflow(int ch)
 {
+	Guard guard(m_mutex);
+
 	if (ch == '\n' || ch == '\r')
 	{
 		char* msg = (char*)*m_buffer;
@@ -1342,7 +1567,9 @@ ParChecker::EFileStatus ParChecker::VerifyDataFile(void* diskfile, void* sourcef
 	{
 		return fileStatus;
 	}
-	else if ((fileStatus == fsSuccess && !VerifySuccessDataFile(diskfile, sourcefile, downloadCrc)) ||
+	else if ((fileStatus == fsSuccess &&
+			!VerifyHashDataFile(sourcefile, FindFileHash(FileSystem::BaseFileName(filename))) &&
+			!VerifySuccessDataFile(diskfile, sourcefile, downloadCrc)) ||
 		(fileStatus == fsPartial && !VerifyPartialDataFile(diskfile, sourcefile, &segments, &validBlocks)))
 	{
 		PrintMessage(Message::mkWarning, "Quick verification failed for %s file %s, performing full verification instead",
@@ -1351,6 +1578,7 @@ ParChecker::EFileStatus ParChecker::VerifyDataFile(void* diskfile, void* sourcef
 	}
 
 	// attach verification blocks to the file
+	std::lock_guard<std::mutex> lock(GetRepairer()->verificationmutex);
 	*availableBlocks = 0;
 	Par2::u64 blocksize = GetRepairer()->mainpacket->BlockSize();
 	std::deque<const Par2::VerificationHashEntry*> undoList;
@@ -1412,6 +1640,27 @@ bool ParChecker::VerifySuccessDataFile(void* diskfile, void* sourcefile, uint32
 	return parCrc == downloadCrc;
 }
 
+/*
+ * The full-file MD5 computed during download (if the file was assembled in memory)
+ * is the same check libpar2 uses to recognize a complete file, only without reading it.
+ */
+bool ParChecker::VerifyHashDataFile(void* sourcefile, const char* downloadHash)
+{
+	Par2::Par2RepairerSourceFile* sourceFile = (Par2::Par2RepairerSourceFile*)sourcefile;
+	Par2::DescriptionPacket* packet = sourceFile->GetDescriptionPacket();
+
+	if (Util::EmptyStr(downloadHash) || !packet ||
+		packet->FileSize() != sourceFile->GetTargetFile()->FileSize())
+	{
+		return false;
+	}
+
+	std::string parHash = packet->HashFull().print();
+	debug("Download-MD5: %s, Par-MD5: %s", downloadHash, parHash.c_str());
+
+	return !strcasecmp(parHash.c_str(), downloadHash);
+}
+
 bool ParChecker::VerifyPartialDataFile(void* diskfile, void* sourcefile, SegmentList* segments, ValidBlocks* validBlocks)
 {
 	Par2::Par2RepairerSourceFile* sourceFile = (Par2::Par2RepairerSourceFile*)sourcefile;
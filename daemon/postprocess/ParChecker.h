@@ -27,6 +27,7 @@
 #include "Container.h"
 #include "FileSystem.h"
 #include "Log.h"
+#include "Thread.h"
 
 class Repairer;
 
@@ -133,6 +134,7 @@ protected:
 	virtual bool IsParredFile(const char* filename) { return false; }
 	virtual EFileStatus FindFileCrc(const char* filename, uint32* crc, SegmentList* segments) { return fsUnknown; }
 	virtual const char* FindFileOrigname(const char* filename) { return nullptr; }
+	virtual const char* FindFileHash(const char* filename) { return nullptr; }
 	virtual void RequestDupeSources(DupeSourceList* dupeSourceList) {}
 	virtual void StatDupeSources(DupeSourceList* dupeSourceList) {}
 	EStage GetStage() { return m_stage; }
@@ -150,6 +152,7 @@ private:
 		ParChecker* m_owner;
 		Message::EKind m_kind;
 		StringBuilder m_buffer;
+		Mutex m_mutex;
 	};
 
 	typedef std::deque<CString> FileList;
@@ -215,6 +218,7 @@ private:
 	// Par2::DiskFile* pDiskfile, Par2::Par2RepairerSourceFile* pSourcefile
 	EFileStatus VerifyDataFile(void* diskfile, void* sourcefile, int* availableBlocks);
 	bool VerifySuccessDataFile(void* diskfile, void* sourcefile, uint32 downloadCrc);
+	bool VerifyHashDataFile(void* sourcefile, const char* downloadHash);
 	bool VerifyPartialDataFile(void* diskfile, void* sourcefile, SegmentList* segments, ValidBlocks* validBlocks);
 	void SortExtraFiles(void* extrafiles);
 	bool SmartCalcFileRangeCrc(DiskFile& file, int64 start, int64 end, SegmentList* segments,
@@ -128,6 +128,20 @@ const char* RepairController::PostParChecker::FindFileOrigname(const char* filen
 	return nullptr;
 }
 
+const char* RepairController::PostParChecker::FindFileHash(const char* filename)
+{
+	for (CompletedFile& completedFile : m_postInfo->GetNzbInfo()->GetCompletedFiles())
+	{
+		if (!strcasecmp(completedFile.GetFilename(), filename))
+		{
+			return completedFile.GetStatus() == CompletedFile::cfSuccess &&
+				!m_postInfo->GetNzbInfo()->GetReprocess() ? completedFile.GetHashFull() : nullptr;
+		}
+	}
+
+	return nullptr;
+}
+
 void RepairController::PostParChecker::RequestDupeSources(DupeSourceList* dupeSourceList)
 {
 	GuardedDownloadQueue downloadQueue = DownloadQueue::Guard();
@@ -174,6 +188,7 @@ void RepairController::PostParChecker::StatDupeSources(DupeSourceList* dupeSourc
 					historyInfo->GetNzbInfo()->GetId() == dupeSource.GetId())
 				{
 					historyInfo->GetNzbInfo()->SetExtraParBlocks(historyInfo->GetNzbInfo()->GetExtraParBlocks() - dupeSource.GetUsedBlocks());
+					historyInfo->SetChanged(true);
 				}
 			}
 		}
@@ -69,6 +69,7 @@ private:
 		virtual bool IsParredFile(const char* filename);
 		virtual EFileStatus FindFileCrc(const char* filename, uint32* crc, SegmentList* segments);
 		virtual const char* FindFileOrigname(const char* filename);
+		virtual const char* FindFileHash(const char* filename);
 		virtual void RequestDupeSources(DupeSourceList* dupeSourceList);
 		virtual void StatDupeSources(DupeSourceList* dupeSourceList);
 	private:
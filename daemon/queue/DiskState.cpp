@@ -27,20 +27,70 @@
 #include "FileSystem.h"
 
 static const char* FORMATVERSION_SIGNATURE = "nzbget diskstate file version ";
-const int DISKSTATE_QUEUE_VERSION = 62;
+const int DISKSTATE_QUEUE_VERSION = 63;
 const int DISKSTATE_FILE_VERSION = 6;
 const int DISKSTATE_STATS_VERSION = 3;
 const int DISKSTATE_FEEDS_VERSION = 3;
+const char* HISTORY_JOURNAL_FILENAME = "history.journal";
+const int64 HISTORY_JOURNAL_MIN_SIZE = 256 * 1024;
 
+/*
+ * Files opened for reading are loaded into memory at once and parsed from there,
+ * which is much faster than reading them line by line through stdio. Lines are
+ * parsed by "ScanLine" without "sscanf", see below.
+ * Lines printed with "PrintLine" are collected in memory and then passed
+ * to the state writer.
+ * The files remain in text format on purpose: with a preloaded buffer the
+ * parsing takes only a small part of the loading time, most of it is spent
+ * in creating the queue and history objects, which a binary format would not
+ * save (see the benchmark in "DiskStateTest.cpp"). Article lists are not read
+ * at startup at all but loaded on demand by "LoadArticles".
+ */
 class StateDiskFile : public DiskFile
 {
 public:
+	bool Open(const char* filename, EOpenMode mode);
+	bool Close();
 	int64 PrintLine(const char* format, ...) PRINTF_SYNTAX(2);
 	char* ReadLine(char* buffer, int64 size);
 	int ScanLine(const char* format, ...) SCANF_SYNTAX(2);
+	StringBuilder& GetOutput() { return m_output; }
+
+private:
+	StringBuilder m_output;
+	CharBuffer m_data;
+	int64 m_dataSize = 0;
+	int64 m_readPos = 0;
 };
 
 
+bool StateDiskFile::Open(const char* filename, EOpenMode mode)
+{
+	if (mode != omRead)
+	{
+		return DiskFile::Open(filename, mode);
+	}
+
+	m_readPos = 0;
+	if (!FileSystem::LoadFileIntoBuffer(filename, m_data, true))
+	{
+		return false;
+	}
+	m_dataSize = m_data.Size() - 1;
+	return true;
+}
+
+bool StateDiskFile::Close()
+{
+	if (m_data)
+	{
+		m_data.Clear();
+		m_dataSize = 0;
+		return true;
+	}
+	return DiskFile::Close();
+}
+
 int64 StateDiskFile::PrintLine(const char* format, ...)
 {
 	va_list ap;
@@ -52,37 +102,36 @@ int64 StateDiskFile::PrintLine(const char* format, ...)
 	// replacing terminating <NULL> with <LF>
 	str[len++] = '\n';
 
-	Write(*str, len);
+	m_output.Append(*str, len);
 
 	return len;
 }
 
 char* StateDiskFile::ReadLine(char* buffer, int64 size)
 {
-	if (!DiskFile::ReadLine(buffer, size))
+	if (m_readPos >= m_dataSize)
 	{
 		return nullptr;
 	}
 
-	// remove traling '\n'
-	if (*buffer)
-	{
-		if (buffer[strlen(buffer) - 1] != '\n')
-		{
-			// the line is longer than "size", scroll file position to the end of the line
-			for (char skipbuf[1024]; DiskFile::ReadLine(skipbuf, 1024) && *skipbuf && skipbuf[strlen(skipbuf) - 1] != '\n'; ) ;
-		}
+	const char* line = m_data + m_readPos;
+	const char* lineEnd = (const char*)memchr(line, '\n', m_dataSize - m_readPos);
+	int64 len = lineEnd ? lineEnd - line : m_dataSize - m_readPos;
+	m_readPos += len + (lineEnd ? 1 : 0);
 
-		buffer[strlen(buffer) - 1] = 0;
-	}
+	// if the line is longer than "size" the rest of the line is skipped
+	len = std::min(len, size - 1);
+	memcpy(buffer, line, len);
+	buffer[len] = '\0';
 
 	return buffer;
 }
 
 /*
-* Standard "fscanf" scans beoynd current line if the next line is empty.
-* This wrapper fixes that.
-*/
+ * Parses a line of comma separated numbers. Only format specifiers "%i" and "%u"
+ * are supported, that's all what diskstate files consist of. This is many times
+ * faster than "vsscanf", which matters when loading large queue and history.
+ */
 int StateDiskFile::ScanLine(const char* format, ...)
 {
 	char line[1024];
@@ -93,7 +142,41 @@ int StateDiskFile::ScanLine(const char* format, ...)
 
 	va_list ap;
 	va_start(ap, format);
-	int res = vsscanf(line, format, ap);
+
+	int res = 0;
+	char* p = line;
+	for (const char* f = format; *f; )
+	{
+		if (f[0] == '%' && (f[1] == 'i' || f[1] == 'u'))
+		{
+			char* end;
+			if (f[1] == 'i')
+			{
+				int value = (int)strtol(p, &end, 0);
+				if (end == p) break;
+				*va_arg(ap, int*) = value;
+			}
+			else
+			{
+				uint32 value = (uint32)strtoul(p, &end, 10);
+				if (end == p) break;
+				*va_arg(ap, uint32*) = value;
+			}
+			p = end;
+			f += 2;
+			res++;
+		}
+		else if (*f == *p)
+		{
+			f++;
+			p++;
+		}
+		else
+		{
+			break;
+		}
+	}
+
 	va_end(ap);
 
 	return res;
@@ -103,29 +186,35 @@ int StateDiskFile::ScanLine(const char* format, ...)
 class StateFile
 {
 public:
-	StateFile(const char* filename, int formatVersion, bool transactional);
+	StateFile(StateWriter& writer, const char* filename, int formatVersion, bool transactional);
 	void Discard();
 	bool FileExists();
 	StateDiskFile* BeginWrite();
+	StateDiskFile* BeginAppend();
 	bool FinishWrite();
 	StateDiskFile* BeginRead();
+	void EndRead() { m_file.Close(); }
 	int GetFileVersion() { return m_fileVersion; }
 	const char* GetDestFilename() { return m_destFilename; }
+	int64 GetWrittenSize() { return m_writtenSize; }
 
 private:
+	StateWriter& m_writer;
 	BString<1024> m_destFilename;
 	BString<1024> m_tempFilename;
 	int m_formatVersion;
 	bool m_transactional;
+	bool m_append = false;
 	int m_fileVersion;
+	int64 m_writtenSize = 0;
 	StateDiskFile m_file;
 
 	int ParseFormatVersion(const char* formatSignature);
 };
 
 
-StateFile::StateFile(const char* filename, int formatVersion, bool transactional) :
-	m_formatVersion(formatVersion), m_transactional(transactional)
+StateFile::StateFile(StateWriter& writer, const char* filename, int formatVersion, bool transactional) :
+	m_writer(writer), m_formatVersion(formatVersion), m_transactional(transactional)
 {
 	m_destFilename.Format("%s%c%s", g_Options->GetQueueDir(), PATH_SEPARATOR, filename);
 	if (m_transactional)
@@ -140,7 +229,7 @@ StateFile::StateFile(const char* filename, int formatVersion, bool transactional
 
 void StateFile::Discard()
 {
-	FileSystem::DeleteFile(m_destFilename);
+	m_writer.Delete(m_destFilename);
 }
 
 /* Parse signature and return format version number
@@ -157,70 +246,47 @@ int StateFile::ParseFormatVersion(const char* formatSignature)
 
 bool StateFile::FileExists()
 {
+	m_writer.Wait(m_destFilename);
 	return FileSystem::FileExists(m_destFilename) || (m_transactional && FileSystem::FileExists(m_tempFilename));
 }
 
 StateDiskFile* StateFile::BeginWrite()
 {
-	if (!m_file.Open(m_tempFilename, StateDiskFile::omWrite))
-	{
-		error("Error saving diskstate: Could not create file %s: %s", *m_tempFilename,
-			*FileSystem::GetLastErrorMessage());
-		return nullptr;
-	}
-
+	m_append = false;
+	m_file.GetOutput().Clear();
 	m_file.PrintLine("%s%i", FORMATVERSION_SIGNATURE, m_formatVersion);
 
 	return &m_file;
 }
 
-bool StateFile::FinishWrite()
+StateDiskFile* StateFile::BeginAppend()
 {
-	if (!m_transactional)
-	{
-		m_file.Close();
-		return true;
-	}
+	m_append = true;
+	m_file.GetOutput().Clear();
 
-	// flush file content before renaming
-	if (g_Options->GetFlushQueue())
-	{
-		debug("Flushing data for file %s", FileSystem::BaseFileName(m_tempFilename));
-		m_file.Flush();
-		CString errmsg;
-		if (!m_file.Sync(errmsg))
-		{
-			warn("Could not flush file %s into disk: %s", *m_tempFilename, *errmsg);
-		}
-	}
-
-	m_file.Close();
+	return &m_file;
+}
 
-	// now rename to dest file name
-	FileSystem::DeleteFile(m_destFilename);
-	if (!FileSystem::MoveFile(m_tempFilename, m_destFilename))
-	{
-		error("Error saving diskstate: Could not rename file %s to %s: %s",
-			*m_tempFilename, *m_destFilename, *FileSystem::GetLastErrorMessage());
-		return false;
-	}
+/*
+ * Passes the content to the state writer, which saves it into the file
+ * now or in background.
+ */
+bool StateFile::FinishWrite()
+{
+	StringBuilder& output = m_file.GetOutput();
+	m_writtenSize = output.Length();
 
-	// flush directory buffer after renaming
-	if (g_Options->GetFlushQueue())
-	{
-		debug("Flushing directory for file %s", FileSystem::BaseFileName(m_destFilename));
-		CString errmsg;
-		if (!FileSystem::FlushDirBuffers(m_destFilename, errmsg))
-		{
-			warn("Could not flush directory buffers for file %s into disk: %s", *m_destFilename, *errmsg);
-		}
-	}
+	CString data;
+	data.Bind(output.Unbind());
 
-	return true;
+	return m_writer.Write(m_destFilename, m_transactional && !m_append ? *m_tempFilename : nullptr,
+		std::move(data), (int)m_writtenSize, m_append);
 }
 
 StateDiskFile* StateFile::BeginRead()
 {
+	m_writer.Wait(m_destFilename);
+
 	if (!FileSystem::FileExists(m_destFilename) && FileSystem::FileExists(m_tempFilename))
 	{
 		// disaster recovery: temp-file exists but the dest-file doesn't
@@ -254,6 +320,215 @@ StateDiskFile* StateFile::BeginRead()
 }
 
 
+void StateWriter::Run()
+{
+	debug("Entering StateWriter-loop");
+
+	while (true)
+	{
+		bool skip;
+		{
+			Guard guard(m_jobsMutex);
+			m_jobsCond.Wait(m_jobsMutex, [&]{ return !m_jobs.empty() || IsStopped(); });
+			if (m_jobs.empty())
+			{
+				// stopped and all jobs are done
+				break;
+			}
+			m_activeJob = std::move(m_jobs.front());
+			m_jobs.pop_front();
+			skip = m_failed && m_activeJob->kind == jkAppend;
+		}
+
+		// don't append after a failed write, the file may end with an incomplete record
+		bool ok = !skip && Execute(m_activeJob.get());
+
+		{
+			Guard guard(m_jobsMutex);
+			m_failed |= !ok;
+			m_activeJob.reset();
+			m_jobsCond.NotifyAll();
+		}
+	}
+
+	debug("Exiting StateWriter-loop");
+}
+
+void StateWriter::Stop()
+{
+	Thread::Stop();
+	Guard guard(m_jobsMutex);
+	m_jobsCond.NotifyAll();
+}
+
+bool StateWriter::Write(const char* destFilename, const char* tempFilename, CString data, int len, bool append)
+{
+	std::unique_ptr<Job> job = std::make_unique<Job>();
+	job->kind = append ? jkAppend : jkWrite;
+	job->destFilename = destFilename;
+	job->tempFilename = tempFilename;
+	job->data = std::move(data);
+	job->len = len;
+	return AddJob(std::move(job));
+}
+
+void StateWriter::Delete(const char* filename)
+{
+	std::unique_ptr<Job> job = std::make_unique<Job>();
+	job->kind = jkDelete;
+	job->destFilename = filename;
+	job->len = 0;
+	AddJob(std::move(job));
+}
+
+bool StateWriter::AddJob(std::unique_ptr<Job> job)
+{
+	Guard guard(m_jobsMutex);
+
+	if (!IsRunning() || IsStopped())
+	{
+		// jobs queued before must be done first
+		m_jobsCond.Wait(m_jobsMutex, [&]{ return m_jobs.empty() && !m_activeJob; });
+		return Execute(job.get());
+	}
+
+	if (job->kind != jkAppend)
+	{
+		// pending jobs for the same file are obsolete now
+		m_jobs.erase(std::remove_if(m_jobs.begin(), m_jobs.end(),
+			[&job](std::unique_ptr<Job>& pending)
+			{
+				return !strcmp(pending->destFilename, job->destFilename);
+			}),
+			m_jobs.end());
+	}
+
+	m_jobs.push_back(std::move(job));
+	m_jobsCond.NotifyAll();
+
+	return true;
+}
+
+/*
+ * Waits until all pending jobs for the file are done.
+ */
+void StateWriter::Wait(const char* filename)
+{
+	Guard guard(m_jobsMutex);
+	m_jobsCond.Wait(m_jobsMutex, [&]
+		{
+			return (!m_activeJob || strcmp(m_activeJob->destFilename, filename)) &&
+				std::none_of(m_jobs.begin(), m_jobs.end(),
+					[filename](std::unique_ptr<Job>& job) { return !strcmp(job->destFilename, filename); });
+		});
+}
+
+void StateWriter::WaitAll()
+{
+	Guard guard(m_jobsMutex);
+	m_jobsCond.Wait(m_jobsMutex, [&]{ return m_jobs.empty() && !m_activeJob; });
+}
+
+/*
+ * Returns true if a job executed in background has failed since the last call.
+ */
+bool StateWriter::TakeFailure()
+{
+	Guard guard(m_jobsMutex);
+	bool failed = m_failed;
+	m_failed = false;
+	return failed;
+}
+
+bool StateWriter::Execute(Job* job)
+{
+	if (job->kind == jkDelete)
+	{
+		FileSystem::DeleteFile(job->destFilename);
+		return true;
+	}
+
+	const char* filename = job->tempFilename ? *job->tempFilename : *job->destFilename;
+
+	DiskFile outfile;
+	if (!outfile.Open(filename, job->kind == jkAppend ? DiskFile::omAppend : DiskFile::omWrite))
+	{
+		error("Error saving diskstate: Could not create file %s: %s", filename,
+			*FileSystem::GetLastErrorMessage());
+		return false;
+	}
+
+	bool ok = outfile.Write(job->data, job->len) == job->len;
+
+	// flush file content before renaming
+	if (ok && (job->tempFilename || job->kind == jkAppend) && g_Options->GetFlushQueue())
+	{
+		debug("Flushing data for file %s", FileSystem::BaseFileName(filename));
+		ok = outfile.Flush();
+		CString errmsg;
+		if (ok && !outfile.Sync(errmsg))
+		{
+			warn("Could not flush file %s into disk: %s", filename, *errmsg);
+		}
+	}
+
+	ok = outfile.Close() && ok;
+
+	if (!ok)
+	{
+		error("Error saving diskstate: Could not write file %s: %s", filename,
+			*FileSystem::GetLastErrorMessage());
+		return false;
+	}
+
+	if (!job->tempFilename)
+	{
+		return true;
+	}
+
+	// now rename to dest file name
+	FileSystem::DeleteFile(job->destFilename);
+	if (!FileSystem::MoveFile(job->tempFilename, job->destFilename))
+	{
+		error("Error saving diskstate: Could not rename file %s to %s: %s",
+			*job->tempFilename, *job->destFilename, *FileSystem::GetLastErrorMessage());
+		return false;
+	}
+
+	// flush directory buffer after renaming
+	if (g_Options->GetFlushQueue())
+	{
+		debug("Flushing directory for file %s", FileSystem::BaseFileName(job->destFilename));
+		CString errmsg;
+		if (!FileSystem::FlushDirBuffers(job->destFilename, errmsg))
+		{
+			warn("Could not flush directory buffers for file %s into disk: %s", *job->destFilename, *errmsg);
+		}
+	}
+
+	return true;
+}
+
+
+void DiskState::StartWriter()
+{
+	m_stateWriter.Start();
+}
+
+/*
+ * Stops the writer thread after it has written all pending jobs.
+ */
+void DiskState::StopWriter()
+{
+	m_stateWriter.Stop();
+
+	while (m_stateWriter.IsRunning())
+	{
+		Util::Sleep(10);
+	}
+}
+
+
 /* Save Download Queue to Disk.
  * The Disk State consists of file "queue", which contains the order of files,
  * and of one diskstate-file for each file in download queue.
@@ -266,8 +541,17 @@ bool DiskState::SaveDownloadQueue(DownloadQueue* downloadQueue, bool saveHistory
 
 	bool ok = true;
 
+	if (m_stateWriter.TakeFailure())
+	{
+		// a previous write has failed in background; the history journal may
+		// end with an incomplete record, write a new snapshot instead
+		m_compactHistory = true;
+		saveHistory = true;
+		ok = false;
+	}
+
 	{
-		StateFile stateFile("queue", DISKSTATE_QUEUE_VERSION, true);
+		StateFile stateFile(m_stateWriter, "queue", DISKSTATE_QUEUE_VERSION, true);
 		if (!downloadQueue->GetQueue()->empty())
 		{
 			StateDiskFile* outfile = stateFile.BeginWrite();
@@ -280,7 +564,7 @@ bool DiskState::SaveDownloadQueue(DownloadQueue* downloadQueue, bool saveHistory
 			SaveQueue(downloadQueue->GetQueue(), *outfile);
 
 			// now rename to dest file name
-			ok = stateFile.FinishWrite();
+			ok &= stateFile.FinishWrite();
 		}
 		else
 		{
@@ -290,29 +574,11 @@ bool DiskState::SaveDownloadQueue(DownloadQueue* downloadQueue, bool saveHistory
 
 	if (saveHistory)
 	{
-		StateFile stateFile("history", DISKSTATE_QUEUE_VERSION, true);
-		if (!downloadQueue->GetHistory()->empty())
-		{
-			StateDiskFile* outfile = stateFile.BeginWrite();
-			if (!outfile)
-			{
-				return false;
-			}
-
-			// save history
-			SaveHistory(downloadQueue->GetHistory(), *outfile);
-
-			// now rename to dest file name
-			ok &= stateFile.FinishWrite();
-		}
-		else
-		{
-			stateFile.Discard();
-		}
+		ok &= SaveHistoryChanges(downloadQueue->GetHistory());
 	}
 
 	// progress-file isn't needed after saving of full queue data
-	StateFile progressStateFile("progress", DISKSTATE_QUEUE_VERSION, true);
+	StateFile progressStateFile(m_stateWriter, "progress", DISKSTATE_QUEUE_VERSION, true);
 	progressStateFile.Discard();
 
 	return ok;
@@ -326,7 +592,7 @@ bool DiskState::LoadDownloadQueue(DownloadQueue* downloadQueue, Servers* servers
 	int formatVersion = 0;
 
 	{
-		StateFile stateFile("queue", DISKSTATE_QUEUE_VERSION, true);
+		StateFile stateFile(m_stateWriter, "queue", DISKSTATE_QUEUE_VERSION, true);
 		if (stateFile.FileExists())
 		{
 			StateDiskFile* infile = stateFile.BeginRead();
@@ -359,7 +625,7 @@ bool DiskState::LoadDownloadQueue(DownloadQueue* downloadQueue, Servers* servers
 	}
 
 	{
-		StateFile stateFile("progress", DISKSTATE_QUEUE_VERSION, true);
+		StateFile stateFile(m_stateWriter, "progress", DISKSTATE_QUEUE_VERSION, true);
 		if (stateFile.FileExists())
 		{
 			StateDiskFile* infile = stateFile.BeginRead();
@@ -380,7 +646,7 @@ bool DiskState::LoadDownloadQueue(DownloadQueue* downloadQueue, Servers* servers
 
 	if (formatVersion == 0 || formatVersion >= 57)
 	{
-		StateFile stateFile("history", DISKSTATE_QUEUE_VERSION, true);
+		StateFile stateFile(m_stateWriter, "history", DISKSTATE_QUEUE_VERSION, true);
 		if (stateFile.FileExists())
 		{
 			StateDiskFile* infile = stateFile.BeginRead();
@@ -396,7 +662,20 @@ bool DiskState::LoadDownloadQueue(DownloadQueue* downloadQueue, Servers* servers
 			}
 
 			if (!LoadHistory(downloadQueue->GetHistory(), servers, *infile, stateFile.GetFileVersion())) goto error;
+
+			m_historySize = FileSystem::FileSize(stateFile.GetDestFilename());
+			m_compactHistory = false;
 		}
+
+		LoadHistoryJournal(downloadQueue->GetHistory(), servers);
+	}
+
+	m_historyIds.clear();
+	m_historyIds.reserve(downloadQueue->GetHistory()->size());
+	for (HistoryInfo* historyInfo : downloadQueue->GetHistory())
+	{
+		historyInfo->SetSaved(true);
+		m_historyIds.push_back(historyInfo->GetId());
 	}
 
 	LoadAllFileInfos(downloadQueue);
@@ -435,7 +714,7 @@ bool DiskState::SaveDownloadProgress(DownloadQueue* downloadQueue)
 	bool ok = true;
 
 	{
-		StateFile stateFile("progress", DISKSTATE_QUEUE_VERSION, true);
+		StateFile stateFile(m_stateWriter, "progress", DISKSTATE_QUEUE_VERSION, true);
 		if (count > 0)
 		{
 			StateDiskFile* outfile = stateFile.BeginWrite();
@@ -480,7 +759,7 @@ bool DiskState::LoadQueue(NzbList* queue, Servers* servers, StateDiskFile& infil
 	{
 		std::unique_ptr<NzbInfo> nzbInfo = std::make_unique<NzbInfo>();
 		if (!LoadNzbInfo(nzbInfo.get(), servers, infile, formatVersion)) goto error;
-		queue->push_back(std::move(nzbInfo));
+		queue->Add(std::move(nzbInfo));
 	}
 
 	return true;
@@ -587,10 +866,11 @@ void DiskState::SaveNzbInfo(NzbInfo* nzbInfo, StateDiskFile& outfile)
 	outfile.PrintLine("%i", (int)nzbInfo->GetCompletedFiles()->size());
 	for (CompletedFile& completedFile : nzbInfo->GetCompletedFiles())
 	{
-		outfile.PrintLine("%i,%i,%u,%i,%s,%s", completedFile.GetId(), (int)completedFile.GetStatus(),
+		outfile.PrintLine("%i,%i,%u,%i,%s,%s,%s", completedFile.GetId(), (int)completedFile.GetStatus(),
 			completedFile.GetCrc(), (int)completedFile.GetParFile(),
 			completedFile.GetHash16k() ? completedFile.GetHash16k() : "",
-			completedFile.GetParSetId() ? completedFile.GetParSetId() : "");
+			completedFile.GetParSetId() ? completedFile.GetParSetId() : "",
+			completedFile.GetHashFull() ? completedFile.GetHashFull() : "");
 		outfile.PrintLine("%s", completedFile.GetFilename());
 		outfile.PrintLine("%s", completedFile.GetOrigname() ? completedFile.GetOrigname() : "");
 	}
@@ -844,6 +1124,7 @@ bool DiskState::LoadNzbInfo(NzbInfo* nzbInfo, Servers* servers, StateDiskFile& i
 		int parFile = 0;
 		char* hash16k = nullptr;
 		char* parSetId = nullptr;
+		char* hashFull = nullptr;
 		char filenameBuf[1024];
 		char origName[1024];
 
@@ -883,6 +1164,10 @@ bool DiskState::LoadNzbInfo(NzbInfo* nzbInfo, Servers* servers, StateDiskFile& i
 			{
 				fileName++;
 			}
+			if (formatVersion >= 63)
+			{
+				hashFull = fileName;
+			}
 			if (formatVersion >= 62)
 			{
 				if (!infile.ReadLine(filenameBuf, sizeof(filenameBuf))) goto error;
@@ -895,7 +1180,8 @@ bool DiskState::LoadNzbInfo(NzbInfo* nzbInfo, Servers* servers, StateDiskFile& i
 			Util::EmptyStr(origName) ? nullptr : origName,
 			(CompletedFile::EStatus)status, crc, (bool)parFile,
 			Util::EmptyStr(hash16k) ? nullptr : hash16k,
-			Util::EmptyStr(parSetId) ? nullptr : parSetId);
+			Util::EmptyStr(parSetId) ? nullptr : parSetId,
+			Util::EmptyStr(hashFull) ? nullptr : hashFull);
 	}
 
 	nzbInfo->GetParameters()->clear();
@@ -1022,7 +1308,7 @@ bool DiskState::SaveFile(FileInfo* fileInfo)
 	debug("Saving FileInfo %i to disk", fileInfo->GetId());
 
 	BString<100> filename("%i", fileInfo->GetId());
-	StateFile stateFile(filename, DISKSTATE_FILE_VERSION, false);
+	StateFile stateFile(m_stateWriter, filename, DISKSTATE_FILE_VERSION, false);
 
 	StateDiskFile* outfile = stateFile.BeginWrite();
 	if (!outfile)
@@ -1080,7 +1366,7 @@ bool DiskState::LoadFile(FileInfo* fileInfo, bool fileSummary, bool articles)
 	debug("Loading FileInfo %i from disk", fileInfo->GetId());
 
 	BString<100> filename("%i", fileInfo->GetId());
-	StateFile stateFile(filename, DISKSTATE_FILE_VERSION, false);
+	StateFile stateFile(m_stateWriter, filename, DISKSTATE_FILE_VERSION, false);
 
 	StateDiskFile* infile = stateFile.BeginRead();
 	if (!infile)
@@ -1177,7 +1463,7 @@ bool DiskState::SaveFileState(FileInfo* fileInfo, bool completed)
 	debug("Saving FileState %i to disk", fileInfo->GetId());
 
 	BString<100> filename("%i%s", fileInfo->GetId(), completed ? "c" : "s");
-	StateFile stateFile(filename, DISKSTATE_FILE_VERSION, false);
+	StateFile stateFile(m_stateWriter, filename, DISKSTATE_FILE_VERSION, false);
 
 	StateDiskFile* outfile = stateFile.BeginWrite();
 	if (!outfile)
@@ -1185,7 +1471,7 @@ bool DiskState::SaveFileState(FileInfo* fileInfo, bool completed)
 		return false;
 	}
 
-	return SaveFileState(fileInfo, *outfile, completed);
+	return SaveFileState(fileInfo, *outfile, completed) && stateFile.FinishWrite();
 }
 
 bool DiskState::SaveFileState(FileInfo* fileInfo, StateDiskFile& outfile, bool completed)
@@ -1212,7 +1498,6 @@ bool DiskState::SaveFileState(FileInfo* fileInfo, StateDiskFile& outfile, bool c
 			articleInfo->GetSegmentSize(), (uint32)articleInfo->GetCrc());
 	}
 
-	outfile.Close();
 	return true;
 }
 
@@ -1221,7 +1506,7 @@ bool DiskState::LoadFileState(FileInfo* fileInfo, Servers* servers, bool complet
 	debug("Loading FileInfo %i from disk", fileInfo->GetId());
 
 	BString<100> filename("%i%s", fileInfo->GetId(), completed ? "c" : "s");
-	StateFile stateFile(filename, DISKSTATE_FILE_VERSION, false);
+	StateFile stateFile(m_stateWriter, filename, DISKSTATE_FILE_VERSION, false);
 
 	StateDiskFile* infile = stateFile.BeginRead();
 	if (!infile)
@@ -1274,6 +1559,8 @@ bool DiskState::LoadFileState(FileInfo* fileInfo, Servers* servers, StateDiskFil
 	int completedArticles;
 	completedArticles = 0; //clang requires initialization in a separate line (due to goto statements)
 
+	fileInfo->SetArticleCursor(0);
+
 	int size;
 	if (infile.ScanLine("%i", &size) != 1) goto error;
 	for (int i = 0; i < size; i++)
@@ -1406,70 +1693,402 @@ void DiskState::SaveHistory(HistoryList* history, StateDiskFile& outfile)
 {
 	debug("Saving history to disk");
 
-	outfile.PrintLine("%i", (int)history->size());
+	outfile.PrintLine("%i,%u", (int)history->size(), m_historyGeneration);
 	for (HistoryInfo* historyInfo : history)
 	{
-		outfile.PrintLine("%i,%i,%i", historyInfo->GetId(), (int)historyInfo->GetKind(), (int)historyInfo->GetTime());
+		SaveHistoryInfo(historyInfo, outfile);
+	}
+}
+
+bool DiskState::LoadHistory(HistoryList* history, Servers* servers, StateDiskFile& infile, int formatVersion)
+{
+	debug("Loading history from disk");
+
+	// older versions don't save generation number
+	int size;
+	m_historyGeneration = 0;
+	if (infile.ScanLine("%i,%u", &size, &m_historyGeneration) < 1) goto error;
+	for (int i = 0; i < size; i++)
+	{
+		std::unique_ptr<HistoryInfo> historyInfo = LoadHistoryInfo(servers, infile, formatVersion);
+		if (!historyInfo) goto error;
+		history->push_back(std::move(historyInfo));
+	}
+
+	return true;
+
+error:
+	error("Error reading diskstate for history");
+	return false;
+}
+
+void DiskState::SaveHistoryInfo(HistoryInfo* historyInfo, StateDiskFile& outfile)
+{
+	outfile.PrintLine("%i,%i,%i", historyInfo->GetId(), (int)historyInfo->GetKind(), (int)historyInfo->GetTime());
+
+	if (historyInfo->GetKind() == HistoryInfo::hkNzb || historyInfo->GetKind() == HistoryInfo::hkUrl)
+	{
+		SaveNzbInfo(historyInfo->GetNzbInfo(), outfile);
+	}
+	else if (historyInfo->GetKind() == HistoryInfo::hkDup)
+	{
+		SaveDupInfo(historyInfo->GetDupInfo(), outfile);
+	}
+}
+
+std::unique_ptr<HistoryInfo> DiskState::LoadHistoryInfo(Servers* servers, StateDiskFile& infile, int formatVersion)
+{
+	std::unique_ptr<HistoryInfo> historyInfo;
+	HistoryInfo::EKind kind = HistoryInfo::hkNzb;
+	int id = 0;
+	int time;
+
+	int kindval = 0;
+	if (infile.ScanLine("%i,%i,%i", &id, &kindval, &time) != 3) return nullptr;
+	kind = (HistoryInfo::EKind)kindval;
+
+	if (kind == HistoryInfo::hkNzb)
+	{
+		std::unique_ptr<NzbInfo> nzbInfo = std::make_unique<NzbInfo>();
+		if (!LoadNzbInfo(nzbInfo.get(), servers, infile, formatVersion)) return nullptr;
+		nzbInfo->LeavePostProcess();
+		historyInfo = std::make_unique<HistoryInfo>(std::move(nzbInfo));
+	}
+	else if (kind == HistoryInfo::hkUrl)
+	{
+		std::unique_ptr<NzbInfo> nzbInfo = std::make_unique<NzbInfo>();
+		if (!LoadNzbInfo(nzbInfo.get(), servers, infile, formatVersion)) return nullptr;
+		historyInfo = std::make_unique<HistoryInfo>(std::move(nzbInfo));
+	}
+	else if (kind == HistoryInfo::hkDup)
+	{
+		std::unique_ptr<DupInfo> dupInfo = std::make_unique<DupInfo>();
+		if (!LoadDupInfo(dupInfo.get(), infile, formatVersion)) return nullptr;
+		dupInfo->SetId(id);
+		historyInfo = std::make_unique<HistoryInfo>(std::move(dupInfo));
+	}
+	else
+	{
+		return nullptr;
+	}
+
+	historyInfo->SetTime((time_t)time);
+
+	return historyInfo;
+}
+
+/*
+ * Saves changes made in history since the last save. Normally only changed items
+ * are appended to the journal. The snapshot is rewritten (and the journal discarded)
+ * when the journal grows too large, when there are too many changes or if the
+ * changes can't be expressed as journal records.
+ */
+bool DiskState::SaveHistoryChanges(HistoryList* history)
+{
+	HistoryRecords records;
+	bool compact = m_compactHistory || history->empty() ||
+		m_journalSize > std::max(m_historySize / 2, HISTORY_JOURNAL_MIN_SIZE) ||
+		!DiffHistory(history, records);
 
-		if (historyInfo->GetKind() == HistoryInfo::hkNzb || historyInfo->GetKind() == HistoryInfo::hkUrl)
+	if (!compact)
+	{
+		int changedCount = std::count_if(records.begin(), records.end(),
+			[](HistoryRecord& record) { return record.historyInfo != nullptr; });
+		compact = changedCount > (int)history->size() / 4;
+	}
+
+	if (!compact && !records.empty())
+	{
+		compact = !AppendHistoryJournal(records);
+	}
+
+	if (compact && !SaveHistorySnapshot(history))
+	{
+		return false;
+	}
+
+	m_historyIds.clear();
+	m_historyIds.reserve(history->size());
+	for (HistoryInfo* historyInfo : history)
+	{
+		historyInfo->SetSaved(true);
+		historyInfo->SetChanged(false);
+		m_historyIds.push_back(historyInfo->GetId());
+	}
+
+	return true;
+}
+
+bool DiskState::SaveHistorySnapshot(HistoryList* history)
+{
+	debug("Compacting history journal");
+
+	StateFile stateFile(m_stateWriter, "history", DISKSTATE_QUEUE_VERSION, true);
+	StateFile journalFile(m_stateWriter, HISTORY_JOURNAL_FILENAME, DISKSTATE_QUEUE_VERSION, false);
+
+	if (!history->empty())
+	{
+		StateDiskFile* outfile = stateFile.BeginWrite();
+		if (!outfile)
 		{
-			SaveNzbInfo(historyInfo->GetNzbInfo(), outfile);
+			m_compactHistory = true;
+			return false;
 		}
-		else if (historyInfo->GetKind() == HistoryInfo::hkDup)
+
+		// the new generation number makes the old journal obsolete, even if
+		// it couldn't be deleted
+		m_historyGeneration++;
+		SaveHistory(history, *outfile);
+
+		if (!stateFile.FinishWrite())
 		{
-			SaveDupInfo(historyInfo->GetDupInfo(), outfile);
+			m_compactHistory = true;
+			return false;
 		}
+
+		m_historySize = stateFile.GetWrittenSize();
 	}
+	else
+	{
+		stateFile.Discard();
+		m_historySize = 0;
+	}
+
+	journalFile.Discard();
+	m_journalSize = 0;
+	m_compactHistory = false;
+
+	return true;
 }
 
-bool DiskState::LoadHistory(HistoryList* history, Servers* servers, StateDiskFile& infile, int formatVersion)
+/*
+ * Compares history with the item list saved in snapshot and journal and
+ * builds journal records for the changes. Returns false if the changes can't
+ * be expressed as journal records (for example if the item order has changed).
+ */
+bool DiskState::DiffHistory(HistoryList* history, HistoryRecords& records)
 {
-	debug("Loading history from disk");
+	std::unordered_set<int> ids;
+	ids.reserve(history->size());
+	for (HistoryInfo* historyInfo : history)
+	{
+		ids.insert(historyInfo->GetId());
+	}
 
-	int size;
-	if (infile.ScanLine("%i", &size) != 1) goto error;
-	for (int i = 0; i < size; i++)
+	HistoryRecords added;
+	uint32 pos = 0;
+	bool matched = false;
+
+	for (HistoryInfo* historyInfo : history)
 	{
-		std::unique_ptr<HistoryInfo> historyInfo;
-		HistoryInfo::EKind kind = HistoryInfo::hkNzb;
-		int id = 0;
-		int time;
+		int id = historyInfo->GetId();
 
-		int kindval = 0;
-		if (infile.ScanLine("%i,%i,%i", &id, &kindval, &time) != 3) goto error;
-		kind = (HistoryInfo::EKind)kindval;
+		// new items can only appear at the top of history
+		if (!historyInfo->GetSaved() && !matched &&
+			(pos == m_historyIds.size() || m_historyIds[pos] != id))
+		{
+			added.push_back({'+', id, historyInfo});
+			continue;
+		}
+		matched = true;
 
-		if (kind == HistoryInfo::hkNzb)
+		for (; pos < m_historyIds.size() && m_historyIds[pos] != id; pos++)
 		{
-			std::unique_ptr<NzbInfo> nzbInfo = std::make_unique<NzbInfo>();
-			if (!LoadNzbInfo(nzbInfo.get(), servers, infile, formatVersion)) goto error;
-			nzbInfo->LeavePostProcess();
-			historyInfo = std::make_unique<HistoryInfo>(std::move(nzbInfo));
+			if (ids.find(m_historyIds[pos]) != ids.end())
+			{
+				// the item was moved
+				return false;
+			}
+			records.push_back({'-', m_historyIds[pos], nullptr});
 		}
-		else if (kind == HistoryInfo::hkUrl)
+
+		if (pos == m_historyIds.size())
 		{
-			std::unique_ptr<NzbInfo> nzbInfo = std::make_unique<NzbInfo>();
-			if (!LoadNzbInfo(nzbInfo.get(), servers, infile, formatVersion)) goto error;
-			historyInfo = std::make_unique<HistoryInfo>(std::move(nzbInfo));
+			// new item in the middle of history
+			return false;
 		}
-		else if (kind == HistoryInfo::hkDup)
+		pos++;
+
+		if (!historyInfo->GetSaved() || historyInfo->GetChanged())
 		{
-			std::unique_ptr<DupInfo> dupInfo = std::make_unique<DupInfo>();
-			if (!LoadDupInfo(dupInfo.get(), infile, formatVersion)) goto error;
-			dupInfo->SetId(id);
-			historyInfo = std::make_unique<HistoryInfo>(std::move(dupInfo));
+			records.push_back({'=', id, historyInfo});
 		}
+	}
 
-		historyInfo->SetTime((time_t)time);
+	for (; pos < m_historyIds.size(); pos++)
+	{
+		if (ids.find(m_historyIds[pos]) != ids.end())
+		{
+			return false;
+		}
+		records.push_back({'-', m_historyIds[pos], nullptr});
+	}
 
-		history->push_back(std::move(historyInfo));
+	// new items are added to the top one by one, the last one first
+	records.insert(records.end(), added.rbegin(), added.rend());
+
+	return true;
+}
+
+bool DiskState::AppendHistoryJournal(HistoryRecords& records)
+{
+	debug("Appending %i records to history journal", (int)records.size());
+
+	StateFile stateFile(m_stateWriter, HISTORY_JOURNAL_FILENAME, DISKSTATE_QUEUE_VERSION, false);
+
+	// new journal starts with the generation number of the snapshot it belongs to
+	StateDiskFile* outfile = m_journalSize > 0 ? stateFile.BeginAppend() : stateFile.BeginWrite();
+	if (!outfile)
+	{
+		return false;
+	}
+
+	if (m_journalSize == 0)
+	{
+		outfile->PrintLine("%u", m_historyGeneration);
+	}
+
+	for (HistoryRecord& record : records)
+	{
+		outfile->PrintLine("%c%i", record.action, record.id);
+		if (record.historyInfo)
+		{
+			SaveHistoryInfo(record.historyInfo, *outfile);
+		}
 	}
 
+	if (!stateFile.FinishWrite())
+	{
+		// the journal may end with an incomplete record now, start a new one
+		m_journalSize = 0;
+		return false;
+	}
+
+	m_journalSize += stateFile.GetWrittenSize();
+
 	return true;
+}
 
-error:
-	error("Error reading diskstate for history");
-	return false;
+void DiskState::LoadHistoryJournal(HistoryList* history, Servers* servers)
+{
+	StateFile stateFile(m_stateWriter, HISTORY_JOURNAL_FILENAME, DISKSTATE_QUEUE_VERSION, false);
+	if (!stateFile.FileExists())
+	{
+		return;
+	}
+
+	if (m_compactHistory)
+	{
+		// no snapshot to apply the journal to
+		stateFile.Discard();
+		return;
+	}
+
+	StateDiskFile* infile = stateFile.BeginRead();
+	if (!infile)
+	{
+		m_compactHistory = true;
+		return;
+	}
+
+	uint32 generation;
+	if (stateFile.GetFileVersion() <= 0 || infile->ScanLine("%u", &generation) != 1 ||
+		generation != m_historyGeneration)
+	{
+		// journal of an older snapshot
+		stateFile.EndRead();
+		stateFile.Discard();
+		return;
+	}
+
+	debug("Loading history journal from disk");
+
+	// items are kept in slots during replaying, which allows to apply
+	// each record in constant time
+	std::vector<std::unique_ptr<HistoryInfo>> slots;
+	std::vector<uint32> added;
+	std::unordered_map<int, uint32> index;
+	slots.reserve(history->size());
+	index.reserve(history->size());
+	for (std::unique_ptr<HistoryInfo>& historyInfo : *history)
+	{
+		index[historyInfo->GetId()] = slots.size();
+		slots.push_back(std::move(historyInfo));
+	}
+	uint32 snapshotSize = slots.size();
+
+	int count = 0;
+	bool ok = true;
+	char buf[64];
+	while (infile->ReadLine(buf, sizeof(buf)))
+	{
+		char action = buf[0];
+		int id = atoi(buf + 1);
+
+		std::unique_ptr<HistoryInfo> historyInfo;
+		if (action == '+' || action == '=')
+		{
+			historyInfo = LoadHistoryInfo(servers, *infile, stateFile.GetFileVersion());
+			if (!historyInfo || historyInfo->GetId() != id)
+			{
+				ok = false;
+				break;
+			}
+		}
+
+		auto it = index.find(id);
+		if (action == '+' && it == index.end())
+		{
+			index[id] = slots.size();
+			added.push_back(slots.size());
+			slots.push_back(std::move(historyInfo));
+		}
+		else if (action == '=' && it != index.end())
+		{
+			slots[it->second] = std::move(historyInfo);
+		}
+		else if (action == '-' && it != index.end())
+		{
+			slots[it->second].reset();
+			index.erase(it);
+		}
+		else
+		{
+			ok = false;
+			break;
+		}
+
+		count++;
+	}
+
+	history->clear();
+	for (auto it = added.rbegin(); it != added.rend(); it++)
+	{
+		if (slots[*it])
+		{
+			history->push_back(std::move(slots[*it]));
+		}
+	}
+	for (uint32 i = 0; i < snapshotSize; i++)
+	{
+		if (slots[i])
+		{
+			history->push_back(std::move(slots[i]));
+		}
+	}
+
+	debug("Applied %i records from history journal", count);
+
+	if (!ok)
+	{
+		// the journal is damaged, probably the program was terminated while writing it;
+		// the snapshot will be rewritten on next save
+		warn("Could not read all records from history journal, history may be incomplete");
+		m_compactHistory = true;
+		return;
+	}
+
+	m_journalSize = FileSystem::FileSize(stateFile.GetDestFilename());
 }
 
 /*
@@ -1479,12 +2098,20 @@ void DiskState::DiscardDownloadQueue()
 {
 	debug("Discarding queue");
 
+	m_stateWriter.WaitAll();
+
 	BString<1024> fullFilename("%s%c%s", g_Options->GetQueueDir(), PATH_SEPARATOR, "queue");
 	FileSystem::DeleteFile(fullFilename);
 
 	fullFilename.Format("%s%c%s", g_Options->GetQueueDir(), PATH_SEPARATOR, "history");
 	FileSystem::DeleteFile(fullFilename);
 
+	fullFilename.Format("%s%c%s", g_Options->GetQueueDir(), PATH_SEPARATOR, HISTORY_JOURNAL_FILENAME);
+	FileSystem::DeleteFile(fullFilename);
+
+	m_historyIds.clear();
+	m_compactHistory = true;
+
 	DirBrowser dir(g_Options->GetQueueDir());
 	while (const char* filename = dir.Next())
 	{
@@ -1530,21 +2157,21 @@ void DiskState::DiscardFile(int fileId, bool deleteData, bool deletePartialState
 	if (deleteData)
 	{
 		fileName.Format("%s%c%i", g_Options->GetQueueDir(), PATH_SEPARATOR, fileId);
-		FileSystem::DeleteFile(fileName);
+		m_stateWriter.Delete(fileName);
 	}
 
 	// partial state file
 	if (deletePartialState)
 	{
 		fileName.Format("%s%c%is", g_Options->GetQueueDir(), PATH_SEPARATOR, fileId);
-		FileSystem::DeleteFile(fileName);
+		m_stateWriter.Delete(fileName);
 	}
 
 	// completed state file
 	if (deleteCompletedState)
 	{
 		fileName.Format("%s%c%ic", g_Options->GetQueueDir(), PATH_SEPARATOR, fileId);
-		FileSystem::DeleteFile(fileName);
+		m_stateWriter.Delete(fileName);
 	}
 }
 
@@ -1668,7 +2295,7 @@ bool DiskState::SaveFeeds(Feeds* feeds, FeedHistory* feedHistory)
 {
 	debug("Saving feeds state to disk");
 
-	StateFile stateFile("feeds", DISKSTATE_FEEDS_VERSION, true);
+	StateFile stateFile(m_stateWriter, "feeds", DISKSTATE_FEEDS_VERSION, true);
 
 	if (feeds->empty() && feedHistory->empty())
 	{
@@ -1696,7 +2323,7 @@ bool DiskState::LoadFeeds(Feeds* feeds, FeedHistory* feedHistory)
 {
 	debug("Loading feeds state from disk");
 
-	StateFile stateFile("feeds", DISKSTATE_FEEDS_VERSION, true);
+	StateFile stateFile(m_stateWriter, "feeds", DISKSTATE_FEEDS_VERSION, true);
 
 	if (!stateFile.FileExists())
 	{
@@ -1841,7 +2468,7 @@ void DiskState::CalcFileStats(DownloadQueue* downloadQueue, int formatVersion)
 bool DiskState::SaveAllFileInfos(DownloadQueue* downloadQueue)
 {
 	bool ok = true;
-	StateFile stateFile("files", DISKSTATE_FILE_VERSION, true);
+	StateFile stateFile(m_stateWriter, "files", DISKSTATE_FILE_VERSION, true);
 	if (!downloadQueue->GetQueue()->empty())
 	{
 		StateDiskFile* outfile = stateFile.BeginWrite();
@@ -1886,7 +2513,7 @@ bool DiskState::LoadAllFileInfos(DownloadQueue* downloadQueue)
 		return true;
 	}
 
-	StateFile stateFile("files", DISKSTATE_FILE_VERSION, false);
+	StateFile stateFile(m_stateWriter, "files", DISKSTATE_FILE_VERSION, false);
 	StateDiskFile* infile = nullptr;
 	bool useHibernate = false;
 
@@ -1947,7 +2574,7 @@ bool DiskState::LoadAllFileInfos(DownloadQueue* downloadQueue)
 
 void DiskState::DiscardQuickFileInfos()
 {
-	StateFile stateFile("files", DISKSTATE_FILE_VERSION, false);
+	StateFile stateFile(m_stateWriter, "files", DISKSTATE_FILE_VERSION, false);
 	stateFile.Discard();
 }
 
@@ -1956,6 +2583,16 @@ bool DiskState::LoadAllFileStates(DownloadQueue* downloadQueue, Servers* servers
 	BString<1024> cacheFlagFilename("%s%c%s", g_Options->GetQueueDir(), PATH_SEPARATOR, "acache");
 	bool cacheWasActive = FileSystem::FileExists(cacheFlagFilename);
 
+	// index for faster search, the queue may have many thousands of files
+	std::unordered_map<int, FileInfo*> fileIndex;
+	for (NzbInfo* nzbInfo : downloadQueue->GetQueue())
+	{
+		for (FileInfo* fileInfo : nzbInfo->GetFileList())
+		{
+			fileIndex[fileInfo->GetId()] = fileInfo;
+		}
+	}
+
 	DirBrowser dir(g_Options->GetQueueDir());
 	while (const char* filename = dir.Next())
 	{
@@ -1965,18 +2602,16 @@ bool DiskState::LoadAllFileStates(DownloadQueue* downloadQueue, Servers* servers
 		{
 			if (suffix == 'c' || (suffix == 's' && g_Options->GetContinuePartial() && !cacheWasActive))
 			{
-				for (NzbInfo* nzbInfo : downloadQueue->GetQueue())
+				auto it = fileIndex.find(id);
+				if (it != fileIndex.end())
 				{
-					for (FileInfo* fileInfo : nzbInfo->GetFileList())
+					FileInfo* fileInfo = it->second;
+					if (!LoadFileState(fileInfo, servers, suffix == 'c'))
 					{
-						if (fileInfo->GetId() == id)
-						{
-							if (!LoadFileState(fileInfo, servers, suffix == 'c')) goto error;
-							fileInfo->GetArticles()->clear();
-							fileInfo->SetPartialState(suffix == 'c' ? FileInfo::psCompleted : FileInfo::psPartial);
-							goto next;
-						}
+						return false;
 					}
+					fileInfo->GetArticles()->clear();
+					fileInfo->SetPartialState(suffix == 'c' ? FileInfo::psCompleted : FileInfo::psPartial);
 				}
 			}
 			else
@@ -1985,20 +2620,16 @@ bool DiskState::LoadAllFileStates(DownloadQueue* downloadQueue, Servers* servers
 				FileSystem::DeleteFile(fullFilename);
 			}
 		}
-		next:;
 	}
 
 	return true;
-
-error:
-	return false;
 }
 
 bool DiskState::SaveStats(Servers* servers, ServerVolumes* serverVolumes)
 {
 	debug("Saving stats to disk");
 
-	StateFile stateFile("stats", DISKSTATE_STATS_VERSION, true);
+	StateFile stateFile(m_stateWriter, "stats", DISKSTATE_STATS_VERSION, true);
 
 	if (servers->empty())
 	{
@@ -2026,7 +2657,7 @@ bool DiskState::LoadStats(Servers* servers, ServerVolumes* serverVolumes, bool*
 {
 	debug("Loading stats from disk");
 
-	StateFile stateFile("stats", DISKSTATE_STATS_VERSION, true);
+	StateFile stateFile(m_stateWriter, "stats", DISKSTATE_STATS_VERSION, true);
 
 	if (!stateFile.FileExists())
 	{
@@ -30,9 +30,59 @@
 
 class StateDiskFile;
 
+/*
+ * Performs disk I/O for diskstate files in background. The state is serialized
+ * into memory by the caller (usually while holding the queue lock) and then written
+ * (and flushed) by this thread, which doesn't need any lock on the queue.
+ * Jobs for the same file are coalesced: a newer content replaces pending writes.
+ * When the thread isn't running the jobs are executed immediately.
+ * Failures of background jobs are remembered until the next call of "TakeFailure".
+ */
+class StateWriter : public Thread
+{
+public:
+	virtual void Run();
+	virtual void Stop();
+	bool Write(const char* destFilename, const char* tempFilename, CString data, int len, bool append);
+	void Delete(const char* filename);
+	void Wait(const char* filename);
+	void WaitAll();
+	bool TakeFailure();
+
+private:
+	enum EJobKind
+	{
+		jkWrite,
+		jkAppend,
+		jkDelete
+	};
+
+	struct Job
+	{
+		EJobKind kind;
+		CString destFilename;
+		CString tempFilename;
+		CString data;
+		int len;
+	};
+
+	typedef std::deque<std::unique_ptr<Job>> Jobs;
+
+	Jobs m_jobs;
+	std::unique_ptr<Job> m_activeJob;
+	bool m_failed = false;
+	Mutex m_jobsMutex;
+	ConditionVar m_jobsCond;
+
+	bool AddJob(std::unique_ptr<Job> job);
+	bool Execute(Job* job);
+};
+
 class DiskState
 {
 public:
+	void StartWriter();
+	void StopWriter();
 	bool DownloadQueueExists();
 	bool SaveDownloadQueue(DownloadQueue* downloadQueue, bool saveHistory);
 	bool LoadDownloadQueue(DownloadQueue* downloadQueue, Servers* servers);
@@ -58,6 +108,24 @@ public:
 	void LoadNzbMessages(int nzbId, MessageList* messages);
 
 private:
+	// History is stored as snapshot and a journal of changes made since the snapshot
+	// was written. Each journal record is a line with action ('+' - add item at the top,
+	// '-' - remove item, '=' - replace item) and item id, followed by item data.
+	struct HistoryRecord
+	{
+		char action;
+		int id;
+		HistoryInfo* historyInfo;
+	};
+	typedef std::vector<HistoryRecord> HistoryRecords;
+
+	std::vector<int> m_historyIds;
+	uint32 m_historyGeneration = 0;
+	int64 m_historySize = 0;
+	int64 m_journalSize = 0;
+	bool m_compactHistory = true;
+	StateWriter m_stateWriter;
+
 	bool SaveFileInfo(FileInfo* fileInfo, StateDiskFile& outfile, bool articles);
 	bool LoadFileInfo(FileInfo* fileInfo, StateDiskFile& outfile, int formatVersion, bool fileSummary, bool articles);
 	bool SaveFileState(FileInfo* fileInfo, StateDiskFile& outfile, bool completed);
@@ -72,6 +140,13 @@ private:
 	bool LoadDupInfo(DupInfo* dupInfo, StateDiskFile& infile, int formatVersion);
 	void SaveHistory(HistoryList* history, StateDiskFile& outfile);
 	bool LoadHistory(HistoryList* history, Servers* servers, StateDiskFile& infile, int formatVersion);
+	void SaveHistoryInfo(HistoryInfo* historyInfo, StateDiskFile& outfile);
+	std::unique_ptr<HistoryInfo> LoadHistoryInfo(Servers* servers, StateDiskFile& infile, int formatVersion);
+	bool SaveHistoryChanges(HistoryList* history);
+	bool SaveHistorySnapshot(HistoryList* history);
+	bool DiffHistory(HistoryList* history, HistoryRecords& records);
+	bool AppendHistoryJournal(HistoryRecords& records);
+	void LoadHistoryJournal(HistoryList* history, Servers* servers);
 	bool SaveFeedStatus(Feeds* feeds, StateDiskFile& outfile);
 	bool LoadFeedStatus(Feeds* feeds, StateDiskFile& infile, int formatVersion);
 	bool SaveFeedHistory(FeedHistory* feedHistory, StateDiskFile& outfile);
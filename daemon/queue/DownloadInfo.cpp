@@ -25,6 +25,7 @@
 #include "Options.h"
 #include "Util.h"
 #include "FileSystem.h"
+#include "ArticleWriter.h"
 
 int FileInfo::m_idGen = 0;
 int FileInfo::m_idMax = 0;
@@ -32,6 +33,10 @@ int NzbInfo::m_idGen = 0;
 int NzbInfo::m_idMax = 0;
 DownloadQueue* DownloadQueue::g_DownloadQueue = nullptr;
 bool DownloadQueue::g_Loaded = false;
+DownloadQueue::Stats DownloadQueue::g_Stats;
+Mutex DownloadQueue::g_StatsMutex;
+std::atomic<int64> ChangeTracker::g_Revision(0);
+std::atomic<int64> ChangeTracker::g_KindRevision[ChangeTracker::ikHistory + 1];
 
 void NzbParameterList::SetParameter(const char* name, const char* value)
 {
@@ -143,6 +148,12 @@ void ServerStatList::ListOp(ServerStatList* serverStats, EStatOperation statOper
 }
 
 
+NzbInfo::~NzbInfo()
+{
+	m_queued = false;
+	UpdateQueueStats();
+}
+
 void NzbInfo::SetId(int id)
 {
 	m_id = id;
@@ -193,6 +204,20 @@ void NzbInfo::SetFilename(const char* filename)
 	}
 }
 
+/*
+ * Fields reported with each file of the nzb (name, category, etc.) also
+ * advance the revision of the file items.
+ */
+void NzbInfo::Touch(bool fileItems)
+{
+	m_changeRevision = ChangeTracker::NextRevision(m_queued ? ChangeTracker::ikGroup : ChangeTracker::ikHistory);
+	if (fileItems)
+	{
+		m_fileItemRevision = m_changeRevision;
+		ChangeTracker::SetRevision(ChangeTracker::ikFile, m_changeRevision);
+	}
+}
+
 CString NzbInfo::MakeNiceNzbName(const char * nzbFilename, bool removeExt)
 {
 	BString<1024> nicename = FileSystem::BaseFileName(nzbFilename);
@@ -344,6 +369,8 @@ void NzbInfo::UpdateMinMaxTime()
 			}
 		}
 	}
+
+	Touch();
 }
 
 void NzbInfo::AddMessage(Message::EKind kind, const char * text, bool print)
@@ -430,6 +457,7 @@ void NzbInfo::MoveFileList(NzbInfo* srcNzbInfo)
 	SetSize(srcNzbInfo->GetSize());
 	SetRemainingSize(srcNzbInfo->GetRemainingSize());
 	SetPausedSize(srcNzbInfo->GetPausedSize());
+	SetDeletedSize(srcNzbInfo->GetDeletedSize());
 	SetSuccessSize(srcNzbInfo->GetSuccessSize());
 	SetCurrentSuccessSize(srcNzbInfo->GetCurrentSuccessSize());
 	SetFailedSize(srcNzbInfo->GetFailedSize());
@@ -455,11 +483,13 @@ void NzbInfo::EnterPostProcess()
 {
 	m_postInfo = std::make_unique<PostInfo>();
 	m_postInfo->SetNzbInfo(this);
+	UpdateQueueStats();
 }
 
 void NzbInfo::LeavePostProcess()
 {
 	m_postInfo.reset();
+	UpdateQueueStats();
 	ClearMessages();
 }
 
@@ -487,6 +517,7 @@ void NzbInfo::SetActiveDownloads(int activeDownloads)
 		m_changed = true;
 	}
 	m_activeDownloads = activeDownloads;
+	Touch();
 }
 
 bool NzbInfo::IsDupeSuccess()
@@ -655,6 +686,7 @@ void NzbInfo::UpdateCurrentStats()
 	m_remainingParCount = 0;
 	m_remainingSize = 0;
 	m_pausedSize = 0;
+	m_deletedSize = 0;
 	m_currentSuccessArticles = m_successArticles;
 	m_currentFailedArticles = m_failedArticles;
 	m_currentSuccessSize = m_successSize;
@@ -679,6 +711,10 @@ void NzbInfo::UpdateCurrentStats()
 			m_pausedFileCount++;
 			m_pausedSize += fileInfo->GetRemainingSize();
 		}
+		else if (fileInfo->GetDeleted())
+		{
+			m_deletedSize += fileInfo->GetRemainingSize();
+		}
 		if (fileInfo->GetParFile())
 		{
 			m_remainingParCount++;
@@ -688,6 +724,9 @@ void NzbInfo::UpdateCurrentStats()
 
 		m_currentServerStats.ListOp(fileInfo->GetServerStats(), ServerStatList::soAdd);
 	}
+
+	UpdateQueueStats();
+	Touch();
 }
 
 void NzbInfo::UpdateCompletedStats(FileInfo* fileInfo)
@@ -711,6 +750,7 @@ void NzbInfo::UpdateCompletedStats(FileInfo* fileInfo)
 	}
 
 	m_serverStats.ListOp(fileInfo->GetServerStats(), ServerStatList::soAdd);
+	Touch();
 }
 
 void NzbInfo::UpdateDeletedStats(FileInfo* fileInfo)
@@ -741,8 +781,56 @@ void NzbInfo::UpdateDeletedStats(FileInfo* fileInfo)
 		m_pausedFileCount--;
 		m_pausedSize -= fileInfo->GetRemainingSize();
 	}
+	else if (fileInfo->GetDeleted())
+	{
+		m_deletedSize -= fileInfo->GetRemainingSize();
+	}
 
 	m_currentServerStats.ListOp(fileInfo->GetServerStats(), ServerStatList::soSubtract);
+	UpdateQueueStats();
+	Touch();
+}
+
+void NzbInfo::SetQueued(bool queued)
+{
+	m_queued = queued;
+	UpdateQueueStats();
+	// the item moves between the queue and the history
+	ChangeTracker::TouchAll();
+}
+
+/*
+ * Moves the contribution of the item to the statistics of the queue, called
+ * whenever any of the counted values changes.
+ */
+void NzbInfo::UpdateQueueStats()
+{
+	DownloadQueue::Stats stats;
+	if (m_queued)
+	{
+		stats.remainingSize = m_remainingSize - m_pausedSize - m_deletedSize;
+		stats.forcedSize = GetForcePriority() ? stats.remainingSize : 0;
+		stats.postJobCount = m_postInfo ? 1 : 0;
+		stats.urlCount = m_kind == nkUrl ? 1 : 0;
+	}
+
+	if (stats.remainingSize == m_statsRemainingSize && stats.forcedSize == m_statsForcedSize &&
+		stats.postJobCount == m_statsPostJobCount && stats.urlCount == m_statsUrlCount)
+	{
+		return;
+	}
+
+	DownloadQueue::Stats delta;
+	delta.remainingSize = stats.remainingSize - m_statsRemainingSize;
+	delta.forcedSize = stats.forcedSize - m_statsForcedSize;
+	delta.postJobCount = stats.postJobCount - m_statsPostJobCount;
+	delta.urlCount = stats.urlCount - m_statsUrlCount;
+	DownloadQueue::AddStats(delta);
+
+	m_statsRemainingSize = stats.remainingSize;
+	m_statsForcedSize = stats.forcedSize;
+	m_statsPostJobCount = stats.postJobCount;
+	m_statsUrlCount = stats.urlCount;
 }
 
 bool NzbInfo::IsDownloadCompleted(bool ignorePausedPars)
@@ -764,6 +852,36 @@ bool NzbInfo::IsDownloadCompleted(bool ignorePausedPars)
 	return true;
 }
 
+
+void NzbList::Add(std::unique_ptr<NzbInfo> nzbInfo, bool addTop)
+{
+	nzbInfo->SetQueued(true);
+	m_items.Add(std::move(nzbInfo), addTop);
+}
+
+std::unique_ptr<NzbInfo> NzbList::Remove(NzbInfo* nzbInfo)
+{
+	std::unique_ptr<NzbInfo> uptr = m_items.Remove(nzbInfo);
+	if (uptr)
+	{
+		uptr->SetQueued(false);
+	}
+	return uptr;
+}
+
+void NzbList::Replace(iterator pos, std::unique_ptr<NzbInfo> nzbInfo)
+{
+	nzbInfo->SetQueued(true);
+	m_items.Replace(pos, std::move(nzbInfo));
+}
+
+NzbList::iterator NzbList::Insert(iterator pos, std::unique_ptr<NzbInfo> nzbInfo)
+{
+	nzbInfo->SetQueued(true);
+	return m_items.insert(pos, std::move(nzbInfo));
+}
+
+
 void ArticleInfo::AttachSegment(std::unique_ptr<SegmentData> content, int64 offset, int size)
 {
 	m_segmentContent = std::move(content);
@@ -777,6 +895,16 @@ void ArticleInfo::DiscardSegment()
 }
 
 
+FileInfo::~FileInfo()
+{
+	if (m_cachedArticles > 0 && g_ArticleCache)
+	{
+		// the file is deleted before its cached articles were flushed
+		Guard contentGuard = g_ArticleCache->GuardContent();
+		g_ArticleCache->SetCachedArticles(this, 0);
+	}
+}
+
 void FileInfo::SetId(int id)
 {
 	m_id = id;
@@ -805,8 +933,38 @@ void FileInfo::SetPaused(bool paused)
 	{
 		m_nzbInfo->SetPausedFileCount(m_nzbInfo->GetPausedFileCount() + (paused ? 1 : -1));
 		m_nzbInfo->SetPausedSize(m_nzbInfo->GetPausedSize() + (paused ? m_remainingSize : - m_remainingSize));
+		if (m_deleted)
+		{
+			m_nzbInfo->SetDeletedSize(m_nzbInfo->GetDeletedSize() + (paused ? - m_remainingSize : m_remainingSize));
+		}
+		m_nzbInfo->Touch();
 	}
 	m_paused = paused;
+	Touch();
+}
+
+void FileInfo::SetDeleted(bool deleted)
+{
+	if (m_deleted != deleted && !m_paused && m_nzbInfo)
+	{
+		m_nzbInfo->SetDeletedSize(m_nzbInfo->GetDeletedSize() + (deleted ? m_remainingSize : - m_remainingSize));
+	}
+	m_deleted = deleted;
+}
+
+void FileInfo::SetRemainingSize(int64 remainingSize)
+{
+	if (m_deleted && !m_paused && m_nzbInfo)
+	{
+		m_nzbInfo->SetDeletedSize(m_nzbInfo->GetDeletedSize() + remainingSize - m_remainingSize);
+	}
+	m_remainingSize = remainingSize;
+	Touch();
+}
+
+void FileInfo::Touch()
+{
+	m_changeRevision = ChangeTracker::NextRevision(ChangeTracker::ikFile);
 }
 
 void FileInfo::SetExtraPriority(bool extraPriority)
@@ -826,6 +984,7 @@ void FileInfo::MakeValidFilename()
 void FileInfo::SetActiveDownloads(int activeDownloads)
 {
 	m_activeDownloads = activeDownloads;
+	Touch();
 
 	if (m_activeDownloads > 0 && !m_outputFileMutex)
 	{
@@ -839,9 +998,9 @@ void FileInfo::SetActiveDownloads(int activeDownloads)
 
 
 CompletedFile::CompletedFile(int id, const char* filename, const char* origname, EStatus status,
-	uint32 crc, bool parFile, const char* hash16k, const char* parSetId) :
+	uint32 crc, bool parFile, const char* hash16k, const char* parSetId, const char* hashFull) :
 	m_id(id), m_filename(filename), m_origname(origname), m_status(status),
-	m_crc(crc), m_parFile(parFile), m_hash16k(hash16k), m_parSetId(parSetId)
+	m_crc(crc), m_parFile(parFile), m_hash16k(hash16k), m_parSetId(parSetId), m_hashFull(hashFull)
 {
 	if (FileInfo::m_idMax < m_id)
 	{
@@ -874,7 +1033,12 @@ HistoryInfo::~HistoryInfo()
 
 int HistoryInfo::GetId()
 {
-	if ((m_kind == hkNzb || m_kind == hkUrl))
+	if (!m_info)
+	{
+		// the nzb was moved back to queue, the item is about to be removed from history
+		return 0;
+	}
+	else if ((m_kind == hkNzb || m_kind == hkUrl))
 	{
 		return ((NzbInfo*)m_info)->GetId();
 	}
@@ -900,6 +1064,39 @@ const char* HistoryInfo::GetName()
 	}
 }
 
+/*
+ * Modifications of nzb-infos in history can be flagged either on the
+ * history item or on the nzb-info itself.
+ */
+bool HistoryInfo::GetChanged()
+{
+	return m_changed || ((m_kind == hkNzb || m_kind == hkUrl) && m_info && GetNzbInfo()->GetChanged());
+}
+
+void HistoryInfo::SetChanged(bool changed)
+{
+	m_changed = changed;
+	if (changed)
+	{
+		Touch();
+	}
+	if ((m_kind == hkNzb || m_kind == hkUrl) && m_info)
+	{
+		GetNzbInfo()->SetChanged(changed);
+	}
+}
+
+int64 HistoryInfo::GetChangeRevision()
+{
+	return (m_kind == hkNzb || m_kind == hkUrl) && m_info ?
+		std::max(m_changeRevision, GetNzbInfo()->GetChangeRevision()) : m_changeRevision;
+}
+
+void HistoryInfo::Touch()
+{
+	m_changeRevision = ChangeTracker::NextRevision(ChangeTracker::ikHistory);
+}
+
 
 void DownloadQueue::CalcRemainingSize(int64* remaining, int64* remainingForced)
 {
@@ -928,3 +1125,118 @@ void DownloadQueue::CalcRemainingSize(int64* remaining, int64* remainingForced)
 		*remainingForced = remainingForcedSize;
 	}
 }
+
+/*
+ * The items of the queue report the changes of their counted values, status
+ * readers get the totals without the queue lock.
+ */
+void DownloadQueue::AddStats(const Stats& delta)
+{
+	::Guard guard(g_StatsMutex);
+	g_Stats.remainingSize += delta.remainingSize;
+	g_Stats.forcedSize += delta.forcedSize;
+	g_Stats.postJobCount += delta.postJobCount;
+	g_Stats.urlCount += delta.urlCount;
+}
+
+DownloadQueue::Stats DownloadQueue::GetStats()
+{
+	::Guard guard(g_StatsMutex);
+	return g_Stats;
+}
+
+
+ChangeTracker::ChangeTracker()
+{
+	// revisions restart with every program run, clients still holding
+	// revisions of a previous run are recognized by the instance id
+	std::random_device random;
+	m_instance = (int)(random() & 0x7FFFFFFF);
+}
+
+bool ChangeTracker::IsKnownRevision(int instance, int64 revision)
+{
+	return instance == m_instance && revision >= m_minRevision && revision <= g_Revision;
+}
+
+void ChangeTracker::Update(Subject* caller, void* aspect)
+{
+	DownloadQueue::Aspect* queueAspect = (DownloadQueue::Aspect*)aspect;
+	if (queueAspect->nzbInfo)
+	{
+		queueAspect->nzbInfo->Touch();
+	}
+	if (queueAspect->fileInfo)
+	{
+		queueAspect->fileInfo->Touch();
+	}
+}
+
+int64 ChangeTracker::NextRevision(EItemKind kind)
+{
+	int64 revision = ++g_Revision;
+	g_KindRevision[kind] = revision;
+	return revision;
+}
+
+/*
+ * Called when items may have been added or deleted in any list.
+ */
+void ChangeTracker::TouchAll()
+{
+	int64 revision = ++g_Revision;
+	for (std::atomic<int64>& kindRevision : g_KindRevision)
+	{
+		kindRevision = revision;
+	}
+}
+
+void ChangeTracker::BeginScan()
+{
+	m_pass++;
+	m_scanRevision = NextRevision();
+}
+
+/*
+ * Returns revision in which the item was changed last time.
+ */
+int64 ChangeTracker::Scan(EItemKind kind, int id, int64 revision)
+{
+	Item& item = m_items.emplace(MakeKey(kind, id), Item{m_scanRevision, m_pass}).first->second;
+	item.pass = m_pass;
+	return std::max(item.revision, revision);
+}
+
+void ChangeTracker::EndScan()
+{
+	for (ItemMap::iterator it = m_items.begin(); it != m_items.end(); )
+	{
+		if (it->second.pass != m_pass)
+		{
+			m_deleted.push_back({(EItemKind)(it->first >> 32), (int)(uint32)it->first, m_scanRevision});
+			it = m_items.erase(it);
+		}
+		else
+		{
+			it++;
+		}
+	}
+
+	// clients having older revisions must request a full update
+	while (m_deleted.size() > MAX_DELETED)
+	{
+		m_minRevision = m_deleted.front().revision;
+		m_deleted.pop_front();
+	}
+}
+
+void ChangeTracker::ListDeleted(EItemKind kind, int64 sinceRevision, IdList* idList)
+{
+	for (DeletedItem& deleted : m_deleted)
+	{
+		if (deleted.kind == kind && deleted.revision > sinceRevision)
+		{
+			idList->push_back(deleted.id);
+		}
+	}
+}
@@ -129,6 +129,7 @@ public:
 	typedef std::vector<CString> Groups;
 
 	FileInfo(int id = 0) : m_id(id ? id : ++m_idGen) {}
+	~FileInfo();
 	int GetId() { return m_id; }
 	void SetId(int id);
 	static void ResetGenId(bool max);
@@ -137,24 +138,24 @@ public:
 	ArticleList* GetArticles() { return &m_articles; }
 	Groups* GetGroups() { return &m_groups; }
 	const char* GetSubject() { return m_subject; }
-	void SetSubject(const char* subject) { m_subject = subject; }
+	void SetSubject(const char* subject) { m_subject = subject; Touch(); }
 	const char* GetFilename() { return m_filename; }
-	void SetFilename(const char* filename) { m_filename = filename; }
+	void SetFilename(const char* filename) { m_filename = filename; Touch(); }
 	void SetOrigname(const char* origname) { m_origname = origname; }
 	const char* GetOrigname() { return m_origname; }
 	void MakeValidFilename();
 	bool GetFilenameConfirmed() { return m_filenameConfirmed; }
-	void SetFilenameConfirmed(bool filenameConfirmed) { m_filenameConfirmed = filenameConfirmed; }
-	void SetSize(int64 size) { m_size = size; m_remainingSize = size; }
+	void SetFilenameConfirmed(bool filenameConfirmed) { m_filenameConfirmed = filenameConfirmed; Touch(); }
+	void SetSize(int64 size) { m_size = size; m_remainingSize = size; Touch(); }
 	int64 GetSize() { return m_size; }
 	int64 GetRemainingSize() { return m_remainingSize; }
-	void SetRemainingSize(int64 remainingSize) { m_remainingSize = remainingSize; }
+	void SetRemainingSize(int64 remainingSize);
 	int64 GetMissedSize() { return m_missedSize; }
-	void SetMissedSize(int64 missedSize) { m_missedSize = missedSize; }
+	void SetMissedSize(int64 missedSize) { m_missedSize = missedSize; Touch(); }
 	int64 GetSuccessSize() { return m_successSize; }
-	void SetSuccessSize(int64 successSize) { m_successSize = successSize; }
+	void SetSuccessSize(int64 successSize) { m_successSize = successSize; Touch(); }
 	int64 GetFailedSize() { return m_failedSize; }
-	void SetFailedSize(int64 failedSize) { m_failedSize = failedSize; }
+	void SetFailedSize(int64 failedSize) { m_failedSize = failedSize; Touch(); }
 	int GetTotalArticles() { return m_totalArticles; }
 	void SetTotalArticles(int totalArticles) { m_totalArticles = totalArticles; }
 	int GetMissedArticles() { return m_missedArticles; }
@@ -164,11 +165,11 @@ public:
 	int GetSuccessArticles() { return m_successArticles; }
 	void SetSuccessArticles(int successArticles) { m_successArticles = successArticles; }
 	time_t GetTime() { return m_time; }
-	void SetTime(time_t time) { m_time = time; }
+	void SetTime(time_t time) { m_time = time; Touch(); }
 	bool GetPaused() { return m_paused; }
 	void SetPaused(bool paused);
 	bool GetDeleted() { return m_deleted; }
-	void SetDeleted(bool Deleted) { m_deleted = Deleted; }
+	void SetDeleted(bool deleted);
 	int GetCompletedArticles() { return m_completedArticles; }
 	void SetCompletedArticles(int completedArticles) { m_completedArticles = completedArticles; }
 	bool GetParFile() { return m_parFile; }
@@ -196,12 +197,18 @@ public:
 	void SetCrc(uint32 crc) { m_crc = crc; }
 	const char* GetHash16k() { return m_hash16k; }
 	void SetHash16k(const char* hash16k) { m_hash16k = hash16k; }
+	const char* GetHashFull() { return m_hashFull; }
+	void SetHashFull(const char* hashFull) { m_hashFull = hashFull; }
 	const char* GetParSetId() { return m_parSetId; }
 	void SetParSetId(const char* parSetId) { m_parSetId = parSetId; }
 	bool GetFlushLocked() { return m_flushLocked; }
 	void SetFlushLocked(bool flushLocked) { m_flushLocked = flushLocked; }
+	int GetArticleCursor() { return m_articleCursor; }
+	void SetArticleCursor(int articleCursor) { m_articleCursor = articleCursor; }
 
 	ServerStatList* GetServerStats() { return &m_serverStats; }
+	int64 GetChangeRevision() { return m_changeRevision; }
+	void Touch();
 
 private:
 	int m_id;
@@ -239,8 +246,11 @@ private:
 	EPartialState m_partialState = psNone;
 	uint32 m_crc = 0;
 	CString m_hash16k;
+	CString m_hashFull;
 	CString m_parSetId;
 	bool m_flushLocked = false;
+	int m_articleCursor = 0;
+	int64 m_changeRevision = 0;
 
 	static int m_idGen;
 	static int m_idMax;
@@ -263,7 +273,7 @@ public:
 	};
 
 	CompletedFile(int id, const char* filename, const char* oldname, EStatus status,
-		uint32 crc, bool parFile, const char* hash16k, const char* parSetId);
+		uint32 crc, bool parFile, const char* hash16k, const char* parSetId, const char* hashFull);
 	int GetId() { return m_id; }
 	void SetFilename(const char* filename) { m_filename = filename; }
 	const char* GetFilename() { return m_filename; }
@@ -276,6 +286,7 @@ public:
 	void SetHash16k(const char* hash16k) { m_hash16k = hash16k; }
 	const char* GetParSetId() { return m_parSetId; }
 	void SetParSetId(const char* parSetId) { m_parSetId = parSetId; }
+	const char* GetHashFull() { return m_hashFull; }
 
 private:
 	int m_id;
@@ -286,6 +297,7 @@ private:
 	bool m_parFile;
 	CString m_hash16k;
 	CString m_parSetId;
+	CString m_hashFull;
 };
 
 typedef std::deque<CompletedFile> CompletedFileList;
@@ -459,12 +471,13 @@ public:
 		dhRedownloadAuto
 	};
 
+	~NzbInfo();
 	int GetId() { return m_id; }
 	void SetId(int id);
 	static void ResetGenId(bool max);
 	static int GenerateId();
 	EKind GetKind() { return m_kind; }
-	void SetKind(EKind kind) { m_kind = kind; }
+	void SetKind(EKind kind) { m_kind = kind; UpdateQueueStats(); }
 	const char* GetUrl() { return m_url; }
 	void SetUrl(const char* url);
 	const char* GetFilename() { return m_filename; }
@@ -472,27 +485,29 @@ public:
 	static CString MakeNiceNzbName(const char* nzbFilename, bool removeExt);
 	static CString MakeNiceUrlName(const char* url, const char* nzbFilename);
 	const char* GetDestDir() { return m_destDir; }
-	void SetDestDir(const char* destDir) { m_destDir = destDir; }
+	void SetDestDir(const char* destDir) { m_destDir = destDir; Touch(true); }
 	const char* GetFinalDir() { return m_finalDir; }
-	void SetFinalDir(const char* finalDir) { m_finalDir = finalDir; }
+	void SetFinalDir(const char* finalDir) { m_finalDir = finalDir; Touch(); }
 	const char* GetCategory() { return m_category; }
-	void SetCategory(const char* category) { m_category = category; }
+	void SetCategory(const char* category) { m_category = category; Touch(true); }
 	const char* GetName() { return m_name; }
-	void SetName(const char* name) { m_name = name; }
+	void SetName(const char* name) { m_name = name; Touch(true); }
 	int GetFileCount() { return m_fileCount; }
-	void SetFileCount(int fileCount) { m_fileCount = fileCount; }
+	void SetFileCount(int fileCount) { m_fileCount = fileCount; Touch(); }
 	int GetParkedFileCount() { return m_parkedFileCount; }
 	void SetParkedFileCount(int parkedFileCount) { m_parkedFileCount = parkedFileCount; }
 	int64 GetSize() { return m_size; }
-	void SetSize(int64 size) { m_size = size; }
+	void SetSize(int64 size) { m_size = size; Touch(); }
 	int64 GetRemainingSize() { return m_remainingSize; }
-	void SetRemainingSize(int64 remainingSize) { m_remainingSize = remainingSize; }
+	void SetRemainingSize(int64 remainingSize) { m_remainingSize = remainingSize; UpdateQueueStats(); }
 	int64 GetPausedSize() { return m_pausedSize; }
-	void SetPausedSize(int64 pausedSize) { m_pausedSize = pausedSize; }
+	void SetPausedSize(int64 pausedSize) { m_pausedSize = pausedSize; UpdateQueueStats(); Touch(); }
+	int64 GetDeletedSize() { return m_deletedSize; }
+	void SetDeletedSize(int64 deletedSize) { m_deletedSize = deletedSize; UpdateQueueStats(); }
 	int GetPausedFileCount() { return m_pausedFileCount; }
 	void SetPausedFileCount(int pausedFileCount) { m_pausedFileCount = pausedFileCount; }
 	int GetRemainingParCount() { return m_remainingParCount; }
-	void SetRemainingParCount(int remainingParCount) { m_remainingParCount = remainingParCount; }
+	void SetRemainingParCount(int remainingParCount) { m_remainingParCount = remainingParCount; Touch(); }
 	int GetActiveDownloads() { return m_activeDownloads; }
 	void SetActiveDownloads(int activeDownloads);
 	int64 GetSuccessSize() { return m_successSize; }
@@ -514,7 +529,7 @@ public:
 	int64 GetParCurrentFailedSize() { return m_parCurrentFailedSize; }
 	void SetParCurrentFailedSize(int64 parCurrentFailedSize) { m_parCurrentFailedSize = parCurrentFailedSize; }
 	int GetTotalArticles() { return m_totalArticles; }
-	void SetTotalArticles(int totalArticles) { m_totalArticles = totalArticles; }
+	void SetTotalArticles(int totalArticles) { m_totalArticles = totalArticles; Touch(); }
 	int GetSuccessArticles() { return m_successArticles; }
 	void SetSuccessArticles(int successArticles) { m_successArticles = successArticles; }
 	int GetFailedArticles() { return m_failedArticles; }
@@ -524,15 +539,15 @@ public:
 	int GetCurrentFailedArticles() { return m_currentFailedArticles; }
 	void SetCurrentFailedArticles(int currentFailedArticles) { m_currentFailedArticles = currentFailedArticles; }
 	int GetPriority() { return m_priority; }
-	void SetPriority(int priority) { m_priority = priority; }
+	void SetPriority(int priority) { m_priority = priority; UpdateQueueStats(); Touch(true); }
 	int GetExtraPriority() { return m_extraPriority; }
 	void SetExtraPriority(int extraPriority) { m_extraPriority = extraPriority; }
 	bool HasExtraPriority() { return m_extraPriority > 0; }
 	bool GetForcePriority() { return m_priority >= FORCE_PRIORITY; }
 	time_t GetMinTime() { return m_minTime; }
-	void SetMinTime(time_t minTime) { m_minTime = minTime; }
+	void SetMinTime(time_t minTime) { m_minTime = minTime; Touch(); }
 	time_t GetMaxTime() { return m_maxTime; }
-	void SetMaxTime(time_t maxTime) { m_maxTime = maxTime; }
+	void SetMaxTime(time_t maxTime) { m_maxTime = maxTime; Touch(); }
 	void BuildDestDirName();
 	CString BuildFinalDirName();
 	CompletedFileList* GetCompletedFiles() { return &m_completedFiles; }
@@ -543,23 +558,23 @@ public:
 	EPostRenameStatus GetRarRenameStatus() { return m_rarRenameStatus; }
 	void SetRarRenameStatus(EPostRenameStatus renameStatus) { m_rarRenameStatus = renameStatus; }
 	EParStatus GetParStatus() { return m_parStatus; }
-	void SetParStatus(EParStatus parStatus) { m_parStatus = parStatus; }
+	void SetParStatus(EParStatus parStatus) { m_parStatus = parStatus; Touch(); }
 	EDirectUnpackStatus GetDirectUnpackStatus() { return m_directUnpackStatus; }
 	void SetDirectUnpackStatus(EDirectUnpackStatus directUnpackStatus) { m_directUnpackStatus = directUnpackStatus; }
 	EPostUnpackStatus GetUnpackStatus() { return m_unpackStatus; }
-	void SetUnpackStatus(EPostUnpackStatus unpackStatus) { m_unpackStatus = unpackStatus; }
+	void SetUnpackStatus(EPostUnpackStatus unpackStatus) { m_unpackStatus = unpackStatus; Touch(); }
 	ECleanupStatus GetCleanupStatus() { return m_cleanupStatus; }
 	void SetCleanupStatus(ECleanupStatus cleanupStatus) { m_cleanupStatus = cleanupStatus; }
 	EMoveStatus GetMoveStatus() { return m_moveStatus; }
-	void SetMoveStatus(EMoveStatus moveStatus) { m_moveStatus = moveStatus; }
+	void SetMoveStatus(EMoveStatus moveStatus) { m_moveStatus = moveStatus; Touch(); }
 	EDeleteStatus GetDeleteStatus() { return m_deleteStatus; }
-	void SetDeleteStatus(EDeleteStatus deleteStatus) { m_deleteStatus = deleteStatus; }
+	void SetDeleteStatus(EDeleteStatus deleteStatus) { m_deleteStatus = deleteStatus; Touch(); }
 	EMarkStatus GetMarkStatus() { return m_markStatus; }
-	void SetMarkStatus(EMarkStatus markStatus) { m_markStatus = markStatus; }
+	void SetMarkStatus(EMarkStatus markStatus) { m_markStatus = markStatus; Touch(); }
 	EUrlStatus GetUrlStatus() { return m_urlStatus; }
 	int GetExtraParBlocks() { return m_extraParBlocks; }
-	void SetExtraParBlocks(int extraParBlocks) { m_extraParBlocks = extraParBlocks; }
-	void SetUrlStatus(EUrlStatus urlStatus) { m_urlStatus = urlStatus; }
+	void SetExtraParBlocks(int extraParBlocks) { m_extraParBlocks = extraParBlocks; Touch(); }
+	void SetUrlStatus(EUrlStatus urlStatus) { m_urlStatus = urlStatus; Touch(); }
 	const char* GetQueuedFilename() { return m_queuedFilename; }
 	void SetQueuedFilename(const char* queuedFilename) { m_queuedFilename = queuedFilename; }
 	bool GetDeleting() { return m_deleting; }
@@ -588,11 +603,11 @@ public:
 	int CalcHealth();
 	int CalcCriticalHealth(bool allowEstimation);
 	const char* GetDupeKey() { return m_dupeKey; }
-	void SetDupeKey(const char* dupeKey) { m_dupeKey = dupeKey ? dupeKey : ""; }
+	void SetDupeKey(const char* dupeKey) { m_dupeKey = dupeKey ? dupeKey : ""; Touch(); }
 	int GetDupeScore() { return m_dupeScore; }
-	void SetDupeScore(int dupeScore) { m_dupeScore = dupeScore; }
+	void SetDupeScore(int dupeScore) { m_dupeScore = dupeScore; Touch(); }
 	EDupeMode GetDupeMode() { return m_dupeMode; }
-	void SetDupeMode(EDupeMode dupeMode) { m_dupeMode = dupeMode; }
+	void SetDupeMode(EDupeMode dupeMode) { m_dupeMode = dupeMode; Touch(); }
 	EDupeHint GetDupeHint() { return m_dupeHint; }
 	void SetDupeHint(EDupeHint dupeHint) { m_dupeHint = dupeHint; }
 	uint32 GetFullContentHash() { return m_fullContentHash; }
@@ -614,7 +629,7 @@ public:
 	time_t GetDownloadStartTime() { return m_downloadStartTime; }
 	void SetDownloadStartTime(time_t downloadStartTime) { m_downloadStartTime = downloadStartTime; }
 	bool GetChanged() { return m_changed; }
-	void SetChanged(bool changed) { m_changed = changed; }
+	void SetChanged(bool changed) { m_changed = changed; if (changed) Touch(); }
 	void SetReprocess(bool reprocess) { m_reprocess = reprocess; }
 	bool GetReprocess() { return m_reprocess; }
 	time_t GetQueueScriptTime() { return m_queueScriptTime; }
@@ -625,6 +640,9 @@ public:
 	void SetFeedId(int feedId) { m_feedId = feedId; }
 	void MoveFileList(NzbInfo* srcNzbInfo);
 	void UpdateMinMaxTime();
+	int64 GetChangeRevision() { return m_changeRevision; }
+	int64 GetFileItemRevision() { return m_fileItemRevision; }
+	void Touch(bool fileItems = false);
 	PostInfo* GetPostInfo() { return m_postInfo.get(); }
 	void EnterPostProcess();
 	void LeavePostProcess();
@@ -666,6 +684,8 @@ private:
 	int64 m_remainingSize = 0;
 	int m_pausedFileCount = 0;
 	int64 m_pausedSize = 0;
+	// remaining size of files marked as deleted, which aren't paused and are still in the file list
+	int64 m_deletedSize = 0;
 	int m_remainingParCount = 0;
 	int m_activeDownloads = 0;
 	int64 m_successSize = 0;
@@ -735,6 +755,8 @@ private:
 	int m_unpackSec = 0;
 	bool m_reprocess = false;
 	bool m_changed = false;
+	int64 m_changeRevision = 0;
+	int64 m_fileItemRevision = 0;
 	time_t m_queueScriptTime = 0;
 	bool m_parFull = false;
 	int m_messageCount = 0;
@@ -744,16 +766,58 @@ private:
 	bool m_waitingPar = false;
 	bool m_loadingPar = false;
 	Thread* m_unpackThread = nullptr;
+	bool m_queued = false;
+	int64 m_statsRemainingSize = 0;
+	int64 m_statsForcedSize = 0;
+	int m_statsPostJobCount = 0;
+	int m_statsUrlCount = 0;
 
 	static int m_idGen;
 	static int m_idMax;
 
 	void ClearMessages();
+	void SetQueued(bool queued);
+	void UpdateQueueStats();
 
 	friend class DupInfo;
+	friend class NzbList;
 };
 
-typedef UniqueDeque<NzbInfo> NzbList;
+/*
+ * The download queue. Items held by the list are marked as queued, only they
+ * count in the statistics of the queue (see "DownloadQueue::GetStats").
+ * Items erased from the list are destroyed and withdraw from the statistics
+ * in their destructor. The deque is not exposed, all functions adding or
+ * removing items keep the statistics up to date.
+ */
+class NzbList
+{
+public:
+	typedef UniqueDeque<NzbInfo>::iterator iterator;
+	typedef UniqueDeque<NzbInfo>::const_iterator const_iterator;
+
+	iterator begin() { return m_items.begin(); }
+	iterator end() { return m_items.end(); }
+	bool empty() { return m_items.empty(); }
+	int size() { return (int)m_items.size(); }
+	std::unique_ptr<NzbInfo>& at(int index) { return m_items.at(index); }
+	iterator Find(NzbInfo* nzbInfo) { return m_items.Find(nzbInfo); }
+	NzbInfo* Find(int id) { return m_items.Find(id); }
+	void Move(int from, int to) { m_items.Move(from, to); }
+	void Add(std::unique_ptr<NzbInfo> nzbInfo, bool addTop = false);
+	std::unique_ptr<NzbInfo> Remove(NzbInfo* nzbInfo);
+	void Replace(iterator pos, std::unique_ptr<NzbInfo> nzbInfo);
+	iterator Insert(iterator pos, std::unique_ptr<NzbInfo> nzbInfo);
+	void Clear() { m_items.clear(); }
+
+private:
+	UniqueDeque<NzbInfo> m_items;
+};
+
+// for-range loops on pointers to the queue: iterating through raw pointers
+inline RawDequeIterator<NzbInfo> begin(NzbList* c) { return RawDequeIterator<NzbInfo>(c->begin()); }
+inline RawDequeIterator<NzbInfo> end(NzbList* c) { return RawDequeIterator<NzbInfo>(c->end()); }
+
 typedef std::vector<NzbInfo*> RawNzbList;
 
 class PostInfo
@@ -901,8 +965,8 @@ public:
 	};
 
 	HistoryInfo(std::unique_ptr<NzbInfo> nzbInfo) : m_info(nzbInfo.release()),
-		m_kind(GetNzbInfo()->GetKind() == NzbInfo::nkNzb ? hkNzb : hkUrl) {}
-	HistoryInfo(std::unique_ptr<DupInfo> dupInfo) : m_info(dupInfo.release()), m_kind(hkDup) {}
+		m_kind(GetNzbInfo()->GetKind() == NzbInfo::nkNzb ? hkNzb : hkUrl) { Touch(); }
+	HistoryInfo(std::unique_ptr<DupInfo> dupInfo) : m_info(dupInfo.release()), m_kind(hkDup) { Touch(); }
 	~HistoryInfo();
 	EKind GetKind() { return m_kind; }
 	int GetId();
@@ -912,17 +976,93 @@ public:
 	time_t GetTime() { return m_time; }
 	void SetTime(time_t time) { m_time = time; }
 	const char* GetName();
+	bool GetSaved() { return m_saved; }
+	void SetSaved(bool saved) { m_saved = saved; }
+	bool GetChanged();
+	void SetChanged(bool changed);
+	int64 GetChangeRevision();
+	void Touch();
 
 private:
 	void* m_info;
 	EKind m_kind;
 	time_t m_time = 0;
+	bool m_saved = false;
+	bool m_changed = false;
+	int64 m_changeRevision = 0;
 };
 
 typedef UniqueDeque<HistoryInfo> HistoryList;
 
 typedef GuardedPtr<DownloadQueue> GuardedDownloadQueue;
 
+/*
+ * Tracks changes of queue and history items for incremental RPC-requests.
+ * Items are stamped with the current revision when fields reported by
+ * RPC-methods are modified. Items which appear for the first time during
+ * a scan or which are not reported anymore (deleted) are stamped with
+ * the revision of that scan.
+ */
+class ChangeTracker : public Observer
+{
+public:
+	enum EItemKind
+	{
+		ikGroup,
+		ikFile,
+		ikHistory
+	};
+
+	ChangeTracker();
+	static int64 NextRevision() { return ++g_Revision; }
+	static int64 NextRevision(EItemKind kind);
+	static void TouchAll();
+	static int64 GetRevision() { return g_Revision; }
+	static int64 GetRevision(EItemKind kind) { return g_KindRevision[kind]; }
+	static void SetRevision(EItemKind kind, int64 revision) { g_KindRevision[kind] = revision; }
+	int GetInstance() { return m_instance; }
+	bool IsKnownRevision(int instance, int64 revision);
+	void BeginScan();
+	int64 Scan(EItemKind kind, int id, int64 revision);
+	void EndScan();
+	void ListDeleted(EItemKind kind, int64 sinceRevision, IdList* idList);
+
+protected:
+	virtual void Update(Subject* caller, void* aspect);
+
+private:
+	struct Item
+	{
+		int64 revision;
+		int pass;
+	};
+
+	struct DeletedItem
+	{
+		EItemKind kind;
+		int id;
+		int64 revision;
+	};
+
+	typedef std::unordered_map<int64, Item> ItemMap;
+	typedef std::deque<DeletedItem> DeletedList;
+
+	static const int MAX_DELETED = 10000;
+
+	ItemMap m_items;
+	DeletedList m_deleted;
+	int m_instance;
+	int64 m_scanRevision = 0;
+	int64 m_minRevision = 1;
+	int m_pass = 0;
+
+	static std::atomic<int64> g_Revision;
+	// last revision in which an item of the kind was changed, added or deleted
+	static std::atomic<int64> g_KindRevision[ikHistory + 1];
+
+	int64 MakeKey(EItemKind kind, int id) { return ((int64)kind << 32) | (uint32)id; }
+};
+
 class DownloadQueue : public Subject
 {
 public:
@@ -1013,6 +1153,14 @@ public:
 		mmRegEx
 	};
 
+	struct Stats
+	{
+		int64 remainingSize = 0;
+		int64 forcedSize = 0;
+		int postJobCount = 0;
+		int urlCount = 0;
+	};
+
 	static bool IsLoaded() { return g_Loaded; }
 	static GuardedDownloadQueue Guard() { return GuardedDownloadQueue(g_DownloadQueue, &g_DownloadQueue->m_lockMutex); }
 	NzbList* GetQueue() { return &m_queue; }
@@ -1023,9 +1171,12 @@ public:
 	virtual void Save() = 0;
 	virtual void SaveChanged() = 0;
 	void CalcRemainingSize(int64* remaining, int64* remainingForced);
+	static void AddStats(const Stats& delta);
+	static Stats GetStats();
+	ChangeTracker* GetChangeTracker() { return &m_changeTracker; }
 
 protected:
-	DownloadQueue() {}
+	DownloadQueue() { Attach(&m_changeTracker); }
 	static void Init(DownloadQueue* globalInstance) { g_DownloadQueue = globalInstance; }
 	static void Final() { g_DownloadQueue = nullptr; }
 	static void Loaded() { g_Loaded = true; }
@@ -1033,10 +1184,13 @@ protected:
 private:
 	NzbList m_queue;
 	HistoryList m_history;
+	ChangeTracker m_changeTracker;
 	Mutex m_lockMutex;
 
 	static DownloadQueue* g_DownloadQueue;
 	static bool g_Loaded;
+	static Stats g_Stats;
+	static Mutex g_StatsMutex;
 };
 
 #endif
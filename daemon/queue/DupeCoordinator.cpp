@@ -35,6 +35,195 @@ bool DupeCoordinator::SameNameOrKey(const char* name1, const char* dupeKey1,
 		(!hasDupeKeys && !strcasecmp(name1, name2));
 }
 
+uint32 DupeCoordinator::HashName(const char* name)
+{
+	BString<1024> loName = name;
+	for (char* p = loName; *p; p++) *p = tolower(*p); // convert string to lowercase
+	return Util::HashBJ96(loName, loName.Length(), 0);
+}
+
+void DupeCoordinator::AddToIndex(HistoryIndex* index, uint32 hash, int id)
+{
+	IdList& ids = (*index)[hash];
+	if (std::find(ids.begin(), ids.end(), id) == ids.end())
+	{
+		ids.push_back(id);
+		m_indexSize++;
+	}
+}
+
+void DupeCoordinator::IndexHistory(HistoryInfo* historyInfo)
+{
+	const char* name;
+	const char* dupeKey;
+	uint32 fullContentHash;
+	uint32 filteredContentHash;
+
+	if ((historyInfo->GetKind() == HistoryInfo::hkNzb || historyInfo->GetKind() == HistoryInfo::hkUrl) &&
+		historyInfo->GetNzbInfo())
+	{
+		name = historyInfo->GetNzbInfo()->GetName();
+		dupeKey = historyInfo->GetNzbInfo()->GetDupeKey();
+		fullContentHash = historyInfo->GetNzbInfo()->GetFullContentHash();
+		filteredContentHash = historyInfo->GetNzbInfo()->GetFilteredContentHash();
+	}
+	else if (historyInfo->GetKind() == HistoryInfo::hkDup && historyInfo->GetDupInfo())
+	{
+		name = historyInfo->GetDupInfo()->GetName();
+		dupeKey = historyInfo->GetDupInfo()->GetDupeKey();
+		fullContentHash = historyInfo->GetDupInfo()->GetFullContentHash();
+		filteredContentHash = historyInfo->GetDupInfo()->GetFilteredContentHash();
+	}
+	else
+	{
+		return;
+	}
+
+	int id = historyInfo->GetId();
+	AddToIndex(&m_nameIndex, HashName(name), id);
+	if (!Util::EmptyStr(dupeKey))
+	{
+		AddToIndex(&m_dupeKeyIndex, HashName(dupeKey), id);
+	}
+	if (fullContentHash > 0)
+	{
+		AddToIndex(&m_contentIndex, fullContentHash, id);
+	}
+	if (filteredContentHash > 0)
+	{
+		AddToIndex(&m_contentIndex, filteredContentHash, id);
+	}
+}
+
+void DupeCoordinator::BuildIndex(DownloadQueue* downloadQueue)
+{
+	debug("Building duplicate index for history");
+
+	m_nameIndex.clear();
+	m_dupeKeyIndex.clear();
+	m_contentIndex.clear();
+	m_historyOrder.clear();
+	m_indexSize = 0;
+
+	m_historyTop = downloadQueue->GetHistory()->size();
+	uint32 order = m_historyTop;
+	for (HistoryInfo* historyInfo : downloadQueue->GetHistory())
+	{
+		m_historyOrder[historyInfo->GetId()] = order--;
+		IndexHistory(historyInfo);
+	}
+
+	// history added during loading of the queue isn't reported, build again later
+	m_indexed = DownloadQueue::IsLoaded();
+}
+
+void DupeCoordinator::HistoryAdded(DownloadQueue* downloadQueue, HistoryInfo* historyInfo)
+{
+	if (m_indexed)
+	{
+		// new items are always added on top of history
+		m_historyOrder[historyInfo->GetId()] = ++m_historyTop;
+		HistoryUpdated(downloadQueue, historyInfo);
+	}
+}
+
+void DupeCoordinator::HistoryUpdated(DownloadQueue* downloadQueue, HistoryInfo* historyInfo)
+{
+	if (!m_indexed)
+	{
+		return;
+	}
+
+	IndexHistory(historyInfo);
+
+	// too many outdated entries, rebuild on next use
+	if (m_indexSize > (int)downloadQueue->GetHistory()->size() * 4 + 1000)
+	{
+		m_indexed = false;
+	}
+}
+
+void DupeCoordinator::HistoryRemoved(DownloadQueue* downloadQueue, int id)
+{
+	// entries in hash indices are removed on next lookup, the order isn't looked up by id
+	m_historyOrder.erase(id);
+}
+
+void DupeCoordinator::FindInIndex(HistoryIndex* index, uint32 hash, HistoryList* history, RawHistoryList* result)
+{
+	HistoryIndex::iterator it = index->find(hash);
+	if (it == index->end())
+	{
+		return;
+	}
+
+	IdList& ids = it->second;
+	for (IdList::iterator itId = ids.begin(); itId != ids.end(); )
+	{
+		HistoryInfo* historyInfo = history->Find(*itId);
+		if (!historyInfo)
+		{
+			// the item was deleted from history or moved back to queue
+			itId = ids.erase(itId);
+			m_indexSize--;
+			continue;
+		}
+
+		if (std::find(result->begin(), result->end(), historyInfo) == result->end())
+		{
+			result->push_back(historyInfo);
+		}
+		itId++;
+	}
+
+	if (ids.empty())
+	{
+		index->erase(it);
+	}
+}
+
+/**
+  Returns history items which may be duplicates of the given name/dupekey or which
+  may have the same content as the given nzb, in the order of history (most recent first).
+  The list can contain items which are not duplicates, the caller must check each item.
+*/
+DupeCoordinator::RawHistoryList DupeCoordinator::FindHistory(DownloadQueue* downloadQueue,
+	const char* name, const char* dupeKey, NzbInfo* contentNzbInfo)
+{
+	if (!m_indexed)
+	{
+		BuildIndex(downloadQueue);
+	}
+
+	RawHistoryList result;
+	HistoryList* history = downloadQueue->GetHistory();
+
+	FindInIndex(&m_nameIndex, HashName(name), history, &result);
+
+	if (!Util::EmptyStr(dupeKey))
+	{
+		FindInIndex(&m_dupeKeyIndex, HashName(dupeKey), history, &result);
+	}
+
+	if (contentNzbInfo && contentNzbInfo->GetFullContentHash() > 0)
+	{
+		FindInIndex(&m_contentIndex, contentNzbInfo->GetFullContentHash(), history, &result);
+	}
+
+	if (contentNzbInfo && contentNzbInfo->GetFilteredContentHash() > 0)
+	{
+		FindInIndex(&m_contentIndex, contentNzbInfo->GetFilteredContentHash(), history, &result);
+	}
+
+	std::sort(result.begin(), result.end(),
+		[this](HistoryInfo* historyInfo1, HistoryInfo* historyInfo2)
+		{
+			return m_historyOrder[historyInfo1->GetId()] > m_historyOrder[historyInfo2->GetId()];
+		});
+
+	return result;
+}
+
 /**
   Check if the title was already downloaded or is already queued:
   - if there is a duplicate with exactly same content (via hash-check)
@@ -113,7 +302,7 @@ void DupeCoordinator::NzbFound(DownloadQueue* downloadQueue, NzbInfo* nzbInfo)
 	}
 	if (Util::EmptyStr(nzbInfo->GetDupeKey()) && nzbInfo->GetDupeScore() == 0)
 	{
-		for (HistoryInfo* historyInfo : downloadQueue->GetHistory())
+		for (HistoryInfo* historyInfo : FindHistory(downloadQueue, nzbInfo->GetName(), nullptr, nullptr))
 		{
 			if (historyInfo->GetKind() == HistoryInfo::hkNzb &&
 				!strcmp(historyInfo->GetNzbInfo()->GetName(), nzbInfo->GetName()) &&
@@ -148,7 +337,7 @@ void DupeCoordinator::NzbFound(DownloadQueue* downloadQueue, NzbInfo* nzbInfo)
 	// find duplicates in history having exactly same content
 	// also: nzb-files having duplicates marked as good are skipped
 	// also (only in score mode): nzb-files having success-duplicates in dup-history but not having duplicates in recent history are skipped
-	for (HistoryInfo* historyInfo : downloadQueue->GetHistory())
+	for (HistoryInfo* historyInfo : FindHistory(downloadQueue, nzbInfo->GetName(), nzbInfo->GetDupeKey(), nzbInfo))
 	{
 		if (historyInfo->GetKind() == HistoryInfo::hkNzb &&
 			((nzbInfo->GetFullContentHash() > 0 &&
@@ -211,7 +400,7 @@ void DupeCoordinator::NzbFound(DownloadQueue* downloadQueue, NzbInfo* nzbInfo)
 	if (!sameContent && !good && nzbInfo->GetDupeMode() == dmScore)
 	{
 		// nzb-files having success-duplicates in recent history (with different content) are added to history for backup
-		for (HistoryInfo* historyInfo : downloadQueue->GetHistory())
+		for (HistoryInfo* historyInfo : FindHistory(downloadQueue, nzbInfo->GetName(), nzbInfo->GetDupeKey(), nullptr))
 		{
 			if ((historyInfo->GetKind() == HistoryInfo::hkNzb ||
 				 historyInfo->GetKind() == HistoryInfo::hkUrl) &&
@@ -328,10 +517,12 @@ void DupeCoordinator::NzbCompleted(DownloadQueue* downloadQueue, NzbInfo* nzbInf
 */
 void DupeCoordinator::ReturnBestDupe(DownloadQueue* downloadQueue, NzbInfo* nzbInfo, const char* nzbName, const char* dupeKey)
 {
+	RawHistoryList historyDupes = FindHistory(downloadQueue, nzbName, dupeKey, nullptr);
+
 	// check if history (recent or dup) has other success-duplicates or good-duplicates
 	bool dupeFound = false;
 	int historyScore = 0;
-	for (HistoryInfo* historyInfo : downloadQueue->GetHistory())
+	for (HistoryInfo* historyInfo : historyDupes)
 	{
 		bool goodDupe = false;
 
@@ -388,7 +579,7 @@ void DupeCoordinator::ReturnBestDupe(DownloadQueue* downloadQueue, NzbInfo* nzbI
 	// find dupe-backup with highest score, whose score is also higher than other
 	// success-duplicates and higher than already queued items
 	HistoryInfo* historyDupe = nullptr;
-	for (HistoryInfo* historyInfo : downloadQueue->GetHistory())
+	for (HistoryInfo* historyInfo : historyDupes)
 	{
 		if ((historyInfo->GetKind() == HistoryInfo::hkNzb ||
 			 historyInfo->GetKind() == HistoryInfo::hkUrl) &&
@@ -420,6 +611,8 @@ void DupeCoordinator::HistoryMark(DownloadQueue* downloadQueue, HistoryInfo* his
 
 	info("Marking %s as %s", historyInfo->GetName(), markStatusName[markStatus]);
 
+	historyInfo->SetChanged(true);
+
 	if (historyInfo->GetKind() == HistoryInfo::hkNzb)
 	{
 		historyInfo->GetNzbInfo()->SetMarkStatus(markStatus);
@@ -472,13 +665,13 @@ void DupeCoordinator::HistoryCleanup(DownloadQueue* downloadQueue, HistoryInfo*
 		markHistoryInfo->GetKind() == HistoryInfo::hkDup ? markHistoryInfo->GetDupInfo()->GetName() :
 		nullptr;
 	bool changed = false;
-	int index = 0;
+	RawHistoryList historyDupes = FindHistory(downloadQueue, nzbName, dupeKey, nullptr);
 
 	// traversing in a reverse order to delete items in order they were added to history
 	// (just to produce the log-messages in a more logical order)
-	for (HistoryList::reverse_iterator it = downloadQueue->GetHistory()->rbegin(); it != downloadQueue->GetHistory()->rend(); )
+	for (RawHistoryList::reverse_iterator it = historyDupes.rbegin(); it != historyDupes.rend(); it++)
 	{
-		HistoryInfo* historyInfo = (*it).get();
+		HistoryInfo* historyInfo = *it;
 
 		if ((historyInfo->GetKind() == HistoryInfo::hkNzb ||
 			 historyInfo->GetKind() == HistoryInfo::hkUrl) &&
@@ -487,16 +680,11 @@ void DupeCoordinator::HistoryCleanup(DownloadQueue* downloadQueue, HistoryInfo*
 			historyInfo != markHistoryInfo &&
 			SameNameOrKey(historyInfo->GetNzbInfo()->GetName(), historyInfo->GetNzbInfo()->GetDupeKey(), nzbName, dupeKey))
 		{
-			g_HistoryCoordinator->HistoryHide(downloadQueue, historyInfo, index);
-			index++;
-			it = downloadQueue->GetHistory()->rbegin() + index;
+			HistoryList* history = downloadQueue->GetHistory();
+			int rindex = history->end() - 1 - history->Find(historyInfo);
+			g_HistoryCoordinator->HistoryHide(downloadQueue, historyInfo, rindex);
 			changed = true;
 		}
-		else
-		{
-			it++;
-			index++;
-		}
 	}
 
 	if (changed)
@@ -528,7 +716,7 @@ DupeCoordinator::EDupeStatus DupeCoordinator::GetDupeStatus(DownloadQueue* downl
 	}
 
 	// find duplicates in history
-	for (HistoryInfo* historyInfo : downloadQueue->GetHistory())
+	for (HistoryInfo* historyInfo : FindHistory(downloadQueue, name, dupeKey, nullptr))
 	{
 		if (historyInfo->GetKind() == HistoryInfo::hkNzb &&
 			SameNameOrKey(name, dupeKey, historyInfo->GetNzbInfo()->GetName(), historyInfo->GetNzbInfo()->GetDupeKey()))
@@ -577,7 +765,7 @@ RawNzbList DupeCoordinator::ListHistoryDupes(DownloadQueue* downloadQueue, NzbIn
 	}
 
 	// find duplicates in history
-	for (HistoryInfo* historyInfo : downloadQueue->GetHistory())
+	for (HistoryInfo* historyInfo : FindHistory(downloadQueue, nzbInfo->GetName(), nzbInfo->GetDupeKey(), nullptr))
 	{
 		if (historyInfo->GetKind() == HistoryInfo::hkNzb &&
 			historyInfo->GetNzbInfo()->GetDupeMode() != dmForce &&
@@ -41,11 +41,35 @@ public:
 	void HistoryMark(DownloadQueue* downloadQueue, HistoryInfo* historyInfo, NzbInfo::EMarkStatus markStatus);
 	EDupeStatus GetDupeStatus(DownloadQueue* downloadQueue, const char* name, const char* dupeKey);
 	RawNzbList ListHistoryDupes(DownloadQueue* downloadQueue, NzbInfo* nzbInfo);
+	void HistoryAdded(DownloadQueue* downloadQueue, HistoryInfo* historyInfo);
+	void HistoryUpdated(DownloadQueue* downloadQueue, HistoryInfo* historyInfo);
+	void HistoryRemoved(DownloadQueue* downloadQueue, int id);
 
 private:
+	typedef std::vector<HistoryInfo*> RawHistoryList;
+	typedef std::unordered_map<uint32, IdList> HistoryIndex;
+
+	// Ids of history items by hashes of lower-case names, dupe keys and by content hashes.
+	// The index is built on first use and then updated on history changes. Entries may
+	// be outdated, every candidate is looked up by id and then checked as usual.
+	HistoryIndex m_nameIndex;
+	HistoryIndex m_dupeKeyIndex;
+	HistoryIndex m_contentIndex;
+	// position of items in history, greater values are closer to the top
+	std::unordered_map<int, uint32> m_historyOrder;
+	uint32 m_historyTop = 0;
+	int m_indexSize = 0;
+	bool m_indexed = false;
+
 	void ReturnBestDupe(DownloadQueue* downloadQueue, NzbInfo* nzbInfo, const char* nzbName, const char* dupeKey);
 	void HistoryCleanup(DownloadQueue* downloadQueue, HistoryInfo* markHistoryInfo);
 	bool SameNameOrKey(const char* name1, const char* dupeKey1, const char* name2, const char* dupeKey2);
+	RawHistoryList FindHistory(DownloadQueue* downloadQueue, const char* name, const char* dupeKey, NzbInfo* contentNzbInfo);
+	void FindInIndex(HistoryIndex* index, uint32 hash, HistoryList* history, RawHistoryList* result);
+	void BuildIndex(DownloadQueue* downloadQueue);
+	void IndexHistory(HistoryInfo* historyInfo);
+	void AddToIndex(HistoryIndex* index, uint32 hash, int id);
+	uint32 HashName(const char* name);
 };
 
 extern DupeCoordinator* g_DupeCoordinator;
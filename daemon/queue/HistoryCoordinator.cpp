@@ -65,6 +65,7 @@ void HistoryCoordinator::ServiceWork()
 				}
 				info("Collection %s removed from history", historyInfo->GetName());
 
+				g_DupeCoordinator->HistoryRemoved(downloadQueue, historyInfo->GetId());
 				downloadQueue->GetHistory()->erase(downloadQueue->GetHistory()->end() - 1 - index);
 			}
 
@@ -123,8 +124,10 @@ void HistoryCoordinator::AddToHistory(DownloadQueue* downloadQueue, NzbInfo* nzb
 	std::unique_ptr<NzbInfo> oldNzbInfo = downloadQueue->GetQueue()->Remove(nzbInfo);
 	std::unique_ptr<HistoryInfo> historyInfo = std::make_unique<HistoryInfo>(std::move(oldNzbInfo));
 	historyInfo->SetTime(Util::CurrentTime());
+	HistoryInfo* addedHistoryInfo = historyInfo.get();
 	downloadQueue->GetHistory()->Add(std::move(historyInfo), true);
 	downloadQueue->HistoryChanged();
+	g_DupeCoordinator->HistoryAdded(downloadQueue, addedHistoryInfo);
 
 	// park remaining files
 	for (FileInfo* fileInfo : nzbInfo->GetFileList())
@@ -132,7 +135,7 @@ void HistoryCoordinator::AddToHistory(DownloadQueue* downloadQueue, NzbInfo* nzb
 		nzbInfo->UpdateCompletedStats(fileInfo);
 		nzbInfo->GetCompletedFiles()->emplace_back(fileInfo->GetId(), fileInfo->GetFilename(),
 			fileInfo->GetOrigname(), CompletedFile::cfNone, 0, fileInfo->GetParFile(),
-			fileInfo->GetHash16k(), fileInfo->GetParSetId());
+			fileInfo->GetHash16k(), fileInfo->GetParSetId(), nullptr);
 	}
 
 	// Cleaning up parked files if par-check was successful or unpack was successful or
@@ -220,7 +223,7 @@ void HistoryCoordinator::HistoryHide(DownloadQueue* downloadQueue, HistoryInfo*
 
 	info("Collection %s removed from history", historyInfo->GetName());
 
-	(*downloadQueue->GetHistory())[downloadQueue->GetHistory()->size() - 1 - rindex] = std::move(newHistoryInfo);
+	downloadQueue->GetHistory()->Replace(downloadQueue->GetHistory()->end() - 1 - rindex, std::move(newHistoryInfo));
 }
 
 void HistoryCoordinator::PrepareEdit(DownloadQueue* downloadQueue, IdList* idList, DownloadQueue::EEditAction action)
@@ -235,6 +238,7 @@ void HistoryCoordinator::PrepareEdit(DownloadQueue* downloadQueue, IdList* idLis
 			if (historyInfo && historyInfo->GetKind() == HistoryInfo::hkNzb)
 			{
 				historyInfo->GetNzbInfo()->SetMarkStatus(NzbInfo::ksBad);
+				historyInfo->SetChanged(true);
 			}
 		}
 	}
@@ -246,79 +250,90 @@ bool HistoryCoordinator::EditList(DownloadQueue* downloadQueue, IdList* idList,
 	bool ok = false;
 	PrepareEdit(downloadQueue, idList, action);
 
+	HistoryList* history = downloadQueue->GetHistory();
+
 	for (int id : *idList)
 	{
-		for (HistoryList::iterator itHistory = downloadQueue->GetHistory()->begin(); itHistory != downloadQueue->GetHistory()->end(); itHistory++)
+		HistoryList::iterator itHistory = history->Locate(id);
+		if (itHistory == history->end())
 		{
-			HistoryInfo* historyInfo = (*itHistory).get();
-			if (historyInfo->GetId() == id)
-			{
-				ok = true;
+			continue;
+		}
 
-				switch (action)
-				{
-					case DownloadQueue::eaHistoryDelete:
-					case DownloadQueue::eaHistoryFinalDelete:
-						HistoryDelete(downloadQueue, itHistory, historyInfo, action == DownloadQueue::eaHistoryFinalDelete);
-						break;
-
-					case DownloadQueue::eaHistoryReturn:
-						HistoryReturn(downloadQueue, itHistory, historyInfo);
-						break;
-
-					case DownloadQueue::eaHistoryProcess:
-						HistoryProcess(downloadQueue, itHistory, historyInfo);
-						break;
-
-					case DownloadQueue::eaHistoryRedownload:
-						HistoryRedownload(downloadQueue, itHistory, historyInfo, false);
-						break;
-
-					case DownloadQueue::eaHistoryRetryFailed:
-						HistoryRetry(downloadQueue, itHistory, historyInfo, true, false);
-						break;
-
-					case DownloadQueue::eaHistorySetParameter:
-						ok = HistorySetParameter(historyInfo, args);
-						break;
-
- 					case DownloadQueue::eaHistorySetCategory:
-						ok = HistorySetCategory(historyInfo, args);
-						break;
-
- 					case DownloadQueue::eaHistorySetName:
-						ok = HistorySetName(historyInfo, args);
-						break;
-
-					case DownloadQueue::eaHistorySetDupeKey:
-					case DownloadQueue::eaHistorySetDupeScore:
-					case DownloadQueue::eaHistorySetDupeMode:
-					case DownloadQueue::eaHistorySetDupeBackup:
-						HistorySetDupeParam(historyInfo, action, args);
-						break;
-
-					case DownloadQueue::eaHistoryMarkBad:
-						g_DupeCoordinator->HistoryMark(downloadQueue, historyInfo, NzbInfo::ksBad);
-						break;
-
-					case DownloadQueue::eaHistoryMarkGood:
-						g_DupeCoordinator->HistoryMark(downloadQueue, historyInfo, NzbInfo::ksGood);
-						break;
-
-					case DownloadQueue::eaHistoryMarkSuccess:
-						g_DupeCoordinator->HistoryMark(downloadQueue, historyInfo, NzbInfo::ksSuccess);
-						break;
-
-					default:
-						// nothing, just to avoid compiler warning
-						break;
-				}
+		HistoryInfo* historyInfo = itHistory->get();
+		ok = true;
 
+		switch (action)
+		{
+			case DownloadQueue::eaHistoryDelete:
+			case DownloadQueue::eaHistoryFinalDelete:
+				HistoryDelete(downloadQueue, itHistory, historyInfo, action == DownloadQueue::eaHistoryFinalDelete);
+				break;
+
+			case DownloadQueue::eaHistoryReturn:
+				HistoryReturn(downloadQueue, itHistory, historyInfo);
+				break;
+
+			case DownloadQueue::eaHistoryProcess:
+				HistoryProcess(downloadQueue, itHistory, historyInfo);
+				break;
+
+			case DownloadQueue::eaHistoryRedownload:
+				HistoryRedownload(downloadQueue, itHistory, historyInfo, false);
+				break;
+
+			case DownloadQueue::eaHistoryRetryFailed:
+				HistoryRetry(downloadQueue, itHistory, historyInfo, true, false);
+				break;
+
+			case DownloadQueue::eaHistorySetParameter:
+				ok = HistorySetParameter(historyInfo, args);
+				historyInfo->SetChanged(true);
+				break;
+
+			case DownloadQueue::eaHistorySetCategory:
+				ok = HistorySetCategory(historyInfo, args);
+				historyInfo->SetChanged(true);
+				break;
+
+			case DownloadQueue::eaHistorySetName:
+				ok = HistorySetName(historyInfo, args);
+				historyInfo->SetChanged(true);
+				g_DupeCoordinator->HistoryUpdated(downloadQueue, historyInfo);
+				break;
+
+			case DownloadQueue::eaHistorySetDupeKey:
+			case DownloadQueue::eaHistorySetDupeScore:
+			case DownloadQueue::eaHistorySetDupeMode:
+			case DownloadQueue::eaHistorySetDupeBackup:
+				HistorySetDupeParam(historyInfo, action, args);
+				historyInfo->SetChanged(true);
+				g_DupeCoordinator->HistoryUpdated(downloadQueue, historyInfo);
+				break;
+
+			case DownloadQueue::eaHistoryMarkBad:
+				g_DupeCoordinator->HistoryMark(downloadQueue, historyInfo, NzbInfo::ksBad);
+				break;
+
+			case DownloadQueue::eaHistoryMarkGood:
+				g_DupeCoordinator->HistoryMark(downloadQueue, historyInfo, NzbInfo::ksGood);
+				break;
+
+			case DownloadQueue::eaHistoryMarkSuccess:
+				g_DupeCoordinator->HistoryMark(downloadQueue, historyInfo, NzbInfo::ksSuccess);
+				break;
+
+			default:
+				// nothing, just to avoid compiler warning
 				break;
-			}
 		}
 	}
 
+	if (action == DownloadQueue::eaHistoryDelete || action == DownloadQueue::eaHistoryFinalDelete)
+	{
+		history->Compact();
+	}
+
 	if (ok)
 	{
 		downloadQueue->HistoryChanged();
@@ -355,7 +370,9 @@ void HistoryCoordinator::HistoryDelete(DownloadQueue* downloadQueue, HistoryList
 
 	if (final || !g_Options->GetDupeCheck() || historyInfo->GetKind() == HistoryInfo::hkUrl)
 	{
-		downloadQueue->GetHistory()->erase(itHistory);
+		g_DupeCoordinator->HistoryRemoved(downloadQueue, historyInfo->GetId());
+		// the empty slot is removed by "EditList" together with other deleted items
+		itHistory->reset();
 	}
 	else
 	{
@@ -415,6 +432,7 @@ void HistoryCoordinator::MoveToQueue(DownloadQueue* downloadQueue, HistoryList::
 	nzbInfo->SetReprocess(reprocess);
 	nzbInfo->SetFinalDir("");
 
+	g_DupeCoordinator->HistoryRemoved(downloadQueue, nzbInfo->GetId());
 	downloadQueue->GetHistory()->erase(itHistory);
 	// the object "pHistoryInfo" is released few lines later, after the call to "NZBDownloaded"
 	nzbInfo->PrintMessage(Message::mkInfo, "%s returned from history back to download queue", *nicename);
@@ -440,6 +458,7 @@ void HistoryCoordinator::HistoryRedownload(DownloadQueue* downloadQueue, History
 		nzbInfo->SetDeleteStatus(NzbInfo::dsNone);
 		nzbInfo->SetDupeHint(nzbInfo->GetDupeHint() == NzbInfo::dhNone ? NzbInfo::dhRedownloadManual : nzbInfo->GetDupeHint());
 		downloadQueue->GetQueue()->Add(std::unique_ptr<NzbInfo>(nzbInfo), true);
+		g_DupeCoordinator->HistoryRemoved(downloadQueue, nzbInfo->GetId());
 		downloadQueue->GetHistory()->erase(itHistory);
 
 		DownloadQueue::Aspect aspect = {DownloadQueue::eaUrlReturned, downloadQueue, nzbInfo, nullptr};
@@ -687,6 +706,8 @@ void HistoryCoordinator::ResetArticles(FileInfo* fileInfo, bool allFailed, bool
 		nzbInfo->SetParSuccessSize(nzbInfo->GetParSuccessSize() - fileInfo->GetSuccessSize());
 	}
 
+	fileInfo->SetArticleCursor(0);
+
 	for (ArticleInfo* pa : fileInfo->GetArticles())
 	{
 		if ((pa->GetStatus() == ArticleInfo::aiFailed && (resetFailed || fileInfo->GetPartialState() == FileInfo::psNone)) ||
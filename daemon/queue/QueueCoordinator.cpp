@@ -32,6 +32,9 @@
 #include "Decoder.h"
 #include "StatMeter.h"
 
+// How long RPC readers wait for the coordinator to publish a snapshot before taking it themselves
+static const int SNAPSHOT_WAIT_TIME = 1000;
+
 bool QueueCoordinator::CoordinatorDownloadQueue::EditEntry(
 	int ID, EEditAction action, const char* args)
 {
@@ -73,6 +76,9 @@ void QueueCoordinator::CoordinatorDownloadQueue::Save()
 	m_wantSave = false;
 	m_historyChanged = false;
 
+	// items deleted by the edit are detected by the next scan of change tracker
+	ChangeTracker::TouchAll();
+
 	// queue has changed, time to wake up if in standby
 	m_owner->WakeUp();
 }
@@ -144,6 +150,10 @@ void QueueCoordinator::Load()
 		g_StatMeter->Save();
 
 		// re-save queue into diskstate to update server ids
+		for (HistoryInfo* historyInfo : downloadQueue->GetHistory())
+		{
+			historyInfo->SetChanged(true);
+		}
 		downloadQueue->HistoryChanged();
 		downloadQueue->Save();
 
@@ -234,10 +244,15 @@ void QueueCoordinator::Run()
 
 		if (!downloadsChecked)
 		{
-			GuardedDownloadQueue guard = DownloadQueue::Guard();
+			Guard guard(m_activeDownloadsMutex);
 			articeDownloadsRunning = !m_activeDownloads.empty();
 		}
 
+		if (m_snapshotWanted)
+		{
+			PublishSnapshots(m_snapshotWanted.exchange(0));
+		}
+
 		bool standBy = !articeDownloadsRunning;
 		if (standBy != wasStandBy)
 		{
@@ -257,13 +272,13 @@ void QueueCoordinator::Run()
 			// sleeping max. 2 seconds; can't sleep much longer because we can't rely on
 			// notifications from 'WorkState' and we also have periodical work to do here
 			waitInterval = std::min(waitInterval * 2, 2000);
-			m_waitCond.WaitFor(m_waitMutex, waitInterval, [&]{ return m_hasMoreJobs || IsStopped(); });
+			m_waitCond.WaitFor(m_waitMutex, waitInterval, [&]{ return m_hasMoreJobs || m_snapshotWanted || IsStopped(); });
 		}
 		else
 		{
 			int sleepInterval = downloadStarted ? 0 : 5;
 			Util::Sleep(sleepInterval);
-			g_StatMeter->AddSpeedReading(0);
+			g_StatMeter->CollectSpeedReadings();
 			waitInterval = 100;
 		}
 
@@ -301,6 +316,73 @@ void QueueCoordinator::WakeUp()
 	m_waitCond.NotifyAll();
 }
 
+/*
+ * Returns the snapshot of the current revision of the groups, files or history. The
+ * snapshot is taken in the loop of the coordinator; readers asking in the meantime
+ * share it. While the loop doesn't run (on start and on shutdown) readers take the
+ * snapshot themselves.
+ */
+std::shared_ptr<QueueSnapshot> QueueCoordinator::GetSnapshot(ChangeTracker::EItemKind kind)
+{
+	int snapshotCount;
+	{
+		Guard guard(m_snapshotMutex);
+		if (m_snapshots[kind] && m_snapshots[kind]->IsCurrent())
+		{
+			return m_snapshots[kind];
+		}
+		snapshotCount = m_snapshotCounts[kind];
+		m_snapshotWanted |= 1 << kind;
+	}
+
+	{
+		Guard guard(m_waitMutex);
+		m_waitCond.NotifyAll();
+	}
+
+	{
+		Guard guard(m_snapshotMutex);
+		m_snapshotCond.WaitFor(m_snapshotMutex, SNAPSHOT_WAIT_TIME,
+			[&]{ return m_snapshotCounts[kind] != snapshotCount; });
+		if (m_snapshotCounts[kind] != snapshotCount)
+		{
+			return m_snapshots[kind];
+		}
+	}
+
+	PublishSnapshots(1 << kind);
+
+	Guard guard(m_snapshotMutex);
+	return m_snapshots[kind];
+}
+
+void QueueCoordinator::PublishSnapshots(int kinds)
+{
+	std::shared_ptr<QueueSnapshot> snapshots[ChangeTracker::ikHistory + 1];
+	{
+		GuardedDownloadQueue downloadQueue = DownloadQueue::Guard();
+		for (int kind = 0; kind <= ChangeTracker::ikHistory; kind++)
+		{
+			if (kinds & (1 << kind))
+			{
+				snapshots[kind] = std::make_shared<QueueSnapshot>(downloadQueue, (ChangeTracker::EItemKind)kind);
+			}
+		}
+	}
+
+	// previous snapshots are freed after releasing the lock, unless readers still use them
+	Guard guard(m_snapshotMutex);
+	for (int kind = 0; kind <= ChangeTracker::ikHistory; kind++)
+	{
+		if (snapshots[kind])
+		{
+			m_snapshots[kind].swap(snapshots[kind]);
+			m_snapshotCounts[kind]++;
+		}
+	}
+	m_snapshotCond.NotifyAll();
+}
+
 void QueueCoordinator::WaitJobs()
 {
 	// waiting for downloads
@@ -309,7 +391,7 @@ void QueueCoordinator::WaitJobs()
 	while (true)
 	{
 		{
-			GuardedDownloadQueue guard = DownloadQueue::Guard();
+			Guard guard(m_activeDownloadsMutex);
 			if (m_activeDownloads.empty())
 			{
 				break;
@@ -335,12 +417,13 @@ void QueueCoordinator::AdjustDownloadsLimit()
 	// two extra threads for completing files (when connections are not needed)
 	int downloadsLimit = 2;
 
-	// allow one thread per 0-level (main) and 1-level (backup) server connection
+	// allow one thread per 0-level (main) and 1-level (backup) server connection,
+	// or as many threads as articles can be pipelined on the connection
 	for (NewsServer* newsServer : g_ServerPool->GetServers())
 	{
 		if ((newsServer->GetNormLevel() == 0 || newsServer->GetNormLevel() == 1) && newsServer->GetActive())
 		{
-			downloadsLimit += newsServer->GetMaxConnections();
+			downloadsLimit += newsServer->GetMaxConnections() * newsServer->GetPipelining();
 		}
 	}
 
@@ -374,6 +457,13 @@ NzbInfo* QueueCoordinator::AddNzbFileToQueue(std::unique_ptr<NzbInfo> nzbInfo, N
 		nzbInfo->SetDeletePaused(allPaused);
 	}
 
+	if (urlInfo)
+	{
+		// the nzb replaces the url item and gets its id, the id must be set before
+		// adding to the queue to keep the id index of the queue valid
+		nzbInfo->SetId(urlInfo->GetId());
+	}
+
 	if (deleteStatus == NzbInfo::dsNone)
 	{
 		if (g_Options->GetDupeCheck() && nzbInfo->GetDupeMode() != dmForce)
@@ -384,7 +474,7 @@ NzbInfo* QueueCoordinator::AddNzbFileToQueue(std::unique_ptr<NzbInfo> nzbInfo, N
 		if (urlInfo)
 		{
 			// insert at the URL position
-			downloadQueue->GetQueue()->insert(downloadQueue->GetQueue()->Find(urlInfo), std::move(nzbInfo));
+			downloadQueue->GetQueue()->Insert(downloadQueue->GetQueue()->Find(urlInfo), std::move(nzbInfo));
 		}
 		else
 		{
@@ -399,7 +489,6 @@ NzbInfo* QueueCoordinator::AddNzbFileToQueue(std::unique_ptr<NzbInfo> nzbInfo, N
 
 	if (urlInfo)
 	{
-		addedNzb->SetId(urlInfo->GetId());
 		downloadQueue->GetQueue()->Remove(urlInfo);
 	}
 
@@ -488,7 +577,7 @@ void QueueCoordinator::Stop()
 
 	debug("Stopping ArticleDownloads");
 	{
-		GuardedDownloadQueue guard = DownloadQueue::Guard();
+		Guard guard(m_activeDownloadsMutex);
 		for (ArticleDownloader* articleDownloader : m_activeDownloads)
 		{
 			articleDownloader->Stop();
@@ -507,19 +596,24 @@ void QueueCoordinator::Stop()
 bool QueueCoordinator::GetNextArticle(DownloadQueue* downloadQueue, FileInfo* &fileInfo, ArticleInfo* &articleInfo)
 {
 	// find an unpaused file with the highest priority, then take the next article from the file.
-	// if the file doesn't have any articles left for download, we store that fact and search again,
-	// ignoring all files which were previously marked as not having any articles.
+	// if the file doesn't have any articles left for download, its article cursor reaches
+	// the end of the article list and the file is skipped on the next search.
 
 	// special case: if the file has ExtraPriority-flag set, it has the highest priority.
 
-	//debug("QueueCoordinator::GetNextArticle()");
+	// cost of a search: once a file is found, nzbs which can't outrank it are skipped
+	// in O(1) each, and within an nzb the files are visited only up to the first
+	// eligible one. Only files which are paused, waiting for propagation or have all
+	// their articles in progress are passed over, so a search is linear in the number
+	// of nzbs plus such files, not in the size of the queue. A full scan of all files
+	// happens only if there is nothing to download.
 
-	bool ok = false;
+	//debug("QueueCoordinator::GetNextArticle()");
 
-	RawFileList checkedFiles;
+	RawFileList emptyFiles;
 	time_t curDate = Util::CurrentTime();
 
-	while (!ok)
+	while (true)
 	{
 		fileInfo = nullptr;
 
@@ -537,8 +631,9 @@ bool QueueCoordinator::GetNextArticle(DownloadQueue* downloadQueue, FileInfo* &f
 			{
 				for (FileInfo* fileInfo1 : nzbInfo->GetFileList())
 				{
-					bool alreadyChecked = !checkedFiles.empty() &&
-						std::find(checkedFiles.begin(), checkedFiles.end(), fileInfo1) != checkedFiles.end();
+					bool noArticlesLeft = fileInfo1->GetArticles()->empty() ?
+						!emptyFiles.empty() && std::find(emptyFiles.begin(), emptyFiles.end(), fileInfo1) != emptyFiles.end() :
+						fileInfo1->GetArticleCursor() >= (int)fileInfo1->GetArticles()->size();
 
 					bool propagationWait = g_Options->GetPropagationDelay() > 0 &&
 						(int)fileInfo1->GetTime() + g_Options->GetPropagationDelay() >= (int)curDate;
@@ -548,11 +643,18 @@ bool QueueCoordinator::GetNextArticle(DownloadQueue* downloadQueue, FileInfo* &f
 							fileInfo1->GetNzbInfo()->GetPriority() > fileInfo->GetNzbInfo()->GetPriority()) ||
 							(fileInfo1->GetExtraPriority() > fileInfo->GetExtraPriority()));
 
-					if (!alreadyChecked && !propagationWait && !fileInfo1->GetPaused() && 
+					if (!noArticlesLeft && !propagationWait && !fileInfo1->GetPaused() &&
 						!fileInfo1->GetDeleted() && (!fileInfo || higherPriority))
 					{
 						fileInfo = fileInfo1;
 					}
+
+					// no other file of this nzb can have a higher priority than the one already found
+					if (fileInfo && fileInfo->GetNzbInfo() == nzbInfo &&
+						(fileInfo->GetExtraPriority() || !nzbInfo->HasExtraPriority()))
+					{
+						break;
+					}
 				}
 			}
 		}
@@ -560,7 +662,7 @@ bool QueueCoordinator::GetNextArticle(DownloadQueue* downloadQueue, FileInfo* &f
 		if (!fileInfo)
 		{
 			// there are no more files for download
-			break;
+			return false;
 		}
 
 		if (g_Options->GetDirectRename() &&
@@ -575,27 +677,32 @@ bool QueueCoordinator::GetNextArticle(DownloadQueue* downloadQueue, FileInfo* &f
 		{
 			g_DiskState->LoadArticles(fileInfo);
 			LoadPartialState(fileInfo);
+			fileInfo->SetArticleCursor(0);
 		}
 
-		// check if the file has any articles left for download
-		for (ArticleInfo* article : fileInfo->GetArticles())
+		// check if the file has any articles left for download;
+		// all articles before the cursor are already downloaded or being downloaded.
+		ArticleList* articles = fileInfo->GetArticles();
+		int cursor = std::min(fileInfo->GetArticleCursor(), (int)articles->size());
+		for (; cursor < (int)articles->size(); cursor++)
 		{
+			ArticleInfo* article = (*articles)[cursor].get();
 			if (article->GetStatus() == ArticleInfo::aiUndefined)
 			{
+				fileInfo->SetArticleCursor(cursor);
 				articleInfo = article;
 				return true;
 			}
 		}
 
-		if (!ok)
+		// the file doesn't have any articles left for download
+		fileInfo->SetArticleCursor(cursor);
+
+		if (articles->empty())
 		{
-			// the file doesn't have any articles left for download
-			checkedFiles.reserve(100);
-			checkedFiles.push_back(fileInfo);
+			emptyFiles.push_back(fileInfo);
 		}
 	}
-
-	return false;
 }
 
 bool QueueCoordinator::GetNextFirstArticle(NzbInfo* nzbInfo, FileInfo* &fileInfo, ArticleInfo* &articleInfo)
@@ -653,7 +760,10 @@ void QueueCoordinator::StartArticleDownload(FileInfo* fileInfo, ArticleInfo* art
 	fileInfo->SetActiveDownloads(fileInfo->GetActiveDownloads() + 1);
 	fileInfo->GetNzbInfo()->SetActiveDownloads(fileInfo->GetNzbInfo()->GetActiveDownloads() + 1);
 
-	m_activeDownloads.push_back(articleDownloader);
+	{
+		Guard guard(m_activeDownloadsMutex);
+		m_activeDownloads.push_back(articleDownloader);
+	}
 	articleDownloader->Start();
 }
 
@@ -713,6 +823,7 @@ void QueueCoordinator::ArticleCompleted(ArticleDownloader* articleDownloader)
 		else if (articleDownloader->GetStatus() == ArticleDownloader::adRetry)
 		{
 			articleInfo->SetStatus(ArticleInfo::aiUndefined);
+			fileInfo->SetArticleCursor(0);
 			retry = true;
 			if (articleInfo->GetPartNumber() == 1)
 			{
@@ -769,6 +880,7 @@ void QueueCoordinator::ArticleCompleted(ArticleDownloader* articleDownloader)
 		}
 
 		nzbInfo->SetDownloadedSize(nzbInfo->GetDownloadedSize() + articleDownloader->GetDownloadedSize());
+		nzbInfo->Touch();
 
 		CheckHealth(downloadQueue, fileInfo);
 
@@ -805,7 +917,10 @@ void QueueCoordinator::DeleteDownloader(DownloadQueue* downloadQueue,
 	bool deleteFileObj = fileCompleted || (fileInfo->GetDeleted() && !hasOtherDownloaders);
 
 	// remove downloader from downloader list
-	m_activeDownloads.erase(std::find(m_activeDownloads.begin(), m_activeDownloads.end(), articleDownloader));
+	{
+		Guard guard(m_activeDownloadsMutex);
+		m_activeDownloads.erase(std::find(m_activeDownloads.begin(), m_activeDownloads.end(), articleDownloader));
+	}
 
 	fileInfo->SetActiveDownloads(fileInfo->GetActiveDownloads() - 1);
 	nzbInfo->SetActiveDownloads(nzbInfo->GetActiveDownloads() - 1);
@@ -820,7 +935,7 @@ void QueueCoordinator::DeleteDownloader(DownloadQueue* downloadQueue,
 
 void QueueCoordinator::DeleteFileInfo(DownloadQueue* downloadQueue, FileInfo* fileInfo, bool completed)
 {
-	while (g_ArticleCache->FileBusy(fileInfo))
+	while (!g_ArticleCache->LockFile(fileInfo))
 	{
 		Util::Sleep(5);
 	}
@@ -868,7 +983,8 @@ void QueueCoordinator::DeleteFileInfo(DownloadQueue* downloadQueue, FileInfo* fi
 			FileSystem::BaseFileName(fileInfo->GetOutputFilename()) : fileInfo->GetFilename(),
 			fileInfo->GetOrigname(), fileStatus,
 			fileStatus == CompletedFile::cfSuccess ? fileInfo->GetCrc() : 0,
-			fileInfo->GetParFile(), fileInfo->GetHash16k(), fileInfo->GetParSetId());
+			fileInfo->GetParFile(), fileInfo->GetHash16k(), fileInfo->GetParSetId(),
+			fileStatus == CompletedFile::cfSuccess ? fileInfo->GetHashFull() : nullptr);
 	}
 
 	if (g_Options->GetDirectRename())
@@ -1055,7 +1171,7 @@ void QueueCoordinator::ResetHangingDownloads()
 		return;
 	}
 
-	GuardedDownloadQueue guard = DownloadQueue::Guard();
+	Guard guard(m_activeDownloadsMutex);
 	time_t tm = Util::CurrentTime();
 
 	for (ArticleDownloader* articleDownloader : m_activeDownloads)
@@ -1180,6 +1296,7 @@ bool QueueCoordinator::MergeQueueEntries(DownloadQueue* downloadQueue, NzbInfo*
 	destNzbInfo->SetRemainingSize(destNzbInfo->GetRemainingSize() + srcNzbInfo->GetRemainingSize());
 	destNzbInfo->SetPausedFileCount(destNzbInfo->GetPausedFileCount() + srcNzbInfo->GetPausedFileCount());
 	destNzbInfo->SetPausedSize(destNzbInfo->GetPausedSize() + srcNzbInfo->GetPausedSize());
+	destNzbInfo->SetDeletedSize(destNzbInfo->GetDeletedSize() + srcNzbInfo->GetDeletedSize());
 
 	destNzbInfo->SetSuccessSize(destNzbInfo->GetSuccessSize() + srcNzbInfo->GetSuccessSize());
 	destNzbInfo->SetCurrentSuccessSize(destNzbInfo->GetCurrentSuccessSize() + srcNzbInfo->GetCurrentSuccessSize());
@@ -1326,6 +1443,11 @@ bool QueueCoordinator::SplitQueueEntries(DownloadQueue* downloadQueue, RawFileLi
 			nzbInfo->SetPausedFileCount(srcNzbInfo->GetPausedFileCount() + 1);
 			nzbInfo->SetPausedSize(nzbInfo->GetPausedSize() + fileInfo->GetRemainingSize());
 		}
+		else if (fileInfo->GetDeleted())
+		{
+			srcNzbInfo->SetDeletedSize(srcNzbInfo->GetDeletedSize() - fileInfo->GetRemainingSize());
+			nzbInfo->SetDeletedSize(nzbInfo->GetDeletedSize() + fileInfo->GetRemainingSize());
+		}
 	}
 
 	nzbInfo->UpdateMinMaxTime();
@@ -1466,7 +1588,10 @@ void QueueCoordinator::DiscardDownloadedArticles(NzbInfo* nzbInfo, FileInfo* fil
 
 	fileInfo->SetOutputFilename(nullptr);
 	fileInfo->SetOutputInitialized(false);
-	fileInfo->SetCachedArticles(0);
+	{
+		Guard contentGuard = g_ArticleCache->GuardContent();
+		g_ArticleCache->SetCachedArticles(fileInfo, 0);
+	}
 	fileInfo->SetPartialChanged(false);
 	fileInfo->SetPartialState(FileInfo::psNone);
 
@@ -1478,6 +1603,7 @@ void QueueCoordinator::DiscardDownloadedArticles(NzbInfo* nzbInfo, FileInfo* fil
 	else
 	{
 		// reset article states if discarding isn't possible
+		fileInfo->SetArticleCursor(0);
 		for (ArticleInfo* articleInfo : fileInfo->GetArticles())
 		{
 			articleInfo->SetStatus(ArticleInfo::aiUndefined);
@@ -31,6 +31,7 @@
 #include "QueueEditor.h"
 #include "NntpConnection.h"
 #include "DirectRenamer.h"
+#include "QueueSnapshot.h"
 
 class QueueCoordinator : public Thread, public Observer, public Debuggable
 {
@@ -54,6 +55,9 @@ public:
 	bool MergeQueueEntries(DownloadQueue* downloadQueue, NzbInfo* destNzbInfo, NzbInfo* srcNzbInfo);
 	bool SplitQueueEntries(DownloadQueue* downloadQueue, RawFileList* fileList, const char* name, NzbInfo** newNzbInfo);
 
+	// reading queue
+	std::shared_ptr<QueueSnapshot> GetSnapshot(ChangeTracker::EItemKind kind);
+
 protected:
 	virtual void LogDebugInfo();
 
@@ -89,7 +93,10 @@ private:
 	};
 
 	CoordinatorDownloadQueue m_downloadQueue{this};
+	// modified only while holding both the queue lock and "m_activeDownloadsMutex",
+	// can be read while holding either of them
 	ActiveDownloads m_activeDownloads;
+	Mutex m_activeDownloadsMutex;
 	QueueEditor m_queueEditor;
 	CoordinatorDirectRenamer m_directRenamer{this};
 	bool m_hasMoreJobs = true;
@@ -97,6 +104,12 @@ private:
 	int m_serverConfigGeneration = 0;
 	Mutex m_waitMutex;
 	ConditionVar m_waitCond;
+	std::shared_ptr<QueueSnapshot> m_snapshots[ChangeTracker::ikHistory + 1];
+	int m_snapshotCounts[ChangeTracker::ikHistory + 1] = {0};
+	// bits of the kinds of snapshots requested by readers
+	std::atomic<int> m_snapshotWanted{0};
+	Mutex m_snapshotMutex;
+	ConditionVar m_snapshotCond;
 
 	bool GetNextArticle(DownloadQueue* downloadQueue, FileInfo* &fileInfo, ArticleInfo* &articleInfo);
 	bool GetNextFirstArticle(NzbInfo* nzbInfo, FileInfo* &fileInfo, ArticleInfo* &articleInfo);
@@ -118,6 +131,7 @@ private:
 	void SaveAllFileState();
 	void WaitJobs();
 	void WakeUp();
+	void PublishSnapshots(int kinds);
 };
 
 extern QueueCoordinator* g_QueueCoordinator;
@@ -253,9 +253,7 @@ void QueueEditor::MoveEntry(FileInfo* fileInfo, int offset)
 
 	if (newEntry >= 0 && newEntry <= size - 1)
 	{
-		std::unique_ptr<FileInfo> movedFileInfo = std::move(*(fileInfo->GetNzbInfo()->GetFileList()->begin() + entry));
-		fileInfo->GetNzbInfo()->GetFileList()->erase(fileInfo->GetNzbInfo()->GetFileList()->begin() + entry);
-		fileInfo->GetNzbInfo()->GetFileList()->insert(fileInfo->GetNzbInfo()->GetFileList()->begin() + newEntry, std::move(movedFileInfo));
+		fileInfo->GetNzbInfo()->GetFileList()->Move(entry, newEntry);
 	}
 }
 
@@ -285,9 +283,7 @@ void QueueEditor::MoveGroup(NzbInfo* nzbInfo, int offset)
 
 	if (newEntry >= 0 && newEntry <= size - 1)
 	{
-		std::unique_ptr<NzbInfo> movedNzbInfo = std::move(*(m_downloadQueue->GetQueue()->begin() + entry));
-		m_downloadQueue->GetQueue()->erase(m_downloadQueue->GetQueue()->begin() + entry);
-		m_downloadQueue->GetQueue()->insert(m_downloadQueue->GetQueue()->begin() + newEntry, std::move(movedNzbInfo));
+		m_downloadQueue->GetQueue()->Move(entry, newEntry);
 	}
 }
 
@@ -466,6 +462,10 @@ void QueueEditor::PrepareList(ItemList* itemList, IdList* idList,
 	}
 
 	itemList->reserve(idList->size());
+
+	// for fast search of ids when iterating through the queue
+	std::unordered_set<int> ids(idList->begin(), idList->end());
+
 	if ((offset != 0) &&
 		(action == DownloadQueue::eaFileMoveOffset || action == DownloadQueue::eaFileMoveTop || action == DownloadQueue::eaFileMoveBottom))
 	{
@@ -490,8 +490,7 @@ void QueueEditor::PrepareList(ItemList* itemList, IdList* idList,
 			for (int index = start; index != end; index += step)
 			{
 				std::unique_ptr<FileInfo>& fileInfo = nzbInfo->GetFileList()->at(index);
-				IdList::iterator it2 = std::find(idList->begin(), idList->end(), fileInfo->GetId());
-				if (it2 != idList->end())
+				if (ids.find(fileInfo->GetId()) != ids.end())
 				{
 					int workOffset = offset;
 					int destPos = index + workOffset;
@@ -546,8 +545,7 @@ void QueueEditor::PrepareList(ItemList* itemList, IdList* idList,
 		for (int index = start; index != end; index += step)
 		{
 			std::unique_ptr<NzbInfo>& nzbInfo = m_downloadQueue->GetQueue()->at(index);
-			IdList::iterator it2 = std::find(idList->begin(), idList->end(), nzbInfo->GetId());
-			if (it2 != idList->end())
+			if (ids.find(nzbInfo->GetId()) != ids.end())
 			{
 				int workOffset = offset;
 				int destPos = index + workOffset;
@@ -635,12 +633,10 @@ void QueueEditor::PrepareList(ItemList* itemList, IdList* idList,
 		{
 			if (minId <= id && id <= maxId)
 			{
-				for (NzbInfo* nzbInfo : m_downloadQueue->GetQueue())
+				NzbInfo* nzbInfo = m_downloadQueue->GetQueue()->Find(id);
+				if (nzbInfo)
 				{
-					if (id == nzbInfo->GetId())
-					{
-						itemList->emplace_back(nullptr, nzbInfo, offset);
-					}
+					itemList->emplace_back(nullptr, nzbInfo, offset);
 				}
 			}
 		}
@@ -1071,9 +1067,7 @@ void QueueEditor::AlignGroups(ItemList* itemList)
 		{
 			if (lastNzbInfo && num - lastNum > 1)
 			{
-				std::unique_ptr<NzbInfo> movedNzbInfo = std::move(*(nzbList->begin() + num));
-				nzbList->erase(nzbList->begin() + num);
-				nzbList->insert(nzbList->begin() + lastNum + 1, std::move(movedNzbInfo));
+				nzbList->Move(num, lastNum + 1);
 				lastNum++;
 			}
 			else
@@ -1193,9 +1187,7 @@ void QueueEditor::ReorderFiles(ItemList* itemList)
 		FileList::iterator it2 = nzbInfo->GetFileList()->Find(fileInfo);
 		if (it2 != nzbInfo->GetFileList()->end())
 		{
-			std::unique_ptr<FileInfo> movedFileInfo = std::move(*it2);
-			nzbInfo->GetFileList()->erase(it2);
-			nzbInfo->GetFileList()->insert(nzbInfo->GetFileList()->begin() + insertPos, std::move(movedFileInfo));
+			nzbInfo->GetFileList()->Move(it2 - nzbInfo->GetFileList()->begin(), insertPos);
 			insertPos++;
 		}
 	}
@@ -1212,6 +1204,7 @@ void QueueEditor::SetNzbParameter(NzbInfo* nzbInfo, const char* paramString)
 		*value = '\0';
 		value++;
 		nzbInfo->GetParameters()->SetParameter(str, value);
+		nzbInfo->Touch();
 	}
 	else
 	{
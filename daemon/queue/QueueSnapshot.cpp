@@ -0,0 +1,235 @@
+/*
+ *  This file is part of nzbget. See <http://nzbget.net>.
+ *
+ *  Copyright (C) 2016 Andrey Prygunkov <hugbug@users.sourceforge.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "nzbget.h"
+#include "QueueSnapshot.h"
+#include "QueueScript.h"
+#include "Util.h"
+
+static const char* DetectStatus(NzbInfo* nzbInfo)
+{
+	const char* postStageName[] = { "PP_QUEUED", "LOADING_PARS", "VERIFYING_SOURCES", "REPAIRING",
+		"VERIFYING_REPAIRED", "RENAMING", "RENAMING", "UNPACKING", "MOVING", "MOVING", "EXECUTING_SCRIPT", "PP_FINISHED" };
+
+	const char* status = nullptr;
+
+	if (nzbInfo->GetPostInfo())
+	{
+		bool queueScriptActive = false;
+		if (nzbInfo->GetPostInfo()->GetStage() == PostInfo::ptQueued &&
+			g_QueueScriptCoordinator->HasJob(nzbInfo->GetId(), &queueScriptActive))
+		{
+			status = queueScriptActive ? "QS_EXECUTING" : "QS_QUEUED";
+		}
+		else if (nzbInfo->GetDirectUnpackStatus() == NzbInfo::nsRunning)
+		{
+			status = "UNPACKING";
+		}
+		else
+		{
+			status = postStageName[nzbInfo->GetPostInfo()->GetStage()];
+		}
+	}
+	else if (nzbInfo->GetActiveDownloads() > 0)
+	{
+		status = nzbInfo->GetKind() == NzbInfo::nkUrl ? "FETCHING" : "DOWNLOADING";
+	}
+	else if ((nzbInfo->GetPausedSize() > 0) && (nzbInfo->GetRemainingSize() == nzbInfo->GetPausedSize()))
+	{
+		status = "PAUSED";
+	}
+	else
+	{
+		status = "QUEUED";
+	}
+
+	return status;
+}
+
+static const char* DetectStatus(HistoryInfo* historyInfo)
+{
+	const char* status = "FAILURE/INTERNAL_ERROR";
+
+	if (historyInfo->GetKind() == HistoryInfo::hkNzb || historyInfo->GetKind() == HistoryInfo::hkUrl)
+	{
+		NzbInfo* nzbInfo = historyInfo->GetNzbInfo();
+		status = nzbInfo->MakeTextStatus(false);
+	}
+	else if (historyInfo->GetKind() == HistoryInfo::hkDup)
+	{
+		DupInfo* dupInfo = historyInfo->GetDupInfo();
+		const char* dupStatusName[] = { "FAILURE/INTERNAL_ERROR", "SUCCESS/HIDDEN", "FAILURE/HIDDEN",
+			"DELETED/MANUAL", "DELETED/DUPE", "FAILURE/BAD", "SUCCESS/GOOD" };
+		status = dupStatusName[dupInfo->GetStatus()];
+	}
+
+	return status;
+}
+
+FileSnapshot::FileSnapshot(FileInfo* fileInfo) :
+	id(fileInfo->GetId()), size(fileInfo->GetSize()), remainingSize(fileInfo->GetRemainingSize()),
+	time(fileInfo->GetTime()), filenameConfirmed(fileInfo->GetFilenameConfirmed()),
+	paused(fileInfo->GetPaused()), subject(fileInfo->GetSubject()), filename(fileInfo->GetFilename()),
+	activeDownloads(fileInfo->GetActiveDownloads()), nzbId(fileInfo->GetNzbInfo()->GetId()),
+	nzbName(fileInfo->GetNzbInfo()->GetName()), nzbFilename(fileInfo->GetNzbInfo()->GetFilename()),
+	destDir(fileInfo->GetNzbInfo()->GetDestDir()), category(fileInfo->GetNzbInfo()->GetCategory()),
+	priority(fileInfo->GetNzbInfo()->GetPriority())
+{
+	progress = fileInfo->GetFailedSize() == 0 && fileInfo->GetSuccessSize() == 0 ? 0 :
+		(int)(1000 - fileInfo->GetRemainingSize() * 1000 / (fileInfo->GetSize() - fileInfo->GetMissedSize()));
+}
+
+NzbSnapshot::NzbSnapshot(NzbInfo* nzbInfo, int logEntries) :
+	id(nzbInfo->GetId()), kind(nzbInfo->GetKind()), name(nzbInfo->GetName()), url(nzbInfo->GetUrl()),
+	filename(nzbInfo->GetFilename()), destDir(nzbInfo->GetDestDir()), finalDir(nzbInfo->GetFinalDir()),
+	category(nzbInfo->GetCategory()), parStatus(nzbInfo->GetParStatus()),
+	unpackStatus(nzbInfo->GetUnpackStatus()), moveStatus(nzbInfo->GetMoveStatus()),
+	scriptStatus(nzbInfo->GetScriptStatuses()->CalcTotalStatus()), deleteStatus(nzbInfo->GetDeleteStatus()),
+	markStatus(nzbInfo->GetMarkStatus()), urlStatus(nzbInfo->GetUrlStatus()),
+	size(nzbInfo->GetSize()), remainingSize(nzbInfo->GetRemainingSize()), pausedSize(nzbInfo->GetPausedSize()),
+	downloadedSize(nzbInfo->GetDownloadedSize()), fileCount(nzbInfo->GetFileCount()),
+	remainingFileCount((int)nzbInfo->GetFileList()->size()), remainingParCount(nzbInfo->GetRemainingParCount()),
+	priority(nzbInfo->GetPriority()), activeDownloads(nzbInfo->GetActiveDownloads()),
+	minTime(nzbInfo->GetMinTime()), maxTime(nzbInfo->GetMaxTime()), totalArticles(nzbInfo->GetTotalArticles()),
+	successArticles(nzbInfo->GetCurrentSuccessArticles()), failedArticles(nzbInfo->GetCurrentFailedArticles()),
+	health(nzbInfo->CalcHealth()), criticalHealth(nzbInfo->CalcCriticalHealth(false)),
+	dupeKey(nzbInfo->GetDupeKey()), dupeScore(nzbInfo->GetDupeScore()), dupeMode(nzbInfo->GetDupeMode()),
+	downloadSec(nzbInfo->GetDownloadSec()), parSec(nzbInfo->GetParSec()), repairSec(nzbInfo->GetRepairSec()),
+	unpackSec(nzbInfo->GetUnpackSec()), extraParBlocks(nzbInfo->GetExtraParBlocks()),
+	serverStats(*nzbInfo->GetCurrentServerStats())
+{
+	status = DetectStatus(nzbInfo);
+
+	messageCount = nzbInfo->GetMessageCount() > 0 ? nzbInfo->GetMessageCount() : nzbInfo->GetCachedMessageCount();
+
+	parameters.CopyFrom(nzbInfo->GetParameters());
+	for (ScriptStatus& item : nzbInfo->GetScriptStatuses())
+	{
+		scriptStatuses.emplace_back(item.GetName(), item.GetStatus());
+	}
+
+	time_t curTime = Util::CurrentTime();
+	PostInfo* postInfo = nzbInfo->GetPostInfo();
+	postJob = postInfo != nullptr;
+	postTotalSec = nzbInfo->GetPostTotalSec();
+
+	if (!postInfo)
+	{
+		return;
+	}
+
+	stage = postInfo->GetStage();
+	progressLabel = postInfo->GetProgressLabel();
+	fileProgress = postInfo->GetFileProgress();
+	stageProgress = postInfo->GetStageProgress();
+	stageSec = (int)(postInfo->GetStageTime() ? curTime - postInfo->GetStageTime() : 0);
+	postJobSec = (int)(postInfo->GetStartTime() ? curTime - postInfo->GetStartTime() : 0);
+	postTotalSec += postJobSec;
+
+	if (logEntries > 0)
+	{
+		GuardedMessageList cachedMessages = nzbInfo->GuardCachedMessages();
+		int start = std::max((int)cachedMessages->size() - logEntries, 0);
+		for (uint32 i = (uint32)start; i < cachedMessages->size(); i++)
+		{
+			Message& message = cachedMessages->at(i);
+			messages.emplace_back(message.GetId(), message.GetKind(), message.GetTime(), message.GetText());
+		}
+	}
+}
+
+HistorySnapshot::HistorySnapshot(HistoryInfo* historyInfo) :
+	id(historyInfo->GetId()), kind(historyInfo->GetKind()), name(historyInfo->GetName()),
+	time(historyInfo->GetTime())
+{
+	status = DetectStatus(historyInfo);
+
+	if (historyInfo->GetKind() == HistoryInfo::hkNzb ||
+		historyInfo->GetKind() == HistoryInfo::hkUrl)
+	{
+		NzbInfo* nzbInfo = historyInfo->GetNzbInfo();
+		parkedFileCount = nzbInfo->GetParkedFileCount();
+		retryData = !nzbInfo->GetCompletedFiles()->empty();
+		nzb = std::make_unique<NzbSnapshot>(nzbInfo, 0);
+	}
+	else if (historyInfo->GetKind() == HistoryInfo::hkDup)
+	{
+		DupInfo* dupInfo = historyInfo->GetDupInfo();
+		dupSize = dupInfo->GetSize();
+		dupeKey = dupInfo->GetDupeKey();
+		dupeScore = dupInfo->GetDupeScore();
+		dupeMode = dupInfo->GetDupeMode();
+		dupStatus = dupInfo->GetStatus();
+	}
+}
+
+QueueSnapshot::QueueSnapshot(DownloadQueue* downloadQueue, ChangeTracker::EItemKind kind) :
+	m_kind(kind), m_revision(GetRevision(kind)), m_time(Util::CurrentTime())
+{
+	switch (kind)
+	{
+		case ChangeTracker::ikGroup:
+			m_groups.reserve(downloadQueue->GetQueue()->size());
+			for (NzbInfo* nzbInfo : downloadQueue->GetQueue())
+			{
+				m_groups.emplace_back(nzbInfo, 0);
+				m_postJobs |= m_groups.back().postJob;
+			}
+			break;
+
+		case ChangeTracker::ikFile:
+			for (NzbInfo* nzbInfo : downloadQueue->GetQueue())
+			{
+				for (FileInfo* fileInfo : nzbInfo->GetFileList())
+				{
+					m_files.emplace_back(fileInfo);
+				}
+			}
+			break;
+
+		case ChangeTracker::ikHistory:
+			m_history.reserve(downloadQueue->GetHistory()->size());
+			for (HistoryInfo* historyInfo : downloadQueue->GetHistory())
+			{
+				m_history.emplace_back(historyInfo);
+			}
+			break;
+	}
+}
+
+/*
+ * Progress of files isn't stamped on their groups, groups also change with
+ * the revision of the files.
+ */
+int64 QueueSnapshot::GetRevision(ChangeTracker::EItemKind kind)
+{
+	return kind == ChangeTracker::ikGroup ?
+		std::max(ChangeTracker::GetRevision(ChangeTracker::ikGroup), ChangeTracker::GetRevision(ChangeTracker::ikFile)) :
+		ChangeTracker::GetRevision(kind);
+}
+
+/*
+ * Elapsed times of post-processing jobs change every second without stamping
+ * revisions, with such jobs the snapshot is only current within its second.
+ */
+bool QueueSnapshot::IsCurrent()
+{
+	return m_revision == GetRevision(m_kind) && (!m_postJobs || m_time == Util::CurrentTime());
+}
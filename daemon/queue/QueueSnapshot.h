@@ -0,0 +1,168 @@
+/*
+ *  This file is part of nzbget. See <http://nzbget.net>.
+ *
+ *  Copyright (C) 2016 Andrey Prygunkov <hugbug@users.sourceforge.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef QUEUESNAPSHOT_H
+#define QUEUESNAPSHOT_H
+
+#include "DownloadInfo.h"
+#include "Log.h"
+
+/*
+ * Copy of the fields of an nzb (and its post-processing job) reported via RPC.
+ * Snapshots are taken while the download queue is locked; responses are then
+ * formatted from snapshots with no lock held, which keeps big queues and
+ * histories from blocking downloads.
+ */
+struct NzbSnapshot
+{
+	NzbSnapshot(NzbInfo* nzbInfo, int logEntries);
+
+	int id;
+	NzbInfo::EKind kind;
+	CString name;
+	CString url;
+	CString filename;
+	CString destDir;
+	CString finalDir;
+	CString category;
+	NzbInfo::EParStatus parStatus;
+	NzbInfo::EPostUnpackStatus unpackStatus;
+	NzbInfo::EMoveStatus moveStatus;
+	ScriptStatus::EStatus scriptStatus;
+	NzbInfo::EDeleteStatus deleteStatus;
+	NzbInfo::EMarkStatus markStatus;
+	NzbInfo::EUrlStatus urlStatus;
+	int64 size;
+	int64 remainingSize;
+	int64 pausedSize;
+	int64 downloadedSize;
+	int fileCount;
+	int remainingFileCount;
+	int remainingParCount;
+	int priority;
+	int activeDownloads;
+	time_t minTime;
+	time_t maxTime;
+	int totalArticles;
+	int successArticles;
+	int failedArticles;
+	int health;
+	int criticalHealth;
+	CString dupeKey;
+	int dupeScore;
+	EDupeMode dupeMode;
+	int downloadSec;
+	int postTotalSec;
+	int parSec;
+	int repairSec;
+	int unpackSec;
+	int messageCount;
+	int extraParBlocks;
+	NzbParameterList parameters;
+	ScriptStatusList scriptStatuses;
+	ServerStatList serverStats;
+	const char* status = nullptr;
+
+	bool postJob;
+	PostInfo::EStage stage;
+	CString progressLabel;
+	int fileProgress;
+	int stageProgress;
+	int stageSec;
+	int postJobSec;
+	MessageList messages;
+};
+
+typedef std::vector<NzbSnapshot> NzbSnapshotList;
+
+struct FileSnapshot
+{
+	FileSnapshot(FileInfo* fileInfo);
+
+	int id;
+	int64 size;
+	int64 remainingSize;
+	time_t time;
+	bool filenameConfirmed;
+	bool paused;
+	CString subject;
+	CString filename;
+	int activeDownloads;
+	int progress;
+	int nzbId;
+	CString nzbName;
+	CString nzbFilename;
+	CString destDir;
+	CString category;
+	int priority;
+};
+
+typedef std::vector<FileSnapshot> FileSnapshotList;
+
+struct HistorySnapshot
+{
+	HistorySnapshot(HistoryInfo* historyInfo);
+
+	int id;
+	HistoryInfo::EKind kind;
+	CString name;
+	time_t time;
+	const char* status = nullptr;
+	int parkedFileCount = 0;
+	bool retryData = false;
+	int64 dupSize = 0;
+	CString dupeKey;
+	int dupeScore = 0;
+	EDupeMode dupeMode = dmScore;
+	DupInfo::EStatus dupStatus = DupInfo::dsUndefined;
+	std::unique_ptr<NzbSnapshot> nzb;
+};
+
+typedef std::vector<HistorySnapshot> HistorySnapshotList;
+
+/*
+ * Copy of the groups, the files or the history at one revision of the change tracker.
+ * The queue coordinator publishes one snapshot of each kind per revision of that kind,
+ * all RPC readers asking for that revision share it (see "QueueCoordinator::GetSnapshot").
+ * Only the list of the kind of the snapshot is filled.
+ */
+class QueueSnapshot
+{
+public:
+	QueueSnapshot(DownloadQueue* downloadQueue, ChangeTracker::EItemKind kind);
+	ChangeTracker::EItemKind GetKind() { return m_kind; }
+	int64 GetRevision() { return m_revision; }
+	bool IsCurrent();
+	NzbSnapshotList* GetGroups() { return &m_groups; }
+	FileSnapshotList* GetFiles() { return &m_files; }
+	HistorySnapshotList* GetHistory() { return &m_history; }
+	static int64 GetRevision(ChangeTracker::EItemKind kind);
+
+private:
+	ChangeTracker::EItemKind m_kind;
+	int64 m_revision;
+	time_t m_time;
+	bool m_postJobs = false;
+	NzbSnapshotList m_groups;
+	FileSnapshotList m_files;
+	HistorySnapshotList m_history;
+};
+
+#endif
@@ -659,16 +659,9 @@ void ListBinCommand::Execute()
 
 	if (htonl(ListRequest.m_serverState))
 	{
-		int postJobCount = 0;
-		int64 remainingSize;
-		{
-			GuardedDownloadQueue downloadQueue = DownloadQueue::Guard();
-			for (NzbInfo* nzbInfo : downloadQueue->GetQueue())
-			{
-				postJobCount += nzbInfo->GetPostInfo() ? 1 : 0;
-			}
-			downloadQueue->CalcRemainingSize(&remainingSize, nullptr);
-		}
+		DownloadQueue::Stats queueStats = DownloadQueue::GetStats();
+		int postJobCount = queueStats.postJobCount;
+		int64 remainingSize = queueStats.remainingSize;
 
 		uint32 sizeHi, sizeLo;
 		ListResponse.m_downloadRate = htonl(g_StatMeter->CalcCurrentDownloadSpeed());
@@ -263,9 +263,11 @@ bool RequestProcessor::ServWebRequest(const char* signature)
 		return false;
 	}
 
+	bool http11 = false;
 	if (char* p = strchr(url, ' '))
 	{
 		*p = '\0';
+		http11 = !strncmp(p + 1, "HTTP/1.1", 8);
 	}
 
 	debug("url: %s", url);
@@ -274,6 +276,7 @@ bool RequestProcessor::ServWebRequest(const char* signature)
 	processor.SetConnection(m_connection.get());
 	processor.SetUrl(url);
 	processor.SetHttpMethod(httpMethod);
+	processor.SetHttp11(http11);
 	processor.Execute();
 
 	return processor.GetKeepAlive();
@@ -322,8 +322,16 @@ void WebProcessor::Dispatch()
 		processor.SetHttpMethod(m_httpMethod == hmGet ? XmlRpcProcessor::hmGet : XmlRpcProcessor::hmPost);
 		processor.SetUserAccess((XmlRpcProcessor::EUserAccess)m_userAccess);
 		processor.SetUrl(m_url);
+		if (m_http11)
+		{
+			// big responses are sent in chunks while they are being built
+			processor.SetResponseStream(this);
+		}
 		processor.Execute();
-		SendBodyResponse(processor.GetResponse(), strlen(processor.GetResponse()), processor.GetContentType(), processor.IsSafeMethod());
+		if (!processor.IsStreamed())
+		{
+			SendBodyResponse(processor.GetResponse(), strlen(processor.GetResponse()), processor.GetContentType(), processor.IsSafeMethod());
+		}
 		return;
 	}
 
@@ -542,6 +550,128 @@ void WebProcessor::SendBodyResponse(const char* body, int bodyLen, const char* c
 	m_connection->Send(body, bodyLen);
 }
 
+bool WebProcessor::StartStream(const char* contentType)
+{
+	const char* RESPONSE_HEADER =
+		"HTTP/1.1 %s\r\n"
+		"Connection: %s\r\n"
+		"Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n"
+		"Access-Control-Allow-Origin: %s\r\n"
+		"Access-Control-Allow-Credentials: true\r\n"
+		"Access-Control-Max-Age: 86400\r\n"
+		"Access-Control-Allow-Headers: Content-Type, Authorization\r\n"
+		"Set-Cookie: Auth-Type=%s; SameSite=Lax\r\n"
+		"Set-Cookie: Auth-Token=%s; HttpOnly; SameSite=Lax\r\n"
+		"Transfer-Encoding: chunked\r\n"
+		"%s"					// Content-Type: xxx
+		"%s"					// Content-Encoding: gzip
+		"Server: nzbget-%s\r\n"
+		"\r\n";
+
+#ifndef DISABLE_GZIP
+	if (m_gzip)
+	{
+		m_gzipStream = std::make_unique<GZipStream>(1024 * 64);
+	}
+	bool gzip = m_gzip;
+#else
+	bool gzip = false;
+#endif
+
+	BString<1024> contentTypeHeader;
+	if (contentType)
+	{
+		contentTypeHeader.Format("Content-Type: %s\r\n", contentType);
+	}
+
+	BString<1024> responseHeader(RESPONSE_HEADER,
+		ERR_HTTP_OK,
+		m_keepAlive ? "keep-alive" : "close",
+		m_origin.Str(),
+		g_Options->GetFormAuth() ? "form" : "http",
+		m_authorized ? m_serverAuthToken[m_userAccess] : "",
+		*contentTypeHeader,
+		gzip ? "Content-Encoding: gzip\r\n" : "",
+		Util::VersionRevision());
+
+	debug("[%s] %s", *m_url, *responseHeader);
+
+	return m_connection->Send(responseHeader, responseHeader.Length());
+}
+
+bool WebProcessor::WriteStream(const char* data, int len)
+{
+#ifndef DISABLE_GZIP
+	if (m_gzipStream)
+	{
+		m_gzipStream->Write(data, len, false);
+		const void* outBuf;
+		int outLen;
+		while (m_gzipStream->Read(&outBuf, &outLen) == GZipStream::zlOK && outLen > 0)
+		{
+			if (!SendChunk((const char*)outBuf, outLen))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+#endif
+
+	return SendChunk(data, len);
+}
+
+bool WebProcessor::FinishStream()
+{
+#ifndef DISABLE_GZIP
+	if (m_gzipStream)
+	{
+		m_gzipStream->Write(nullptr, 0, true);
+		const void* outBuf;
+		int outLen;
+		GZipStream::EStatus status;
+		do
+		{
+			status = m_gzipStream->Read(&outBuf, &outLen);
+			if (!SendChunk((const char*)outBuf, outLen))
+			{
+				return false;
+			}
+		}
+		while (status == GZipStream::zlOK && outLen > 0);
+		m_gzipStream.reset();
+	}
+#endif
+
+	// last chunk
+	return m_connection->Send("0\r\n\r\n", 5);
+}
+
+/*
+ * The response can't be completed. The last chunk is not sent and the
+ * connection is closed, so that the client sees an incomplete response.
+ */
+void WebProcessor::AbortStream()
+{
+#ifndef DISABLE_GZIP
+	m_gzipStream.reset();
+#endif
+	m_keepAlive = false;
+}
+
+bool WebProcessor::SendChunk(const char* data, int len)
+{
+	if (len <= 0)
+	{
+		return true;
+	}
+
+	BString<20> chunkHeader("%x\r\n", len);
+	return m_connection->Send(chunkHeader, chunkHeader.Length()) &&
+		m_connection->Send(data, len) &&
+		m_connection->Send("\r\n", 2);
+}
+
 void WebProcessor::SendSingleFileResponse()
 {
 	const char *defRes = "";
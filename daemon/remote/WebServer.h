@@ -23,8 +23,10 @@
 
 #include "NString.h"
 #include "Connection.h"
+#include "XmlRpc.h"
+#include "Util.h"
 
-class WebProcessor
+class WebProcessor : private XmlRpcProcessor::ResponseStream
 {
 public:
 	enum EHttpMethod
@@ -39,6 +41,7 @@ public:
 	void SetConnection(Connection* connection) { m_connection = connection; }
 	void SetUrl(const char* url) { m_url = url; }
 	void SetHttpMethod(EHttpMethod httpMethod) { m_httpMethod = httpMethod; }
+	void SetHttp11(bool http11) { m_http11 = http11; }
 	bool GetKeepAlive() { return m_keepAlive; }
 
 private:
@@ -65,6 +68,10 @@ private:
 	CString m_forwardedFor;
 	CString m_oldETag;
 	bool m_keepAlive = false;
+	bool m_http11 = false;
+#ifndef DISABLE_GZIP
+	std::unique_ptr<GZipStream> m_gzipStream;
+#endif
 
 	void Dispatch();
 	void SendAuthResponse();
@@ -74,6 +81,11 @@ private:
 	void SendMultiFileResponse();
 	void SendBodyResponse(const char* body, int bodyLen, const char* contentType, bool cachable);
 	void SendRedirectResponse(const char* url);
+	bool SendChunk(const char* data, int len);
+	virtual bool StartStream(const char* contentType);
+	virtual bool WriteStream(const char* data, int len);
+	virtual bool FinishStream();
+	virtual void AbortStream();
 	const char* DetectContentType(const char* filename);
 	bool IsAuthorizedIp(const char* remoteAddr);
 	void ParseHeaders();
@@ -36,10 +36,13 @@
 #include "QueueScript.h"
 #include "CommandScript.h"
 #include "UrlCoordinator.h"
+#include "QueueCoordinator.h"
 
 extern void ExitProc();
 extern void Reload();
 
+static const int STREAM_BLOCK_SIZE = 1024 * 64;
+
 class SafeXmlCommand: public XmlCommand
 {
 public:
@@ -134,11 +137,14 @@ protected:
 class NzbInfoXmlCommand: public SafeXmlCommand
 {
 protected:
-	void AppendNzbInfoFields(NzbInfo* nzbInfo);
-	void AppendPostInfoFields(PostInfo* postInfo, int logEntries, bool postQueue);
+	void AppendNzbInfoFields(NzbSnapshot& nzb);
+	void AppendPostInfoFields(NzbSnapshot& nzb, bool postQueue);
+	void AppendGroupItem(NzbSnapshot& nzb);
+	void AppendFileItem(FileSnapshot& file);
+	void AppendHistoryItem(HistorySnapshot& item);
 };
 
-class ListFilesXmlCommand: public SafeXmlCommand
+class ListFilesXmlCommand: public NzbInfoXmlCommand
 {
 public:
 	virtual void Execute();
@@ -148,8 +154,6 @@ class ListGroupsXmlCommand: public NzbInfoXmlCommand
 {
 public:
 	virtual void Execute();
-private:
-	const char* DetectStatus(NzbInfo* nzbInfo);
 };
 
 class EditQueueXmlCommand: public XmlCommand
@@ -192,8 +196,15 @@ class HistoryXmlCommand: public NzbInfoXmlCommand
 {
 public:
 	virtual void Execute();
+};
+
+class ChangesXmlCommand: public NzbInfoXmlCommand
+{
+public:
+	virtual void Execute();
+
 private:
-	const char* DetectStatus(HistoryInfo* historyInfo);
+	void AppendDeleted(const char* name, IdList* idList);
 };
 
 class UrlQueueXmlCommand: public SafeXmlCommand
@@ -374,7 +385,6 @@ void XmlRpcProcessor::Dispatch()
 	char* request = m_request;
 
 	BString<100> methodName;
-	BString<100> requestId;
 
 	if (m_httpMethod == hmGet)
 	{
@@ -410,8 +420,8 @@ void XmlRpcProcessor::Dispatch()
 		}
 		if (const char* requestIdPtr = WebUtil::JsonFindField(m_request, "id", &valueLen))
 		{
-			valueLen = valueLen >= (int)sizeof(requestId) ? (int)sizeof(requestId) - 1 : valueLen;
-			requestId.Set(requestIdPtr, valueLen);
+			valueLen = valueLen >= (int)sizeof(m_requestId) ? (int)sizeof(m_requestId) - 1 : valueLen;
+			m_requestId.Set(requestIdPtr, valueLen);
 		}
 	}
 
@@ -428,13 +438,14 @@ void XmlRpcProcessor::Dispatch()
 		command->SetProtocol(m_protocol);
 		command->SetHttpMethod(m_httpMethod);
 		command->SetUserAccess(m_userAccess);
+		command->SetProcessor(m_responseStream ? this : nullptr);
 		command->PrepareParams();
 		m_safeMethod = command->IsSafeMethod();
 		bool safeToExecute = m_safeMethod || m_httpMethod == XmlRpcProcessor::hmPost || m_protocol == XmlRpcProcessor::rpJsonPRpc;
 		if (safeToExecute || command->IsError())
 		{
 			command->Execute();
-			BuildResponse(command->GetResponse(), command->GetCallbackFunc(), command->GetFault(), requestId);
+			BuildResponse(command->GetResponse(), command->GetCallbackFunc(), command->GetFault(), m_requestId);
 		}
 		else
 		{
@@ -507,36 +518,72 @@ void XmlRpcProcessor::MutliCall()
 void XmlRpcProcessor::BuildResponse(const char* response, const char* callbackFunc,
 	bool fault, const char* requestId)
 {
-	const char XML_HEADER[] = "<?xml version=\"1.0\"?>\n<methodResponse>\n";
 	const char XML_FOOTER[] = "</methodResponse>";
-	const char XML_OK_OPEN[] = "<params><param><value>";
 	const char XML_OK_CLOSE[] = "</value></param></params>\n";
-	const char XML_FAULT_OPEN[] = "<fault><value>";
 	const char XML_FAULT_CLOSE[] = "</value></fault>\n";
 
-	const char JSON_HEADER[] = "{\n\"version\" : \"1.1\",\n";
-	const char JSON_ID_OPEN[] = "\"id\" : ";
-	const char JSON_ID_CLOSE[] = ",\n";
 	const char JSON_FOOTER[] = "\n}";
-	const char JSON_OK_OPEN[] = "\"result\" : ";
 	const char JSON_OK_CLOSE[] = "";
-	const char JSON_FAULT_OPEN[] = "\"error\" : ";
 	const char JSON_FAULT_CLOSE[] = "";
 
-	const char JSONP_CALLBACK_HEADER[] = "(";
 	const char JSONP_CALLBACK_FOOTER[] = ")";
 
 	bool xmlRpc = m_protocol == rpXmlRpc;
 
-	const char* callbackHeader = m_protocol == rpJsonPRpc ? JSONP_CALLBACK_HEADER : "";
-	const char* header = xmlRpc ? XML_HEADER : JSON_HEADER;
 	const char* footer = xmlRpc ? XML_FOOTER : JSON_FOOTER;
-	const char* openTag = fault ? (xmlRpc ? XML_FAULT_OPEN : JSON_FAULT_OPEN) : (xmlRpc ? XML_OK_OPEN : JSON_OK_OPEN);
 	const char* closeTag = fault ? (xmlRpc ? XML_FAULT_CLOSE : JSON_FAULT_CLOSE ) : (xmlRpc ? XML_OK_CLOSE : JSON_OK_CLOSE);
 	const char* callbackFooter = m_protocol == rpJsonPRpc ? JSONP_CALLBACK_FOOTER : "";
 
 	debug("Response=%s", response);
 
+	if (m_streamed && (fault || m_streamFailed))
+	{
+		// a fault can't be reported in the middle of already sent result
+		m_responseStream->AbortStream();
+		return;
+	}
+
+	if (!m_streamed)
+	{
+		BuildResponseHeader(callbackFunc, fault, requestId);
+	}
+
+	m_response.Append(response);
+	m_response.Append(closeTag);
+	m_response.Append(footer);
+	m_response.Append(callbackFooter);
+
+	if (m_streamed)
+	{
+		if (!m_responseStream->WriteStream(m_response, m_response.Length()) ||
+			!m_responseStream->FinishStream())
+		{
+			m_responseStream->AbortStream();
+		}
+		m_response.Clear();
+	}
+}
+
+void XmlRpcProcessor::BuildResponseHeader(const char* callbackFunc, bool fault, const char* requestId)
+{
+	const char XML_HEADER[] = "<?xml version=\"1.0\"?>\n<methodResponse>\n";
+	const char XML_OK_OPEN[] = "<params><param><value>";
+	const char XML_FAULT_OPEN[] = "<fault><value>";
+
+	const char JSON_HEADER[] = "{\n\"version\" : \"1.1\",\n";
+	const char JSON_ID_OPEN[] = "\"id\" : ";
+	const char JSON_ID_CLOSE[] = ",\n";
+	const char JSON_OK_OPEN[] = "\"result\" : ";
+	const char JSON_FAULT_OPEN[] = "\"error\" : ";
+
+	const char JSONP_CALLBACK_HEADER[] = "(";
+
+	bool xmlRpc = m_protocol == rpXmlRpc;
+
+	const char* callbackHeader = m_protocol == rpJsonPRpc ? JSONP_CALLBACK_HEADER : "";
+	const char* header = xmlRpc ? XML_HEADER : JSON_HEADER;
+	const char* openTag = fault ? (xmlRpc ? XML_FAULT_OPEN : JSON_FAULT_OPEN) : (xmlRpc ? XML_OK_OPEN : JSON_OK_OPEN);
+
 	if (callbackFunc)
 	{
 		m_response.Append(callbackFunc);
@@ -550,14 +597,31 @@ void XmlRpcProcessor::BuildResponse(const char* response, const char* callbackFu
 		m_response.Append(JSON_ID_CLOSE);
 	}
 	m_response.Append(openTag);
-	m_response.Append(response);
-	m_response.Append(closeTag);
-	m_response.Append(footer);
-	m_response.Append(callbackFooter);
 
 	m_contentType = xmlRpc ? "text/xml" : "application/json";
 }
 
+/*
+ * Sends a part of a big response of a command. The first part starts the
+ * stream; the rest of the response is sent by "BuildResponse".
+ * Returns false if the connection is broken.
+ */
+bool XmlRpcProcessor::StreamResponse(const char* response, int len, const char* callbackFunc)
+{
+	if (!m_streamed)
+	{
+		BuildResponseHeader(callbackFunc, false, m_requestId);
+		m_streamed = true;
+		m_streamFailed = !m_responseStream->StartStream(m_contentType) ||
+			!m_responseStream->WriteStream(m_response, m_response.Length());
+		m_response.Clear();
+	}
+
+	m_streamFailed = m_streamFailed || !m_responseStream->WriteStream(response, len);
+
+	return !m_streamFailed;
+}
+
 void XmlRpcProcessor::BuildErrorResponse(int errCode, const char* errText)
 {
 	ErrorXmlCommand command(errCode, errText);
@@ -680,6 +744,10 @@ std::unique_ptr<XmlCommand> XmlRpcProcessor::CreateCommand(const char* methodNam
 	{
 		command = std::make_unique<HistoryXmlCommand>();
 	}
+	else if (!strcasecmp(methodName, "changes"))
+	{
+		command = std::make_unique<ChangesXmlCommand>();
+	}
 	else if (!strcasecmp(methodName, "urlqueue"))
 	{
 		command = std::make_unique<UrlQueueXmlCommand>();
@@ -795,6 +863,25 @@ void XmlCommand::AppendCondResponse(const char* part, bool cond)
 	}
 }
 
+/*
+ * Big responses are passed to the processor in blocks as they grow instead of
+ * accumulating them in memory. Commands call this between items built from
+ * snapshots, never while holding a lock, since sending may block on a slow
+ * client. Errors must be reported before the first block.
+ * Returns false if the response can't be sent anymore and the command
+ * should stop.
+ */
+bool XmlCommand::StreamResponse()
+{
+	if (m_processor && !m_fault && m_response.Length() >= STREAM_BLOCK_SIZE)
+	{
+		bool ok = m_processor->StreamResponse(m_response, m_response.Length(), m_callbackFunc);
+		m_response.Reset();
+		return ok;
+	}
+	return true;
+}
+
 void XmlCommand::BuildErrorResponse(int errCode, const char* errText, ...)
 {
 	const char* XML_RESPONSE_ERROR_BODY =
@@ -1294,18 +1381,11 @@ void StatusXmlCommand::Execute()
 		"\"Active\" : %s\n"
 		"}";
 
-	int postJobCount = 0;
-	int urlCount = 0;
-	int64 remainingSize, forcedSize;
-	{
-		GuardedDownloadQueue downloadQueue = DownloadQueue::Guard();
-		for (NzbInfo* nzbInfo : downloadQueue->GetQueue())
-		{
-			postJobCount += nzbInfo->GetPostInfo() ? 1 : 0;
-			urlCount += nzbInfo->GetKind() == NzbInfo::nkUrl ? 1 : 0;
-		}
-		downloadQueue->CalcRemainingSize(&remainingSize, &forcedSize);
-	}
+	DownloadQueue::Stats queueStats = DownloadQueue::GetStats();
+	int postJobCount = queueStats.postJobCount;
+	int urlCount = queueStats.urlCount;
+	int64 remainingSize = queueStats.remainingSize;
+	int64 forcedSize = queueStats.forcedSize;
 
 	uint32 remainingSizeHi, remainingSizeLo;
 	Util::SplitInt64(remainingSize, &remainingSizeHi, &remainingSizeLo);
@@ -1482,6 +1562,31 @@ void ListFilesXmlCommand::Execute()
 
 	AppendResponse(IsJson() ? "[\n" : "<array><data>\n");
 
+	std::shared_ptr<QueueSnapshot> snapshot = g_QueueCoordinator->GetSnapshot(ChangeTracker::ikFile);
+
+	int index = 0;
+
+	for (FileSnapshot& file : snapshot->GetFiles())
+	{
+		if (!((nzbId > 0 && nzbId == file.nzbId) ||
+			(nzbId == 0 && (idStart == 0 || (idStart <= file.id && file.id <= idEnd)))))
+		{
+			continue;
+		}
+
+		AppendCondResponse(",\n", IsJson() && index++ > 0);
+		AppendFileItem(file);
+		if (!StreamResponse())
+		{
+			return;
+		}
+	}
+
+	AppendResponse(IsJson() ? "\n]" : "</data></array>\n");
+}
+
+void NzbInfoXmlCommand::AppendFileItem(FileSnapshot& file)
+{
 	const char* XML_LIST_ITEM =
 		"<value><struct>\n"
 		"<member><name>ID</name><value><i4>%i</i4></value></member>\n"
@@ -1528,42 +1633,23 @@ void ListFilesXmlCommand::Execute()
 		"\"Progress\" : %i\n"
 		"}";
 
-	int index = 0;
+	uint32 fileSizeHi, fileSizeLo;
+	uint32 remainingSizeLo, remainingSizeHi;
+	Util::SplitInt64(file.size, &fileSizeHi, &fileSizeLo);
+	Util::SplitInt64(file.remainingSize, &remainingSizeHi, &remainingSizeLo);
+	CString xmlNzbNicename = EncodeStr(file.nzbName);
 
-	GuardedDownloadQueue downloadQueue = DownloadQueue::Guard();
-	for (NzbInfo* nzbInfo : downloadQueue->GetQueue())
-	{
-		for (FileInfo* fileInfo : nzbInfo->GetFileList())
-		{
-			if ((nzbId > 0 && nzbId == fileInfo->GetNzbInfo()->GetId()) ||
-				(nzbId == 0 && (idStart == 0 || (idStart <= fileInfo->GetId() && fileInfo->GetId() <= idEnd))))
-			{
-				uint32 fileSizeHi, fileSizeLo;
-				uint32 remainingSizeLo, remainingSizeHi;
-				Util::SplitInt64(fileInfo->GetSize(), &fileSizeHi, &fileSizeLo);
-				Util::SplitInt64(fileInfo->GetRemainingSize(), &remainingSizeHi, &remainingSizeLo);
-				CString xmlNzbNicename = EncodeStr(fileInfo->GetNzbInfo()->GetName());
-
-				int progress = fileInfo->GetFailedSize() == 0 && fileInfo->GetSuccessSize() == 0 ? 0 :
-					(int)(1000 - fileInfo->GetRemainingSize() * 1000 / (fileInfo->GetSize() - fileInfo->GetMissedSize()));
-
-				AppendCondResponse(",\n", IsJson() && index++ > 0);
-				AppendFmtResponse(IsJson() ? JSON_LIST_ITEM : XML_LIST_ITEM,
-					fileInfo->GetId(), fileSizeLo, fileSizeHi, remainingSizeLo, remainingSizeHi,
-					(int)fileInfo->GetTime(), BoolToStr(fileInfo->GetFilenameConfirmed()),
-					BoolToStr(fileInfo->GetPaused()), fileInfo->GetNzbInfo()->GetId(),
-					*xmlNzbNicename, *xmlNzbNicename, *EncodeStr(fileInfo->GetNzbInfo()->GetFilename()),
-					*EncodeStr(fileInfo->GetSubject()), *EncodeStr(fileInfo->GetFilename()),
-					*EncodeStr(fileInfo->GetNzbInfo()->GetDestDir()), *EncodeStr(fileInfo->GetNzbInfo()->GetCategory()),
-					fileInfo->GetNzbInfo()->GetPriority(), fileInfo->GetActiveDownloads(), progress);
-			}
-		}
-	}
-
-	AppendResponse(IsJson() ? "\n]" : "</data></array>\n");
+	AppendFmtResponse(IsJson() ? JSON_LIST_ITEM : XML_LIST_ITEM,
+		file.id, fileSizeLo, fileSizeHi, remainingSizeLo, remainingSizeHi,
+		(int)file.time, BoolToStr(file.filenameConfirmed),
+		BoolToStr(file.paused), file.nzbId,
+		*xmlNzbNicename, *xmlNzbNicename, *EncodeStr(file.nzbFilename),
+		*EncodeStr(file.subject), *EncodeStr(file.filename),
+		*EncodeStr(file.destDir), *EncodeStr(file.category),
+		file.priority, file.activeDownloads, file.progress);
 }
 
-void NzbInfoXmlCommand::AppendNzbInfoFields(NzbInfo* nzbInfo)
+void NzbInfoXmlCommand::AppendNzbInfoFields(NzbSnapshot& nzb)
 {
 	const char* XML_NZB_ITEM_START =
 		"<member><name>NZBID</name><value><i4>%i</i4></value></member>\n"
@@ -1726,41 +1812,37 @@ void NzbInfoXmlCommand::AppendNzbInfoFields(NzbInfo* nzbInfo)
 	const char* dupeModeName[] = { "SCORE", "ALL", "FORCE" };
 
 	uint32 fileSizeHi, fileSizeLo, fileSizeMB;
-	Util::SplitInt64(nzbInfo->GetSize(), &fileSizeHi, &fileSizeLo);
-	fileSizeMB = (int)(nzbInfo->GetSize() / 1024 / 1024);
+	Util::SplitInt64(nzb.size, &fileSizeHi, &fileSizeLo);
+	fileSizeMB = (int)(nzb.size / 1024 / 1024);
 
 	uint32 downloadedSizeHi, downloadedSizeLo, downloadedSizeMB;
-	Util::SplitInt64(nzbInfo->GetDownloadedSize(), &downloadedSizeHi, &downloadedSizeLo);
-	downloadedSizeMB = (int)(nzbInfo->GetDownloadedSize() / 1024 / 1024);
+	Util::SplitInt64(nzb.downloadedSize, &downloadedSizeHi, &downloadedSizeLo);
+	downloadedSizeMB = (int)(nzb.downloadedSize / 1024 / 1024);
 
-	int messageCount = nzbInfo->GetMessageCount() > 0 ? nzbInfo->GetMessageCount() : nzbInfo->GetCachedMessageCount();
-
-	CString xmlNzbNicename = EncodeStr(nzbInfo->GetName());
-	const char* exParStatus = nzbInfo->GetExtraParBlocks() > 0 ? "RECIPIENT" : nzbInfo->GetExtraParBlocks() < 0 ? "DONOR" : "NONE";
+	CString xmlNzbNicename = EncodeStr(nzb.name);
+	const char* exParStatus = nzb.extraParBlocks > 0 ? "RECIPIENT" : nzb.extraParBlocks < 0 ? "DONOR" : "NONE";
 
 	AppendFmtResponse(IsJson() ? JSON_NZB_ITEM_START : XML_NZB_ITEM_START,
-			nzbInfo->GetId(), *xmlNzbNicename, *xmlNzbNicename, kindName[nzbInfo->GetKind()],
-			*EncodeStr(nzbInfo->GetUrl()), *EncodeStr(nzbInfo->GetFilename()),
-			*EncodeStr(nzbInfo->GetDestDir()), *EncodeStr(nzbInfo->GetFinalDir()),
-			*EncodeStr(nzbInfo->GetCategory()), parStatusName[nzbInfo->GetParStatus()], exParStatus,
-			unpackStatusName[nzbInfo->GetUnpackStatus()], moveStatusName[nzbInfo->GetMoveStatus()],
-			scriptStatusName[nzbInfo->GetScriptStatuses()->CalcTotalStatus()],
-			deleteStatusName[nzbInfo->GetDeleteStatus()], markStatusName[nzbInfo->GetMarkStatus()],
-			urlStatusName[nzbInfo->GetUrlStatus()],
-			fileSizeLo, fileSizeHi, fileSizeMB, nzbInfo->GetFileCount(),
-			(int)nzbInfo->GetMinTime(), (int)nzbInfo->GetMaxTime(),
-			nzbInfo->GetTotalArticles(), nzbInfo->GetCurrentSuccessArticles(), nzbInfo->GetCurrentFailedArticles(),
-			nzbInfo->CalcHealth(), nzbInfo->CalcCriticalHealth(false),
-			*EncodeStr(nzbInfo->GetDupeKey()), nzbInfo->GetDupeScore(), dupeModeName[nzbInfo->GetDupeMode()],
-			BoolToStr(nzbInfo->GetDeleteStatus() != NzbInfo::dsNone),
-			downloadedSizeLo, downloadedSizeHi, downloadedSizeMB, nzbInfo->GetDownloadSec(),
-			(int)(nzbInfo->GetPostTotalSec() + (nzbInfo->GetPostInfo() && nzbInfo->GetPostInfo()->GetStartTime() ?
-				Util::CurrentTime() - nzbInfo->GetPostInfo()->GetStartTime() : 0)),
-			nzbInfo->GetParSec(), nzbInfo->GetRepairSec(), nzbInfo->GetUnpackSec(), messageCount, nzbInfo->GetExtraParBlocks());
+			nzb.id, *xmlNzbNicename, *xmlNzbNicename, kindName[nzb.kind],
+			*EncodeStr(nzb.url), *EncodeStr(nzb.filename),
+			*EncodeStr(nzb.destDir), *EncodeStr(nzb.finalDir),
+			*EncodeStr(nzb.category), parStatusName[nzb.parStatus], exParStatus,
+			unpackStatusName[nzb.unpackStatus], moveStatusName[nzb.moveStatus],
+			scriptStatusName[nzb.scriptStatus],
+			deleteStatusName[nzb.deleteStatus], markStatusName[nzb.markStatus],
+			urlStatusName[nzb.urlStatus],
+			fileSizeLo, fileSizeHi, fileSizeMB, nzb.fileCount,
+			(int)nzb.minTime, (int)nzb.maxTime,
+			nzb.totalArticles, nzb.successArticles, nzb.failedArticles,
+			nzb.health, nzb.criticalHealth,
+			*EncodeStr(nzb.dupeKey), nzb.dupeScore, dupeModeName[nzb.dupeMode],
+			BoolToStr(nzb.deleteStatus != NzbInfo::dsNone),
+			downloadedSizeLo, downloadedSizeHi, downloadedSizeMB, nzb.downloadSec,
+			nzb.postTotalSec, nzb.parSec, nzb.repairSec, nzb.unpackSec, nzb.messageCount, nzb.extraParBlocks);
 
 	// Post-processing parameters
 	int paramIndex = 0;
-	for (NzbParameter& parameter : nzbInfo->GetParameters())
+	for (NzbParameter& parameter : nzb.parameters)
 	{
 		AppendCondResponse(",\n", IsJson() && paramIndex++ > 0);
 		AppendFmtResponse(IsJson() ? JSON_PARAMETER_ITEM : XML_PARAMETER_ITEM,
@@ -1771,7 +1853,7 @@ void NzbInfoXmlCommand::AppendNzbInfoFields(NzbInfo* nzbInfo)
 
 	// Script statuses
 	int scriptIndex = 0;
-	for (ScriptStatus& scriptStatus : nzbInfo->GetScriptStatuses())
+	for (ScriptStatus& scriptStatus : nzb.scriptStatuses)
 	{
 		AppendCondResponse(",\n", IsJson() && scriptIndex++ > 0);
 		AppendFmtResponse(IsJson() ? JSON_SCRIPT_ITEM : XML_SCRIPT_ITEM,
@@ -1782,7 +1864,7 @@ void NzbInfoXmlCommand::AppendNzbInfoFields(NzbInfo* nzbInfo)
 
 	// Server stats
 	int statIndex = 0;
-	for (ServerStat& serverStat : nzbInfo->GetCurrentServerStats())
+	for (ServerStat& serverStat : nzb.serverStats)
 	{
 		AppendCondResponse(",\n", IsJson() && statIndex++ > 0);
 		AppendFmtResponse(IsJson() ? JSON_STAT_ITEM : XML_STAT_ITEM,
@@ -1792,7 +1874,7 @@ void NzbInfoXmlCommand::AppendNzbInfoFields(NzbInfo* nzbInfo)
 	AppendResponse(IsJson() ? JSON_NZB_ITEM_END : XML_NZB_ITEM_END);
 }
 
-void NzbInfoXmlCommand::AppendPostInfoFields(PostInfo* postInfo, int logEntries, bool postQueue)
+void NzbInfoXmlCommand::AppendPostInfoFields(NzbSnapshot& nzb, bool postQueue)
 {
 	const char* XML_GROUPQUEUE_ITEM_START =
 		"<member><name>PostInfoText</name><value><string>%s</string></value></member>\n"
@@ -1850,14 +1932,10 @@ void NzbInfoXmlCommand::AppendPostInfoFields(PostInfo* postInfo, int logEntries,
 	const char* itemStart = postQueue ? IsJson() ? JSON_POSTQUEUE_ITEM_START : XML_POSTQUEUE_ITEM_START :
 		IsJson() ? JSON_GROUPQUEUE_ITEM_START : XML_GROUPQUEUE_ITEM_START;
 
-	if (postInfo)
+	if (nzb.postJob)
 	{
-		time_t curTime = Util::CurrentTime();
-
-		AppendFmtResponse(itemStart, *EncodeStr(postInfo->GetProgressLabel()),
-			postInfo->GetStageProgress(),
-			(int)(postInfo->GetStageTime() ? curTime - postInfo->GetStageTime() : 0),
-			(int)(postInfo->GetStartTime() ? curTime - postInfo->GetStartTime() : 0));
+		AppendFmtResponse(itemStart, *EncodeStr(nzb.progressLabel),
+			nzb.stageProgress, nzb.stageSec, nzb.postJobSec);
 	}
 	else
 	{
@@ -1866,28 +1944,13 @@ void NzbInfoXmlCommand::AppendPostInfoFields(PostInfo* postInfo, int logEntries,
 
 	AppendResponse(IsJson() ? JSON_LOG_START : XML_LOG_START);
 
-	if (logEntries > 0 && postInfo)
+	int index = 0;
+	for (Message& message : nzb.messages)
 	{
-		GuardedMessageList messages = postInfo->GetNzbInfo()->GuardCachedMessages();
-		if (!messages->empty())
-		{
-			if (logEntries > (int)messages->size())
-			{
-				logEntries = messages->size();
-			}
-			int start = messages->size() - logEntries;
-
-			int index = 0;
-			for (uint32 i = (uint32)start; i < messages->size(); i++)
-			{
-				Message& message = messages->at(i);
-
-				AppendCondResponse(",\n", IsJson() && index++ > 0);
-				AppendFmtResponse(IsJson() ? JSON_LOG_ITEM : XML_LOG_ITEM,
-					message.GetId(), messageType[message.GetKind()], (int)message.GetTime(),
-					*EncodeStr(message.GetText()));
-			}
-		}
+		AppendCondResponse(",\n", IsJson() && index++ > 0);
+		AppendFmtResponse(IsJson() ? JSON_LOG_ITEM : XML_LOG_ITEM,
+			message.GetId(), messageType[message.GetKind()], (int)message.GetTime(),
+			*EncodeStr(message.GetText()));
 	}
 
 	AppendResponse(IsJson() ? JSON_POSTQUEUE_ITEM_END : XML_POSTQUEUE_ITEM_END);
@@ -1901,6 +1964,41 @@ void ListGroupsXmlCommand::Execute()
 
 	AppendResponse(IsJson() ? "[\n" : "<array><data>\n");
 
+	std::shared_ptr<QueueSnapshot> snapshot;
+	NzbSnapshotList nzbs;
+
+	if (nrEntries > 0)
+	{
+		// the shared snapshot has no log entries
+		GuardedDownloadQueue downloadQueue = DownloadQueue::Guard();
+		nzbs.reserve(downloadQueue->GetQueue()->size());
+		for (NzbInfo* nzbInfo : downloadQueue->GetQueue())
+		{
+			nzbs.emplace_back(nzbInfo, nrEntries);
+		}
+	}
+	else
+	{
+		snapshot = g_QueueCoordinator->GetSnapshot(ChangeTracker::ikGroup);
+	}
+
+	int index = 0;
+
+	for (NzbSnapshot& nzb : snapshot ? snapshot->GetGroups() : &nzbs)
+	{
+		AppendCondResponse(",\n", IsJson() && index++ > 0);
+		AppendGroupItem(nzb);
+		if (!StreamResponse())
+		{
+			return;
+		}
+	}
+
+	AppendResponse(IsJson() ? "\n]" : "</data></array>\n");
+}
+
+void NzbInfoXmlCommand::AppendGroupItem(NzbSnapshot& nzb)
+{
 	const char* XML_LIST_ITEM_START =
 		"<value><struct>\n"
 		"<member><name>FirstID</name><value><i4>%i</i4></value></member>\n"				// deprecated, use "NZBID" instead
@@ -1941,74 +2039,24 @@ void ListGroupsXmlCommand::Execute()
 	const char* JSON_LIST_ITEM_END =
 		"}";
 
-	int index = 0;
-
-	GuardedDownloadQueue downloadQueue = DownloadQueue::Guard();
-	for (NzbInfo* nzbInfo : downloadQueue->GetQueue())
-	{
-		uint32 remainingSizeLo, remainingSizeHi, remainingSizeMB;
-		uint32 pausedSizeLo, pausedSizeHi, pausedSizeMB;
-		Util::SplitInt64(nzbInfo->GetRemainingSize(), &remainingSizeHi, &remainingSizeLo);
-		remainingSizeMB = (int)(nzbInfo->GetRemainingSize() / 1024 / 1024);
-		Util::SplitInt64(nzbInfo->GetPausedSize(), &pausedSizeHi, &pausedSizeLo);
-		pausedSizeMB = (int)(nzbInfo->GetPausedSize() / 1024 / 1024);
-		const char* status = DetectStatus(nzbInfo);
-
-		AppendCondResponse(",\n", IsJson() && index++ > 0);
-		AppendFmtResponse(IsJson() ? JSON_LIST_ITEM_START : XML_LIST_ITEM_START,
-			nzbInfo->GetId(), nzbInfo->GetId(), remainingSizeLo, remainingSizeHi, remainingSizeMB,
-			pausedSizeLo, pausedSizeHi, pausedSizeMB, (int)nzbInfo->GetFileList()->size(),
-			nzbInfo->GetRemainingParCount(), nzbInfo->GetPriority(), nzbInfo->GetPriority(),
-			nzbInfo->GetActiveDownloads(), status);
+	uint32 remainingSizeLo, remainingSizeHi, remainingSizeMB;
+	uint32 pausedSizeLo, pausedSizeHi, pausedSizeMB;
+	Util::SplitInt64(nzb.remainingSize, &remainingSizeHi, &remainingSizeLo);
+	remainingSizeMB = (int)(nzb.remainingSize / 1024 / 1024);
+	Util::SplitInt64(nzb.pausedSize, &pausedSizeHi, &pausedSizeLo);
+	pausedSizeMB = (int)(nzb.pausedSize / 1024 / 1024);
 
-		AppendNzbInfoFields(nzbInfo);
-		AppendCondResponse(",\n", IsJson());
-		AppendPostInfoFields(nzbInfo->GetPostInfo(), nrEntries, false);
-
-		AppendResponse(IsJson() ? JSON_LIST_ITEM_END : XML_LIST_ITEM_END);
-	}
+	AppendFmtResponse(IsJson() ? JSON_LIST_ITEM_START : XML_LIST_ITEM_START,
+		nzb.id, nzb.id, remainingSizeLo, remainingSizeHi, remainingSizeMB,
+		pausedSizeLo, pausedSizeHi, pausedSizeMB, nzb.remainingFileCount,
+		nzb.remainingParCount, nzb.priority, nzb.priority,
+		nzb.activeDownloads, nzb.status);
 
-	AppendResponse(IsJson() ? "\n]" : "</data></array>\n");
-}
-
-const char* ListGroupsXmlCommand::DetectStatus(NzbInfo* nzbInfo)
-{
-	const char* postStageName[] = { "PP_QUEUED", "LOADING_PARS", "VERIFYING_SOURCES", "REPAIRING",
-		"VERIFYING_REPAIRED", "RENAMING", "RENAMING", "UNPACKING", "MOVING", "MOVING", "EXECUTING_SCRIPT", "PP_FINISHED" };
-
-	const char* status = nullptr;
-
-	if (nzbInfo->GetPostInfo())
-	{
-		bool queueScriptActive = false;
-		if (nzbInfo->GetPostInfo()->GetStage() == PostInfo::ptQueued &&
-			g_QueueScriptCoordinator->HasJob(nzbInfo->GetId(), &queueScriptActive))
-		{
-			status = queueScriptActive ? "QS_EXECUTING" : "QS_QUEUED";
-		}
-		else if (nzbInfo->GetDirectUnpackStatus() == NzbInfo::nsRunning)
-		{
-			status = "UNPACKING";
-		}
-		else
-		{
-			status = postStageName[nzbInfo->GetPostInfo()->GetStage()];
-		}
-	}
-	else if (nzbInfo->GetActiveDownloads() > 0)
-	{
-		status = nzbInfo->GetKind() == NzbInfo::nkUrl ? "FETCHING" : "DOWNLOADING";
-	}
-	else if ((nzbInfo->GetPausedSize() > 0) && (nzbInfo->GetRemainingSize() == nzbInfo->GetPausedSize()))
-	{
-		status = "PAUSED";
-	}
-	else
-	{
-		status = "QUEUED";
-	}
+	AppendNzbInfoFields(nzb);
+	AppendCondResponse(",\n", IsJson());
+	AppendPostInfoFields(nzb, false);
 
-	return status;
+	AppendResponse(IsJson() ? JSON_LIST_ITEM_END : XML_LIST_ITEM_END);
 }
 
 struct EditCommandEntry
@@ -2323,27 +2371,48 @@ void PostQueueXmlCommand::Execute()
 	const char* postStageName[] = { "QUEUED", "LOADING_PARS", "VERIFYING_SOURCES", "REPAIRING",
 		"VERIFYING_REPAIRED", "RENAMING", "RENAMING", "UNPACKING", "MOVING", "MOVING", "EXECUTING_SCRIPT", "FINISHED" };
 
+	std::shared_ptr<QueueSnapshot> snapshot;
+	NzbSnapshotList nzbs;
+
+	if (nrEntries > 0)
+	{
+		// the shared snapshot has no log entries
+		GuardedDownloadQueue downloadQueue = DownloadQueue::Guard();
+		for (NzbInfo* nzbInfo : downloadQueue->GetQueue())
+		{
+			if (nzbInfo->GetPostInfo())
+			{
+				nzbs.emplace_back(nzbInfo, nrEntries);
+			}
+		}
+	}
+	else
+	{
+		snapshot = g_QueueCoordinator->GetSnapshot(ChangeTracker::ikGroup);
+	}
+
 	int index = 0;
 
-	GuardedDownloadQueue downloadQueue = DownloadQueue::Guard();
-	for (NzbInfo* nzbInfo : downloadQueue->GetQueue())
+	for (NzbSnapshot& nzb : snapshot ? snapshot->GetGroups() : &nzbs)
 	{
-		PostInfo* postInfo = nzbInfo->GetPostInfo();
-		if (!postInfo)
+		if (!nzb.postJob)
 		{
 			continue;
 		}
 
 		AppendCondResponse(",\n", IsJson() && index++ > 0);
 		AppendFmtResponse(IsJson() ? JSON_POSTQUEUE_ITEM_START : XML_POSTQUEUE_ITEM_START,
-			nzbInfo->GetId(), *EncodeStr(postInfo->GetNzbInfo()->GetName()),
-			postStageName[postInfo->GetStage()], postInfo->GetFileProgress());
+			nzb.id, *EncodeStr(nzb.name), postStageName[nzb.stage], nzb.fileProgress);
 
-		AppendNzbInfoFields(postInfo->GetNzbInfo());
+		AppendNzbInfoFields(nzb);
 		AppendCondResponse(",\n", IsJson());
-		AppendPostInfoFields(postInfo, nrEntries, true);
+		AppendPostInfoFields(nzb, true);
 
 		AppendResponse(IsJson() ? JSON_POSTQUEUE_ITEM_END : XML_POSTQUEUE_ITEM_END);
+		if (!StreamResponse())
+		{
+			return;
+		}
 	}
 
 	AppendResponse(IsJson() ? "\n]" : "</data></array>\n");
@@ -2415,6 +2484,33 @@ void HistoryXmlCommand::Execute()
 {
 	AppendResponse(IsJson() ? "[\n" : "<array><data>\n");
 
+	bool dup = false;
+	NextParamAsBool(&dup);
+
+	std::shared_ptr<QueueSnapshot> snapshot = g_QueueCoordinator->GetSnapshot(ChangeTracker::ikHistory);
+
+	int index = 0;
+
+	for (HistorySnapshot& item : snapshot->GetHistory())
+	{
+		if (item.kind == HistoryInfo::hkDup && !dup)
+		{
+			continue;
+		}
+
+		AppendCondResponse(",\n", IsJson() && index++ > 0);
+		AppendHistoryItem(item);
+		if (!StreamResponse())
+		{
+			return;
+		}
+	}
+
+	AppendResponse(IsJson() ? "\n]" : "</data></array>\n");
+}
+
+void NzbInfoXmlCommand::AppendHistoryItem(HistorySnapshot& item)
+{
 	const char* XML_HISTORY_ITEM_START =
 		"<value><struct>\n"
 		"<member><name>ID</name><value><i4>%i</i4></value></member>\n"					// Deprecated, use "NZBID" instead
@@ -2476,79 +2572,202 @@ void HistoryXmlCommand::Execute()
 	const char* dupStatusName[] = { "UNKNOWN", "SUCCESS", "FAILURE", "DELETED", "DUPE", "BAD", "GOOD" };
 	const char* dupeModeName[] = { "SCORE", "ALL", "FORCE" };
 
-	bool dup = false;
-	NextParamAsBool(&dup);
+	if (item.kind == HistoryInfo::hkNzb || item.kind == HistoryInfo::hkUrl)
+	{
+		AppendFmtResponse(IsJson() ? JSON_HISTORY_ITEM_START : XML_HISTORY_ITEM_START,
+			item.id, *EncodeStr(item.name), item.parkedFileCount,
+			BoolToStr(item.retryData), (int)item.time, item.status);
+	}
+	else if (item.kind == HistoryInfo::hkDup)
+	{
+		uint32 fileSizeHi, fileSizeLo, fileSizeMB;
+		Util::SplitInt64(item.dupSize, &fileSizeHi, &fileSizeLo);
+		fileSizeMB = (int)(item.dupSize / 1024 / 1024);
 
-	int index = 0;
+		AppendFmtResponse(IsJson() ? JSON_HISTORY_DUP_ITEM : XML_HISTORY_DUP_ITEM,
+			item.id, item.id, "DUP", *EncodeStr(item.name),
+			(int)item.time, fileSizeLo, fileSizeHi, fileSizeMB,
+			*EncodeStr(item.dupeKey), item.dupeScore,
+			dupeModeName[item.dupeMode], dupStatusName[item.dupStatus],
+			item.status);
+	}
 
-	GuardedDownloadQueue guard = DownloadQueue::Guard();
-	for (HistoryInfo* historyInfo : guard->GetHistory())
+	if (item.nzb)
 	{
-		if (historyInfo->GetKind() == HistoryInfo::hkDup && !dup)
+		AppendNzbInfoFields(*item.nzb);
+	}
+
+	AppendResponse(IsJson() ? JSON_HISTORY_ITEM_END : XML_HISTORY_ITEM_END);
+}
+
+// struct changes(string Revision, int NumberOfLogEntries, int Instance)
+// Returns groups, files and history items (including hidden) added or changed
+// since the given revision and the ids of items deleted since then.
+// Revisions are 64-bit numbers and are therefore passed as strings.
+// With revision "0", a revision which is no longer known or an instance id
+// of another program run all items are returned and the member "Reset" is set.
+void ChangesXmlCommand::Execute()
+{
+	char* revisionStr = nullptr;
+	int nrEntries = 0;
+	int instance = 0;
+	NextParamAsStr(&revisionStr);
+	NextParamAsInt(&nrEntries);
+	NextParamAsInt(&instance);
+	int64 sinceRevision = revisionStr ? atoll(revisionStr) : 0;
+
+	const char* XML_CHANGES_START =
+		"<struct>\n"
+		"<member><name>Instance</name><value><i4>%i</i4></value></member>\n"
+		"<member><name>Revision</name><value><string>%" PRIi64 "</string></value></member>\n"
+		"<member><name>Reset</name><value><boolean>%s</boolean></value></member>\n";
+
+	const char* XML_CHANGES_END =
+		"</struct>\n";
+
+	const char* XML_LIST_START =
+		"<member><name>%s</name><value><array><data>\n";
+
+	const char* XML_LIST_END =
+		"</data></array></value></member>\n";
+
+	const char* JSON_CHANGES_START =
+		"{\n"
+		"\"Instance\" : %i,\n"
+		"\"Revision\" : \"%" PRIi64 "\",\n"
+		"\"Reset\" : %s";
+
+	const char* JSON_CHANGES_END =
+		"\n}";
+
+	const char* JSON_LIST_START =
+		",\n\"%s\" : [\n";
+
+	const char* JSON_LIST_END =
+		"\n]";
+
+	NzbSnapshotList groups;
+	FileSnapshotList files;
+	HistorySnapshotList history;
+	IdList deletedGroups;
+	IdList deletedFiles;
+	IdList deletedHistory;
+	int64 revision;
+	bool reset;
+
+	{
+		GuardedDownloadQueue downloadQueue = DownloadQueue::Guard();
+		ChangeTracker* changeTracker = downloadQueue->GetChangeTracker();
+
+		reset = !changeTracker->IsKnownRevision(instance, sinceRevision);
+		if (reset)
 		{
-			continue;
+			sinceRevision = 0;
 		}
+		instance = changeTracker->GetInstance();
 
-		NzbInfo* nzbInfo = nullptr;
+		// elapsed times of post-processing jobs change every second
+		// without stamping revisions, such groups are always reported
+		if (sinceRevision != ChangeTracker::GetRevision() || DownloadQueue::GetStats().postJobCount > 0)
+		{
+			changeTracker->BeginScan();
 
-		const char* status = DetectStatus(historyInfo);
+			for (NzbInfo* nzbInfo : downloadQueue->GetQueue())
+			{
+				if (changeTracker->Scan(ChangeTracker::ikGroup, nzbInfo->GetId(),
+					nzbInfo->GetChangeRevision()) > sinceRevision || nzbInfo->GetPostInfo())
+				{
+					groups.emplace_back(nzbInfo, nrEntries);
+				}
 
-		AppendCondResponse(",\n", IsJson() && index++ > 0);
+				for (FileInfo* fileInfo : nzbInfo->GetFileList())
+				{
+					if (changeTracker->Scan(ChangeTracker::ikFile, fileInfo->GetId(),
+						std::max(fileInfo->GetChangeRevision(), nzbInfo->GetFileItemRevision())) > sinceRevision)
+					{
+						files.emplace_back(fileInfo);
+					}
+				}
+			}
 
-		if (historyInfo->GetKind() == HistoryInfo::hkNzb ||
-			historyInfo->GetKind() == HistoryInfo::hkUrl)
-		{
-			nzbInfo = historyInfo->GetNzbInfo();
+			for (HistoryInfo* historyInfo : downloadQueue->GetHistory())
+			{
+				if (changeTracker->Scan(ChangeTracker::ikHistory, historyInfo->GetId(),
+					historyInfo->GetChangeRevision()) > sinceRevision)
+				{
+					history.emplace_back(historyInfo);
+				}
+			}
 
-			AppendFmtResponse(IsJson() ? JSON_HISTORY_ITEM_START : XML_HISTORY_ITEM_START,
-				historyInfo->GetId(), *EncodeStr(historyInfo->GetName()), nzbInfo->GetParkedFileCount(),
-				BoolToStr(nzbInfo->GetCompletedFiles()->size()), (int)historyInfo->GetTime(), status);
+			changeTracker->EndScan();
 		}
-		else if (historyInfo->GetKind() == HistoryInfo::hkDup)
-		{
-			DupInfo* dupInfo = historyInfo->GetDupInfo();
 
-			uint32 fileSizeHi, fileSizeLo, fileSizeMB;
-			Util::SplitInt64(dupInfo->GetSize(), &fileSizeHi, &fileSizeLo);
-			fileSizeMB = (int)(dupInfo->GetSize() / 1024 / 1024);
+		revision = ChangeTracker::GetRevision();
+		changeTracker->ListDeleted(ChangeTracker::ikGroup, sinceRevision, &deletedGroups);
+		changeTracker->ListDeleted(ChangeTracker::ikFile, sinceRevision, &deletedFiles);
+		changeTracker->ListDeleted(ChangeTracker::ikHistory, sinceRevision, &deletedHistory);
+	}
 
-			AppendFmtResponse(IsJson() ? JSON_HISTORY_DUP_ITEM : XML_HISTORY_DUP_ITEM,
-				historyInfo->GetId(), historyInfo->GetId(), "DUP", *EncodeStr(historyInfo->GetName()),
-				(int)historyInfo->GetTime(), fileSizeLo, fileSizeHi, fileSizeMB,
-				*EncodeStr(dupInfo->GetDupeKey()), dupInfo->GetDupeScore(),
-				dupeModeName[dupInfo->GetDupeMode()], dupStatusName[dupInfo->GetStatus()],
-				status);
+	AppendFmtResponse(IsJson() ? JSON_CHANGES_START : XML_CHANGES_START, instance, revision, BoolToStr(reset));
+
+	AppendFmtResponse(IsJson() ? JSON_LIST_START : XML_LIST_START, "Groups");
+	int index = 0;
+	for (NzbSnapshot& nzb : groups)
+	{
+		AppendCondResponse(",\n", IsJson() && index++ > 0);
+		AppendGroupItem(nzb);
+		if (!StreamResponse())
+		{
+			return;
 		}
+	}
+	AppendResponse(IsJson() ? JSON_LIST_END : XML_LIST_END);
 
-		if (nzbInfo)
+	AppendFmtResponse(IsJson() ? JSON_LIST_START : XML_LIST_START, "Files");
+	index = 0;
+	for (FileSnapshot& file : files)
+	{
+		AppendCondResponse(",\n", IsJson() && index++ > 0);
+		AppendFileItem(file);
+		if (!StreamResponse())
 		{
-			AppendNzbInfoFields(nzbInfo);
+			return;
 		}
+	}
+	AppendResponse(IsJson() ? JSON_LIST_END : XML_LIST_END);
 
-		AppendResponse(IsJson() ? JSON_HISTORY_ITEM_END : XML_HISTORY_ITEM_END);
+	AppendFmtResponse(IsJson() ? JSON_LIST_START : XML_LIST_START, "History");
+	index = 0;
+	for (HistorySnapshot& item : history)
+	{
+		AppendCondResponse(",\n", IsJson() && index++ > 0);
+		AppendHistoryItem(item);
+		if (!StreamResponse())
+		{
+			return;
+		}
 	}
+	AppendResponse(IsJson() ? JSON_LIST_END : XML_LIST_END);
 
-	AppendResponse(IsJson() ? "\n]" : "</data></array>\n");
+	AppendDeleted("DeletedGroups", &deletedGroups);
+	AppendDeleted("DeletedFiles", &deletedFiles);
+	AppendDeleted("DeletedHistory", &deletedHistory);
+
+	AppendResponse(IsJson() ? JSON_CHANGES_END : XML_CHANGES_END);
 }
 
-const char* HistoryXmlCommand::DetectStatus(HistoryInfo* historyInfo)
+void ChangesXmlCommand::AppendDeleted(const char* name, IdList* idList)
 {
-	const char* status = "FAILURE/INTERNAL_ERROR";
+	AppendFmtResponse(IsJson() ? ",\n\"%s\" : [" : "<member><name>%s</name><value><array><data>\n", name);
 
-	if (historyInfo->GetKind() == HistoryInfo::hkNzb || historyInfo->GetKind() == HistoryInfo::hkUrl)
-	{
-		NzbInfo* nzbInfo = historyInfo->GetNzbInfo();
-		status = nzbInfo->MakeTextStatus(false);
-	}
-	else if (historyInfo->GetKind() == HistoryInfo::hkDup)
+	int index = 0;
+	for (int id : *idList)
 	{
-		DupInfo* dupInfo = historyInfo->GetDupInfo();
-		const char* dupStatusName[] = { "FAILURE/INTERNAL_ERROR", "SUCCESS/HIDDEN", "FAILURE/HIDDEN",
-			"DELETED/MANUAL", "DELETED/DUPE", "FAILURE/BAD", "SUCCESS/GOOD" };
-		status = dupStatusName[dupInfo->GetStatus()];
+		AppendCondResponse(", ", IsJson() && index++ > 0);
+		AppendFmtResponse(IsJson() ? "%i" : "<value><i4>%i</i4></value>\n", id);
 	}
 
-	return status;
+	AppendResponse(IsJson() ? "]" : "</data></array></value></member>\n");
 }
 
 // Deprecated in v13
@@ -2576,17 +2795,40 @@ void UrlQueueXmlCommand::Execute()
 		"\"Priority\" : %i\n"
 		"}";
 
+	struct UrlSnapshot
+	{
+		int id;
+		CString filename;
+		CString url;
+		CString name;
+		CString category;
+		int priority;
+	};
+	std::vector<UrlSnapshot> urls;
+
+	{
+		GuardedDownloadQueue downloadQueue = DownloadQueue::Guard();
+		for (NzbInfo* nzbInfo : downloadQueue->GetQueue())
+		{
+			if (nzbInfo->GetKind() == NzbInfo::nkUrl)
+			{
+				urls.push_back({nzbInfo->GetId(), nzbInfo->GetFilename(), nzbInfo->GetUrl(),
+					nzbInfo->GetName(), nzbInfo->GetCategory(), nzbInfo->GetPriority()});
+			}
+		}
+	}
+
 	int index = 0;
 
-	GuardedDownloadQueue downloadQueue = DownloadQueue::Guard();
-	for (NzbInfo* nzbInfo : downloadQueue->GetQueue())
+	for (UrlSnapshot& url : urls)
 	{
-		if (nzbInfo->GetKind() == NzbInfo::nkUrl)
+		AppendCondResponse(",\n", IsJson() && index++ > 0);
+		AppendFmtResponse(IsJson() ? JSON_URLQUEUE_ITEM : XML_URLQUEUE_ITEM,
+			url.id, *EncodeStr(url.filename), *EncodeStr(url.url),
+			*EncodeStr(url.name), *EncodeStr(url.category), url.priority);
+		if (!StreamResponse())
 		{
-			AppendCondResponse(",\n", IsJson() && index++ > 0);
-			AppendFmtResponse(IsJson() ? JSON_URLQUEUE_ITEM : XML_URLQUEUE_ITEM,
-				nzbInfo->GetId(), *EncodeStr(nzbInfo->GetFilename()), *EncodeStr(nzbInfo->GetUrl()),
-				*EncodeStr(nzbInfo->GetName()), *EncodeStr(nzbInfo->GetCategory()), nzbInfo->GetPriority());
+			return;
 		}
 	}
 
@@ -3305,7 +3547,7 @@ void TestServerXmlCommand::Execute()
 		return;
 	}
 
-	NewsServer server(0, true, "test server", host, port, 0, username, password, false, encryption, cipher, 1, 0, 0, 0, false);
+	NewsServer server(0, true, "test server", host, port, 0, username, password, false, encryption, cipher, 1, 0, 0, 0, false, 0);
 	TestConnection connection(&server, this);
 	connection.SetTimeout(timeout == 0 ? g_Options->GetArticleTimeout() : timeout);
 	connection.SetSuppressErrors(false);
@@ -51,6 +51,20 @@ public:
 		uaAdd
 	};
 
+	/*
+	* Receives big responses in parts while they are being built.
+	* Methods return false if the data could not be sent.
+	*/
+	class ResponseStream
+	{
+	public:
+		virtual ~ResponseStream() {}
+		virtual bool StartStream(const char* contentType) = 0;
+		virtual bool WriteStream(const char* data, int len) = 0;
+		virtual bool FinishStream() = 0;
+		virtual void AbortStream() = 0;
+	};
+
 	void Execute();
 	void SetHttpMethod(EHttpMethod httpMethod) { m_httpMethod = httpMethod; }
 	void SetUserAccess(EUserAccess userAccess) { m_userAccess = userAccess; }
@@ -60,6 +74,8 @@ public:
 	const char* GetContentType() { return m_contentType; }
 	static bool IsRpcRequest(const char* url);
 	bool IsSafeMethod() { return m_safeMethod; };
+	void SetResponseStream(ResponseStream* responseStream) { m_responseStream = responseStream; }
+	bool IsStreamed() { return m_streamed; }
 
 private:
 	char* m_request = nullptr;
@@ -70,12 +86,20 @@ private:
 	CString m_url;
 	StringBuilder m_response;
 	bool m_safeMethod = false;
+	ResponseStream* m_responseStream = nullptr;
+	bool m_streamed = false;
+	bool m_streamFailed = false;
+	BString<100> m_requestId;
 
 	void Dispatch();
 	std::unique_ptr<XmlCommand> CreateCommand(const char* methodName);
 	void MutliCall();
 	void BuildResponse(const char* response, const char* callbackFunc, bool fault, const char* requestId);
+	void BuildResponseHeader(const char* callbackFunc, bool fault, const char* requestId);
 	void BuildErrorResponse(int errCode, const char* errText);
+	bool StreamResponse(const char* response, int len, const char* callbackFunc);
+
+	friend class XmlCommand;
 };
 
 class XmlCommand
@@ -89,6 +113,7 @@ public:
 	void SetProtocol(XmlRpcProcessor::ERpcProtocol protocol) { m_protocol = protocol; }
 	void SetHttpMethod(XmlRpcProcessor::EHttpMethod httpMethod) { m_httpMethod = httpMethod; }
 	void SetUserAccess(XmlRpcProcessor::EUserAccess userAccess) { m_userAccess = userAccess; }
+	void SetProcessor(XmlRpcProcessor* processor) { m_processor = processor; }
 	const char* GetResponse() { return m_response; }
 	const char* GetCallbackFunc() { return m_callbackFunc; }
 	bool GetFault() { return m_fault; }
@@ -104,6 +129,7 @@ protected:
 	XmlRpcProcessor::ERpcProtocol m_protocol = XmlRpcProcessor::rpUndefined;
 	XmlRpcProcessor::EHttpMethod m_httpMethod;
 	XmlRpcProcessor::EUserAccess m_userAccess;
+	XmlRpcProcessor* m_processor = nullptr;
 
 	void BuildErrorResponse(int errCode, const char* errText, ...);
 	void BuildBoolResponse(bool ok);
@@ -111,6 +137,7 @@ protected:
 	void AppendResponse(const char* part);
 	void AppendFmtResponse(const char* format, ...);
 	void AppendCondResponse(const char* part, bool cond);
+	bool StreamResponse();
 	bool IsJson();
 	bool NextParamAsInt(int* value);
 	bool NextParamAsBool(bool* value);
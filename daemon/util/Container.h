@@ -57,11 +57,32 @@ template <typename T> RawVectorIterator<T> begin(std::vector<std::unique_ptr<T>>
 template <typename T> RawVectorIterator<T> end(std::vector<std::unique_ptr<T>>* c) { return RawVectorIterator<T>(c->end()); }
 
 
-/* Template class for deque of unique_ptr with useful utility functions */
+/*
+ * Template class for deque of unique_ptr with useful utility functions.
+ *
+ * Searching by id or by pointer uses an index of item positions, which is built
+ * on the first search and then kept up to date by the modifying functions of this
+ * class. Inserting or erasing renumbers the items on the shorter side of the
+ * position, just like the deque shifts them. Entries found in the index are
+ * validated; if the deque was reordered or modified in other ways (for example
+ * sorted or filled directly via the base class) the index is built again, also
+ * when an id is missing from the index. Searching for an item which isn't in
+ * the deque therefore costs as much as a linear search. Items must not be
+ * replaced via references returned by "operator[]" or iterators, use "Replace"
+ * instead. Ids of items must not be changed while they are in the deque.
+ *
+ * Erasing renumbers up to half of the items. To remove many items, release them
+ * in place ("iterator->reset()"), which keeps the positions of other items, and
+ * then call "Compact" to remove all empty slots in one pass.
+ */
 template <typename T>
 class UniqueDeque : public std::deque<std::unique_ptr<T>>
 {
 public:
+	typedef std::deque<std::unique_ptr<T>> Base;
+	typedef typename Base::iterator iterator;
+	typedef typename Base::const_iterator const_iterator;
+
 	void Add(std::unique_ptr<T> uptr, bool addTop = false)
 	{
 		if (addTop)
@@ -78,18 +99,51 @@ public:
 	{
 		std::unique_ptr<T> uptr;
 
-		typename UniqueDeque::iterator it = Find(p);
+		iterator it = Find(p);
 		if (it != this->end())
 		{
 			uptr = std::move(*it);
-			this->erase(it);
+			EraseAt(it, uptr.get());
 		}
 
 		return uptr;
 	}
 
-	typename UniqueDeque::iterator Find(T* p)
+	void Replace(iterator pos, std::unique_ptr<T> uptr)
+	{
+		int index = pos - this->begin();
+		Unindex(pos->get(), index);
+		*pos = std::move(uptr);
+		Index(pos->get(), index);
+	}
+
+	// Moves item to position "to", which is counted after the item was taken out
+	void Move(int from, int to)
 	{
+		iterator first = this->begin() + std::min(from, to);
+		iterator last = this->begin() + std::max(from, to) + 1;
+		if (from < to)
+		{
+			std::rotate(first, first + 1, last);
+		}
+		else
+		{
+			std::rotate(first, last - 1, last);
+		}
+		Renumber(std::min(from, to), std::max(from, to) + 1);
+	}
+
+	iterator Find(T* p)
+	{
+		if (p)
+		{
+			iterator it = Locate(p->GetId());
+			if (it != this->end() && it->get() == p)
+			{
+				return it;
+			}
+		}
+
 		return std::find_if(this->begin(), this->end(),
 			[p](std::unique_ptr<T>& uptr)
 			{
@@ -99,15 +153,165 @@ public:
 
 	T* Find(int id)
 	{
-		for (std::unique_ptr<T>& uptr : *this)
+		iterator it = Locate(id);
+		return it != this->end() ? it->get() : nullptr;
+	}
+
+	iterator Locate(int id)
+	{
+		bool built = m_index.empty();
+		if (built)
+		{
+			BuildIndex();
+		}
+
+		auto it = m_index.find(id);
+		if (it != m_index.end())
 		{
-			if (uptr->GetId() == id)
+			int index = it->second - m_base;
+			if (index >= 0 && index < (int)this->size() && (*this)[index] && (*this)[index]->GetId() == id)
 			{
-				return uptr.get();
+				return this->begin() + index;
 			}
 		}
 
-		return nullptr;
+		if (built)
+		{
+			return this->end();
+		}
+
+		// the item was added to the deque bypassing the index, the deque was reordered
+		// or the id of the item was changed; like a linear search this costs O(n)
+		BuildIndex();
+		it = m_index.find(id);
+		return it != m_index.end() ? this->begin() + (it->second - m_base) : this->end();
+	}
+
+	void push_back(std::unique_ptr<T>&& uptr)
+	{
+		Base::push_back(std::move(uptr));
+		Index(this->back().get(), (int)this->size() - 1);
+	}
+
+	void push_front(std::unique_ptr<T>&& uptr)
+	{
+		Base::push_front(std::move(uptr));
+		if (!m_index.empty())
+		{
+			m_base--;
+			Index(this->front().get(), 0);
+		}
+	}
+
+	iterator insert(const_iterator pos, std::unique_ptr<T>&& uptr)
+	{
+		int index = pos - this->cbegin();
+		iterator it = Base::insert(pos, std::move(uptr));
+		if (!m_index.empty())
+		{
+			if (index < (int)this->size() / 2)
+			{
+				m_base--;
+				Renumber(0, index);
+			}
+			else
+			{
+				Renumber(index + 1, this->size());
+			}
+			Index(it->get(), index);
+		}
+		return it;
+	}
+
+	// Renumbers the items between "pos" and the nearer end of the deque,
+	// that is O(n) with up to n/2 index updates
+	iterator erase(const_iterator pos)
+	{
+		return EraseAt(pos, pos->get());
+	}
+
+	iterator erase(const_iterator first, const_iterator last)
+	{
+		m_index.clear();
+		return Base::erase(first, last);
+	}
+
+	void clear()
+	{
+		m_index.clear();
+		Base::clear();
+	}
+
+	// Removes empty slots of released items, the index is built again on next search
+	void Compact()
+	{
+		erase(std::remove(this->begin(), this->end(), nullptr), this->end());
+	}
+
+private:
+	// position of an item is the stored value minus "m_base"
+	std::unordered_map<int, int> m_index;
+	int m_base = 0;
+
+	void BuildIndex()
+	{
+		m_index.clear();
+		m_base = 0;
+		Renumber(0, this->size());
+	}
+
+	void Renumber(int from, int to)
+	{
+		if (!m_index.empty() || (from == 0 && to == (int)this->size()))
+		{
+			for (int index = from; index < to; index++)
+			{
+				T* p = (*this)[index].get();
+				if (p)
+				{
+					m_index[p->GetId()] = index + m_base;
+				}
+			}
+		}
+	}
+
+	void Index(T* p, int index)
+	{
+		if (!m_index.empty() && p)
+		{
+			m_index[p->GetId()] = index + m_base;
+		}
+	}
+
+	void Unindex(T* p, int index)
+	{
+		// an entry not found here (the id of the item has changed) stays in
+		// the index; lookups detect such stale entries
+		auto it = p ? m_index.find(p->GetId()) : m_index.end();
+		if (it != m_index.end() && it->second == index + m_base)
+		{
+			m_index.erase(it);
+		}
+	}
+
+	iterator EraseAt(const_iterator pos, T* p)
+	{
+		int index = pos - this->cbegin();
+		Unindex(p, index);
+		iterator it = Base::erase(pos);
+		if (!m_index.empty())
+		{
+			if (index < (int)this->size() / 2)
+			{
+				m_base++;
+				Renumber(0, index);
+			}
+			else
+			{
+				Renumber(index, this->size());
+			}
+		}
+		return it;
 	}
 };
 
@@ -290,6 +290,22 @@ bool FileSystem::AllocateFile(const char* filename, int64 size, bool sparse, CSt
 
 	// there are no reliable function to expand file on POSIX, so we must try different approaches,
 	// starting with the fastest one and hoping it will work
+#ifdef HAVE_FALLOCATE
+	// 0) reserve disk space using "fallocate" (fast, if supported by file system)
+	if (!sparse)
+	{
+		int fd = open(filename, O_WRONLY);
+		if (fd > -1)
+		{
+			ok = fallocate(fd, 0, 0, size) == 0;
+			close(fd);
+		}
+		if (ok)
+		{
+			return true;
+		}
+	}
+#endif
 	// 1) set file size using function "truncate" (this is fast, if it works)
 	truncate(filename, size);
 	// check if it worked
@@ -1153,7 +1169,7 @@ bool DiskFile::Close()
 	{
 		int ret = fclose(m_file);
 		m_file = nullptr;
-		return ret;
+		return ret == 0;
 	}
 	else
 	{
@@ -1222,3 +1238,413 @@ bool DiskFile::Sync(CString& errmsg)
 	return FileSystem::FlushFileBuffers(fileno(m_file), errmsg);
 }
 
+
+
+BatchFileWriter::~BatchFileWriter()
+{
+	Close();
+#ifdef HAVE_IO_URING
+	CloseRing();
+#endif
+}
+
+bool BatchFileWriter::Open(const char* filename)
+{
+	Close();
+	m_filename = filename;
+	m_blocks.clear();
+
+#ifdef HAVE_IO_URING
+	if (m_ringFd == -1 && !m_ringUnavailable && !InitRing())
+	{
+		// io_uring is not available in the running kernel, falling back to buffered writes
+		CloseRing();
+		m_ringUnavailable = true;
+	}
+
+	if (m_ringFd > -1)
+	{
+		m_fd = open(filename, O_WRONLY | O_CLOEXEC);
+		m_active = m_fd > -1;
+		return m_active;
+	}
+#endif
+
+	m_active = OpenFile();
+	return m_active;
+}
+
+bool BatchFileWriter::OpenFile()
+{
+	m_filePos = -1;
+	if (!m_file.Open(m_filename, DiskFile::omReadWrite))
+	{
+		return false;
+	}
+	if (m_writeBuffer > 0)
+	{
+		m_file.SetWriteBuffer(m_writeBuffer);
+	}
+	return true;
+}
+
+bool BatchFileWriter::Close()
+{
+	if (!m_active)
+	{
+		return true;
+	}
+
+	bool ok = Flush();
+
+#ifdef HAVE_IO_URING
+	if (m_fd > -1)
+	{
+		close(m_fd);
+		m_fd = -1;
+	}
+#endif
+
+	if (m_file.Active())
+	{
+		ok = m_file.Close() && ok;
+	}
+
+	m_active = false;
+	return ok;
+}
+
+void BatchFileWriter::Write(const void* buffer, int size, int64 offset)
+{
+	m_blocks.push_back({(const char*)buffer, size, offset});
+}
+
+bool BatchFileWriter::Flush()
+{
+	if (m_blocks.empty())
+	{
+		return true;
+	}
+
+	std::vector<bool> written(m_blocks.size(), false);
+	bool ok = true;
+
+#ifdef HAVE_IO_URING
+	if (m_ringFd > -1)
+	{
+		ok = FlushRing(written);
+	}
+
+	if (ok && m_fd > -1 && m_ringFd == -1)
+	{
+		// the ring became unusable: write remaining blocks via regular file
+		close(m_fd);
+		m_fd = -1;
+		ok = OpenFile();
+	}
+#endif
+
+	if (ok && m_file.Active())
+	{
+		ok = FlushFile(written);
+	}
+
+	m_blocks.clear();
+	return ok;
+}
+
+bool BatchFileWriter::Sync(CString& errmsg)
+{
+	if (!m_active)
+	{
+		return true;
+	}
+
+	if (!Flush())
+	{
+		errmsg = FileSystem::GetLastErrorMessage();
+		return false;
+	}
+
+#ifdef HAVE_IO_URING
+	if (m_fd > -1)
+	{
+		return SyncRing(errmsg);
+	}
+#endif
+
+	if (!m_file.Flush())
+	{
+		errmsg = FileSystem::GetLastErrorMessage();
+		return false;
+	}
+
+	return m_file.Sync(errmsg);
+}
+
+bool BatchFileWriter::FlushFile(std::vector<bool>& written)
+{
+	for (size_t i = 0; i < m_blocks.size(); i++)
+	{
+		Block& block = m_blocks[i];
+		if (written[i])
+		{
+			continue;
+		}
+
+		// adjacent blocks are written without seeking, allowing the write buffer
+		// to combine them into large sequential writes
+		if (m_filePos != block.offset && !m_file.Seek(block.offset))
+		{
+			m_filePos = -1;
+			return false;
+		}
+
+		if (m_file.Write(block.buffer, block.size) != block.size)
+		{
+			m_filePos = -1;
+			return false;
+		}
+
+		m_filePos = block.offset + block.size;
+		written[i] = true;
+	}
+
+	return true;
+}
+
+#ifdef HAVE_IO_URING
+bool BatchFileWriter::InitRing()
+{
+	io_uring_params params;
+	memset(&params, 0, sizeof(params));
+
+	m_ringFd = (int)syscall(__NR_io_uring_setup, RING_ENTRIES, &params);
+	if (m_ringFd < 0)
+	{
+		m_ringFd = -1;
+		return false;
+	}
+
+	// plain write operations (without registered buffers) require kernel 5.6,
+	// which is also the version introducing this feature flag
+	if (!(params.features & IORING_FEAT_RW_CUR_POS))
+	{
+		return false;
+	}
+
+	auto mapRing = [this](size_t size, off_t offset)
+	{
+		void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, offset);
+		return addr == MAP_FAILED ? nullptr : addr;
+	};
+
+	m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32);
+	m_sqRing = mapRing(m_sqRingSize, IORING_OFF_SQ_RING);
+	m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	m_cqRing = mapRing(m_cqRingSize, IORING_OFF_CQ_RING);
+	m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+	m_sqes = (io_uring_sqe*)mapRing(m_sqesSize, IORING_OFF_SQES);
+	if (!m_sqRing || !m_cqRing || !m_sqes)
+	{
+		return false;
+	}
+
+	char* sqRing = (char*)m_sqRing;
+	char* cqRing = (char*)m_cqRing;
+	m_sqEntries = params.sq_entries;
+	m_sqTail = (uint32*)(sqRing + params.sq_off.tail);
+	m_sqMask = (uint32*)(sqRing + params.sq_off.ring_mask);
+	m_sqArray = (uint32*)(sqRing + params.sq_off.array);
+	m_cqHead = (uint32*)(cqRing + params.cq_off.head);
+	m_cqTail = (uint32*)(cqRing + params.cq_off.tail);
+	m_cqMask = (uint32*)(cqRing + params.cq_off.ring_mask);
+	m_cqes = (io_uring_cqe*)(cqRing + params.cq_off.cqes);
+
+	return true;
+}
+
+void BatchFileWriter::CloseRing()
+{
+	if (m_sqes)
+	{
+		munmap(m_sqes, m_sqesSize);
+		m_sqes = nullptr;
+	}
+	if (m_cqRing)
+	{
+		munmap(m_cqRing, m_cqRingSize);
+		m_cqRing = nullptr;
+	}
+	if (m_sqRing)
+	{
+		munmap(m_sqRing, m_sqRingSize);
+		m_sqRing = nullptr;
+	}
+	if (m_ringFd > -1)
+	{
+		close(m_ringFd);
+		m_ringFd = -1;
+	}
+}
+
+/*
+ * Submits all blocks to the ring, keeping up to "m_sqEntries" writes in flight.
+ * Returns false on write errors. If the ring itself fails it is closed and
+ * the blocks not yet written are left for the caller.
+ */
+bool BatchFileWriter::FlushRing(std::vector<bool>& written)
+{
+	uint32 sqMask = *m_sqMask;
+	uint32 cqMask = *m_cqMask;
+	size_t next = 0;
+	uint32 queued = 0;
+	uint32 inFlight = 0;
+	bool ok = true;
+	bool broken = false;
+
+	while ((ok && !broken && next < m_blocks.size()) || (!broken && queued > 0) || inFlight > 0)
+	{
+		uint32 tail = *m_sqTail;
+		while (ok && !broken && next < m_blocks.size() && queued + inFlight < m_sqEntries)
+		{
+			Block& block = m_blocks[next];
+			uint32 index = tail & sqMask;
+			io_uring_sqe* sqe = &m_sqes[index];
+			memset(sqe, 0, sizeof(*sqe));
+			sqe->opcode = IORING_OP_WRITE;
+			sqe->fd = m_fd;
+			sqe->addr = (uint64)(uintptr_t)block.buffer;
+			sqe->len = block.size;
+			sqe->off = block.offset;
+			sqe->user_data = next;
+			m_sqArray[index] = index;
+			tail++;
+			next++;
+			queued++;
+		}
+		__atomic_store_n(m_sqTail, tail, __ATOMIC_RELEASE);
+
+		if (!broken)
+		{
+			int submitted = (int)syscall(__NR_io_uring_enter, m_ringFd, queued, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+			if (submitted < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+			{
+				// stop using the ring but let the writes already in flight finish first
+				broken = true;
+			}
+			else if (submitted > 0)
+			{
+				queued -= submitted;
+				inFlight += submitted;
+			}
+		}
+		else
+		{
+			usleep(1000);
+		}
+
+		uint32 head = *m_cqHead;
+		uint32 cqTail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+		for (; head != cqTail; head++)
+		{
+			io_uring_cqe* cqe = &m_cqes[head & cqMask];
+			size_t index = (size_t)cqe->user_data;
+			Block& block = m_blocks[index];
+			inFlight--;
+
+			if (cqe->res < 0)
+			{
+				errno = -cqe->res;
+				ok = false;
+				continue;
+			}
+
+			// finish short writes synchronously
+			int done = cqe->res;
+			while (done < block.size)
+			{
+				ssize_t res = pwrite(m_fd, block.buffer + done, block.size - done, block.offset + done);
+				if (res <= 0)
+				{
+					break;
+				}
+				done += (int)res;
+			}
+
+			written[index] = done == block.size;
+			ok &= written[index];
+		}
+		__atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+	}
+
+	if (broken)
+	{
+		CloseRing();
+	}
+
+	return ok;
+}
+
+/*
+ * Flushes the file content into disk via the ring. Falls back to a regular
+ * sync of the file if the ring fails.
+ */
+bool BatchFileWriter::SyncRing(CString& errmsg)
+{
+	bool done = false;
+	int res = 0;
+
+	if (m_ringFd > -1)
+	{
+		uint32 tail = *m_sqTail;
+		uint32 index = tail & *m_sqMask;
+		io_uring_sqe* sqe = &m_sqes[index];
+		memset(sqe, 0, sizeof(*sqe));
+		sqe->opcode = IORING_OP_FSYNC;
+		sqe->fd = m_fd;
+#ifdef HAVE_FDATASYNC
+		sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+#endif
+		m_sqArray[index] = index;
+		__atomic_store_n(m_sqTail, tail + 1, __ATOMIC_RELEASE);
+
+		uint32 toSubmit = 1;
+		while (!done)
+		{
+			int submitted = (int)syscall(__NR_io_uring_enter, m_ringFd, toSubmit, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+			if (submitted < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+			{
+				CloseRing();
+				break;
+			}
+			else if (submitted > 0)
+			{
+				toSubmit = 0;
+			}
+
+			uint32 head = *m_cqHead;
+			if (head != __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE))
+			{
+				res = m_cqes[head & *m_cqMask].res;
+				__atomic_store_n(m_cqHead, head + 1, __ATOMIC_RELEASE);
+				done = true;
+			}
+		}
+	}
+
+	if (!done)
+	{
+		return FileSystem::FlushFileBuffers(m_fd, errmsg);
+	}
+
+	if (res < 0)
+	{
+		errno = -res;
+		errmsg = FileSystem::GetLastErrorMessage();
+		return false;
+	}
+
+	return true;
+}
+#endif
@@ -147,4 +147,74 @@ private:
 	FILE* m_file = nullptr;
 };
 
+/*
+ * Writes blocks of data at different positions of an existing file.
+ * On Linux the blocks are submitted to the kernel in batches via io_uring
+ * if the system supports it. Otherwise they are written one by one using
+ * DiskFile, adjacent blocks without seeking.
+ * The buffers passed to "Write" must remain valid until "Flush" or "Close".
+ * "Sync" writes pending blocks and flushes the file content into disk.
+ * The ring is set up on the first "Open" and reused for all files written
+ * by the object until it is destroyed; keep one object per writer thread.
+ */
+class BatchFileWriter
+{
+public:
+	BatchFileWriter() = default;
+	BatchFileWriter(const BatchFileWriter&) = delete;
+	~BatchFileWriter();
+	bool Open(const char* filename);
+	bool Close();
+	bool Active() { return m_active; }
+	void SetWriteBuffer(int size) { m_writeBuffer = size; }
+	void Write(const void* buffer, int size, int64 offset);
+	bool Flush();
+	bool Sync(CString& errmsg);
+
+private:
+	struct Block
+	{
+		const char* buffer;
+		int size;
+		int64 offset;
+	};
+	typedef std::vector<Block> BlockList;
+
+	bool m_active = false;
+	CString m_filename;
+	BlockList m_blocks;
+	DiskFile m_file;
+	int m_writeBuffer = 0;
+	int64 m_filePos = -1;
+
+#ifdef HAVE_IO_URING
+	static const int RING_ENTRIES = 64;
+	int m_fd = -1;
+	int m_ringFd = -1;
+	bool m_ringUnavailable = false;
+	void* m_sqRing = nullptr;
+	size_t m_sqRingSize = 0;
+	void* m_cqRing = nullptr;
+	size_t m_cqRingSize = 0;
+	io_uring_sqe* m_sqes = nullptr;
+	size_t m_sqesSize = 0;
+	uint32 m_sqEntries = 0;
+	uint32* m_sqTail = nullptr;
+	uint32* m_sqMask = nullptr;
+	uint32* m_sqArray = nullptr;
+	uint32* m_cqHead = nullptr;
+	uint32* m_cqTail = nullptr;
+	uint32* m_cqMask = nullptr;
+	io_uring_cqe* m_cqes = nullptr;
+
+	bool InitRing();
+	void CloseRing();
+	bool FlushRing(std::vector<bool>& written);
+	bool SyncRing(CString& errmsg);
+#endif
+
+	bool OpenFile();
+	bool FlushFile(std::vector<bool>& written);
+};
+
 #endif
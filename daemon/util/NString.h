@@ -129,6 +129,7 @@ public:
 	void Reserve(int capacity, bool exact = false);
 	bool Empty() const { return m_length == 0; }
 	void Clear();
+	void Reset() { m_length = 0; if (m_data) m_data[0] = '\0'; }
 	void Append(const char* str, int len = 0);
 	void AppendFmt(const char* format, ...) PRINTF_SYNTAX(2);
 	void AppendFmtV(const char* format, va_list ap);
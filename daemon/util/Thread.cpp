@@ -24,6 +24,15 @@
 
 int Thread::m_threadCount = 1; // take the main program thread into account
 std::unique_ptr<Mutex> Thread::m_threadMutex;
+Mutex* Thread::m_workerMutex = nullptr;
+ConditionVar* Thread::m_workerCond = nullptr;
+Thread::PendingList* Thread::m_pendingThreads = nullptr;
+int Thread::m_idleWorkers = 0;
+
+// How long a finished OS-thread waits for the next Thread-object before it exits
+static const int WORKER_IDLE_TIME = 10000;
+// How many finished OS-threads may wait at the same time, others exit at once
+static const int MAX_IDLE_WORKERS = 16;
 
 
 void Thread::Init()
@@ -31,6 +40,12 @@ void Thread::Init()
 	debug("Initializing global thread data");
 
 	m_threadMutex = std::make_unique<Mutex>();
+
+	// NOTE: the worker data is never freed because idle workers may still be
+	// waiting on it while the program terminates
+	m_workerMutex = new Mutex();
+	m_workerCond = new ConditionVar();
+	m_pendingThreads = new PendingList();
 }
 
 Thread::Thread()
@@ -49,22 +64,36 @@ void Thread::Start()
 
 	m_running = true;
 
+	{
+		// hand the object over to an idle worker if there is one
+		Guard guard(m_workerMutex);
+		if (m_idleWorkers > (int)m_pendingThreads->size())
+		{
+			m_pendingThreads->push_back(this);
+			m_workerCond->NotifyOne();
+			return;
+		}
+	}
+
 	// NOTE: "m_threadMutex" ensures that "t" lives until the very end of the function
 	Guard guard(m_threadMutex);
 
 	// start the new thread
-	std::thread t([&]{
+	std::thread t([this]{
 		{
 			// trying to lock "m_threadMutex", this will wait until function "Start()" is completed
 			// and "t" is detached.
 			Guard guard(m_threadMutex);
 		}
 
-		thread_handler();
+		worker_handler(this);
 	});
 
 	// save the native handle to be able to cancel (Kill) the thread and then detach
-	m_threadObj = t.native_handle();
+	{
+		Guard workerGuard(m_workerMutex);
+		m_threadObj = t.native_handle();
+	}
 	t.detach();
 }
 
@@ -87,6 +116,22 @@ bool Thread::Kill()
 	debug("Killing Thread");
 
 	Guard guard(m_threadMutex);
+	Guard workerGuard(m_workerMutex);
+
+	PendingList::iterator pos = std::find(m_pendingThreads->begin(), m_pendingThreads->end(), this);
+	if (pos != m_pendingThreads->end())
+	{
+		// not yet picked up by a worker, there is nothing to cancel
+		m_pendingThreads->erase(pos);
+		m_running = false;
+		return true;
+	}
+
+	if (!m_threadObj)
+	{
+		// the thread has already finished, the worker may be running another object now
+		return false;
+	}
 
 #ifdef WIN32
 	bool terminated = TerminateThread(m_threadObj, 0) != 0;
@@ -101,6 +146,7 @@ bool Thread::Kill()
 
 	if (terminated)
 	{
+		m_threadObj = 0;
 		m_threadCount--;
 	}
 	return terminated;
@@ -116,6 +162,12 @@ void Thread::thread_handler()
 
 	debug("Thread-func exited");
 
+	{
+		// the worker may run another object from now on
+		Guard workerGuard(m_workerMutex);
+		m_threadObj = 0;
+	}
+
 	m_running = false;
 
 	m_threadCount--;
@@ -127,6 +179,50 @@ void Thread::thread_handler()
 	}
 }
 
+/*
+ * Runs Thread-objects one after another on the same OS-thread. Short living threads
+ * (such as article downloaders) are started very often; reusing the OS-threads
+ * avoids the costs of creating and destroying them for every object.
+ * The number of workers follows the number of Thread-objects running at the same
+ * time, for downloads that is the number of active connections: connections,
+ * TLS sockets and decoders use blocking I/O and need a thread each while busy.
+ * Only a limited number of finished workers stay parked for the next object.
+ */
+void Thread::worker_handler(Thread* thread)
+{
+	std::thread::native_handle_type threadObj;
+	{
+		Guard guard(m_workerMutex);
+		threadObj = thread->m_threadObj;
+	}
+
+	while (thread)
+	{
+		thread->thread_handler();
+		thread = nullptr;
+
+		Guard guard(m_workerMutex);
+		if (m_idleWorkers >= MAX_IDLE_WORKERS)
+		{
+			// a spike of connections is over, don't keep all its threads parked
+			break;
+		}
+
+		m_idleWorkers++;
+		m_workerCond->WaitFor(*m_workerMutex, WORKER_IDLE_TIME,
+			[]{ return !m_pendingThreads->empty(); });
+		m_idleWorkers--;
+
+		if (!m_pendingThreads->empty())
+		{
+			// publish the handle while still under the lock, "Kill" relies on it
+			thread = m_pendingThreads->front();
+			m_pendingThreads->pop_front();
+			thread->m_threadObj = threadObj;
+		}
+	}
+}
+
 int Thread::GetThreadCount()
 {
 	Guard guard(m_threadMutex);
@@ -123,14 +123,21 @@ protected:
 	virtual void Run() {}; // Virtual function - override in derivatives
 
 private:
+	typedef std::deque<Thread*> PendingList;
+
 	static std::unique_ptr<Mutex> m_threadMutex;
 	static int m_threadCount;
+	static Mutex* m_workerMutex;
+	static ConditionVar* m_workerCond;
+	static PendingList* m_pendingThreads;
+	static int m_idleWorkers;
 	std::thread::native_handle_type m_threadObj = 0;
 	bool m_running = false;
 	bool m_stopped = false;
 	bool m_autoDestroy = false;
 
 	void thread_handler();
+	static void worker_handler(Thread* thread);
 };
 
 #endif
@@ -676,9 +676,10 @@ int64 Util::CurrentTicks()
 	QueryPerformanceCounter((LARGE_INTEGER*)&t);
 	return ((t-hzo)*1000000)/hz;
 #else
-	timeval t;
-	gettimeofday(&t, nullptr);
-	return (int64)(t.tv_sec) * 1000000ll + (int64)(t.tv_usec);
+	// monotonic clock, not affected by changes of system time
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (int64)(t.tv_sec) * 1000000ll + (int64)(t.tv_nsec) / 1000;
 #endif
 }
 
@@ -1796,6 +1797,60 @@ GUnzipStream::EStatus GUnzipStream::Read(const void **outputBuffer, int *outputB
 
 	return zlError;
 }
+
+GZipStream::GZipStream(int BufferSize) :
+	m_bufferSize(BufferSize)
+{
+	m_outputBuffer = std::make_unique<Bytef[]>(BufferSize);
+
+	/* add 16 to MAX_WBITS to enforce gzip format */
+	int ret = deflateInit2(&m_zStream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, MAX_WBITS + 16, MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY);
+	m_active = ret == Z_OK;
+}
+
+GZipStream::~GZipStream()
+{
+	if (m_active)
+	{
+		deflateEnd(&m_zStream);
+	}
+}
+
+void GZipStream::Write(const void *inputBuffer, int inputBufferLength, bool finish)
+{
+	m_zStream.next_in = (Bytef*)inputBuffer;
+	m_zStream.avail_in = inputBufferLength;
+	m_finish = finish;
+}
+
+GZipStream::EStatus GZipStream::Read(const void **outputBuffer, int *outputBufferLength)
+{
+	m_zStream.next_out = (Bytef*)m_outputBuffer.get();
+	m_zStream.avail_out = m_bufferSize;
+
+	*outputBufferLength = 0;
+
+	if (!m_active)
+	{
+		return zlError;
+	}
+
+	int ret = deflate(&m_zStream, m_finish ? Z_FINISH : Z_NO_FLUSH);
+
+	switch (ret)
+	{
+		case Z_STREAM_END:
+		case Z_OK:
+			*outputBufferLength = m_bufferSize - m_zStream.avail_out;
+			*outputBuffer = m_outputBuffer.get();
+			return ret == Z_STREAM_END ? zlFinished : zlOK;
+
+		case Z_BUF_ERROR:
+			return zlOK;
+	}
+
+	return zlError;
+}
 #endif
 
 Tokenizer::Tokenizer(const char* dataString, const char* separators) :
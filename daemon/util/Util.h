@@ -296,6 +296,39 @@ private:
 	int m_bufferSize;
 	bool m_active = false;
 };
+
+class GZipStream
+{
+public:
+	enum EStatus
+	{
+		zlError,
+		zlFinished,
+		zlOK
+	};
+
+	GZipStream(int BufferSize);
+	~GZipStream();
+
+	/*
+	* set next memory block for compression.
+	* bFinish - the block is the last one, the stream is finalized after it.
+	*/
+	void Write(const void *inputBuffer, int inputBufferLength, bool finish);
+
+	/*
+	* get next compressed memory block.
+	* iOutputBufferLength - the size of compressed block. if it is "0" the next block must be provided via "Write".
+	*/
+	EStatus Read(const void **outputBuffer, int *outputBufferLength);
+
+private:
+	z_stream m_zStream = {0};
+	std::unique_ptr<Bytef[]> m_outputBuffer;
+	int m_bufferSize;
+	bool m_active = false;
+	bool m_finish = false;
+};
 #endif
 
 class Tokenizer
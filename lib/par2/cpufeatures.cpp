@@ -0,0 +1,96 @@
+//  This file is part of par2cmdline (a PAR 2.0 compatible file verification and
+//  repair tool). See http://parchive.sourceforge.net for details of PAR 2.0.
+//
+//  Copyright (c) 2003 Peter Brian Clements
+//
+//  par2cmdline is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  par2cmdline is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#include "nzbget.h"
+#include "par2cmdline.h"
+
+#if (defined(__i686__) || defined(__amd64__)) && !defined(WIN32)
+#include <cpuid.h>
+#endif
+
+namespace Par2
+{
+
+#if defined(__i686__) || defined(__amd64__)
+class CpuId
+{
+  u32 regs[4];
+public:
+  CpuId(u32 level, u32 sublevel = 0)
+  {
+#ifdef WIN32
+    __cpuidex((int *)regs, (int)level, (int)sublevel);
+#else
+    __cpuid_count(level, sublevel, regs[0], regs[1], regs[2], regs[3]);
+#endif
+  }
+  const u32 &EAX() const {return regs[0];}
+  const u32 &EBX() const {return regs[1];}
+  const u32 &ECX() const {return regs[2];}
+  const u32 &EDX() const {return regs[3];}
+};
+
+// Register state components enabled by the OS (XCR0)
+static u64 GetEnabledXState()
+{
+#ifdef WIN32
+  return _xgetbv(0);
+#else
+  u32 eax, edx;
+  __asm__ ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return ((u64)edx << 32) | eax;
+#endif
+}
+#endif
+
+CpuFeatures::CpuFeatures(void)
+{
+#if defined(__i686__) || defined(__amd64__)
+  CpuId cpuid1(1);
+  CpuId cpuid7(7);
+
+  bool cpu_supports_ssse3 = cpuid1.ECX() & 0x00000200;
+  bool os_supports_xsave = cpuid1.ECX() & 0x08000000;
+  u64 xstate = os_supports_xsave ? GetEnabledXState() : 0;
+  bool os_supports_avx = (xstate & 0x06) == 0x06;
+  bool os_supports_avx512 = (xstate & 0xE6) == 0xE6;
+  bool cpu_supports_avx2 = CpuId(0).EAX() >= 7 && (cpuid7.EBX() & 0x00000020);
+  bool cpu_supports_avx512bw = CpuId(0).EAX() >= 7 &&
+    (cpuid7.EBX() & 0x00010000) && (cpuid7.EBX() & 0x40000000);
+
+  ssse3 = cpu_supports_ssse3;
+  avx2 = cpu_supports_avx2 && os_supports_avx;
+  avx512bw = cpu_supports_avx512bw && os_supports_avx512;
+#endif
+
+#if (defined(__arm__) || defined(__aarch64__)) && defined(__linux__)
+  if (FILE* file = fopen("/proc/cpuinfo", "r"))
+  {
+    char buf[200];
+    while (fgets(buf, sizeof(buf), file))
+    {
+      neon |= !strncasecmp(buf, "Features", 8) &&
+        (strstr(buf, " neon ") || strstr(buf, " asimd "));
+    }
+    fclose(file);
+  }
+#endif
+}
+
+} // end namespace Par2
@@ -0,0 +1,43 @@
+//  This file is part of par2cmdline (a PAR 2.0 compatible file verification and
+//  repair tool). See http://parchive.sourceforge.net for details of PAR 2.0.
+//
+//  Copyright (c) 2003 Peter Brian Clements
+//
+//  par2cmdline is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  par2cmdline is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#ifndef __CPUFEATURES_H__
+#define __CPUFEATURES_H__
+
+namespace Par2
+{
+
+// Instruction set extensions supported by the CPU and enabled by the OS.
+// The SIMD kernels of galois multiplication and MD5 are selected with them
+// by Galois16SimdInit() and MD5SimdInit().
+
+class CpuFeatures
+{
+public:
+  CpuFeatures(void);
+
+  bool ssse3 = false;
+  bool avx2 = false;
+  bool avx512bw = false;
+  bool neon = false;
+};
+
+} // end namespace Par2
+
+#endif // __CPUFEATURES_H__
@@ -19,6 +19,7 @@
 
 #include "nzbget.h"
 #include "par2cmdline.h"
+#include "Util.h"
 
 #ifdef _MSC_VER
 #ifdef _DEBUG
@@ -36,17 +37,27 @@ namespace Par2
 FileCheckSummer::FileCheckSummer(DiskFile   *_diskfile,
                                  u64         _blocksize,
                                  const u32 (&_windowtable)[256],
-                                 u32         _windowmask)
+                                 u32         _windowmask,
+                                 u64         _hashahead)
 : diskfile(_diskfile)
 , blocksize(_blocksize)
 , windowtable(_windowtable)
 , windowmask(_windowmask)
 {
-  buffer = new char[(size_t)blocksize*2];
+  hashlanes = (size_t)max((u64)1, min((u64)MD5Lanes(), _hashahead / blocksize));
+  hashes.resize(hashlanes);
+  hashcount = 0;
+  hashoffset = 0;
+
+  buffersize = (size_t)blocksize * (hashlanes+1);
+  buffer = new char[buffersize];
 
   filesize = diskfile->FileSize();
 
   currentoffset = 0;
+  candidatelane = candidateindex = 0;
+  scannedoffset = 0;
+  scannedchecksum = 0;
 }
 
 FileCheckSummer::~FileCheckSummer(void)
@@ -59,6 +70,11 @@ bool FileCheckSummer::Start(void)
 {
   currentoffset = readoffset = 0;
 
+  for (vector<ScanCandidate> &lane : candidates)
+    lane.clear();
+  candidatelane = candidateindex = 0;
+  scannedoffset = 0;
+
   tailpointer = outpointer = buffer;
   inpointer = &buffer[blocksize];
 
@@ -67,7 +83,7 @@ bool FileCheckSummer::Start(void)
     return false;
 
   // Compute the checksum for the block
-  checksum = ~0 ^ CRCUpdateBlock(~0, (size_t)blocksize, buffer);
+  checksum = BlockChecksum(buffer);
 
   return true;
 }
@@ -106,31 +122,161 @@ bool FileCheckSummer::Jump(u64 distance)
   outpointer += distance;
   assert(outpointer <= tailpointer);
 
-  // Is there any data left in the buffer that we are keeping
-  size_t keep = tailpointer - outpointer;
-  if (keep > 0)
+  // Does the window still fit into the buffer
+  if ((size_t)(outpointer - buffer) + blocksize < buffersize)
   {
-    // Move it back to the start of the buffer
-    memmove(buffer, outpointer, keep);
-    tailpointer = &buffer[keep];
+    inpointer = &outpointer[blocksize];
   }
   else
   {
-    tailpointer = buffer;
-  }
+    // Is there any data left in the buffer that we are keeping
+    size_t keep = tailpointer - outpointer;
+    if (keep > 0)
+    {
+      // Move it back to the start of the buffer
+      memmove(buffer, outpointer, keep);
+      tailpointer = &buffer[keep];
+    }
+    else
+    {
+      tailpointer = buffer;
+    }
 
-  outpointer = buffer;
-  inpointer = &buffer[blocksize];
+    outpointer = buffer;
+    inpointer = &buffer[blocksize];
 
-  if (!Fill())
-    return false;
+    if (!Fill())
+      return false;
+  }
 
   // Compute the checksum for the block
-  checksum = ~0 ^ CRCUpdateBlock(~0, (size_t)blocksize, buffer);
+  checksum = BlockChecksum(outpointer);
 
   return true;
 }
 
+// Slide the window through data which doesn't match any block, stopping at
+// the next candidate found by ScanBuffer. If there is none the window is moved
+// to the end of the scanned data, which also refills the buffer.
+bool FileCheckSummer::Scan(const VerificationHashTable &table)
+{
+  // Are we already at the end of the file
+  if (currentoffset >= filesize)
+    return false;
+
+  for (;;)
+  {
+    // Skip the candidates which were passed
+    while (candidatelane < scanlanes)
+    {
+      vector<ScanCandidate> &lane = candidates[candidatelane];
+      while (candidateindex < lane.size() && lane[candidateindex].offset <= currentoffset)
+        candidateindex++;
+
+      if (candidateindex < lane.size())
+      {
+        const ScanCandidate &candidate = lane[candidateindex++];
+        return Advance(candidate.offset - currentoffset, candidate.checksum);
+      }
+
+      candidatelane++;
+      candidateindex = 0;
+    }
+
+    if (scannedoffset > currentoffset)
+      return Advance(scannedoffset - currentoffset, scannedchecksum);
+
+    // Nothing left to scan in the buffer
+    if (currentoffset + 1 >= filesize || inpointer + 1 >= &buffer[buffersize])
+      return Step();
+
+    ScanBuffer(table);
+  }
+}
+
+// The rolling checksum depends on the previous position, so the positions
+// are split into lanes which start with a checksum computed from scratch and
+// then roll side by side.
+void FileCheckSummer::ScanBuffer(const VerificationHashTable &table)
+{
+  // Positions whose window lies within the buffer and the file
+  size_t count = (size_t)min((u64)(&buffer[buffersize] - inpointer), filesize-currentoffset-1);
+
+  // Starting a lane costs much less than rolling through a block
+  size_t length = count >= blocksize ? count / scanlanes : 0;
+
+  const u8 *in = (const u8*)inpointer;
+  const u8 *out = (const u8*)outpointer;
+
+  for (vector<ScanCandidate> &lane : candidates)
+    lane.clear();
+  candidatelane = candidateindex = 0;
+
+  auto roll = [&](u32 &crc, size_t position, vector<ScanCandidate> &found)
+  {
+    crc = CRCSlideChar(crc, in[position], out[position], windowtable);
+    if (table.MayContain(windowmask ^ crc))
+    {
+      ScanCandidate candidate = {currentoffset + position + 1, windowmask ^ crc};
+      found.push_back(candidate);
+    }
+  };
+
+  u32 crc0 = windowmask ^ checksum;
+  u32 crc3 = crc0;
+  if (length > 0)
+  {
+    u32 crc1 = windowmask ^ BlockChecksum(&outpointer[length]);
+    u32 crc2 = windowmask ^ BlockChecksum(&outpointer[length*2]);
+    crc3 = windowmask ^ BlockChecksum(&outpointer[length*3]);
+
+    for (size_t i = 0; i < length; i++)
+    {
+      roll(crc0, i, candidates[0]);
+      roll(crc1, length + i, candidates[1]);
+      roll(crc2, length*2 + i, candidates[2]);
+      roll(crc3, length*3 + i, candidates[3]);
+    }
+  }
+
+  // The last lane continues through the remaining positions
+  for (size_t position = length*scanlanes; position < count; position++)
+  {
+    roll(crc3, position, candidates[scanlanes-1]);
+  }
+
+  scannedoffset = currentoffset + count;
+  scannedchecksum = windowmask ^ crc3;
+}
+
+bool FileCheckSummer::Advance(u64 distance, u32 newchecksum)
+{
+  currentoffset += distance;
+  outpointer += distance;
+  inpointer += distance;
+  checksum = newchecksum;
+
+  // Can the window slide further
+  if (inpointer < &buffer[buffersize])
+    return true;
+
+  // Copy the data back to the beginning of the buffer
+  memmove(buffer, outpointer, (size_t)blocksize);
+  tailpointer -= outpointer - buffer;
+  inpointer = &buffer[blocksize];
+  outpointer = buffer;
+
+  // Fill the rest of the buffer
+  return Fill();
+}
+
+u32 FileCheckSummer::BlockChecksum(const char *data) const
+{
+  Crc32 crc;
+  crc.Append((uchar*)data, (uint32)blocksize);
+  return crc.Finish();
+}
+
 // Fill the buffer from disk
 
 bool FileCheckSummer::Fill(void)
@@ -140,7 +286,7 @@ bool FileCheckSummer::Fill(void)
     return true;
 
   // How much data can we read into the buffer
-  size_t want = (size_t)min(filesize-readoffset, (u64)(&buffer[2*blocksize]-tailpointer));
+  size_t want = (size_t)min(filesize-readoffset, (u64)(&buffer[buffersize]-tailpointer));
 
   if (want > 0)
   {
@@ -154,7 +300,7 @@ bool FileCheckSummer::Fill(void)
   }
 
   // Did we fill the buffer
-  want = &buffer[2*blocksize] - tailpointer;
+  want = &buffer[buffersize] - tailpointer;
   if (want > 0)
   {
     // Blank the rest of the buffer
@@ -218,13 +364,27 @@ void FileCheckSummer::GetFileHashes(MD5Hash &hashfull, MD5Hash &hash16k) const
 // Compute and return the current hash
 MD5Hash FileCheckSummer::Hash(void)
 {
-  MD5Context context;
-  context.Update(outpointer, (size_t)blocksize);
+  // Has the hash already been computed ahead
+  if (hashcount > 0 && currentoffset >= hashoffset && (currentoffset-hashoffset) % blocksize == 0)
+  {
+    u64 index = (currentoffset-hashoffset) / blocksize;
+    if (index < hashcount)
+      return hashes[(size_t)index];
+  }
 
-  MD5Hash hash;
-  context.Final(hash);
+  // Hash the window together with the whole blocks following it
+  vector<const void*> blocks;
+  do
+  {
+    blocks.push_back(&outpointer[blocks.size()*blocksize]);
+  } while (blocks.size() < hashlanes && (size_t)(tailpointer - outpointer) >= (blocks.size()+1)*blocksize);
 
-  return hash;
+  size_t count = blocks.size();
+  MD5HashBuffers(&blocks[0], count, (size_t)blocksize, &hashes[0]);
+  hashoffset = currentoffset;
+  hashcount = count;
+
+  return hashes[0];
 }
 
 u32 FileCheckSummer::ShortChecksum(u64 blocklength)
@@ -23,6 +23,8 @@
 namespace Par2
 {
 
+class VerificationHashTable;
+
 // This source file defines the FileCheckSummer object which is used
 // when scanning a data file to find blocks of undamaged data.
 //
@@ -35,6 +37,14 @@ namespace Par2
 // block of data is expected to start. Whilst the file is being scanned
 // the object also computes the MD5 Hash of the whole file and of
 // the first 16k of the file for later tests.
+//
+// The buffer holds several blocks ahead of the window. When the hash of
+// the window is needed, the whole blocks following it are hashed as well
+// using the multi-buffer MD5, since an undamaged file asks for them next.
+//
+// Through damaged data the window is moved by Scan. It rolls the checksum
+// over all positions in the buffer at once, in several independent lanes,
+// and remembers the positions whose checksum may belong to a block.
 
 class FileCheckSummer
 {
@@ -42,9 +52,13 @@ public:
   FileCheckSummer(DiskFile   *diskfile,
                   u64         blocksize,
                   const u32 (&windowtable)[256],
-                  u32         windowmask);
+                  u32         windowmask,
+                  u64         hashahead = MaxHashAhead);
   ~FileCheckSummer(void);
 
+  // How much data may be hashed ahead of the window by default
+  static const u64 MaxHashAhead = 8*1024*1024;
+
   // Start reading the file at the beginning
   bool Start(void);
 
@@ -54,10 +68,13 @@ public:
   // Step forward one byte
   bool Step(void);
 
+  // Step forward at least one byte, until the checksum may be found in the table
+  bool Scan(const VerificationHashTable &table);
+
   // Return the current checksum
   u32 Checksum(void) const;
 
-  // Compute and return the current hash
+  // Compute and return the current hash (or the one computed ahead)
   MD5Hash Hash(void);
 
   // Compute short values of checksum and hash
@@ -86,6 +103,7 @@ protected:
   u64         filesize;
 
   u64         currentoffset; // file offset for current window position
+  size_t      buffersize;    // blocksize * (hashlanes+1)
   char       *buffer;        // buffer for reading from the file
   char       *outpointer;    // position in buffer of scan window
   char       *inpointer;     // &outpointer[blocksize];
@@ -101,7 +119,35 @@ protected:
   MD5Context  contextfull;
   MD5Context  context16k;
 
+  // Hashes of the blocks at hashoffset, hashoffset+blocksize, ...
+  size_t          hashlanes;
+  u64             hashoffset;
+  size_t          hashcount;
+  vector<MD5Hash> hashes;
+
+  // Positions found by Scan which may match a block
+  struct ScanCandidate
+  {
+    u64 offset;
+    u32 checksum;
+  };
+  static const size_t scanlanes = 4;
+  vector<ScanCandidate> candidates[scanlanes];
+  size_t      candidatelane;
+  size_t      candidateindex;
+  u64         scannedoffset; // all positions up to here were scanned
+  u32         scannedchecksum;
+
 protected:
+  // Compute the checksum of a whole block
+  u32 BlockChecksum(const char *data) const;
+
+  // Roll the checksum through all positions in the buffer collecting candidates
+  void ScanBuffer(const VerificationHashTable &table);
+
+  // Move the window forward within the buffer
+  bool Advance(u64 distance, u32 newchecksum);
+
   //void ComputeCurrentCRC(void);
   void UpdateHashes(u64 offset, const void *buffer, size_t length);
 
@@ -162,16 +208,16 @@ inline bool FileCheckSummer::Step(void)
   checksum = windowmask ^ CRCSlideChar(windowmask ^ checksum, inch, outch, windowtable);
 
   // Can the window slide further
-  if (outpointer < &buffer[blocksize])
+  if (inpointer < &buffer[buffersize])
     return true;
 
-  assert(outpointer == &buffer[blocksize]);
+  assert(inpointer == &buffer[buffersize]);
 
   // Copy the data back to the beginning of the buffer
   memmove(buffer, outpointer, (size_t)blocksize);
-  inpointer = outpointer;
+  tailpointer -= outpointer - buffer;
+  inpointer = &buffer[blocksize];
   outpointer = buffer;
-  tailpointer -= blocksize;
 
   // Fill the rest of the buffer
   return Fill();
@@ -0,0 +1,90 @@
+//  This file is part of par2cmdline (a PAR 2.0 compatible file verification and
+//  repair tool). See http://parchive.sourceforge.net for details of PAR 2.0.
+//
+//  Copyright (c) 2003 Peter Brian Clements
+//
+//  par2cmdline is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  par2cmdline is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#include "nzbget.h"
+#include "galoissimd.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace Par2
+{
+
+#ifdef __AVX2__
+// Same as the SSSE3 kernel with 256-bit vectors. The byte shuffle, the
+// packing and the unpacking work within 128-bit lanes, so the tables are
+// repeated in both lanes and the values keep their order.
+static void Galois16MulAddAvx2(const Galois16NibbleTables &tables, const void *inputbuffer, void *outputbuffer, size_t size)
+{
+  const __m256i tlo0 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)tables.lo[0]));
+  const __m256i tlo1 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)tables.lo[1]));
+  const __m256i tlo2 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)tables.lo[2]));
+  const __m256i tlo3 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)tables.lo[3]));
+  const __m256i thi0 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)tables.hi[0]));
+  const __m256i thi1 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)tables.hi[1]));
+  const __m256i thi2 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)tables.hi[2]));
+  const __m256i thi3 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)tables.hi[3]));
+  const __m256i nibblemask = _mm256_set1_epi8(0x0f);
+  const __m256i lowmask = _mm256_set1_epi16(0x00ff);
+
+  const uint8_t *src = (const uint8_t*)inputbuffer;
+  uint8_t *dst = (uint8_t*)outputbuffer;
+  const uint8_t *end = src + (size & ~(size_t)63);
+
+  for (; src < end; src += 64, dst += 64)
+  {
+    __m256i a = _mm256_loadu_si256((const __m256i*)src);
+    __m256i b = _mm256_loadu_si256((const __m256i*)(src + 32));
+
+    __m256i lo = _mm256_packus_epi16(_mm256_and_si256(a, lowmask), _mm256_and_si256(b, lowmask));
+    __m256i hi = _mm256_packus_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8));
+
+    __m256i n0 = _mm256_and_si256(lo, nibblemask);
+    __m256i n1 = _mm256_and_si256(_mm256_srli_epi16(lo, 4), nibblemask);
+    __m256i n2 = _mm256_and_si256(hi, nibblemask);
+    __m256i n3 = _mm256_and_si256(_mm256_srli_epi16(hi, 4), nibblemask);
+
+    __m256i plo = _mm256_xor_si256(
+      _mm256_xor_si256(_mm256_shuffle_epi8(tlo0, n0), _mm256_shuffle_epi8(tlo1, n1)),
+      _mm256_xor_si256(_mm256_shuffle_epi8(tlo2, n2), _mm256_shuffle_epi8(tlo3, n3)));
+    __m256i phi = _mm256_xor_si256(
+      _mm256_xor_si256(_mm256_shuffle_epi8(thi0, n0), _mm256_shuffle_epi8(thi1, n1)),
+      _mm256_xor_si256(_mm256_shuffle_epi8(thi2, n2), _mm256_shuffle_epi8(thi3, n3)));
+
+    __m256i da = _mm256_loadu_si256((const __m256i*)dst);
+    __m256i db = _mm256_loadu_si256((const __m256i*)(dst + 32));
+    _mm256_storeu_si256((__m256i*)dst, _mm256_xor_si256(da, _mm256_unpacklo_epi8(plo, phi)));
+    _mm256_storeu_si256((__m256i*)(dst + 32), _mm256_xor_si256(db, _mm256_unpackhi_epi8(plo, phi)));
+  }
+
+  Galois16MulAddScalar(tables, (const uint16_t*)src, (uint16_t*)dst, (size & 63) / 2);
+}
+#endif
+
+Galois16MulAddFunc Galois16KernelAvx2(void)
+{
+#ifdef __AVX2__
+  return &Galois16MulAddAvx2;
+#else
+  return nullptr;
+#endif
+}
+
+} // end namespace Par2
@@ -0,0 +1,91 @@
+//  This file is part of par2cmdline (a PAR 2.0 compatible file verification and
+//  repair tool). See http://parchive.sourceforge.net for details of PAR 2.0.
+//
+//  Copyright (c) 2003 Peter Brian Clements
+//
+//  par2cmdline is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  par2cmdline is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#include "nzbget.h"
+#include "galoissimd.h"
+
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+#include <immintrin.h>
+#endif
+
+namespace Par2
+{
+
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+// Same as the AVX2 kernel with 512-bit vectors; the four lookups are summed
+// with three-way XORs (ternary logic 0x96). Tables are broadcast with the
+// zero-masking form and an all-set mask; the plain form makes GCC 12 warn
+// about uninitialized lanes.
+static void Galois16MulAddAvx512(const Galois16NibbleTables &tables, const void *inputbuffer, void *outputbuffer, size_t size)
+{
+  const __m512i tlo0 = _mm512_maskz_broadcast_i32x4(0xFFFF, _mm_loadu_si128((const __m128i*)tables.lo[0]));
+  const __m512i tlo1 = _mm512_maskz_broadcast_i32x4(0xFFFF, _mm_loadu_si128((const __m128i*)tables.lo[1]));
+  const __m512i tlo2 = _mm512_maskz_broadcast_i32x4(0xFFFF, _mm_loadu_si128((const __m128i*)tables.lo[2]));
+  const __m512i tlo3 = _mm512_maskz_broadcast_i32x4(0xFFFF, _mm_loadu_si128((const __m128i*)tables.lo[3]));
+  const __m512i thi0 = _mm512_maskz_broadcast_i32x4(0xFFFF, _mm_loadu_si128((const __m128i*)tables.hi[0]));
+  const __m512i thi1 = _mm512_maskz_broadcast_i32x4(0xFFFF, _mm_loadu_si128((const __m128i*)tables.hi[1]));
+  const __m512i thi2 = _mm512_maskz_broadcast_i32x4(0xFFFF, _mm_loadu_si128((const __m128i*)tables.hi[2]));
+  const __m512i thi3 = _mm512_maskz_broadcast_i32x4(0xFFFF, _mm_loadu_si128((const __m128i*)tables.hi[3]));
+  const __m512i nibblemask = _mm512_set1_epi8(0x0f);
+  const __m512i lowmask = _mm512_set1_epi16(0x00ff);
+
+  const uint8_t *src = (const uint8_t*)inputbuffer;
+  uint8_t *dst = (uint8_t*)outputbuffer;
+  const uint8_t *end = src + (size & ~(size_t)127);
+
+  for (; src < end; src += 128, dst += 128)
+  {
+    __m512i a = _mm512_loadu_si512((const void*)src);
+    __m512i b = _mm512_loadu_si512((const void*)(src + 64));
+
+    __m512i lo = _mm512_packus_epi16(_mm512_and_si512(a, lowmask), _mm512_and_si512(b, lowmask));
+    __m512i hi = _mm512_packus_epi16(_mm512_srli_epi16(a, 8), _mm512_srli_epi16(b, 8));
+
+    __m512i n0 = _mm512_and_si512(lo, nibblemask);
+    __m512i n1 = _mm512_and_si512(_mm512_srli_epi16(lo, 4), nibblemask);
+    __m512i n2 = _mm512_and_si512(hi, nibblemask);
+    __m512i n3 = _mm512_and_si512(_mm512_srli_epi16(hi, 4), nibblemask);
+
+    __m512i plo = _mm512_ternarylogic_epi32(_mm512_shuffle_epi8(tlo0, n0),
+      _mm512_shuffle_epi8(tlo1, n1), _mm512_shuffle_epi8(tlo2, n2), 0x96);
+    plo = _mm512_xor_si512(plo, _mm512_shuffle_epi8(tlo3, n3));
+    __m512i phi = _mm512_ternarylogic_epi32(_mm512_shuffle_epi8(thi0, n0),
+      _mm512_shuffle_epi8(thi1, n1), _mm512_shuffle_epi8(thi2, n2), 0x96);
+    phi = _mm512_xor_si512(phi, _mm512_shuffle_epi8(thi3, n3));
+
+    __m512i da = _mm512_loadu_si512((const void*)dst);
+    __m512i db = _mm512_loadu_si512((const void*)(dst + 64));
+    _mm512_storeu_si512((void*)dst, _mm512_xor_si512(da, _mm512_unpacklo_epi8(plo, phi)));
+    _mm512_storeu_si512((void*)(dst + 64), _mm512_xor_si512(db, _mm512_unpackhi_epi8(plo, phi)));
+  }
+
+  Galois16MulAddScalar(tables, (const uint16_t*)src, (uint16_t*)dst, (size & 127) / 2);
+}
+#endif
+
+Galois16MulAddFunc Galois16KernelAvx512(void)
+{
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+  return &Galois16MulAddAvx512;
+#else
+  return nullptr;
+#endif
+}
+
+} // end namespace Par2
@@ -0,0 +1,109 @@
+//  This file is part of par2cmdline (a PAR 2.0 compatible file verification and
+//  repair tool). See http://parchive.sourceforge.net for details of PAR 2.0.
+//
+//  Copyright (c) 2003 Peter Brian Clements
+//
+//  par2cmdline is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  par2cmdline is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#include "nzbget.h"
+#include "galoissimd.h"
+
+#if (defined(__ARM_NEON) || defined(__ARM_NEON__)) && !defined(__ARM_BIG_ENDIAN)
+#define GALOIS_NEON
+#include <arm_neon.h>
+#endif
+
+namespace Par2
+{
+
+#ifdef GALOIS_NEON
+#ifdef __aarch64__
+typedef uint8x16_t NibbleTable;
+
+static inline NibbleTable LoadTable(const uint8_t *table)
+{
+  return vld1q_u8(table);
+}
+
+static inline uint8x16_t Lookup(NibbleTable table, uint8x16_t index)
+{
+  return vqtbl1q_u8(table, index);
+}
+#else
+typedef uint8x8x2_t NibbleTable;
+
+static inline NibbleTable LoadTable(const uint8_t *table)
+{
+  NibbleTable result = {{vld1_u8(table), vld1_u8(table + 8)}};
+  return result;
+}
+
+static inline uint8x16_t Lookup(NibbleTable table, uint8x16_t index)
+{
+  return vcombine_u8(vtbl2_u8(table, vget_low_u8(index)), vtbl2_u8(table, vget_high_u8(index)));
+}
+#endif
+
+// The structure loads and stores (VLD2/VST2) separate the low and the high
+// bytes of the values and join them back.
+static void Galois16MulAddNeon(const Galois16NibbleTables &tables, const void *inputbuffer, void *outputbuffer, size_t size)
+{
+  const NibbleTable tlo0 = LoadTable(tables.lo[0]);
+  const NibbleTable tlo1 = LoadTable(tables.lo[1]);
+  const NibbleTable tlo2 = LoadTable(tables.lo[2]);
+  const NibbleTable tlo3 = LoadTable(tables.lo[3]);
+  const NibbleTable thi0 = LoadTable(tables.hi[0]);
+  const NibbleTable thi1 = LoadTable(tables.hi[1]);
+  const NibbleTable thi2 = LoadTable(tables.hi[2]);
+  const NibbleTable thi3 = LoadTable(tables.hi[3]);
+  const uint8x16_t nibblemask = vdupq_n_u8(0x0f);
+
+  const uint8_t *src = (const uint8_t*)inputbuffer;
+  uint8_t *dst = (uint8_t*)outputbuffer;
+  const uint8_t *end = src + (size & ~(size_t)31);
+
+  for (; src < end; src += 32, dst += 32)
+  {
+    uint8x16x2_t s = vld2q_u8(src);
+
+    uint8x16_t n0 = vandq_u8(s.val[0], nibblemask);
+    uint8x16_t n1 = vshrq_n_u8(s.val[0], 4);
+    uint8x16_t n2 = vandq_u8(s.val[1], nibblemask);
+    uint8x16_t n3 = vshrq_n_u8(s.val[1], 4);
+
+    uint8x16x2_t d = vld2q_u8(dst);
+    d.val[0] = veorq_u8(d.val[0], veorq_u8(
+      veorq_u8(Lookup(tlo0, n0), Lookup(tlo1, n1)),
+      veorq_u8(Lookup(tlo2, n2), Lookup(tlo3, n3))));
+    d.val[1] = veorq_u8(d.val[1], veorq_u8(
+      veorq_u8(Lookup(thi0, n0), Lookup(thi1, n1)),
+      veorq_u8(Lookup(thi2, n2), Lookup(thi3, n3))));
+    vst2q_u8(dst, d);
+  }
+
+  Galois16MulAddScalar(tables, (const uint16_t*)src, (uint16_t*)dst, (size & 31) / 2);
+}
+#endif
+
+Galois16MulAddFunc Galois16KernelNeon(void)
+{
+#ifdef GALOIS_NEON
+  return &Galois16MulAddNeon;
+#else
+  return nullptr;
+#endif
+}
+
+} // end namespace Par2
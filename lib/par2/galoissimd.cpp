@@ -0,0 +1,117 @@
+//  This file is part of par2cmdline (a PAR 2.0 compatible file verification and
+//  repair tool). See http://parchive.sourceforge.net for details of PAR 2.0.
+//
+//  Copyright (c) 2003 Peter Brian Clements
+//
+//  par2cmdline is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  par2cmdline is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#include "nzbget.h"
+#include "par2cmdline.h"
+
+namespace Par2
+{
+
+Galois16MulAddFunc Galois16MulAdd = nullptr;
+std::vector<Galois16MulAddKernel> Galois16MulAddKernels;
+
+// The kernel files are built with ISA-specific flags and only return their kernels
+// (or nullptr if the compiler doesn't support the ISA). Any other code compiled there,
+// such as instances of std::vector templates, could be picked by the linker for the
+// whole program and use instructions the CPU doesn't have.
+#if defined(__i686__) || defined(__amd64__)
+extern Galois16MulAddFunc Galois16KernelSsse3(void);
+extern Galois16MulAddFunc Galois16KernelAvx2(void);
+extern Galois16MulAddFunc Galois16KernelAvx512(void);
+#endif
+
+#if defined(__arm__) || defined(__aarch64__)
+extern Galois16MulAddFunc Galois16KernelNeon(void);
+#endif
+
+static void Galois16AddKernel(const char *name, Galois16MulAddFunc func)
+{
+  if (func)
+  {
+    Galois16MulAdd = func;
+    Galois16MulAddKernels.push_back(Galois16MulAddKernel(name, func));
+  }
+}
+
+void Galois16NibbleTables::Prepare(uint16_t factor)
+{
+  // The products of the factor and each single bit of a value
+  u16 bits[16];
+  u32 product = factor;
+  for (int bit = 0; bit < 16; bit++)
+  {
+    bits[bit] = (u16)product;
+    product <<= 1;
+    if (product & 0x10000) product ^= 0x1100B; // generator of Galois16
+  }
+
+  for (int nibble = 0; nibble < 4; nibble++)
+  {
+    for (int n = 0; n < 16; n++)
+    {
+      u16 value = 0;
+      for (int bit = 0; bit < 4; bit++)
+      {
+        if (n & (1 << bit)) value ^= bits[nibble * 4 + bit];
+      }
+      lo[nibble][n] = value & 0xff;
+      hi[nibble][n] = value >> 8;
+    }
+  }
+}
+
+void Galois16MulAddScalar(const Galois16NibbleTables &tables, const uint16_t *src, uint16_t *dst, size_t count)
+{
+  while (count--)
+  {
+    u16 s = *src++;
+    u16 lo = tables.lo[0][s & 0xf] ^ tables.lo[1][(s >> 4) & 0xf] ^ tables.lo[2][(s >> 8) & 0xf] ^ tables.lo[3][s >> 12];
+    u16 hi = tables.hi[0][s & 0xf] ^ tables.hi[1][(s >> 4) & 0xf] ^ tables.hi[2][(s >> 8) & 0xf] ^ tables.hi[3][s >> 12];
+    *dst++ ^= lo | (hi << 8);
+  }
+}
+
+void Galois16SimdInit(void)
+{
+  CpuFeatures cpu;
+
+#if defined(__i686__) || defined(__amd64__)
+  if (cpu.ssse3)
+  {
+    Galois16AddKernel("ssse3", Galois16KernelSsse3());
+  }
+  if (cpu.avx2)
+  {
+    Galois16AddKernel("avx2", Galois16KernelAvx2());
+  }
+  if (cpu.avx512bw)
+  {
+    Galois16AddKernel("avx512", Galois16KernelAvx512());
+  }
+#endif
+
+#if defined(__arm__) || defined(__aarch64__)
+  if (cpu.neon)
+  {
+    Galois16AddKernel("neon", Galois16KernelNeon());
+  }
+#endif
+}
+
+} // end namespace Par2
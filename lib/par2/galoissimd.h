@@ -0,0 +1,72 @@
+//  This file is part of par2cmdline (a PAR 2.0 compatible file verification and
+//  repair tool). See http://parchive.sourceforge.net for details of PAR 2.0.
+//
+//  Copyright (c) 2003 Peter Brian Clements
+//
+//  par2cmdline is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  par2cmdline is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#ifndef __GALOISSIMD_H__
+#define __GALOISSIMD_H__
+
+namespace Par2
+{
+
+// SIMD kernels for the inner loop of the Reed Solomon computation: the
+// multiplication of a block of 16-bit galois values by a constant factor
+// and the addition of the products to an output block.
+//
+// The product of a value is the sum of the products of its four nibbles,
+// each of which is looked up in a table of 16 entries with a byte shuffle
+// instruction (PSHUFB on x86, TBL on ARM). The low and the high bytes of
+// the products are looked up separately.
+//
+// The kernel is selected at runtime by Galois16SimdInit() depending on the
+// features of the CPU. If none is supported "Galois16MulAdd" stays null and
+// ReedSolomon<Galois16>::Process() uses the long multiplication tables.
+
+class Galois16NibbleTables
+{
+public:
+  void Prepare(uint16_t factor);
+
+  uint8_t lo[4][16];   // low bytes of "factor * (n << (4 * nibble))"
+  uint8_t hi[4][16];   // high bytes of "factor * (n << (4 * nibble))"
+};
+
+typedef void (*Galois16MulAddFunc)(const Galois16NibbleTables &tables, const void *inputbuffer, void *outputbuffer, size_t size);
+
+class Galois16MulAddKernel
+{
+public:
+  Galois16MulAddKernel(const char *_name, Galois16MulAddFunc _func) : name(_name), func(_func) {}
+
+  const char *name;
+  Galois16MulAddFunc func;
+};
+
+// The fastest kernel supported by the CPU
+extern Galois16MulAddFunc Galois16MulAdd;
+
+// All kernels supported by the CPU, from the slowest to the fastest
+extern std::vector<Galois16MulAddKernel> Galois16MulAddKernels;
+
+void Galois16SimdInit(void);
+
+// Processes the values which do not fill a whole vector
+void Galois16MulAddScalar(const Galois16NibbleTables &tables, const uint16_t *src, uint16_t *dst, size_t count);
+
+} // end namespace Par2
+
+#endif // __GALOISSIMD_H__
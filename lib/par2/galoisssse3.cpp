@@ -0,0 +1,89 @@
+//  This file is part of par2cmdline (a PAR 2.0 compatible file verification and
+//  repair tool). See http://parchive.sourceforge.net for details of PAR 2.0.
+//
+//  Copyright (c) 2003 Peter Brian Clements
+//
+//  par2cmdline is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  par2cmdline is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#include "nzbget.h"
+#include "galoissimd.h"
+
+#ifdef __SSSE3__
+#include <immintrin.h>
+#endif
+
+namespace Par2
+{
+
+#ifdef __SSSE3__
+static void Galois16MulAddSsse3(const Galois16NibbleTables &tables, const void *inputbuffer, void *outputbuffer, size_t size)
+{
+  const __m128i tlo0 = _mm_loadu_si128((const __m128i*)tables.lo[0]);
+  const __m128i tlo1 = _mm_loadu_si128((const __m128i*)tables.lo[1]);
+  const __m128i tlo2 = _mm_loadu_si128((const __m128i*)tables.lo[2]);
+  const __m128i tlo3 = _mm_loadu_si128((const __m128i*)tables.lo[3]);
+  const __m128i thi0 = _mm_loadu_si128((const __m128i*)tables.hi[0]);
+  const __m128i thi1 = _mm_loadu_si128((const __m128i*)tables.hi[1]);
+  const __m128i thi2 = _mm_loadu_si128((const __m128i*)tables.hi[2]);
+  const __m128i thi3 = _mm_loadu_si128((const __m128i*)tables.hi[3]);
+  const __m128i nibblemask = _mm_set1_epi8(0x0f);
+  const __m128i lowmask = _mm_set1_epi16(0x00ff);
+
+  const uint8_t *src = (const uint8_t*)inputbuffer;
+  uint8_t *dst = (uint8_t*)outputbuffer;
+  const uint8_t *end = src + (size & ~(size_t)31);
+
+  for (; src < end; src += 32, dst += 32)
+  {
+    __m128i a = _mm_loadu_si128((const __m128i*)src);
+    __m128i b = _mm_loadu_si128((const __m128i*)(src + 16));
+
+    // Separate the low and the high bytes of sixteen values
+    __m128i lo = _mm_packus_epi16(_mm_and_si128(a, lowmask), _mm_and_si128(b, lowmask));
+    __m128i hi = _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+
+    __m128i n0 = _mm_and_si128(lo, nibblemask);
+    __m128i n1 = _mm_and_si128(_mm_srli_epi16(lo, 4), nibblemask);
+    __m128i n2 = _mm_and_si128(hi, nibblemask);
+    __m128i n3 = _mm_and_si128(_mm_srli_epi16(hi, 4), nibblemask);
+
+    __m128i plo = _mm_xor_si128(
+      _mm_xor_si128(_mm_shuffle_epi8(tlo0, n0), _mm_shuffle_epi8(tlo1, n1)),
+      _mm_xor_si128(_mm_shuffle_epi8(tlo2, n2), _mm_shuffle_epi8(tlo3, n3)));
+    __m128i phi = _mm_xor_si128(
+      _mm_xor_si128(_mm_shuffle_epi8(thi0, n0), _mm_shuffle_epi8(thi1, n1)),
+      _mm_xor_si128(_mm_shuffle_epi8(thi2, n2), _mm_shuffle_epi8(thi3, n3)));
+
+    // Join the bytes of the products back into values
+    __m128i da = _mm_loadu_si128((const __m128i*)dst);
+    __m128i db = _mm_loadu_si128((const __m128i*)(dst + 16));
+    _mm_storeu_si128((__m128i*)dst, _mm_xor_si128(da, _mm_unpacklo_epi8(plo, phi)));
+    _mm_storeu_si128((__m128i*)(dst + 16), _mm_xor_si128(db, _mm_unpackhi_epi8(plo, phi)));
+  }
+
+  Galois16MulAddScalar(tables, (const uint16_t*)src, (uint16_t*)dst, (size & 31) / 2);
+}
+#endif
+
+Galois16MulAddFunc Galois16KernelSsse3(void)
+{
+#ifdef __SSSE3__
+  return &Galois16MulAddSsse3;
+#else
+  return nullptr;
+#endif
+}
+
+} // end namespace Par2
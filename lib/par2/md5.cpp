@@ -20,6 +20,11 @@
 #include "nzbget.h"
 #include "par2cmdline.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MD5_SSE2
+#include <emmintrin.h>
+#endif
+
 #ifdef _MSC_VER
 #ifdef _DEBUG
 #undef THIS_FILE
@@ -95,85 +100,7 @@ void MD5State::UpdateState(const u32 (&block)[16])
   u32 c = state[2];
   u32 d = state[3];
 
-  ROUND(F1, a, b, c, d,  0,  7, 0xd76aa478);
-  ROUND(F1, d, a, b, c,  1, 12, 0xe8c7b756);
-  ROUND(F1, c, d, a, b, 2, 17, 0x242070db);
-  ROUND(F1, b, c, d, a,  3, 22, 0xc1bdceee);
-  
-  ROUND(F1, a, b, c, d,  4,  7, 0xf57c0faf);
-  ROUND(F1, d, a, b, c,  5, 12, 0x4787c62a);
-  ROUND(F1, c, d, a, b,  6, 17, 0xa8304613);
-  ROUND(F1, b, c, d, a,  7, 22, 0xfd469501);
-  
-  ROUND(F1, a, b, c, d,  8,  7, 0x698098d8);
-  ROUND(F1, d, a, b, c,  9, 12, 0x8b44f7af);
-  ROUND(F1, c, d, a, b, 10, 17, 0xffff5bb1);
-  ROUND(F1, b, c, d, a, 11, 22, 0x895cd7be);
-  
-  ROUND(F1, a, b, c, d, 12,  7, 0x6b901122);
-  ROUND(F1, d, a, b, c, 13, 12, 0xfd987193);
-  ROUND(F1, c, d, a, b, 14, 17, 0xa679438e);
-  ROUND(F1, b, c, d, a, 15, 22, 0x49b40821);
-  
-  ROUND(F2, a, b, c, d,  1,  5, 0xf61e2562);
-  ROUND(F2, d, a, b, c,  6,  9, 0xc040b340);
-  ROUND(F2, c, d, a, b, 11, 14, 0x265e5a51);
-  ROUND(F2, b, c, d, a,  0, 20, 0xe9b6c7aa);
-  
-  ROUND(F2, a, b, c, d,  5,  5, 0xd62f105d);
-  ROUND(F2, d, a, b, c, 10,  9, 0x02441453);
-  ROUND(F2, c, d, a, b, 15, 14, 0xd8a1e681);
-  ROUND(F2, b, c, d, a,  4, 20, 0xe7d3fbc8);
-  
-  ROUND(F2, a, b, c, d,  9,  5, 0x21e1cde6);
-  ROUND(F2, d, a, b, c, 14,  9, 0xc33707d6);
-  ROUND(F2, c, d, a, b,  3, 14, 0xf4d50d87);
-  ROUND(F2, b, c, d, a,  8, 20, 0x455a14ed);
-  
-  ROUND(F2, a, b, c, d, 13,  5, 0xa9e3e905);
-  ROUND(F2, d, a, b, c,  2,  9, 0xfcefa3f8);
-  ROUND(F2, c, d, a, b,  7, 14, 0x676f02d9);
-  ROUND(F2, b, c, d, a, 12, 20, 0x8d2a4c8a);
-  
-  ROUND(F3, a, b, c, d,  5,  4, 0xfffa3942);
-  ROUND(F3, d, a, b, c,  8, 11, 0x8771f681);
-  ROUND(F3, c, d, a, b, 11, 16, 0x6d9d6122);
-  ROUND(F3, b, c, d, a, 14, 23, 0xfde5380c);
-  
-  ROUND(F3, a, b, c, d,  1,  4, 0xa4beea44);
-  ROUND(F3, d, a, b, c,  4, 11, 0x4bdecfa9);
-  ROUND(F3, c, d, a, b,  7, 16, 0xf6bb4b60);
-  ROUND(F3, b, c, d, a, 10, 23, 0xbebfbc70);
-  
-  ROUND(F3, a, b, c, d, 13,  4, 0x289b7ec6);
-  ROUND(F3, d, a, b, c,  0, 11, 0xeaa127fa);
-  ROUND(F3, c, d, a, b,  3, 16, 0xd4ef3085);
-  ROUND(F3, b, c, d, a,  6, 23, 0x04881d05);
-  
-  ROUND(F3, a, b, c, d,  9,  4, 0xd9d4d039);
-  ROUND(F3, d, a, b, c, 12, 11, 0xe6db99e5);
-  ROUND(F3, c, d, a, b, 15, 16, 0x1fa27cf8);
-  ROUND(F3, b, c, d, a,  2, 23, 0xc4ac5665);
-  
-  ROUND(F4, a, b, c, d,  0,  6, 0xf4292244);
-  ROUND(F4, d, a, b, c,  7, 10, 0x432aff97);
-  ROUND(F4, c, d, a, b, 14, 15, 0xab9423a7);
-  ROUND(F4, b, c, d, a,  5, 21, 0xfc93a039);
-  
-  ROUND(F4, a, b, c, d, 12,  6, 0x655b59c3);
-  ROUND(F4, d, a, b, c,  3, 10, 0x8f0ccc92);
-  ROUND(F4, c, d, a, b, 10, 15, 0xffeff47d);
-  ROUND(F4, b, c, d, a, 1, 21, 0x85845dd1);
-  
-  ROUND(F4, a, b, c, d,  8,  6, 0x6fa87e4f);
-  ROUND(F4, d, a, b, c, 15, 10, 0xfe2ce6e0);
-  ROUND(F4, c, d, a, b,  6, 15, 0xa3014314);
-  ROUND(F4, b, c, d, a, 13, 21, 0x4e0811a1);
-  
-  ROUND(F4, a, b, c, d,  4,  6, 0xf7537e82);
-  ROUND(F4, d, a, b, c, 11, 10, 0xbd3af235);
-  ROUND(F4, c, d, a, b,  2, 15, 0x2ad7d2bb);
-  ROUND(F4, b, c, d, a,  9, 21, 0xeb86d391);
+  MD5_STEPS(ROUND);
 
   state[0] += a;
   state[1] += b;
@@ -353,4 +280,194 @@ string MD5Context::print(void) const
   return buffer;
 }
 
+#ifdef MD5_SSE2
+
+// Hash four buffers at once: the SSE2 vectors hold the same state word
+// of the four lanes.
+
+#define VF1(x,y,z)   _mm_xor_si128(z, _mm_and_si128(x, _mm_xor_si128(y, z)))
+#define VF2(x,y,z)   _mm_xor_si128(y, _mm_and_si128(z, _mm_xor_si128(x, y)))
+#define VF3(x,y,z)   _mm_xor_si128(_mm_xor_si128(x, y), z)
+#define VF4(x,y,z)   _mm_xor_si128(y, _mm_or_si128(x, _mm_xor_si128(z, ones)))
+#define VROL(x,s)    _mm_or_si128(_mm_slli_epi32(x, s), _mm_srli_epi32(x, 32-s))
+#define VROUND(f,w,x,y,z,k,s,ti) \
+  w = _mm_add_epi32(x, VROL(_mm_add_epi32(_mm_add_epi32(w, V##f(x,y,z)), \
+    _mm_add_epi32(words[k], _mm_set1_epi32((int)ti))), s))
+
+static void MD5UpdateLanesSse2(u32 *state, const u8 * const *data, size_t blockcount)
+{
+  const __m128i ones = _mm_set1_epi32(-1);
+
+  __m128i sa = _mm_loadu_si128((const __m128i*)&state[0]);
+  __m128i sb = _mm_loadu_si128((const __m128i*)&state[4]);
+  __m128i sc = _mm_loadu_si128((const __m128i*)&state[8]);
+  __m128i sd = _mm_loadu_si128((const __m128i*)&state[12]);
+
+  for (size_t offset = 0; offset < blockcount * 64; offset += 64)
+  {
+    // Transpose the 64 byte blocks of the lanes into 16 vectors of words
+    __m128i words[16];
+    for (int i = 0; i < 16; i += 4)
+    {
+      __m128i r0 = _mm_loadu_si128((const __m128i*)&data[0][offset + i*4]);
+      __m128i r1 = _mm_loadu_si128((const __m128i*)&data[1][offset + i*4]);
+      __m128i r2 = _mm_loadu_si128((const __m128i*)&data[2][offset + i*4]);
+      __m128i r3 = _mm_loadu_si128((const __m128i*)&data[3][offset + i*4]);
+
+      __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+      __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+      __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+      __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+
+      words[i]   = _mm_unpacklo_epi64(t0, t1);
+      words[i+1] = _mm_unpackhi_epi64(t0, t1);
+      words[i+2] = _mm_unpacklo_epi64(t2, t3);
+      words[i+3] = _mm_unpackhi_epi64(t2, t3);
+    }
+
+    __m128i a = sa;
+    __m128i b = sb;
+    __m128i c = sc;
+    __m128i d = sd;
+
+    MD5_STEPS(VROUND);
+
+    sa = _mm_add_epi32(sa, a);
+    sb = _mm_add_epi32(sb, b);
+    sc = _mm_add_epi32(sc, c);
+    sd = _mm_add_epi32(sd, d);
+  }
+
+  _mm_storeu_si128((__m128i*)&state[0], sa);
+  _mm_storeu_si128((__m128i*)&state[4], sb);
+  _mm_storeu_si128((__m128i*)&state[8], sc);
+  _mm_storeu_si128((__m128i*)&state[12], sd);
+}
+
+#endif
+
+std::vector<MD5LanesKernel> MD5LanesKernels = {
+#ifdef MD5_SSE2
+  MD5LanesKernel("sse2", 4, &MD5UpdateLanesSse2)
+#endif
+};
+
+static void MD5AddKernel(const char *name, size_t lanes, MD5UpdateLanesFunc func)
+{
+  if (func)
+  {
+    MD5LanesKernels.push_back(MD5LanesKernel(name, lanes, func));
+  }
+}
+
+void MD5SimdInit(void)
+{
+  CpuFeatures cpu;
+
+  if (cpu.avx2)
+  {
+    MD5AddKernel("avx2", 8, MD5KernelAvx2());
+  }
+  if (cpu.avx512bw)
+  {
+    MD5AddKernel("avx512", 16, MD5KernelAvx512());
+  }
+}
+
+static void MD5HashLanes(const MD5LanesKernel &kernel, const u8 * const *buffers, size_t length, MD5Hash *hashes, size_t count)
+{
+  const size_t lanes = kernel.lanes;
+  u32 state[4 * MD5MaxLanes];
+  for (size_t lane = 0; lane < lanes; lane++)
+  {
+    state[lane]           = 0x67452301;
+    state[lanes + lane]   = 0xefcdab89;
+    state[2*lanes + lane] = 0x98badcfe;
+    state[3*lanes + lane] = 0x10325476;
+  }
+
+  // Whole blocks are read directly from the buffers
+  kernel.func(state, buffers, length / 64);
+
+  // The remainder and the padding take one or two more blocks, which are
+  // the same for all lanes except for the data
+  size_t used = length % 64;
+  size_t tailsize = used < 56 ? 64 : 128;
+  u8 tail[MD5MaxLanes][128];
+  const u8 *tails[MD5MaxLanes];
+  u64 bits = (u64)length << 3;
+  for (size_t lane = 0; lane < lanes; lane++)
+  {
+    memcpy(tail[lane], &buffers[lane][length - used], used);
+    memset(&tail[lane][used], 0, tailsize - used);
+    tail[lane][used] = 0x80;
+    for (int i = 0; i < 8; i++)
+    {
+      tail[lane][tailsize - 8 + i] = (u8)((bits >> (8*i)) & 0xFF);
+    }
+    tails[lane] = tail[lane];
+  }
+  kernel.func(state, tails, tailsize / 64);
+
+  for (size_t lane = 0; lane < count; lane++)
+  {
+    for (size_t i = 0; i < 4; i++)
+    {
+      u32 word = state[i*lanes + lane];
+      hashes[lane].hash[4*i+3] = (u8)((word >> 24) & 0xFF);
+      hashes[lane].hash[4*i+2] = (u8)((word >> 16) & 0xFF);
+      hashes[lane].hash[4*i+1] = (u8)((word >>  8) & 0xFF);
+      hashes[lane].hash[4*i+0] = (u8)((word >>  0) & 0xFF);
+    }
+  }
+}
+
+size_t MD5Lanes(void)
+{
+  return MD5LanesKernels.empty() ? 1 : MD5LanesKernels.back().lanes;
+}
+
+void MD5HashBuffers(const MD5LanesKernel &kernel, const void * const *buffers, size_t count, size_t length, MD5Hash *hashes)
+{
+  while (count > 1)
+  {
+    // Unused lanes repeat the last buffer
+    size_t lanes = min(count, kernel.lanes);
+    const u8 *data[MD5MaxLanes];
+    for (size_t lane = 0; lane < kernel.lanes; lane++)
+    {
+      data[lane] = (const u8*)buffers[min(lane, lanes-1)];
+    }
+
+    MD5HashLanes(kernel, data, length, hashes, lanes);
+
+    buffers += lanes;
+    hashes += lanes;
+    count -= lanes;
+  }
+
+  if (count == 1)
+  {
+    MD5Context context;
+    context.Update(buffers[0], length);
+    context.Final(hashes[0]);
+  }
+}
+
+void MD5HashBuffers(const void * const *buffers, size_t count, size_t length, MD5Hash *hashes)
+{
+  if (MD5LanesKernels.empty())
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      MD5Context context;
+      context.Update(buffers[i], length);
+      context.Final(hashes[i]);
+    }
+    return;
+  }
+
+  MD5HashBuffers(MD5LanesKernels.back(), buffers, count, length, hashes);
+}
+
 } // end namespace Par2
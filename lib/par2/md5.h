@@ -114,6 +114,15 @@ protected:
   u64 bytes;
 };
 
+// Multi-buffer MD5: the hashes of several buffers of the same length are
+// computed at once, each buffer in its own lane of a SIMD vector.
+
+// How many buffers are hashed in parallel (1 if there is no SIMD support)
+size_t MD5Lanes(void);
+
+// Compute the hashes of "count" buffers of "length" bytes each
+void MD5HashBuffers(const void * const *buffers, size_t count, size_t length, MD5Hash *hashes);
+
 // Compare hash values
 
 inline bool MD5Hash::operator==(const MD5Hash &other) const
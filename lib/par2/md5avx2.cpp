@@ -0,0 +1,117 @@
+//  This file is part of par2cmdline (a PAR 2.0 compatible file verification and
+//  repair tool). See http://parchive.sourceforge.net for details of PAR 2.0.
+//
+//  Copyright (c) 2003 Peter Brian Clements
+//
+//  par2cmdline is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  par2cmdline is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#include "nzbget.h"
+#include "par2cmdline.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace Par2
+{
+
+#ifdef __AVX2__
+// Same as the SSE2 kernel with eight lanes.
+
+#define AF1(x,y,z)   _mm256_xor_si256(z, _mm256_and_si256(x, _mm256_xor_si256(y, z)))
+#define AF2(x,y,z)   _mm256_xor_si256(y, _mm256_and_si256(z, _mm256_xor_si256(x, y)))
+#define AF3(x,y,z)   _mm256_xor_si256(_mm256_xor_si256(x, y), z)
+#define AF4(x,y,z)   _mm256_xor_si256(y, _mm256_or_si256(x, _mm256_xor_si256(z, ones)))
+#define AROL(x,s)    _mm256_or_si256(_mm256_slli_epi32(x, s), _mm256_srli_epi32(x, 32-s))
+#define AROUND(f,w,x,y,z,k,s,ti) \
+  w = _mm256_add_epi32(x, AROL(_mm256_add_epi32(_mm256_add_epi32(w, A##f(x,y,z)), \
+    _mm256_add_epi32(words[k], _mm256_set1_epi32((int)ti))), s))
+
+static void MD5UpdateLanesAvx2(u32 *state, const u8 * const *data, size_t blockcount)
+{
+  const __m256i ones = _mm256_set1_epi32(-1);
+
+  __m256i sa = _mm256_loadu_si256((const __m256i*)&state[0]);
+  __m256i sb = _mm256_loadu_si256((const __m256i*)&state[8]);
+  __m256i sc = _mm256_loadu_si256((const __m256i*)&state[16]);
+  __m256i sd = _mm256_loadu_si256((const __m256i*)&state[24]);
+
+  for (size_t offset = 0; offset < blockcount * 64; offset += 64)
+  {
+    // Transpose the 64 byte blocks of the lanes into 16 vectors of words.
+    // The unpacking works within 128-bit halves, which hold the words
+    // "i..i+3" and "i+4..i+7" of four lanes at the end.
+    __m256i words[16];
+    for (int i = 0; i < 16; i += 8)
+    {
+      __m256i r[8];
+      for (int lane = 0; lane < 8; lane++)
+      {
+        r[lane] = _mm256_loadu_si256((const __m256i*)&data[lane][offset + i*4]);
+      }
+
+      __m256i t[8];
+      for (int lane = 0; lane < 8; lane += 2)
+      {
+        t[lane]   = _mm256_unpacklo_epi32(r[lane], r[lane+1]);
+        t[lane+1] = _mm256_unpackhi_epi32(r[lane], r[lane+1]);
+      }
+
+      __m256i u[8];
+      for (int lane = 0; lane < 8; lane += 4)
+      {
+        u[lane]   = _mm256_unpacklo_epi64(t[lane], t[lane+2]);
+        u[lane+1] = _mm256_unpackhi_epi64(t[lane], t[lane+2]);
+        u[lane+2] = _mm256_unpacklo_epi64(t[lane+1], t[lane+3]);
+        u[lane+3] = _mm256_unpackhi_epi64(t[lane+1], t[lane+3]);
+      }
+
+      for (int k = 0; k < 4; k++)
+      {
+        words[i+k]   = _mm256_permute2x128_si256(u[k], u[k+4], 0x20);
+        words[i+k+4] = _mm256_permute2x128_si256(u[k], u[k+4], 0x31);
+      }
+    }
+
+    __m256i a = sa;
+    __m256i b = sb;
+    __m256i c = sc;
+    __m256i d = sd;
+
+    MD5_STEPS(AROUND);
+
+    sa = _mm256_add_epi32(sa, a);
+    sb = _mm256_add_epi32(sb, b);
+    sc = _mm256_add_epi32(sc, c);
+    sd = _mm256_add_epi32(sd, d);
+  }
+
+  _mm256_storeu_si256((__m256i*)&state[0], sa);
+  _mm256_storeu_si256((__m256i*)&state[8], sb);
+  _mm256_storeu_si256((__m256i*)&state[16], sc);
+  _mm256_storeu_si256((__m256i*)&state[24], sd);
+}
+#endif
+
+MD5UpdateLanesFunc MD5KernelAvx2(void)
+{
+#ifdef __AVX2__
+  return &MD5UpdateLanesAvx2;
+#else
+  return nullptr;
+#endif
+}
+
+} // end namespace Par2
@@ -0,0 +1,121 @@
+//  This file is part of par2cmdline (a PAR 2.0 compatible file verification and
+//  repair tool). See http://parchive.sourceforge.net for details of PAR 2.0.
+//
+//  Copyright (c) 2003 Peter Brian Clements
+//
+//  par2cmdline is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  par2cmdline is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#include "nzbget.h"
+#include "par2cmdline.h"
+
+#ifdef __AVX512F__
+#include <immintrin.h>
+#endif
+
+namespace Par2
+{
+
+#ifdef __AVX512F__
+// Same as the SSE2 kernel with sixteen lanes. The MD5 functions are single
+// ternary logic instructions and the rotations are native. Rotations and
+// shuffles use the zero-masking forms with an all-set mask; the plain forms
+// make GCC 12 warn about uninitialized lanes.
+
+#define ZF1(x,y,z)   _mm512_ternarylogic_epi32(x, y, z, 0xCA)
+#define ZF2(x,y,z)   _mm512_ternarylogic_epi32(x, y, z, 0xE4)
+#define ZF3(x,y,z)   _mm512_ternarylogic_epi32(x, y, z, 0x96)
+#define ZF4(x,y,z)   _mm512_ternarylogic_epi32(x, y, z, 0x39)
+#define ZROUND(f,w,x,y,z,k,s,ti) \
+  w = _mm512_add_epi32(x, _mm512_maskz_rol_epi32(0xFFFF, _mm512_add_epi32(_mm512_add_epi32(w, Z##f(x,y,z)), \
+    _mm512_add_epi32(words[k], _mm512_set1_epi32((int)ti))), s))
+
+static void MD5UpdateLanesAvx512(u32 *state, const u8 * const *data, size_t blockcount)
+{
+  __m512i sa = _mm512_loadu_si512(&state[0]);
+  __m512i sb = _mm512_loadu_si512(&state[16]);
+  __m512i sc = _mm512_loadu_si512(&state[32]);
+  __m512i sd = _mm512_loadu_si512(&state[48]);
+
+  for (size_t offset = 0; offset < blockcount * 64; offset += 64)
+  {
+    // Transpose the 64 byte blocks of the lanes into 16 vectors of words.
+    // After the unpacking "u[4*m+q]" holds the words "4*c+q" of the lanes
+    // "4*m..4*m+3" in its 128-bit part "c", the parts are then transposed.
+    __m512i r[16];
+    for (int lane = 0; lane < 16; lane++)
+    {
+      r[lane] = _mm512_loadu_si512(&data[lane][offset]);
+    }
+
+    __m512i t[16];
+    for (int lane = 0; lane < 16; lane += 2)
+    {
+      t[lane]   = _mm512_maskz_unpacklo_epi32(0xFFFF, r[lane], r[lane+1]);
+      t[lane+1] = _mm512_maskz_unpackhi_epi32(0xFFFF, r[lane], r[lane+1]);
+    }
+
+    __m512i u[16];
+    for (int lane = 0; lane < 16; lane += 4)
+    {
+      u[lane]   = _mm512_maskz_unpacklo_epi64(0xFF, t[lane], t[lane+2]);
+      u[lane+1] = _mm512_maskz_unpackhi_epi64(0xFF, t[lane], t[lane+2]);
+      u[lane+2] = _mm512_maskz_unpacklo_epi64(0xFF, t[lane+1], t[lane+3]);
+      u[lane+3] = _mm512_maskz_unpackhi_epi64(0xFF, t[lane+1], t[lane+3]);
+    }
+
+    __m512i words[16];
+    for (int q = 0; q < 4; q++)
+    {
+      __m512i v0 = _mm512_maskz_shuffle_i32x4(0xFFFF, u[q], u[q+4], 0x44);
+      __m512i v1 = _mm512_maskz_shuffle_i32x4(0xFFFF, u[q+8], u[q+12], 0x44);
+      __m512i v2 = _mm512_maskz_shuffle_i32x4(0xFFFF, u[q], u[q+4], 0xEE);
+      __m512i v3 = _mm512_maskz_shuffle_i32x4(0xFFFF, u[q+8], u[q+12], 0xEE);
+
+      words[q]    = _mm512_maskz_shuffle_i32x4(0xFFFF, v0, v1, 0x88);
+      words[q+4]  = _mm512_maskz_shuffle_i32x4(0xFFFF, v0, v1, 0xDD);
+      words[q+8]  = _mm512_maskz_shuffle_i32x4(0xFFFF, v2, v3, 0x88);
+      words[q+12] = _mm512_maskz_shuffle_i32x4(0xFFFF, v2, v3, 0xDD);
+    }
+
+    __m512i a = sa;
+    __m512i b = sb;
+    __m512i c = sc;
+    __m512i d = sd;
+
+    MD5_STEPS(ZROUND);
+
+    sa = _mm512_add_epi32(sa, a);
+    sb = _mm512_add_epi32(sb, b);
+    sc = _mm512_add_epi32(sc, c);
+    sd = _mm512_add_epi32(sd, d);
+  }
+
+  _mm512_storeu_si512(&state[0], sa);
+  _mm512_storeu_si512(&state[16], sb);
+  _mm512_storeu_si512(&state[32], sc);
+  _mm512_storeu_si512(&state[48], sd);
+}
+#endif
+
+MD5UpdateLanesFunc MD5KernelAvx512(void)
+{
+#ifdef __AVX512F__
+  return &MD5UpdateLanesAvx512;
+#else
+  return nullptr;
+#endif
+}
+
+} // end namespace Par2
@@ -0,0 +1,146 @@
+//  This file is part of par2cmdline (a PAR 2.0 compatible file verification and
+//  repair tool). See http://parchive.sourceforge.net for details of PAR 2.0.
+//
+//  Copyright (c) 2003 Peter Brian Clements
+//
+//  par2cmdline is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  par2cmdline is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+
+#ifndef __MD5SIMD_H__
+#define __MD5SIMD_H__
+
+namespace Par2
+{
+
+// Multi-buffer MD5 kernels. A kernel runs the MD5 transform for as many
+// buffers as its vectors have 32-bit lanes, one buffer per lane. The state
+// holds word "i" of lane "n" at "state[i * lanes + n]".
+//
+// The SSE2 kernel is part of the x86-64 baseline. The AVX2 and AVX-512
+// kernels are compiled with per-file flags and added at runtime by
+// MD5SimdInit() if the CPU supports them. The files with per-file flags
+// only return their kernels (or nullptr if the compiler doesn't support the
+// ISA), other code compiled there, such as instances of std::vector
+// templates, could be picked by the linker for the whole program.
+
+typedef void (*MD5UpdateLanesFunc)(u32 *state, const u8 * const *data, size_t blockcount);
+
+class MD5LanesKernel
+{
+public:
+  MD5LanesKernel(const char *_name, size_t _lanes, MD5UpdateLanesFunc _func) : name(_name), lanes(_lanes), func(_func) {}
+
+  const char *name;
+  size_t lanes;
+  MD5UpdateLanesFunc func;
+};
+
+// All kernels supported by the CPU, from the narrowest to the widest
+extern std::vector<MD5LanesKernel> MD5LanesKernels;
+
+// Lanes of the widest kernel
+static const size_t MD5MaxLanes = 16;
+
+// Compute the hashes of "count" buffers of "length" bytes each with the given kernel
+void MD5HashBuffers(const MD5LanesKernel &kernel, const void * const *buffers, size_t count, size_t length, MD5Hash *hashes);
+
+void MD5SimdInit(void);
+MD5UpdateLanesFunc MD5KernelAvx2(void);
+MD5UpdateLanesFunc MD5KernelAvx512(void);
+
+// The 64 steps of the MD5 transform, shared by the scalar and the multi-buffer code
+#define MD5_STEPS(R) \
+  R(F1, a, b, c, d,  0,  7, 0xd76aa478); \
+  R(F1, d, a, b, c,  1, 12, 0xe8c7b756); \
+  R(F1, c, d, a, b, 2, 17, 0x242070db); \
+  R(F1, b, c, d, a,  3, 22, 0xc1bdceee); \
+  \
+  R(F1, a, b, c, d,  4,  7, 0xf57c0faf); \
+  R(F1, d, a, b, c,  5, 12, 0x4787c62a); \
+  R(F1, c, d, a, b,  6, 17, 0xa8304613); \
+  R(F1, b, c, d, a,  7, 22, 0xfd469501); \
+  \
+  R(F1, a, b, c, d,  8,  7, 0x698098d8); \
+  R(F1, d, a, b, c,  9, 12, 0x8b44f7af); \
+  R(F1, c, d, a, b, 10, 17, 0xffff5bb1); \
+  R(F1, b, c, d, a, 11, 22, 0x895cd7be); \
+  \
+  R(F1, a, b, c, d, 12,  7, 0x6b901122); \
+  R(F1, d, a, b, c, 13, 12, 0xfd987193); \
+  R(F1, c, d, a, b, 14, 17, 0xa679438e); \
+  R(F1, b, c, d, a, 15, 22, 0x49b40821); \
+  \
+  R(F2, a, b, c, d,  1,  5, 0xf61e2562); \
+  R(F2, d, a, b, c,  6,  9, 0xc040b340); \
+  R(F2, c, d, a, b, 11, 14, 0x265e5a51); \
+  R(F2, b, c, d, a,  0, 20, 0xe9b6c7aa); \
+  \
+  R(F2, a, b, c, d,  5,  5, 0xd62f105d); \
+  R(F2, d, a, b, c, 10,  9, 0x02441453); \
+  R(F2, c, d, a, b, 15, 14, 0xd8a1e681); \
+  R(F2, b, c, d, a,  4, 20, 0xe7d3fbc8); \
+  \
+  R(F2, a, b, c, d,  9,  5, 0x21e1cde6); \
+  R(F2, d, a, b, c, 14,  9, 0xc33707d6); \
+  R(F2, c, d, a, b,  3, 14, 0xf4d50d87); \
+  R(F2, b, c, d, a,  8, 20, 0x455a14ed); \
+  \
+  R(F2, a, b, c, d, 13,  5, 0xa9e3e905); \
+  R(F2, d, a, b, c,  2,  9, 0xfcefa3f8); \
+  R(F2, c, d, a, b,  7, 14, 0x676f02d9); \
+  R(F2, b, c, d, a, 12, 20, 0x8d2a4c8a); \
+  \
+  R(F3, a, b, c, d,  5,  4, 0xfffa3942); \
+  R(F3, d, a, b, c,  8, 11, 0x8771f681); \
+  R(F3, c, d, a, b, 11, 16, 0x6d9d6122); \
+  R(F3, b, c, d, a, 14, 23, 0xfde5380c); \
+  \
+  R(F3, a, b, c, d,  1,  4, 0xa4beea44); \
+  R(F3, d, a, b, c,  4, 11, 0x4bdecfa9); \
+  R(F3, c, d, a, b,  7, 16, 0xf6bb4b60); \
+  R(F3, b, c, d, a, 10, 23, 0xbebfbc70); \
+  \
+  R(F3, a, b, c, d, 13,  4, 0x289b7ec6); \
+  R(F3, d, a, b, c,  0, 11, 0xeaa127fa); \
+  R(F3, c, d, a, b,  3, 16, 0xd4ef3085); \
+  R(F3, b, c, d, a,  6, 23, 0x04881d05); \
+  \
+  R(F3, a, b, c, d,  9,  4, 0xd9d4d039); \
+  R(F3, d, a, b, c, 12, 11, 0xe6db99e5); \
+  R(F3, c, d, a, b, 15, 16, 0x1fa27cf8); \
+  R(F3, b, c, d, a,  2, 23, 0xc4ac5665); \
+  \
+  R(F4, a, b, c, d,  0,  6, 0xf4292244); \
+  R(F4, d, a, b, c,  7, 10, 0x432aff97); \
+  R(F4, c, d, a, b, 14, 15, 0xab9423a7); \
+  R(F4, b, c, d, a,  5, 21, 0xfc93a039); \
+  \
+  R(F4, a, b, c, d, 12,  6, 0x655b59c3); \
+  R(F4, d, a, b, c,  3, 10, 0x8f0ccc92); \
+  R(F4, c, d, a, b, 10, 15, 0xffeff47d); \
+  R(F4, b, c, d, a, 1, 21, 0x85845dd1); \
+  \
+  R(F4, a, b, c, d,  8,  6, 0x6fa87e4f); \
+  R(F4, d, a, b, c, 15, 10, 0xfe2ce6e0); \
+  R(F4, c, d, a, b,  6, 15, 0xa3014314); \
+  R(F4, b, c, d, a, 13, 21, 0x4e0811a1); \
+  \
+  R(F4, a, b, c, d,  4,  6, 0xf7537e82); \
+  R(F4, d, a, b, c, 11, 10, 0xbd3af235); \
+  R(F4, c, d, a, b,  2, 15, 0x2ad7d2bb); \
+  R(F4, b, c, d, a,  9, 21, 0xeb86d391)
+
+} // end namespace Par2
+
+#endif // __MD5SIMD_H__
@@ -127,8 +127,11 @@ using namespace std;
 // par2cmdline includes
 
 #include "galois.h"
+#include "cpufeatures.h"
+#include "galoissimd.h"
 #include "crc.h"
 #include "md5.h"
+#include "md5simd.h"
 #include "par2fileformat.h"
 #include "commandline.h"
 #include "reedsolomon.h"
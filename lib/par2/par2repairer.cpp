@@ -54,6 +54,10 @@ Par2Repairer::Par2Repairer(std::ostream& cout, std::ostream& cerr):
   inputbuffer = 0;
   outputbuffer = 0;
 
+  hashahead = FileCheckSummer::MaxHashAhead;
+  scantotal = 0;
+  scanprogress = 0;
+
   noiselevel = CommandLine::nlNormal;
   headers = new ParHeaders;
   alreadyloaded = false;
@@ -1252,6 +1256,12 @@ bool Par2Repairer::VerifySourceFiles(void)
 
   sort(sortedfiles.begin(), sortedfiles.end(), SortSourceFilesByFileName);
 
+  // Can the files be verified concurrently
+  if (VerifyFiles(sortedfiles, finalresult))
+  {
+    return finalresult && !cancelled;
+  }
+
   // Start verifying the files
   sf = sortedfiles.begin();
   while (sf != sortedfiles.end())
@@ -1261,47 +1271,42 @@ bool Par2Repairer::VerifySourceFiles(void)
       return false;
     }
 
-    // Do we have a source file
-    Par2RepairerSourceFile *sourcefile = *sf;
+    if (!VerifySourceFile(*sf, finalresult))
+    {
+      return false;
+    }
+
+    ++sf;
+  }
+
+  return finalresult;
+}
 
-    // What filename does the file use
-    string filename = sourcefile->TargetFileName();
+// Attempt to verify one of the source files
+bool Par2Repairer::VerifySourceFile(Par2RepairerSourceFile *sourcefile, bool &finalresult)
+{
+  // What filename does the file use
+  string filename = sourcefile->TargetFileName();
+
+  DiskFile *diskfile = 0;
+
+  {
+    std::lock_guard<std::mutex> lock(verificationmutex);
 
     // Check to see if we have already used this file
     if (diskFileMap.Find(filename) != 0)
     {
       // The file has already been used!
 
-      cerr << "Source file " << filenumber+1 << " is a duplicate." << endl;
+      cerr << "Source file \"" << filename << "\" is a duplicate." << endl;
 
       return false;
     }
 
-    DiskFile *diskfile = new DiskFile(cerr);
+    diskfile = new DiskFile(cerr);
 
     // Does the target file exist
-    if (diskfile->Open(filename))
-    {
-      // Yes. Record that fact.
-      sourcefile->SetTargetExists(true);
-
-      // Remember that the DiskFile is the target file
-      sourcefile->SetTargetFile(diskfile);
-
-      // Remember that we have processed this file
-      bool success = diskFileMap.Insert(diskfile);
-      assert(success); (void)success;
-      // Do the actual verification
-      if (!VerifyDataFile(diskfile, sourcefile))
-        finalresult = false;
-
-      // We have finished with the file for now
-      diskfile->Close();
-
-      // Find out how much data we have found
-      UpdateVerificationResults();
-    }
-    else
+    if (!diskfile->Open(filename))
     {
       // The file does not exist.
       delete diskfile;
@@ -1315,12 +1320,36 @@ bool Par2Repairer::VerifySourceFiles(void)
         cout << "Target: \"" << name << "\" - missing." << endl;
 	sig_done(name, 0, sourcefile && sourcefile->GetVerificationPacket() ? sourcefile->GetVerificationPacket()->BlockCount() : 0);
       }
+
+      return true;
     }
 
-    ++sf;
+    // Yes. Record that fact.
+    sourcefile->SetTargetExists(true);
+
+    // Remember that the DiskFile is the target file
+    sourcefile->SetTargetFile(diskfile);
+
+    // Remember that we have processed this file
+    bool success = diskFileMap.Insert(diskfile);
+    assert(success); (void)success;
   }
 
-  return finalresult;
+  // Do the actual verification
+  bool verified = VerifyDataFile(diskfile, sourcefile);
+
+  // We have finished with the file for now
+  diskfile->Close();
+
+  std::lock_guard<std::mutex> lock(verificationmutex);
+
+  if (!verified)
+    finalresult = false;
+
+  // Find out how much data we have found
+  UpdateVerificationResults();
+
+  return true;
 }
 
 // Scan any extra files specified on the command line
@@ -1411,6 +1440,7 @@ bool Par2Repairer::VerifyDataFile(DiskFile *diskfile, Par2RepairerSourceFile *so
       {
         // We found a perfect match.
 
+        std::lock_guard<std::mutex> lock(verificationmutex);
         sourcefile->SetCompleteFile(diskfile);
 
         // Return the match
@@ -1487,6 +1517,8 @@ bool Par2Repairer::VerifyDataFile(DiskFile *diskfile, Par2RepairerSourceFile *so
       }
     }
 
+    std::lock_guard<std::mutex> lock(verificationmutex);
+
     list<Par2RepairerSourceFile*>::iterator sf = unverifiablesourcefiles.begin();
 
     // Compare the hash values of each source file for a match
@@ -1566,7 +1598,10 @@ bool Par2Repairer::ScanDataFile(DiskFile                *diskfile,    // [in]
   string name;
   DiskFile::SplitFilename(diskfile->FileName(), path, name);
 
-  sig_filename(name);
+  {
+    std::lock_guard<std::mutex> lock(verificationmutex);
+    sig_filename(name);
+  }
 
   string shortname;
   if (name.size() > 56)
@@ -1579,7 +1614,7 @@ bool Par2Repairer::ScanDataFile(DiskFile                *diskfile,    // [in]
   }
 
   // Create the checksummer for the file and start reading from it
-  FileCheckSummer filechecksummer(diskfile, blocksize, windowtable, windowmask);
+  FileCheckSummer filechecksummer(diskfile, blocksize, windowtable, windowmask, hashahead);
   if (!filechecksummer.Start())
     return false;
 
@@ -1598,7 +1633,36 @@ bool Par2Repairer::ScanDataFile(DiskFile                *diskfile,    // [in]
   // Which block do we expect to find first
   const VerificationHashEntry *nextentry = 0;
 
-  u64 progress = 0;
+  // Files verified concurrently share one progress indicator: each scan
+  // adds its own progress to the total and takes it out again when done.
+  struct ScanProgress
+  {
+    Par2Repairer &repairer;
+    u64 size;
+    u64 progress;
+    u64 reported;
+
+    ScanProgress(Par2Repairer &repairer, u64 size) : repairer(repairer), size(size), progress(0), reported(0)
+    {
+      std::lock_guard<std::mutex> lock(repairer.verificationmutex);
+      repairer.scantotal += size;
+    }
+
+    ~ScanProgress()
+    {
+      std::lock_guard<std::mutex> lock(repairer.verificationmutex);
+      repairer.scantotal -= size;
+      repairer.scanprogress -= reported;
+    }
+
+    // Must be called with verificationmutex held
+    u32 Report()
+    {
+      repairer.scanprogress += progress - reported;
+      reported = progress;
+      return (u32)(1000 * repairer.scanprogress / repairer.scantotal);
+    }
+  } scan(*this, diskfile->FileSize());
 
   // Whilst we have not reached the end of the file
   while (filechecksummer.Offset() < diskfile->FileSize())
@@ -1606,12 +1670,14 @@ bool Par2Repairer::ScanDataFile(DiskFile                *diskfile,    // [in]
     if (noiselevel > CommandLine::nlQuiet)
     {
       // Update a progress indicator
-      u32 oldfraction = (u32)(1000 * progress / diskfile->FileSize());
-      u32 newfraction = (u32)(1000 * (progress = filechecksummer.Offset()) / diskfile->FileSize());
+      u32 oldfraction = (u32)(1000 * scan.progress / diskfile->FileSize());
+      u32 newfraction = (u32)(1000 * (scan.progress = filechecksummer.Offset()) / diskfile->FileSize());
       if (oldfraction != newfraction)
       {
+        std::lock_guard<std::mutex> lock(verificationmutex);
+
         cout << "Scanning: \"" << shortname << "\": " << newfraction/10 << '.' << newfraction%10 << "%\r" << flush;
-	sig_progress(newfraction);
+	sig_progress(scan.Report());
 
         if (cancelled)
         {
@@ -1622,10 +1688,30 @@ bool Par2Repairer::ScanDataFile(DiskFile                *diskfile,    // [in]
 
     // If we fail to find a match, it might be because it was a duplicate of a block
     // that we have already found.
-    bool duplicate;
+    bool duplicate = false;
+
+    const VerificationHashEntry *currententry = 0;
+
+    // The hash table entries are shared with the files being verified
+    // concurrently, but only a window with a known checksum can match.
+    bool knownchecksum = verificationhashtable.Lookup(filechecksummer.Checksum()) != 0;
+    if (knownchecksum || nextentry != 0)
+    {
+      // Compute the hash before locking, the checksummer keeps it
+      if (knownchecksum)
+        filechecksummer.Hash();
 
-    // Look for a match
-    const VerificationHashEntry *currententry = verificationhashtable.FindMatch(nextentry, sourcefile, filechecksummer, duplicate);
+      std::lock_guard<std::mutex> lock(verificationmutex);
+
+      // Look for a match
+      currententry = verificationhashtable.FindMatch(nextentry, sourcefile, filechecksummer, duplicate);
+
+      if (currententry != 0 && blocksallocated)
+      {
+        // Record the match
+        currententry->SetBlock(diskfile, filechecksummer.Offset());
+      }
+    }
 
     // Did we find a match
     if (currententry != 0)
@@ -1661,12 +1747,6 @@ bool Par2Repairer::ScanDataFile(DiskFile                *diskfile,    // [in]
         }
       }
 
-      if (blocksallocated)
-      {
-        // Record the match
-        currententry->SetBlock(diskfile, filechecksummer.Offset());
-      }
-
       // Update the number of matches found
       count++;
 
@@ -1699,8 +1779,8 @@ bool Par2Repairer::ScanDataFile(DiskFile                *diskfile,    // [in]
         // What entry do we expect next
         nextentry = 0;
 
-        // Advance 1 byte
-        if (!filechecksummer.Step())
+        // Advance to the next position which may match
+        if (!filechecksummer.Scan(verificationhashtable))
           return false;
       }
     }
@@ -1714,6 +1794,8 @@ bool Par2Repairer::ScanDataFile(DiskFile                *diskfile,    // [in]
   // Get the Full and 16k hash values of the file
   filechecksummer.GetFileHashes(hashfull, hash16k);
 
+  std::lock_guard<std::mutex> lock(verificationmutex);
+
   // Did we make any matches at all
   if (count > 0)
   {
@@ -2248,11 +2330,13 @@ bool Par2Repairer::ComputeRSmatrix(void)
 // Allocate memory buffers for reading and writing data to disk.
 bool Par2Repairer::AllocateBuffers(size_t memorylimit)
 {
+  u32 buffercount = missingblockcount + ExtraBufferCount();
+
   // Would single pass processing use too much memory
-  if (blocksize * missingblockcount > memorylimit)
+  if (blocksize * buffercount > memorylimit)
   {
     // Pick a size that is small enough
-    chunksize = ~3 & (memorylimit / missingblockcount);
+    chunksize = ~3 & (memorylimit / buffercount);
   }
   else
   {
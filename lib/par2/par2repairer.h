@@ -77,6 +77,10 @@ protected:
   // Attempt to verify all of the source files
   bool VerifySourceFiles(void);
 
+  // Attempt to verify one of the source files. This may be called for
+  // several files concurrently (returns "false" if verification must stop).
+  bool VerifySourceFile(Par2RepairerSourceFile *sourcefile, bool &finalresult);
+
   // Scan any extra files specified on the command line
   bool VerifyExtraFiles(const list<CommandLine::ExtraFile> &extrafiles);
 
@@ -131,6 +135,10 @@ protected:
   virtual void sig_headers(ParHeaders* headers) {}
   virtual void sig_done(std::string filename, int available, int total) {}
 
+  // Number of chunk-sized buffers allocated by "BeginRepair" in addition to
+  // the input and output buffers, they count against the memory limit
+  virtual u32 ExtraBufferCount() { return 0; }
+
   // Repair started
   virtual void BeginRepair() {}
 
@@ -140,6 +148,9 @@ protected:
   // Repair chunk of data (returns "true" if repaired or "false" if default repair-routine should be used)
   virtual bool RepairData(u32 inputindex, size_t blocklength) { return false; }
 
+  // Verify source files concurrently using "VerifySourceFile" (returns "true" if verified or "false" if files should be verified one by one)
+  virtual bool VerifyFiles(const vector<Par2RepairerSourceFile*> &files, bool &finalresult) { return false; }
+
 protected:
   std::ostream&             cout;
   std::ostream&             cerr;
@@ -179,6 +190,10 @@ protected:
   bool                            blockverifiable;         // Whether and files can be verified at the block level
   VerificationHashTable           verificationhashtable;   // Hash table for block verification
   list<Par2RepairerSourceFile*>   unverifiablesourcefiles; // Files that are not block verifiable
+  std::mutex                      verificationmutex;       // Guards the above and the output when files are verified concurrently
+  u64                             hashahead;               // How much data each file checksummer may hash ahead
+  u64                             scantotal;               // Total size of the files being scanned
+  u64                             scanprogress;            // How much of scantotal has been scanned
 
   u32                       completefilecount;       // How many files are fully verified
   u32                       renamedfilecount;        // How many files are verified but have the wrong name
@@ -280,6 +280,15 @@ template <> bool ReedSolomon<Galois16>::Process(size_t size, u32 inputindex, con
   if (factor == 0)
     return eSuccess;
 
+  // Use the SIMD kernel if the CPU supports one
+  if (Galois16MulAdd)
+  {
+    Galois16NibbleTables tables;
+    tables.Prepare(factor);
+    Galois16MulAdd(tables, inputbuffer, outputbuffer, size);
+    return eSuccess;
+  }
+
 #ifdef LONGMULTIPLY
   // The 8-bit long multiplication tables
   Galois16 *table = glmt->tables;
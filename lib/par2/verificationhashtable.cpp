@@ -35,6 +35,8 @@ VerificationHashTable::VerificationHashTable(void)
 {
   hashmask = 0;
   hashtable = 0;
+  filtermask = 0;
+  crcfilter.resize(1);
 }
 
 VerificationHashTable::~VerificationHashTable(void)
@@ -66,6 +68,16 @@ void VerificationHashTable::SetLimit(u32 limit)
   memset(hashtable, 0, hashmask * sizeof(hashtable[0]));
 
   hashmask--;
+
+  // Keep the false positive rate of the crc filter low
+  u32 filterbits = 4096;
+  while (filterbits < (u64)limit * 64 && filterbits < (1 << 22))
+  {
+    filterbits <<= 1;
+  }
+
+  crcfilter.assign(filterbits / 64, 0);
+  filtermask = filterbits - 1;
 }
 
 // Load data from a verification packet
@@ -97,6 +109,9 @@ void VerificationHashTable::Load(Par2RepairerSourceFile *sourcefile, u64 blocksi
     // Insert the entry in the hash table
     entry->Insert(&hashtable[entry->Checksum() & hashmask]);
 
+    u32 bit = entry->Checksum() & filtermask;
+    crcfilter[bit >> 6] |= (u64)1 << (bit & 63);
+
     // Make the previous entry point forwards to this one
     if (preventry)
     {
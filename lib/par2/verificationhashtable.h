@@ -238,6 +238,9 @@ public:
   // Look up based on the block crc
   const VerificationHashEntry* Lookup(u32 crc) const;
 
+  // Quick test if there may be a block with the crc (false positives are possible)
+  bool MayContain(u32 crc) const;
+
   // Continue lookup based on the block hash
   const VerificationHashEntry* Lookup(const VerificationHashEntry *entry,
                                       const MD5Hash &hash);
@@ -245,6 +248,11 @@ public:
 protected:
   VerificationHashEntry **hashtable;
   unsigned int hashmask;
+
+  // Bitmap of block crcs, much smaller than the hash table and
+  // therefore faster to test while sliding through damaged data
+  vector<u64> crcfilter;
+  u32 filtermask;
 };
 
 // Search for an entry with the specified crc
@@ -258,6 +266,12 @@ inline const VerificationHashEntry* VerificationHashTable::Lookup(u32 crc) const
   return 0;
 }
 
+inline bool VerificationHashTable::MayContain(u32 crc) const
+{
+  u32 bit = crc & filtermask;
+  return (crcfilter[bit >> 6] >> (bit & 63)) & 1;
+}
+
 // Search for an entry with the specified hash
 inline const VerificationHashEntry* VerificationHashTable::Lookup(const VerificationHashEntry *entry,
                                                                   const MD5Hash &hash)
@@ -23,6 +23,7 @@
 #include "catch.h"
 
 #include "FeedFilter.h"
+#include "Util.h"
 
 void TestFilter(FeedItemInfo* feedItemInfo, const char* filterDef, FeedItemInfo::EMatchStatus expectedMatch)
 {
@@ -84,3 +85,147 @@ TEST_CASE("Feed filter: one liners", "[FeedFilter][Quick]")
 	TestFilter(&item, "A(k:series=GOT-${1}-${2}): Game of clowns S##E##", FeedItemInfo::msAccepted);
 	TestFilter(&item, "A(k:series=GOT-${1}-${2}): $.+S([0-9]{1,2})E([0-9]{1,2})", FeedItemInfo::msAccepted);
 }
+
+TEST_CASE("Feed filter: item list", "[FeedFilter][Quick]")
+{
+	FeedItemList items;
+	items.emplace_back();
+	items.back().SetTitle("Game.of.Clowns.S02E06.720p.HDTV");
+	items.emplace_back();
+	items.back().SetTitle("Game.of.Clowns.S02E07.1080p.WEB-DL");
+	items.emplace_back();
+	items.back().SetTitle("Kings.of.Castles.S01E01.1080p");
+
+	FeedFilter filter(
+		"R: game 720p%"
+		"O(k:got-${1}): game of clowns $.+S([0-9]{1,2})E[0-9]{1,2}%"
+		"A: dupekey:got-02 1080p%"
+		"A: ( kings | queens ) -720p");
+	filter.Match(items);
+
+	REQUIRE(items[0].GetMatchStatus() == FeedItemInfo::msRejected);
+	REQUIRE(items[0].GetMatchRule() == 1);
+	REQUIRE(items[1].GetMatchStatus() == FeedItemInfo::msAccepted);
+	REQUIRE(items[1].GetMatchRule() == 3);
+	REQUIRE(!strcmp(items[1].GetDupeKey(), "got-02"));
+	REQUIRE(items[2].GetMatchStatus() == FeedItemInfo::msAccepted);
+	REQUIRE(items[2].GetMatchRule() == 4);
+}
+
+TEST_CASE("Feed history: find by url", "[FeedFilter][Quick]")
+{
+	FeedHistory feedHistory;
+	REQUIRE(feedHistory.Find("http://host/1") == nullptr);
+
+	for (int i = 1; i <= 100; i++)
+	{
+		feedHistory.emplace_back(BString<100>("http://host/%i", i), FeedHistoryInfo::hsFetched, i);
+	}
+
+	REQUIRE(feedHistory.Find("http://host/50") == &feedHistory[49]);
+	feedHistory.emplace_back("http://host/101", FeedHistoryInfo::hsBacklog, 101);
+	REQUIRE(feedHistory.Find("http://host/101") == &feedHistory.back());
+
+	feedHistory.erase(std::remove_if(feedHistory.begin(), feedHistory.end(),
+		[](FeedHistoryInfo& feedHistoryInfo) { return feedHistoryInfo.GetLastSeen() <= 50; }),
+		feedHistory.end());
+	REQUIRE(feedHistory.Find("http://host/50") == nullptr);
+	REQUIRE(feedHistory.Find("http://host/51") == &feedHistory[0]);
+
+	feedHistory.Remove("http://host/51");
+	REQUIRE(feedHistory.Find("http://host/51") == nullptr);
+	REQUIRE(feedHistory.Find("http://host/52") == &feedHistory[0]);
+}
+
+// Builds a watchlist filter and the same filter with references to matched text
+// in all accept rules (option "k:${1}"). Such rules are evaluated term by term,
+// other rules search literal terms and literal parts of wildcard terms of all
+// rules in one pass over each field.
+static void MakeWatchlist(int ruleCount, int itemCount, StringBuilder& filterDef,
+	StringBuilder& refFilterDef, FeedItemList& items, FeedItemList& refItems)
+{
+	for (int i = 0; i < ruleCount; i++)
+	{
+		BString<1024> terms;
+		switch (i % 4)
+		{
+			case 0: terms.Format("alpha%i beta%i", i, i % 10); break;
+			case 1: terms.Format("gamma%i.delta", i); break;
+			case 2: terms.Format("epsilon%i* -720p s##e*", i); break;
+			case 3: terms.Format("category:*tv?hd* zeta%i", i); break;
+		}
+		filterDef.Append(BString<1024>("%s: %s%%", i % 5 == 4 ? "R" : "A", *terms));
+		// reject rules don't have options
+		refFilterDef.Append(BString<1024>("%s: %s%%", i % 5 == 4 ? "R" : "A(k:x${1})", *terms));
+	}
+	filterDef.Append("A: *omega*%A: eta#*.theta");
+	refFilterDef.Append("A(k:x${1}): *omega*%A(k:x${1}): eta#*.theta");
+
+	for (int i = 0; i < itemCount; i++)
+	{
+		int k = (i * 7919) % (ruleCount * 4 / 3);
+		items.emplace_back();
+		FeedItemInfo& item = items.back();
+		switch (i % 5)
+		{
+			case 0: item.SetTitle(BString<1024>("Alpha%i.Beta%i.S01E02.720p", k, k % 10)); break;
+			case 1: item.SetTitle(BString<1024>("Gamma%i.Delta.1080p", k)); break;
+			case 2: item.SetTitle(BString<1024>("Epsilon%i.S02E03.%s", k, i % 3 ? "1080p" : "720p")); break;
+			case 3: item.SetTitle(BString<1024>("Zeta%i.Omega", k)); break;
+			case 4: item.SetTitle(BString<1024>("Eta%i.Theta", k)); break;
+		}
+		item.SetCategory(i % 2 ? "TV > HD" : "Movies");
+
+		refItems.emplace_back();
+		refItems.back().SetTitle(item.GetTitle());
+		refItems.back().SetCategory(item.GetCategory());
+	}
+}
+
+TEST_CASE("Feed filter: watchlist", "[FeedFilter][Quick]")
+{
+	StringBuilder filterDef;
+	StringBuilder refFilterDef;
+	FeedItemList items;
+	FeedItemList refItems;
+	MakeWatchlist(40, 200, filterDef, refFilterDef, items, refItems);
+
+	FeedFilter filter(filterDef);
+	filter.Match(items);
+
+	FeedFilter refFilter(refFilterDef);
+	refFilter.Match(refItems);
+
+	int accepted = 0;
+	for (int i = 0; i < (int)items.size(); i++)
+	{
+		INFO(items[i].GetTitle());
+		REQUIRE(items[i].GetMatchStatus() == refItems[i].GetMatchStatus());
+		REQUIRE(items[i].GetMatchRule() == refItems[i].GetMatchRule());
+		accepted += items[i].GetMatchStatus() == FeedItemInfo::msAccepted ? 1 : 0;
+	}
+
+	REQUIRE(accepted > 0);
+}
+
+// Hidden from the default run; start with: nzbget --tests "[Benchmark]" -d yes
+TEST_CASE("Feed filter: watchlist benchmark", "[FeedFilter][Benchmark][.]")
+{
+	StringBuilder filterDef;
+	StringBuilder refFilterDef;
+	FeedItemList items;
+	FeedItemList refItems;
+	MakeWatchlist(300, 2000, filterDef, refFilterDef, items, refItems);
+
+	SECTION("compiled")
+	{
+		FeedFilter filter(filterDef);
+		filter.Match(items);
+	}
+
+	SECTION("term by term")
+	{
+		FeedFilter refFilter(refFilterDef);
+		refFilter.Match(refItems);
+	}
+}
@@ -36,7 +36,8 @@ public:
 protected:
 	virtual void AddNewsServer(int id, bool active, const char* name, const char* host,
 		int port, int ipVersion, const char* user, const char* pass, bool joinGroup, bool tls,
-		const char* cipher, int maxConnections, int retention, int level, int group, bool optional)
+		const char* cipher, int maxConnections, int retention, int level, int group, bool optional,
+		int pipelining)
 	{
 		m_newsServers++;
 	}
@@ -27,7 +27,7 @@
 void AddTestServer(ServerPool* pool, int id, bool active, int level, bool optional, int group, int connections)
 {
 	pool->AddServer(std::make_unique<NewsServer>(id, active, nullptr, "", 119, 0,
-		"", "", false, false, nullptr, connections, 0, level, group, optional));
+		"", "", false, false, nullptr, connections, 0, level, group, optional, 0));
 }
 
 TEST_CASE("Server pool: simple levels", "[ServerPool]")
@@ -270,3 +270,32 @@ TEST_CASE("Server pool: block optional and non-optional servers", "[ServerPool]"
 	REQUIRE(con3 == nullptr);
 	REQUIRE(con4 == nullptr);
 }
+
+TEST_CASE("Server pool: pipelining", "[ServerPool]")
+{
+	ServerPool pool;
+	pool.AddServer(std::make_unique<NewsServer>(1, true, nullptr, "", 119, 0,
+		"", "", false, false, nullptr, 2, 0, 0, 0, false, 3));
+	pool.InitConnections();
+
+	NntpConnection* con1 = pool.GetConnection(0, nullptr, nullptr);
+	NntpConnection* con2 = pool.GetConnection(0, nullptr, nullptr);
+	REQUIRE(con1 != nullptr);
+	REQUIRE(con2 != nullptr);
+	REQUIRE(con1 != con2);
+	CHECK(con1->GetPipelining() == 3);
+
+	// connections which are not yet established can't be shared
+	NntpConnection* con3 = pool.GetConnection(0, nullptr, nullptr);
+	REQUIRE(con3 == nullptr);
+
+	pool.FreeConnection(con1, false);
+	con3 = pool.GetConnection(0, nullptr, nullptr);
+	REQUIRE(con3 == con1);
+}
+
+TEST_CASE("Server pool: no pipelining with join group", "[ServerPool]")
+{
+	NewsServer server(1, true, nullptr, "", 119, 0, "", "", true, false, nullptr, 2, 0, 0, 0, false, 3);
+	REQUIRE(server.GetPipelining() == 1);
+}
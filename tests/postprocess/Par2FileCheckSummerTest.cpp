@@ -0,0 +1,246 @@
+/*
+ *  This file is part of nzbget. See <http://nzbget.net>.
+ *
+ *  Copyright (C) 2015-2016 Andrey Prygunkov <hugbug@users.sourceforge.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "nzbget.h"
+
+#include <iostream>
+
+#include "catch.h"
+
+#include "par2cmdline.h"
+#include "FileSystem.h"
+#include "TestUtil.h"
+
+using namespace Par2;
+
+static MD5Hash ReferenceHash(const void* buffer, size_t length)
+{
+	MD5Context context;
+	context.Update(buffer, length);
+	MD5Hash hash;
+	context.Final(hash);
+	return hash;
+}
+
+static void FillRandom(std::vector<u8>& buffer)
+{
+	for (u8& value : buffer)
+	{
+		value = (u8)rand();
+	}
+}
+
+TEST_CASE("Par2: FileCheckSummer hash ahead", "[Par2][FileCheckSummer]")
+{
+	TestUtil::PrepareWorkingDir("nzbfile");
+	std::string filename(TestUtil::WorkingDir() + "/checksummer.dat");
+
+	const u64 blocksize = 4096;
+	srand(1);
+	std::vector<u8> data(blocksize * 10 + 100);
+	FillRandom(data);
+	REQUIRE(FileSystem::SaveBufferIntoFile(filename.c_str(), (const char*)data.data(), data.size()));
+
+	u32 windowtable[256];
+	GenerateWindowTable(blocksize, windowtable);
+	u32 windowmask = ComputeWindowMask(blocksize);
+
+	Par2::DiskFile diskfile(std::cerr);
+	REQUIRE(diskfile.Open(filename));
+
+	FileCheckSummer checksummer(&diskfile, blocksize, windowtable, windowmask);
+	REQUIRE(checksummer.Start());
+
+	// the window is zero padded at the end of the file
+	std::vector<u8> padded(data);
+	padded.resize(data.size() + blocksize);
+
+	int step = 0;
+	while (checksummer.Offset() < data.size())
+	{
+		u64 offset = checksummer.Offset();
+		INFO("Offset " << offset);
+
+		CHECK(checksummer.Checksum() == (~0 ^ CRCUpdateBlock(~0, blocksize, &padded[offset])));
+		CHECK(checksummer.Hash() == ReferenceHash(&padded[offset], blocksize));
+
+		// mostly whole blocks as in undamaged files, with some shifts
+		step++;
+		if (step % 7 == 0)
+		{
+			REQUIRE(checksummer.Step());
+		}
+		else if (step % 5 == 0)
+		{
+			REQUIRE(checksummer.Jump(blocksize / 3));
+		}
+		else
+		{
+			REQUIRE(checksummer.Jump(blocksize));
+		}
+	}
+
+	MD5Hash hashfull;
+	MD5Hash hash16k;
+	checksummer.GetFileHashes(hashfull, hash16k);
+	CHECK(hashfull == ReferenceHash(data.data(), data.size()));
+	CHECK(hash16k == ReferenceHash(data.data(), 16384));
+
+	diskfile.Close();
+}
+
+class ScanHashTable : public VerificationHashTable
+{
+public:
+	void Add(u32 crc)
+	{
+		u32 bit = crc & filtermask;
+		crcfilter[bit >> 6] |= (u64)1 << (bit & 63);
+	}
+};
+
+TEST_CASE("Par2: FileCheckSummer scan", "[Par2][FileCheckSummer]")
+{
+	TestUtil::PrepareWorkingDir("nzbfile");
+	std::string filename(TestUtil::WorkingDir() + "/checksummer.dat");
+
+	const u64 blocksize = 4096;
+	srand(2);
+	std::vector<u8> data(blocksize * 30 + 1234);
+	FillRandom(data);
+	REQUIRE(FileSystem::SaveBufferIntoFile(filename.c_str(), (const char*)data.data(), data.size()));
+
+	std::vector<u8> padded(data);
+	padded.resize(data.size() + blocksize);
+
+	u32 windowtable[256];
+	GenerateWindowTable(blocksize, windowtable);
+	u32 windowmask = ComputeWindowMask(blocksize);
+
+	// blocks at misaligned offsets, including ones at lane and buffer boundaries
+	ScanHashTable table;
+	table.SetLimit(16);
+	std::vector<u64> offsets = {1, 2, 777, blocksize, blocksize + 1, blocksize * 3 - 1,
+		blocksize * 7 + 5, blocksize * 19, blocksize * 29 + 999, data.size() - 1};
+	for (u64 offset : offsets)
+	{
+		table.Add(~0 ^ CRCUpdateBlock(~0, blocksize, &padded[offset]));
+	}
+
+	// reference: step one byte at a time
+	std::vector<u64> expected;
+	{
+		Par2::DiskFile diskfile(std::cerr);
+		REQUIRE(diskfile.Open(filename));
+		FileCheckSummer checksummer(&diskfile, blocksize, windowtable, windowmask);
+		REQUIRE(checksummer.Start());
+		while (checksummer.Step() && checksummer.Offset() < data.size())
+		{
+			if (table.MayContain(checksummer.Checksum()))
+			{
+				expected.push_back(checksummer.Offset());
+			}
+		}
+		diskfile.Close();
+	}
+
+	CHECK(expected.size() >= offsets.size());
+
+	std::vector<u64> found;
+	{
+		Par2::DiskFile diskfile(std::cerr);
+		REQUIRE(diskfile.Open(filename));
+		FileCheckSummer checksummer(&diskfile, blocksize, windowtable, windowmask);
+		REQUIRE(checksummer.Start());
+		while (checksummer.Scan(table) && checksummer.Offset() < data.size())
+		{
+			u64 offset = checksummer.Offset();
+			INFO("Offset " << offset);
+			REQUIRE(checksummer.Checksum() == (~0 ^ CRCUpdateBlock(~0, blocksize, &padded[offset])));
+			if (table.MayContain(checksummer.Checksum()))
+			{
+				found.push_back(offset);
+			}
+		}
+
+		MD5Hash hashfull;
+		MD5Hash hash16k;
+		checksummer.GetFileHashes(hashfull, hash16k);
+		CHECK(hashfull == ReferenceHash(data.data(), data.size()));
+
+		diskfile.Close();
+	}
+
+	CHECK(found == expected);
+}
+
+// Hidden from the default run; start with: nzbget --tests "[Benchmark]" -d yes
+TEST_CASE("Par2: FileCheckSummer scan benchmark", "[Par2][FileCheckSummer][Benchmark][.]")
+{
+	TestUtil::PrepareWorkingDir("nzbfile");
+	std::string filename(TestUtil::WorkingDir() + "/checksummer.dat");
+
+	const u64 blocksize = 768000;
+	srand(3);
+	std::vector<u8> data(64 * 1024 * 1024);
+	FillRandom(data);
+	REQUIRE(FileSystem::SaveBufferIntoFile(filename.c_str(), (const char*)data.data(), data.size()));
+
+	u32 windowtable[256];
+	GenerateWindowTable(blocksize, windowtable);
+	u32 windowmask = ComputeWindowMask(blocksize);
+
+	ScanHashTable table;
+	table.SetLimit(30000);
+	for (int i = 0; i < 30000; i++)
+	{
+		table.Add((u32)rand() * 65536 + (u32)rand());
+	}
+
+	Par2::DiskFile diskfile(std::cerr);
+	REQUIRE(diskfile.Open(filename));
+
+	SECTION("step")
+	{
+		FileCheckSummer checksummer(&diskfile, blocksize, windowtable, windowmask);
+		REQUIRE(checksummer.Start());
+		bool ok = true;
+		while (ok && checksummer.Offset() < data.size())
+		{
+			table.MayContain(checksummer.Checksum());
+			ok = checksummer.Step();
+		}
+		REQUIRE(ok);
+	}
+
+	SECTION("scan")
+	{
+		FileCheckSummer checksummer(&diskfile, blocksize, windowtable, windowmask);
+		REQUIRE(checksummer.Start());
+		bool ok = true;
+		while (ok && checksummer.Offset() < data.size())
+		{
+			ok = checksummer.Scan(table);
+		}
+		REQUIRE(ok);
+	}
+
+	diskfile.Close();
+}
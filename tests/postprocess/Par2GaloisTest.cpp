@@ -0,0 +1,167 @@
+/*
+ *  This file is part of nzbget. See <http://nzbget.net>.
+ *
+ *  Copyright (C) 2015-2016 Andrey Prygunkov <hugbug@users.sourceforge.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "nzbget.h"
+
+#include <iostream>
+
+#include "catch.h"
+
+#include "par2cmdline.h"
+
+using namespace Par2;
+
+static void MulAddReference(u16 factor, const u16* src, u16* dst, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		Galois16 product = Galois16(src[i]) * Galois16(factor);
+		dst[i] ^= product.Value();
+	}
+}
+
+static void FillRandom(std::vector<u16>& buffer)
+{
+	for (u16& value : buffer)
+	{
+		value = (u16)rand();
+	}
+}
+
+TEST_CASE("Par2: Galois16 nibble tables", "[Par2][Galois]")
+{
+	srand(1);
+	const u16 factors[] = {1, 2, 0x8000, 0xFFFF, 0x1234, (u16)rand(), (u16)rand()};
+	for (u16 factor : factors)
+	{
+		Galois16NibbleTables tables;
+		tables.Prepare(factor);
+
+		std::vector<u16> src(1000);
+		FillRandom(src);
+		std::vector<u16> dst(src.size());
+		FillRandom(dst);
+		std::vector<u16> expected(dst);
+
+		MulAddReference(factor, src.data(), expected.data(), src.size());
+		Galois16MulAddScalar(tables, src.data(), dst.data(), src.size());
+
+		REQUIRE(dst == expected);
+	}
+}
+
+TEST_CASE("Par2: Galois16 multiply-add kernels", "[Par2][Galois]")
+{
+	srand(1);
+	for (Galois16MulAddKernel& kernel : Galois16MulAddKernels)
+	{
+		INFO("Kernel " << kernel.name);
+
+		for (int count : {1, 15, 16, 31, 32, 33, 64, 127, 500, 4099})
+		{
+			INFO("Count " << count);
+
+			u16 factor = (u16)rand();
+			Galois16NibbleTables tables;
+			tables.Prepare(factor);
+
+			// unaligned buffers
+			std::vector<u16> src(count + 1);
+			FillRandom(src);
+			std::vector<u16> dst(count + 1);
+			FillRandom(dst);
+			std::vector<u16> expected(dst);
+
+			MulAddReference(factor, src.data() + 1, expected.data() + 1, count);
+			kernel.func(tables, src.data() + 1, dst.data() + 1, count * 2);
+
+			REQUIRE(dst == expected);
+		}
+	}
+}
+
+static bool PrepareReedSolomon(ReedSolomon<Galois16>& rs)
+{
+	// one data block is missing and is to be restored from a recovery block
+	vector<bool> present = {true, false};
+	return rs.SetInput(present) && rs.SetOutput(true, 7) && rs.Compute(CommandLine::nlSilent);
+}
+
+TEST_CASE("Par2: Reed Solomon process", "[Par2][Galois]")
+{
+	ReedSolomon<Galois16> rs(std::cout, std::cerr);
+	REQUIRE(PrepareReedSolomon(rs));
+
+	srand(1);
+	std::vector<u16> input(100000);
+	FillRandom(input);
+
+	Galois16MulAddFunc bestKernel = Galois16MulAdd;
+
+	Galois16MulAdd = nullptr;
+	std::vector<u16> expected(input.size());
+	rs.Process(input.size() * 2, 0, input.data(), 0, expected.data());
+	rs.Process(input.size() * 2, 1, input.data(), 0, expected.data());
+
+	for (Galois16MulAddKernel& kernel : Galois16MulAddKernels)
+	{
+		INFO("Kernel " << kernel.name);
+		Galois16MulAdd = kernel.func;
+		std::vector<u16> output(input.size());
+		rs.Process(input.size() * 2, 0, input.data(), 0, output.data());
+		rs.Process(input.size() * 2, 1, input.data(), 0, output.data());
+		CHECK(output == expected);
+	}
+
+	Galois16MulAdd = bestKernel;
+}
+
+// Hidden from the default run; start with: nzbget --tests "[Benchmark]" -d yes
+TEST_CASE("Par2: Galois16 multiply-add benchmark", "[Par2][Benchmark][.]")
+{
+	srand(1);
+	Galois16NibbleTables tables;
+	tables.Prepare((u16)rand());
+
+	const int blockSize = 1024 * 1024;
+	const int passes = 200;
+	std::vector<u16> input(blockSize / 2);
+	FillRandom(input);
+	std::vector<u16> output(input.size());
+
+	SECTION("scalar")
+	{
+		for (int i = 0; i < passes; i++)
+		{
+			Galois16MulAddScalar(tables, input.data(), output.data(), input.size());
+		}
+	}
+
+	for (Galois16MulAddKernel& kernel : Galois16MulAddKernels)
+	{
+		SECTION(kernel.name)
+		{
+			for (int i = 0; i < passes; i++)
+			{
+				kernel.func(tables, input.data(), output.data(), blockSize);
+			}
+		}
+	}
+}
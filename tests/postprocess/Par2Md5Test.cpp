@@ -0,0 +1,88 @@
+/*
+ *  This file is part of nzbget. See <http://nzbget.net>.
+ *
+ *  Copyright (C) 2015-2016 Andrey Prygunkov <hugbug@users.sourceforge.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "nzbget.h"
+
+#include "catch.h"
+
+#include "par2cmdline.h"
+
+using namespace Par2;
+
+static MD5Hash ReferenceHash(const void* buffer, size_t length)
+{
+	MD5Context context;
+	context.Update(buffer, length);
+	MD5Hash hash;
+	context.Final(hash);
+	return hash;
+}
+
+static void FillRandom(std::vector<u8>& buffer)
+{
+	for (u8& value : buffer)
+	{
+		value = (u8)rand();
+	}
+}
+
+TEST_CASE("Par2: MD5 multi-buffer", "[Par2][MD5]")
+{
+	srand(1);
+	for (size_t length : {0, 1, 55, 56, 63, 64, 65, 119, 120, 1000, 4103})
+	{
+		INFO("Length " << length);
+
+		for (size_t count = 1; count <= MD5MaxLanes + 1; count++)
+		{
+			INFO("Count " << count);
+
+			// unaligned buffers
+			std::vector<u8> data(count * length + 1);
+			FillRandom(data);
+			std::vector<const void*> buffers;
+			for (size_t i = 0; i < count; i++)
+			{
+				buffers.push_back(data.data() + 1 + i * length);
+			}
+
+			std::vector<MD5Hash> hashes(count);
+			MD5HashBuffers(buffers.data(), count, length, hashes.data());
+
+			for (size_t i = 0; i < count; i++)
+			{
+				CHECK(hashes[i] == ReferenceHash(buffers[i], length));
+			}
+
+			for (MD5LanesKernel& kernel : MD5LanesKernels)
+			{
+				INFO("Kernel " << kernel.name);
+
+				std::vector<MD5Hash> kernelHashes(count);
+				MD5HashBuffers(kernel, buffers.data(), count, length, kernelHashes.data());
+
+				for (size_t i = 0; i < count; i++)
+				{
+					CHECK(kernelHashes[i] == hashes[i]);
+				}
+			}
+		}
+	}
+}
@@ -25,6 +25,8 @@
 #include "Options.h"
 #include "ParChecker.h"
 #include "TestUtil.h"
+#include "par2cmdline.h"
+#include "md5.h"
 
 class ParCheckerMock: public ParChecker
 {
@@ -32,12 +34,19 @@ public:
 	ParCheckerMock();
 	void Execute();
 	void CorruptFile(const char* filename, int offset);
+	void InsertIntoFile(const char* filename, int offset, int count);
+	void SetFileHashes(bool fileHashes) { m_fileHashes = fileHashes; }
 
 protected:
 	virtual bool RequestMorePars(int blockNeeded, int* blockFound) { return false; }
 	virtual EFileStatus FindFileCrc(const char* filename, uint32* crc, SegmentList* segments);
+	virtual const char* FindFileHash(const char* filename);
 
 private:
+	bool m_fileHashes = false;
+	std::map<std::string, std::string> m_hashes;
+	Mutex m_hashMutex;
+
 	uint32 CalcFileCrc(const char* filename);
 };
 
@@ -69,6 +78,18 @@ void ParCheckerMock::CorruptFile(const char* filename, int offset)
 	fclose(file);
 }
 
+void ParCheckerMock::InsertIntoFile(const char* filename, int offset, int count)
+{
+	std::string fullfilename(TestUtil::WorkingDir() + "/" + filename);
+
+	CharBuffer buffer;
+	REQUIRE(FileSystem::LoadFileIntoBuffer(fullfilename.c_str(), buffer, false));
+
+	std::string data(buffer, buffer.Size());
+	data.insert(offset, count, 'x');
+	REQUIRE(FileSystem::SaveBufferIntoFile(fullfilename.c_str(), data.c_str(), data.size()));
+}
+
 ParCheckerMock::EFileStatus ParCheckerMock::FindFileCrc(const char* filename, uint32* crc, SegmentList* segments)
 {
 	std::ifstream sm((TestUtil::WorkingDir() + "/crc.txt").c_str());
@@ -80,12 +101,37 @@ ParCheckerMock::EFileStatus ParCheckerMock::FindFileCrc(const char* filename, ui
 		{
 			*crc = strtoul(smcrc.c_str(), nullptr, 16);
 			uint32 realCrc = CalcFileCrc((TestUtil::WorkingDir() + "/" + filename).c_str());
+			if (m_fileHashes)
+			{
+				// CRC not known but the file was hashed during download
+				*crc = 0;
+				return ParChecker::fsSuccess;
+			}
 			return *crc == realCrc ? ParChecker::fsSuccess : ParChecker::fsUnknown;
 		}
 	}
 	return ParChecker::fsUnknown;
 }
 
+const char* ParCheckerMock::FindFileHash(const char* filename)
+{
+	if (!m_fileHashes)
+	{
+		return nullptr;
+	}
+
+	CharBuffer buffer;
+	REQUIRE(FileSystem::LoadFileIntoBuffer((TestUtil::WorkingDir() + "/" + filename).c_str(), buffer, false));
+
+	Par2::MD5Context context;
+	context.Update(buffer, buffer.Size());
+	Par2::MD5Hash hash;
+	context.Final(hash);
+
+	Guard guard(m_hashMutex);
+	return m_hashes[filename].assign(hash.print()).c_str();
+}
+
 uint32 ParCheckerMock::CalcFileCrc(const char* filename)
 {
 	FILE* infile = fopen(filename, FOPEN_RB);
@@ -147,6 +193,53 @@ TEST_CASE("Par-checker: repair successful", "[Par][ParChecker][Slow][TestData]")
 	REQUIRE(parChecker.GetParFull() == true);
 }
 
+TEST_CASE("Par-checker: parallel repair successful", "[Par][ParChecker][Slow][TestData]")
+{
+	Options::CmdOptList cmdOpts;
+	cmdOpts.push_back("ParRepair=yes");
+	cmdOpts.push_back("ParThreads=4");
+	Options options(&cmdOpts, nullptr);
+
+	ParCheckerMock parChecker;
+	parChecker.CorruptFile("testfile.dat", 20000);
+	parChecker.CorruptFile("testfile.dat", 50000);
+	parChecker.Execute();
+
+	REQUIRE(parChecker.GetStatus() == ParChecker::psRepaired);
+	REQUIRE(parChecker.GetParFull() == true);
+}
+
+TEST_CASE("Par-checker: parallel verification", "[Par][ParChecker][Slow][TestData]")
+{
+	Options::CmdOptList cmdOpts;
+	cmdOpts.push_back("ParRepair=no");
+	cmdOpts.push_back("ParThreads=4");
+	Options options(&cmdOpts, nullptr);
+
+	ParCheckerMock parChecker;
+	parChecker.CorruptFile("testfile.dat", 20000);
+	parChecker.CorruptFile("testfile.nfo", 100);
+	parChecker.Execute();
+
+	REQUIRE(parChecker.GetStatus() == ParChecker::psRepairPossible);
+	REQUIRE(parChecker.GetParFull() == true);
+}
+
+TEST_CASE("Par-checker: misaligned blocks", "[Par][ParChecker][Slow][TestData]")
+{
+	Options::CmdOptList cmdOpts;
+	cmdOpts.push_back("ParRepair=yes");
+	Options options(&cmdOpts, nullptr);
+
+	// all blocks after the inserted data are shifted and must be found by scanning
+	ParCheckerMock parChecker;
+	parChecker.InsertIntoFile("testfile.dat", 20000, 123);
+	parChecker.Execute();
+
+	REQUIRE(parChecker.GetStatus() == ParChecker::psRepaired);
+	REQUIRE(parChecker.GetParFull() == true);
+}
+
 TEST_CASE("Par-checker: repair failed", "[Par][ParChecker][Slow][TestData]")
 {
 	Options::CmdOptList cmdOpts;
@@ -196,6 +289,31 @@ TEST_CASE("Par-checker: quick verification repair successful", "[Par][ParChecker
 	REQUIRE(parChecker.GetParFull() == false);
 }
 
+TEST_CASE("Par-checker: quick verification using file hashes", "[Par][ParChecker][Slow][TestData]")
+{
+	Options::CmdOptList cmdOpts;
+	cmdOpts.push_back("ParRepair=no");
+	Options options(&cmdOpts, nullptr);
+
+	ParCheckerMock parChecker;
+	parChecker.SetParQuick(true);
+	parChecker.SetFileHashes(true);
+
+	SECTION("good files")
+	{
+		parChecker.Execute();
+		REQUIRE(parChecker.GetStatus() == ParChecker::psRepairNotNeeded);
+		REQUIRE(parChecker.GetParFull() == false);
+	}
+
+	SECTION("damaged file")
+	{
+		parChecker.CorruptFile("testfile.dat", 20000);
+		parChecker.Execute();
+		REQUIRE(parChecker.GetStatus() == ParChecker::psRepairPossible);
+	}
+}
+
 TEST_CASE("Par-checker: quick full verification repair successful", "[Par][ParChecker][Slow][TestData]")
 {
 	Options::CmdOptList cmdOpts;
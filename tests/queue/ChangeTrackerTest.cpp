@@ -0,0 +1,123 @@
+/*
+ *  This file is part of nzbget. See <http://nzbget.net>.
+ *
+ *  Copyright (C) 2015-2016 Andrey Prygunkov <hugbug@users.sourceforge.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "nzbget.h"
+
+#include "catch.h"
+
+#include "DownloadInfo.h"
+
+TEST_CASE("ChangeTracker: revisions", "[ChangeTracker][Quick]")
+{
+	ChangeTracker changeTracker;
+	int instance = changeTracker.GetInstance();
+	REQUIRE_FALSE(changeTracker.IsKnownRevision(instance, 0));
+
+	// new items are stamped with revision of the scan
+	changeTracker.BeginScan();
+	int64 revision1 = ChangeTracker::GetRevision();
+	REQUIRE(changeTracker.Scan(ChangeTracker::ikGroup, 1, 0) == revision1);
+	REQUIRE(changeTracker.Scan(ChangeTracker::ikGroup, 2, 0) == revision1);
+	REQUIRE(changeTracker.Scan(ChangeTracker::ikHistory, 1, 0) == revision1);
+	changeTracker.EndScan();
+	REQUIRE(changeTracker.IsKnownRevision(instance, revision1));
+	REQUIRE_FALSE(changeTracker.IsKnownRevision(instance + 1, revision1));
+
+	// unchanged items keep their revision
+	changeTracker.BeginScan();
+	REQUIRE(changeTracker.Scan(ChangeTracker::ikGroup, 1, 0) == revision1);
+	REQUIRE(changeTracker.Scan(ChangeTracker::ikGroup, 2, 0) == revision1);
+	REQUIRE(changeTracker.Scan(ChangeTracker::ikHistory, 1, 0) == revision1);
+	changeTracker.EndScan();
+
+	// changed and deleted items
+	int64 changed = ChangeTracker::NextRevision();
+	changeTracker.BeginScan();
+	int64 revision2 = ChangeTracker::GetRevision();
+	REQUIRE(changeTracker.Scan(ChangeTracker::ikGroup, 1, changed) == changed);
+	REQUIRE(changeTracker.Scan(ChangeTracker::ikHistory, 1, 0) == revision1);
+	changeTracker.EndScan();
+
+	IdList deleted;
+	changeTracker.ListDeleted(ChangeTracker::ikGroup, revision1, &deleted);
+	REQUIRE(deleted.size() == 1);
+	REQUIRE(deleted[0] == 2);
+
+	deleted.clear();
+	changeTracker.ListDeleted(ChangeTracker::ikHistory, revision1, &deleted);
+	REQUIRE(deleted.empty());
+
+	deleted.clear();
+	changeTracker.ListDeleted(ChangeTracker::ikGroup, revision2, &deleted);
+	REQUIRE(deleted.empty());
+}
+
+TEST_CASE("ChangeTracker: setters stamp revisions", "[ChangeTracker][Quick]")
+{
+	NzbInfo nzbInfo;
+	FileInfo fileInfo;
+
+	int64 revision = ChangeTracker::GetRevision();
+	fileInfo.SetRemainingSize(100);
+	REQUIRE(fileInfo.GetChangeRevision() > revision);
+	REQUIRE(nzbInfo.GetFileItemRevision() <= revision);
+
+	revision = ChangeTracker::GetRevision();
+	nzbInfo.SetCategory("movies");
+	REQUIRE(nzbInfo.GetChangeRevision() > revision);
+	REQUIRE(nzbInfo.GetFileItemRevision() > revision);
+
+	revision = ChangeTracker::GetRevision();
+	nzbInfo.SetChanged(true);
+	REQUIRE(nzbInfo.GetChangeRevision() > revision);
+	REQUIRE(nzbInfo.GetFileItemRevision() <= revision);
+
+	revision = ChangeTracker::GetRevision();
+	nzbInfo.SetDupeScore(10);
+	REQUIRE(nzbInfo.GetChangeRevision() > revision);
+
+	revision = ChangeTracker::GetRevision();
+	nzbInfo.UpdateDeletedStats(&fileInfo);
+	REQUIRE(nzbInfo.GetChangeRevision() > revision);
+	REQUIRE(nzbInfo.GetFileItemRevision() <= revision);
+}
+
+TEST_CASE("ChangeTracker: revisions per kind", "[ChangeTracker][Quick]")
+{
+	NzbInfo nzbInfo;
+	FileInfo fileInfo;
+
+	int64 group = ChangeTracker::GetRevision(ChangeTracker::ikGroup);
+	int64 history = ChangeTracker::GetRevision(ChangeTracker::ikHistory);
+	fileInfo.SetRemainingSize(100);
+	REQUIRE(ChangeTracker::GetRevision(ChangeTracker::ikFile) == fileInfo.GetChangeRevision());
+	REQUIRE(ChangeTracker::GetRevision(ChangeTracker::ikGroup) == group);
+	REQUIRE(ChangeTracker::GetRevision(ChangeTracker::ikHistory) == history);
+
+	// items not in the queue belong to the history
+	nzbInfo.SetDupeScore(10);
+	REQUIRE(ChangeTracker::GetRevision(ChangeTracker::ikHistory) == nzbInfo.GetChangeRevision());
+	REQUIRE(ChangeTracker::GetRevision(ChangeTracker::ikGroup) == group);
+
+	ChangeTracker::TouchAll();
+	REQUIRE(ChangeTracker::GetRevision(ChangeTracker::ikGroup) == ChangeTracker::GetRevision());
+	REQUIRE(ChangeTracker::GetRevision(ChangeTracker::ikFile) == ChangeTracker::GetRevision());
+	REQUIRE(ChangeTracker::GetRevision(ChangeTracker::ikHistory) == ChangeTracker::GetRevision());
+}
@@ -0,0 +1,180 @@
+/*
+ *  This file is part of nzbget. See <http://nzbget.net>.
+ *
+ *  Copyright (C) 2016 Andrey Prygunkov <hugbug@users.sourceforge.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "nzbget.h"
+
+#include "catch.h"
+
+#include "DiskState.h"
+#include "Options.h"
+#include "FileSystem.h"
+#include "TestUtil.h"
+
+class StateQueue : public DownloadQueue
+{
+public:
+	StateQueue() { Init(this); }
+	virtual bool EditEntry(int ID, EEditAction action, const char* args) { return false; }
+	virtual bool EditList(IdList* idList, NameList* nameList, EMatchMode matchMode, EEditAction action, const char* args) { return false; }
+	virtual void HistoryChanged() {}
+	virtual void Save() {}
+	virtual void SaveChanged() {}
+};
+
+std::unique_ptr<NzbInfo> MakeStateNzb(int num, int fileCount)
+{
+	std::unique_ptr<NzbInfo> nzbInfo = std::make_unique<NzbInfo>();
+	nzbInfo->SetName(CString::FormatStr("Some.Nzb.Name.%i", num));
+	nzbInfo->SetFilename(CString::FormatStr("/downloads/nzb/Some.Nzb.Name.%i.nzb", num));
+	nzbInfo->SetDestDir(CString::FormatStr("/downloads/inter/Some.Nzb.Name.%i", num));
+	nzbInfo->SetCategory("movies");
+
+	for (int i = 0; i < fileCount; i++)
+	{
+		std::unique_ptr<FileInfo> fileInfo = std::make_unique<FileInfo>();
+		fileInfo->SetNzbInfo(nzbInfo.get());
+		fileInfo->SetSubject(CString::FormatStr("\"some.file.name.part%03i.rar\" yEnc (1/10)", i));
+		fileInfo->SetFilename(CString::FormatStr("some.file.name.part%03i.rar", i));
+		fileInfo->SetSize(7000000);
+		fileInfo->SetTotalArticles(10);
+		for (int k = 0; k < 10; k++)
+		{
+			std::unique_ptr<ArticleInfo> article = std::make_unique<ArticleInfo>();
+			article->SetPartNumber(k + 1);
+			article->SetMessageId(CString::FormatStr("part%iof10.%i.%i@news.example.com", k + 1, num, i));
+			article->SetSize(700000);
+			fileInfo->GetArticles()->push_back(std::move(article));
+		}
+		fileInfo->GetGroups()->push_back("alt.binaries.test");
+		nzbInfo->GetFileList()->Add(std::move(fileInfo));
+	}
+
+	nzbInfo->SetFileCount(fileCount);
+	nzbInfo->UpdateCurrentStats();
+	return nzbInfo;
+}
+
+void SaveStateQueue(int nzbCount, int fileCount, int historyCount)
+{
+	StateQueue queue;
+	for (int i = 0; i < nzbCount; i++)
+	{
+		queue.GetQueue()->Add(MakeStateNzb(i, fileCount));
+	}
+	for (int i = 0; i < historyCount; i++)
+	{
+		queue.GetHistory()->Add(std::make_unique<HistoryInfo>(MakeStateNzb(nzbCount + i, 0)));
+	}
+
+	DiskState diskState;
+	diskState.StartWriter();
+	for (NzbInfo* nzbInfo : queue.GetQueue())
+	{
+		for (FileInfo* fileInfo : nzbInfo->GetFileList())
+		{
+			REQUIRE(diskState.SaveFile(fileInfo));
+		}
+	}
+	REQUIRE(diskState.SaveDownloadQueue(&queue, true));
+	REQUIRE(diskState.SaveAllFileInfos(&queue));
+	diskState.StopWriter();
+}
+
+TEST_CASE("DiskState: queue and history", "[DiskState][Quick]")
+{
+	TestUtil::PrepareWorkingDir("nzbfile");
+	std::string queueDir(TestUtil::WorkingDir() + "/queue");
+	FileSystem::CreateDirectory(queueDir.c_str());
+
+	CString queueOpt = CString::FormatStr("QueueDir=%s", queueDir.c_str());
+	Options::CmdOptList cmdOpts;
+	cmdOpts.push_back(queueOpt);
+	Options options(&cmdOpts, nullptr);
+	Servers servers;
+
+	SaveStateQueue(3, 4, 5);
+
+	StateQueue queue;
+	DiskState diskState;
+	diskState.StartWriter();
+	REQUIRE(diskState.LoadDownloadQueue(&queue, &servers));
+	diskState.StopWriter();
+
+	REQUIRE(queue.GetQueue()->size() == 3);
+	for (int i = 0; i < 3; i++)
+	{
+		NzbInfo* nzbInfo = queue.GetQueue()->at(i).get();
+		REQUIRE(std::string(nzbInfo->GetName()) == std::string(CString::FormatStr("Some.Nzb.Name.%i", i)));
+		REQUIRE(nzbInfo->GetFileList()->size() == 4);
+		REQUIRE(nzbInfo->GetRemainingSize() == 4 * 7000000);
+		FileInfo* fileInfo = nzbInfo->GetFileList()->at(2).get();
+		REQUIRE(std::string(fileInfo->GetFilename()) == "some.file.name.part002.rar");
+		REQUIRE(diskState.LoadArticles(fileInfo));
+		REQUIRE(fileInfo->GetArticles()->size() == 10);
+	}
+
+	REQUIRE(queue.GetHistory()->size() == 5);
+	for (int i = 0; i < 5; i++)
+	{
+		HistoryInfo* historyInfo = queue.GetHistory()->at(i).get();
+		REQUIRE(std::string(historyInfo->GetName()) == std::string(CString::FormatStr("Some.Nzb.Name.%i", 3 + i)));
+	}
+}
+
+// Hidden from the default run; start with: nzbget --tests "[Benchmark]" -d yes
+// Compares loading of a big history with creating the same items in memory.
+TEST_CASE("DiskState: loading benchmark", "[DiskState][Benchmark][.]")
+{
+	const int nzbCount = 100;
+	const int fileCount = 100;
+	const int historyCount = 100000;
+
+	TestUtil::PrepareWorkingDir("nzbfile");
+	std::string queueDir(TestUtil::WorkingDir() + "/queue");
+	FileSystem::CreateDirectory(queueDir.c_str());
+
+	CString queueOpt = CString::FormatStr("QueueDir=%s", queueDir.c_str());
+	Options::CmdOptList cmdOpts;
+	cmdOpts.push_back(queueOpt);
+	Options options(&cmdOpts, nullptr);
+	Servers servers;
+
+	SaveStateQueue(nzbCount, fileCount, historyCount);
+
+	SECTION("loading from disk")
+	{
+		StateQueue queue;
+		DiskState diskState;
+		diskState.StartWriter();
+		REQUIRE(diskState.LoadDownloadQueue(&queue, &servers));
+		diskState.StopWriter();
+		REQUIRE(queue.GetHistory()->size() == historyCount);
+	}
+
+	SECTION("creating in memory")
+	{
+		StateQueue queue;
+		for (int i = 0; i < historyCount; i++)
+		{
+			queue.GetHistory()->Add(std::make_unique<HistoryInfo>(MakeStateNzb(nzbCount + i, 0)));
+		}
+		REQUIRE(queue.GetHistory()->size() == historyCount);
+	}
+}
@@ -0,0 +1,110 @@
+/*
+ *  This file is part of nzbget. See <http://nzbget.net>.
+ *
+ *  Copyright (C) 2007-2016 Andrey Prygunkov <hugbug@users.sourceforge.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "nzbget.h"
+
+#include "catch.h"
+
+#include "DupeCoordinator.h"
+
+class DupeDownloadQueue : public DownloadQueue
+{
+public:
+	// history changes are reported to dupe coordinator only after the queue is loaded
+	DupeDownloadQueue() { Loaded(); }
+	virtual bool EditEntry(int ID, EEditAction action, const char* args) { return false; }
+	virtual bool EditList(IdList* idList, NameList* nameList, EMatchMode matchMode,
+		EEditAction action, const char* args) { return false; }
+	virtual void HistoryChanged() {}
+	virtual void Save() {}
+	virtual void SaveChanged() {}
+};
+
+static HistoryInfo* AddNzbHistory(DupeCoordinator* dupeCoordinator, DownloadQueue* downloadQueue,
+	const char* name, const char* dupeKey)
+{
+	std::unique_ptr<NzbInfo> nzbInfo = std::make_unique<NzbInfo>();
+	nzbInfo->SetName(name);
+	nzbInfo->SetDupeKey(dupeKey);
+	std::unique_ptr<HistoryInfo> historyInfo = std::make_unique<HistoryInfo>(std::move(nzbInfo));
+	HistoryInfo* result = historyInfo.get();
+	downloadQueue->GetHistory()->Add(std::move(historyInfo), true);
+	dupeCoordinator->HistoryAdded(downloadQueue, result);
+	return result;
+}
+
+static HistoryInfo* AddDupHistory(DupeCoordinator* dupeCoordinator, DownloadQueue* downloadQueue,
+	const char* name, const char* dupeKey, DupInfo::EStatus status)
+{
+	std::unique_ptr<DupInfo> dupInfo = std::make_unique<DupInfo>();
+	dupInfo->SetId(NzbInfo::GenerateId());
+	dupInfo->SetName(name);
+	dupInfo->SetDupeKey(dupeKey);
+	dupInfo->SetStatus(status);
+	std::unique_ptr<HistoryInfo> historyInfo = std::make_unique<HistoryInfo>(std::move(dupInfo));
+	HistoryInfo* result = historyInfo.get();
+	downloadQueue->GetHistory()->Add(std::move(historyInfo), true);
+	dupeCoordinator->HistoryAdded(downloadQueue, result);
+	return result;
+}
+
+TEST_CASE("DupeCoordinator: history dupes", "[DupeCoordinator][Quick]")
+{
+	DupeCoordinator dupeCoordinator;
+	DupeDownloadQueue downloadQueue;
+
+	HistoryInfo* show1 = AddNzbHistory(&dupeCoordinator, &downloadQueue, "Show.S01E01.720p", "");
+	AddNzbHistory(&dupeCoordinator, &downloadQueue, "Other.Show", "tvdb=2-1-1");
+	HistoryInfo* show2 = AddNzbHistory(&dupeCoordinator, &downloadQueue, "Show.S01E01.1080p", "tvdb=1-1-1");
+	AddDupHistory(&dupeCoordinator, &downloadQueue, "Movie", "", DupInfo::dsSuccess);
+
+	NzbInfo nzbInfo;
+	nzbInfo.SetName("show.s01e01.720p");
+	RawNzbList dupes = dupeCoordinator.ListHistoryDupes(&downloadQueue, &nzbInfo);
+	REQUIRE(dupes.size() == 1);
+	REQUIRE(dupes[0] == show1->GetNzbInfo());
+
+	// items without dupe key are matched by name, other items by dupe key;
+	// the list follows the order of history
+	nzbInfo.SetDupeKey("TVDB=1-1-1");
+	dupes = dupeCoordinator.ListHistoryDupes(&downloadQueue, &nzbInfo);
+	REQUIRE(dupes.size() == 2);
+	REQUIRE(dupes[0] == show2->GetNzbInfo());
+	REQUIRE(dupes[1] == show1->GetNzbInfo());
+
+	REQUIRE(dupeCoordinator.GetDupeStatus(&downloadQueue, "movie", "") == DupeCoordinator::dsSuccess);
+	REQUIRE(dupeCoordinator.GetDupeStatus(&downloadQueue, "Movie 2", "") == DupeCoordinator::dsNone);
+
+	// deleted items are no longer reported
+	downloadQueue.GetHistory()->Remove(show2);
+	dupes = dupeCoordinator.ListHistoryDupes(&downloadQueue, &nzbInfo);
+	REQUIRE(dupes.size() == 1);
+	REQUIRE(dupes[0] == show1->GetNzbInfo());
+
+	// renamed items are found by their new names
+	show1->GetNzbInfo()->SetName("Show.S01E02.720p");
+	dupeCoordinator.HistoryUpdated(&downloadQueue, show1);
+	dupes = dupeCoordinator.ListHistoryDupes(&downloadQueue, &nzbInfo);
+	REQUIRE(dupes.size() == 0);
+	nzbInfo.SetName("Show.S01E02.720p");
+	dupes = dupeCoordinator.ListHistoryDupes(&downloadQueue, &nzbInfo);
+	REQUIRE(dupes.size() == 1);
+	REQUIRE(dupes[0] == show1->GetNzbInfo());
+}
@@ -0,0 +1,187 @@
+/*
+ *  This file is part of nzbget. See <http://nzbget.net>.
+ *
+ *  Copyright (C) 2016 Andrey Prygunkov <hugbug@users.sourceforge.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "nzbget.h"
+
+#include "catch.h"
+
+#include "Container.h"
+
+class Item
+{
+public:
+	Item(int id) : m_id(id) {}
+	int GetId() { m_idReads++; return m_id; }
+	static int m_idReads;
+
+private:
+	int m_id;
+};
+
+int Item::m_idReads = 0;
+
+typedef UniqueDeque<Item> ItemList;
+
+TEST_CASE("UniqueDeque: find by id", "[Container][Quick]")
+{
+	ItemList items;
+	for (int i = 1; i <= 10; i++)
+	{
+		items.Add(std::make_unique<Item>(i));
+	}
+
+	REQUIRE(items.Find(5) == items[4].get());
+	REQUIRE(items.Find(11) == nullptr);
+
+	// the index is updated on modifications
+	items.Add(std::make_unique<Item>(11), true);
+	REQUIRE(items.Find(11) == items[0].get());
+
+	Item* item3 = items.Find(3);
+	std::unique_ptr<Item> removed = items.Remove(item3);
+	REQUIRE(removed.get() == item3);
+	REQUIRE(items.Find(3) == nullptr);
+
+	items.erase(items.begin() + 1);
+	REQUIRE(items.Find(1) == nullptr);
+	REQUIRE(items.Find(2) == items[1].get());
+
+	items.insert(items.begin() + 1, std::move(removed));
+	REQUIRE(items.Find(3) == items[1].get());
+
+	items.Replace(items.begin() + 1, std::make_unique<Item>(12));
+	REQUIRE(items.Find(3) == nullptr);
+	REQUIRE(items.Find(12) == items[1].get());
+
+	items.clear();
+	REQUIRE(items.Find(12) == nullptr);
+}
+
+TEST_CASE("UniqueDeque: index recovery", "[Container][Quick]")
+{
+	ItemList items;
+	for (int i = 1; i <= 5; i++)
+	{
+		items.Add(std::make_unique<Item>(i));
+	}
+	REQUIRE(items.Find(1) == items[0].get());
+
+	// moving an item to another position
+	std::unique_ptr<Item> moved = std::move(items[0]);
+	items.erase(items.begin());
+	items.insert(items.begin() + 2, std::move(moved));
+	REQUIRE(items.Find(1) == items[2].get());
+	REQUIRE(items.Find(4) == items[3].get());
+
+	// sorting doesn't change the index
+	std::sort(items.begin(), items.end(),
+		[](const std::unique_ptr<Item>& item1, const std::unique_ptr<Item>& item2)
+		{
+			return item1->GetId() > item2->GetId();
+		});
+	REQUIRE(items.Find(5) == items[0].get());
+	REQUIRE(items.Find(1) == items[4].get());
+}
+
+TEST_CASE("UniqueDeque: positions", "[Container][Quick]")
+{
+	ItemList items;
+	for (int i = 1; i <= 10; i++)
+	{
+		items.Add(std::make_unique<Item>(i));
+	}
+
+	REQUIRE(items.Locate(4) == items.begin() + 3);
+	REQUIRE(items.Locate(11) == items.end());
+
+	// inserting and erasing near both ends shifts the positions
+	items.Add(std::make_unique<Item>(11), true);
+	items.erase(items.begin() + 2);
+	items.erase(items.end() - 2);
+	items.insert(items.begin() + 1, std::make_unique<Item>(12));
+	items.insert(items.end() - 1, std::make_unique<Item>(13));
+
+	for (int i = 0; i < (int)items.size(); i++)
+	{
+		REQUIRE(items.Locate(items[i]->GetId()) == items.begin() + i);
+		REQUIRE(items.Find(items[i].get()) == items.begin() + i);
+	}
+	REQUIRE(items.Find(2) == nullptr);
+	REQUIRE(items.Find(9) == nullptr);
+
+	items.Move(1, 8);
+	REQUIRE(items[8]->GetId() == 12);
+	items.Move(9, 0);
+	REQUIRE(items[0]->GetId() == 13);
+
+	for (int i = 0; i < (int)items.size(); i++)
+	{
+		REQUIRE(items.Locate(items[i]->GetId()) == items.begin() + i);
+	}
+}
+
+TEST_CASE("UniqueDeque: items added bypassing the index", "[Container][Quick]")
+{
+	ItemList items;
+	for (int i = 1; i <= 5; i++)
+	{
+		items.Add(std::make_unique<Item>(i));
+	}
+	REQUIRE(items.Find(3) == items[2].get());
+
+	items.ItemList::Base::push_back(std::make_unique<Item>(6));
+	items.ItemList::Base::push_front(std::make_unique<Item>(7));
+
+	REQUIRE(items.Find(6) == items[6].get());
+	REQUIRE(items.Find(7) == items[0].get());
+	REQUIRE(items.Locate(3) == items.begin() + 3);
+	REQUIRE(items.Find(8) == nullptr);
+}
+
+TEST_CASE("UniqueDeque: bulk delete", "[Container][Quick]")
+{
+	const int count = 50000;
+	ItemList items;
+	for (int i = 1; i <= count; i++)
+	{
+		items.Add(std::make_unique<Item>(i));
+	}
+	REQUIRE(items.Find(1) == items[0].get());
+
+	// the index is only read while items are released, "Compact" removes them
+	// in one pass and the index is built once again
+	Item::m_idReads = 0;
+	for (int id = 7; id <= count; id += 7)
+	{
+		ItemList::iterator it = items.Locate(id);
+		REQUIRE(it != items.end());
+		it->reset();
+	}
+	items.Compact();
+	REQUIRE(items.Find(2) == items[1].get());
+	REQUIRE(Item::m_idReads < count * 2);
+
+	REQUIRE((int)items.size() == count - count / 7);
+	for (int i = 0; i < (int)items.size(); i++)
+	{
+		REQUIRE((items[i]->GetId() % 7) != 0);
+		REQUIRE(items.Locate(items[i]->GetId()) == items.begin() + i);
+	}
+}
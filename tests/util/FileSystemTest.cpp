@@ -23,6 +23,7 @@
 #include "catch.h"
 
 #include "FileSystem.h"
+#include "TestUtil.h"
 
 #ifdef WIN32
 TEST_CASE("FileSystem: MakeCanonicalPath", "[FileSystem][Quick]")
@@ -37,3 +38,53 @@ TEST_CASE("FileSystem: MakeCanonicalPath", "[FileSystem][Quick]")
 	REQUIRE(!strcmp(FileSystem::MakeCanonicalPath("\\\\server\\Program Files\\NZBGet\\scripts\\email\\..\\..\\"), "\\\\server\\Program Files\\NZBGet\\"));
 }
 #endif
+
+TEST_CASE("FileSystem: BatchFileWriter", "[FileSystem][Quick]")
+{
+	TestUtil::PrepareWorkingDir("nzbfile");
+	std::string filename(TestUtil::WorkingDir() + "/batch.out");
+
+	const int blockSize = 1000;
+	const int blockCount = 200;
+	CString errmsg;
+	REQUIRE(FileSystem::AllocateFile(filename.c_str(), blockSize * blockCount, false, errmsg));
+
+	CharBuffer data(blockSize * blockCount);
+	for (int i = 0; i < blockCount; i++)
+	{
+		memset(data + i * blockSize, 'a' + i % 26, blockSize);
+	}
+
+	// blocks are written in reverse order and flushed in two batches
+	BatchFileWriter writer;
+	REQUIRE(writer.Open(filename.c_str()));
+	for (int i = blockCount - 1; i >= 0; i--)
+	{
+		writer.Write(data + i * blockSize, blockSize, (int64)i * blockSize);
+		if (i == blockCount / 2)
+		{
+			REQUIRE(writer.Flush());
+		}
+	}
+	REQUIRE(writer.Close());
+
+	CharBuffer content;
+	REQUIRE(FileSystem::LoadFileIntoBuffer(filename.c_str(), content, false));
+	REQUIRE(content.Size() == blockSize * blockCount);
+	REQUIRE(!memcmp(content, data, data.Size()));
+
+	// the writer is reused for another file
+	std::string filename2(TestUtil::WorkingDir() + "/batch2.out");
+	REQUIRE(FileSystem::AllocateFile(filename2.c_str(), blockSize * blockCount, false, errmsg));
+	REQUIRE(writer.Open(filename2.c_str()));
+	for (int i = 0; i < blockCount; i++)
+	{
+		writer.Write(data + i * blockSize, blockSize, (int64)i * blockSize);
+	}
+	REQUIRE(writer.Sync(errmsg));
+	REQUIRE(writer.Close());
+
+	REQUIRE(FileSystem::LoadFileIntoBuffer(filename2.c_str(), content, false));
+	REQUIRE(content.Size() == blockSize * blockCount);
+	REQUIRE(!memcmp(content, data, data.Size()));
+}
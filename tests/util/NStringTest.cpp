@@ -176,6 +176,14 @@ TEST_CASE("StringBuilder", "[NString][Quick]")
 	str6.Append("String5String5");
 	str6.Append("67");
 	REQUIRE(!strcmp(str6, "Hello, WorldString5String567"));
+
+	int capacity = str6.Capacity();
+	str6.Reset();
+	REQUIRE(str6.Empty());
+	REQUIRE(!strcmp(str6, ""));
+	REQUIRE(str6.Capacity() == capacity);
+	str6.Append("Hello");
+	REQUIRE(!strcmp(str6, "Hello"));
 }
 
 TEST_CASE("CharBuffer", "[NString][Quick]")
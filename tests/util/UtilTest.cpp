@@ -118,3 +118,51 @@ TEST_CASE("Util: RegEx", "[Util][Quick]")
 	REQUIRE(seasonEpisode.GetMatchStart(1) == 14);
 	REQUIRE(seasonEpisode.GetMatchLen(1) == 2);
 }
+
+#ifndef DISABLE_GZIP
+TEST_CASE("ZLib: GZipStream", "[Util][Quick]")
+{
+	StringBuilder data;
+	for (int i = 0; i < 20000; i++)
+	{
+		data.AppendFmt("<value><i4>%i</i4></value>\n", i);
+	}
+
+	// compress in parts
+	std::vector<char> compressed;
+	GZipStream gzipStream(1024);
+	const int partSize = 10000;
+	for (int pos = 0; pos < data.Length(); pos += partSize)
+	{
+		bool finish = pos + partSize >= data.Length();
+		gzipStream.Write(data + pos, std::min(partSize, data.Length() - pos), finish);
+
+		GZipStream::EStatus status;
+		int outLen;
+		do
+		{
+			const void* outBuf;
+			status = gzipStream.Read(&outBuf, &outLen);
+			REQUIRE(status != GZipStream::zlError);
+			compressed.insert(compressed.end(), (const char*)outBuf, (const char*)outBuf + outLen);
+		} while (finish ? status != GZipStream::zlFinished : outLen > 0);
+	}
+	REQUIRE((int)compressed.size() < data.Length() / 4);
+
+	std::vector<char> uncompressed;
+	GUnzipStream gunzipStream(1024 * 10);
+	gunzipStream.Write(compressed.data(), compressed.size());
+	GUnzipStream::EStatus status;
+	do
+	{
+		const void* outBuf;
+		int outLen;
+		status = gunzipStream.Read(&outBuf, &outLen);
+		REQUIRE(status != GUnzipStream::zlError);
+		uncompressed.insert(uncompressed.end(), (const char*)outBuf, (const char*)outBuf + outLen);
+	} while (status != GUnzipStream::zlFinished);
+
+	REQUIRE((int)uncompressed.size() == data.Length());
+	REQUIRE(!memcmp(uncompressed.data(), data, data.Length()));
+}
+#endif